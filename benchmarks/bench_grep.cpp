@@ -0,0 +1,136 @@
+/**
+ * 代码搜索基准：进程内 GrepEngine 与外部 rg / grep 子进程（GrepTool 旧实现的做法）在同一语料上的耗时对比。
+ * 每个模式分别测 max_results=200（GrepTool 默认，可提前终止）与不限条数（完整扫描），并报告扫描吞吐。
+ * 外部命令的耗时包含 shell + 进程启动 + 读完全部输出，与旧实现一致；系统没有 rg / grep 时只测进程内实现。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_grep
+ * 运行：./bench_grep [corpusDir=.] [iterations=5] [pattern ...]
+ */
+#include "tools/GrepEngine.h"
+#include "utils/ScanIgnore.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static std::string shellQuote(const std::string& s) {
+    std::string out = "'";
+    for (char c : s) {
+        if (c == '\'') out += "'\\''";
+        else out += c;
+    }
+    return out + "'";
+}
+
+static std::string findExternal() {
+#ifdef _WIN32
+    return "";
+#else
+    for (const char* tool : {"rg", "grep"}) {
+        std::string cmd = std::string("command -v ") + tool + " >/dev/null 2>&1";
+        if (std::system(cmd.c_str()) == 0) return tool;
+    }
+    return "";
+#endif
+}
+
+// 与旧 GrepTool 相同：shell 启动外部命令、读完全部输出，返回匹配行数
+static size_t runExternal(const std::string& tool, const fs::path& root, const std::string& pattern) {
+#ifdef _WIN32
+    (void)tool; (void)root; (void)pattern;
+    return 0;
+#else
+    std::string cmd = tool == "rg"
+        ? "rg -n --no-heading -e " + shellQuote(pattern) + " " + shellQuote(root.string()) + " 2>/dev/null"
+        : "grep -rnEI --exclude-dir=.git --exclude-dir=build -e " + shellQuote(pattern) + " " +
+              shellQuote(root.string()) + " 2>/dev/null";
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) return 0;
+    std::array<char, 65536> buf;
+    size_t lines = 0, n;
+    while ((n = fread(buf.data(), 1, buf.size(), pipe)) > 0) lines += std::count(buf.begin(), buf.begin() + n, '\n');
+    pclose(pipe);
+    return lines;
+#endif
+}
+
+int main(int argc, char** argv) {
+    fs::path root = argc > 1 ? fs::path(argv[1]) : fs::path(".");
+    int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+    std::vector<std::string> patterns;
+    for (int i = 3; i < argc; ++i) patterns.emplace_back(argv[i]);
+    if (patterns.empty()) patterns = {"std::string", "TODO", "class \\w+Tool", "nlohmann::json\\s+\\w+\\("};
+
+    ScanIgnoreRules ignore({"build", "_gate_build", "node_modules", "third_party"});
+    const std::string external = findExternal();
+
+    std::cout << "corpus: " << fs::absolute(root).string() << ", iterations: " << iterations
+              << ", external: " << (external.empty() ? "(none)" : external) << "\n\n";
+    std::cout << std::left << std::setw(28) << "pattern" << std::right << std::setw(12) << "engine@200" << std::setw(12)
+              << "engine@all" << std::setw(10) << "matches" << std::setw(10) << "MB/s" << std::setw(12) << "external"
+              << std::setw(10) << "matches" << std::setw(10) << "speedup" << "\n";
+
+    for (const auto& pattern : patterns) {
+        GrepEngine::Options limited;
+        GrepEngine::Options unlimited;
+        unlimited.maxResults = static_cast<size_t>(-1);
+
+        // 预热一次，使各实现都在页缓存命中的情况下比较
+        auto warm = GrepEngine::search(root, ".", pattern, unlimited, &ignore);
+        if (!warm.error.empty()) {
+            std::cout << std::left << std::setw(28) << pattern << "  " << warm.error << "\n";
+            continue;
+        }
+        if (!external.empty()) runExternal(external, root, pattern);
+
+        double limitedMs = 0, fullMs = 0, externalMs = 0;
+        size_t fullMatches = 0, bytes = 0, externalMatches = 0;
+        for (int it = 0; it < iterations; ++it) {
+            auto t0 = Clock::now();
+            GrepEngine::search(root, ".", pattern, limited, &ignore);
+            limitedMs += msSince(t0);
+
+            t0 = Clock::now();
+            auto full = GrepEngine::search(root, ".", pattern, unlimited, &ignore);
+            fullMs += msSince(t0);
+            fullMatches = full.matches.size();
+            bytes = full.bytesScanned;
+
+            if (!external.empty()) {
+                t0 = Clock::now();
+                externalMatches = runExternal(external, root, pattern);
+                externalMs += msSince(t0);
+            }
+        }
+        limitedMs /= iterations;
+        fullMs /= iterations;
+        externalMs /= iterations;
+        const double mbps = fullMs > 0 ? (bytes / 1048576.0) / (fullMs / 1000.0) : 0;
+
+        std::string label = pattern.size() > 26 ? pattern.substr(0, 23) + "..." : pattern;
+        std::cout << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << limitedMs << "ms" << std::setw(10) << fullMs << "ms" << std::setw(10)
+                  << fullMatches << std::setw(10) << std::setprecision(0) << mbps << std::setprecision(2);
+        if (!external.empty()) {
+            std::cout << std::setw(10) << externalMs << "ms" << std::setw(10) << externalMatches << std::setw(9)
+                      << (limitedMs > 0 ? externalMs / limitedMs : 0) << "x";
+        }
+        std::cout << "\n";
+    }
+    std::cout << "\nspeedup = external / engine@200（GrepTool 的默认调用形态）。"
+                 "外部命令不使用项目忽略规则，匹配数可能不同。\n";
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * LLMClient 连接池基准：本机启动 TLS mock 服务（运行时用 OpenSSL 生成自签名证书，客户端关闭证书校验），
+ * 对比「每次请求新建连接」「仅复用 TLS 会话」「keep-alive 连接池」三种模式下 chat / embedding 的单次延迟。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_llm_connection_pool
+ * 运行：./bench_llm_connection_pool [calls=200]
+ */
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "httplib.h"
+
+#include "core/LLMClient.h"
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// 生成 RSA-2048 自签名证书（CN=127.0.0.1），写入 PEM 文件
+static bool writeSelfSignedCert(const fs::path& certPath, const fs::path& keyPath) {
+    EVP_PKEY* pkey = nullptr;
+    EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    if (!kctx || EVP_PKEY_keygen_init(kctx) <= 0 || EVP_PKEY_CTX_set_rsa_keygen_bits(kctx, 2048) <= 0 ||
+        EVP_PKEY_keygen(kctx, &pkey) <= 0) {
+        EVP_PKEY_CTX_free(kctx);
+        return false;
+    }
+    EVP_PKEY_CTX_free(kctx);
+
+    X509* x509 = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 24L * 3600L);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME* name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("127.0.0.1"), -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    bool ok = X509_sign(x509, pkey, EVP_sha256()) > 0;
+
+    FILE* f = ok ? std::fopen(keyPath.string().c_str(), "wb") : nullptr;
+    ok = f && PEM_write_PrivateKey(f, pkey, nullptr, nullptr, 0, nullptr, nullptr);
+    if (f) std::fclose(f);
+    f = ok ? std::fopen(certPath.string().c_str(), "wb") : nullptr;
+    ok = f && PEM_write_X509(f, x509);
+    if (f) std::fclose(f);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+    return ok;
+}
+
+struct Latency {
+    double mean = 0, p50 = 0, p95 = 0;
+};
+
+static Latency summarize(std::vector<double> ms) {
+    Latency l;
+    if (ms.empty()) return l;
+    std::sort(ms.begin(), ms.end());
+    for (double v : ms) l.mean += v;
+    l.mean /= static_cast<double>(ms.size());
+    l.p50 = ms[ms.size() / 2];
+    l.p95 = ms[std::min(ms.size() - 1, ms.size() * 95 / 100)];
+    return l;
+}
+
+int main(int argc, char** argv) {
+    int calls = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    fs::path dir = fs::temp_directory_path() / "photon_bench_llm_pool";
+    fs::create_directories(dir);
+    fs::path certPath = dir / "cert.pem";
+    fs::path keyPath = dir / "key.pem";
+    if (!writeSelfSignedCert(certPath, keyPath)) {
+        std::cerr << "failed to generate self-signed certificate" << std::endl;
+        return 1;
+    }
+
+    httplib::SSLServer server(certPath.string().c_str(), keyPath.string().c_str());
+    if (!server.is_valid()) {
+        std::cerr << "failed to start TLS server" << std::endl;
+        return 1;
+    }
+    server.set_tcp_nodelay(true);
+    server.Post("/v1/chat/completions", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(R"({"choices":[{"message":{"role":"assistant","content":"pong"}}]})", "application/json");
+    });
+    server.Post("/v1/embeddings", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(R"({"data":[{"embedding":[0.1,0.2,0.3,0.4]}]})", "application/json");
+    });
+    int port = server.bind_to_any_port("127.0.0.1");
+    std::thread serverThread([&] { server.listen_after_bind(); });
+    server.wait_until_ready();
+
+    struct Mode {
+        const char* name;
+        size_t maxPerHost;
+        bool sessionReuse;
+    };
+    const Mode modes[] = {
+        {"new connection per call", 0, false},
+        {"new connection + TLS resume", 0, true},
+        {"keep-alive pool", 4, true},
+    };
+
+    std::cout << "calls per mode: " << calls << " (chat + embedding alternating), TLS mock on 127.0.0.1:" << port
+              << "\n\n";
+    std::cout << std::left << std::setw(30) << "mode" << std::right << std::setw(10) << "mean ms" << std::setw(10)
+              << "p50 ms" << std::setw(10) << "p95 ms" << std::setw(12) << "handshakes" << std::setw(10) << "resumed"
+              << "\n";
+    for (const auto& mode : modes) {
+        LLMClient client("bench_key", "https://127.0.0.1:" + std::to_string(port) + "/v1", "bench_model");
+        HttpClientPool::Options opts;
+        opts.maxPerHost = mode.maxPerHost;
+        opts.tlsSessionReuse = mode.sessionReuse;
+        opts.verifyCertificate = false;
+        client.configureConnectionPool(opts);
+
+        client.chat("warmup");  // 首次握手（以及会话票据）不计入
+        std::vector<double> ms;
+        ms.reserve(static_cast<size_t>(calls));
+        for (int i = 0; i < calls; ++i) {
+            auto t0 = Clock::now();
+            bool ok = (i % 2 == 0) ? !client.chat("ping").empty() : !client.getEmbedding("ping").empty();
+            auto t1 = Clock::now();
+            if (!ok) {
+                std::cerr << "request failed in mode: " << mode.name << std::endl;
+                break;
+            }
+            ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+        }
+        auto lat = summarize(ms);
+        auto stats = client.getConnectionPool()->getStats();
+        std::cout << std::left << std::setw(30) << mode.name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(10) << lat.mean << std::setw(10) << lat.p50 << std::setw(10) << lat.p95
+                  << std::setw(12) << stats.tlsHandshakes << std::setw(10) << stats.tlsResumed << "\n";
+    }
+
+    server.stop();
+    serverThread.join();
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return 0;
+}
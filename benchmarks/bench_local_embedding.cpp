@@ -0,0 +1,115 @@
+/**
+ * LocalEmbeddingProvider 基准：索引吞吐（chunk/s、MB/s）与查询延迟（p50/p95）。
+ * 语料为临时目录中生成的 markdown + C++ 文件；不联网。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_local_embedding
+ * 运行：./bench_local_embedding [files=400] [queries=200]
+ */
+#include "analysis/SemanticManager.h"
+#include "analysis/providers/LocalEmbeddingProvider.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static const char* kWords[] = {
+    "parse", "buffer", "symbol", "index", "request", "client", "session", "token", "context", "patch",
+    "render", "scheduler", "cache", "embedding", "graph", "caller", "callee", "file", "line", "range",
+    "stream", "socket", "retry", "timeout", "summary", "config", "manager", "provider", "query", "result"};
+
+static std::string makeIdentifier(std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> pick(0, sizeof(kWords) / sizeof(kWords[0]) - 1);
+    std::string a = kWords[pick(rng)];
+    std::string b = kWords[pick(rng)];
+    b[0] = static_cast<char>(b[0] - 'a' + 'A');
+    return a + b;
+}
+
+static std::string makeMarkdown(std::mt19937& rng, int sections) {
+    std::string out;
+    for (int s = 0; s < sections; ++s) {
+        out += "## " + makeIdentifier(rng) + " overview\n";
+        for (int p = 0; p < 6; ++p) {
+            out += "The " + makeIdentifier(rng) + " component forwards each " + makeIdentifier(rng) +
+                   " to the " + makeIdentifier(rng) + " before the " + makeIdentifier(rng) + " expires.\n";
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    int fileCount = argc > 1 ? std::atoi(argv[1]) : 400;
+    int queryCount = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    fs::path root = fs::temp_directory_path() / "photon_bench_local_embedding";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "docs");
+
+    std::mt19937 rng(42);
+    size_t corpusBytes = 0;
+    for (int i = 0; i < fileCount; ++i) {
+        std::string md = makeMarkdown(rng, 8);
+        corpusBytes += md.size();
+        std::ofstream(root / "docs" / ("doc_" + std::to_string(i) + ".md")) << md;
+    }
+
+    // 1) 纯 embed 吞吐
+    LocalEmbeddingProvider provider;
+    std::string sample = makeMarkdown(rng, 1);
+    const int embedIters = 2000;
+    auto t0 = Clock::now();
+    float sink = 0.0f;
+    for (int i = 0; i < embedIters; ++i) sink += provider.embed(sample)[static_cast<size_t>(i) % 384];
+    double embedMs = msSince(t0);
+
+    // 2) 索引吞吐（含分块与缓存写入）
+    SemanticManager mgr(root.u8string(), std::make_unique<LocalEmbeddingProvider>());
+    t0 = Clock::now();
+    for (int i = 0; i < fileCount; ++i) {
+        mgr.indexFile("docs/doc_" + std::to_string(i) + ".md", "markdown");
+    }
+    double indexMs = msSince(t0);
+    auto cacheStats = mgr.getEmbeddingCacheStats();
+
+    // 3) 查询延迟
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(queryCount));
+    size_t totalHits = 0;
+    for (int q = 0; q < queryCount; ++q) {
+        std::string query = "where is the " + makeIdentifier(rng) + " handled";
+        auto tq = Clock::now();
+        auto results = mgr.search(query, 5);
+        latencies.push_back(msSince(tq));
+        totalHits += results.size();
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) { return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "corpus: " << fileCount << " files, " << (corpusBytes / 1024.0 / 1024.0) << " MB\n";
+    std::cout << "embed:  " << (embedIters / (embedMs / 1000.0)) << " texts/s ("
+              << (sample.size() * embedIters / 1024.0 / 1024.0) / (embedMs / 1000.0) << " MB/s)\n";
+    std::cout << "index:  " << cacheStats.misses << " chunks in " << indexMs << " ms -> "
+              << (cacheStats.misses / (indexMs / 1000.0)) << " chunks/s, "
+              << (corpusBytes / 1024.0 / 1024.0) / (indexMs / 1000.0) << " MB/s\n";
+    std::cout << "query:  p50 " << pct(0.50) << " ms, p95 " << pct(0.95) << " ms, max " << pct(1.0)
+              << " ms (" << queryCount << " queries, " << totalHits << " results)\n";
+    if (sink == 12345.0f) std::cout << "";
+    fs::remove_all(root, ec);
+    return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * 预取回放基准：在生成的 C++ 项目上回放一段「模型会话」的工具调用序列，对比关闭 / 开启 ToolPrefetcher 时
+ * read_code_block 的平均延迟、预取命中率和节省的时间。
+ * 会话由两类常见步骤组成：grep 某函数的调用点后读命中所在的函数；读一个函数后顺着调用读它的某个被调用者。
+ * 两次调用之间 sleep thinkMs 模拟模型生成下一条消息的时间（即预取可用的空闲时间）。
+ * 被调用者预测依赖调用图（tree-sitter 提取调用）：这里用只识别生成代码的简单符号提供者，调用图为空，衡量的是 grep 之后的预测；
+ * 在已建好调用图的真实项目上，读函数 → 读被调用者这一类步骤也会命中。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_prefetch_replay
+ * 运行：./bench_prefetch_replay [steps=200] [thinkMs=20] [files=40] [funcsPerFile=30]
+ */
+#include "analysis/SymbolManager.h"
+#include "tools/CoreTools.h"
+#include "tools/ToolPrefetcher.h"
+#include "tools/ToolRegistry.h"
+#include "tools/ToolResultCache.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct Func {
+    std::string file;
+    std::string name;
+    std::vector<size_t> callees;
+};
+
+// 识别生成代码中的函数定义（"int fn_N(int v) {" 到 "}"），给出完整行范围
+class GeneratedFunctionProvider : public ISymbolProvider {
+public:
+    std::vector<Symbol> extractSymbols(const std::string& content, const std::string& relPath) const override {
+        std::vector<Symbol> out;
+        std::istringstream in(content);
+        std::string line;
+        for (int n = 1; std::getline(in, line); ++n) {
+            if (line.rfind("int ", 0) == 0 && line.back() == '{') {
+                Symbol s;
+                s.name = line.substr(4, line.find('(') - 4);
+                s.type = "function";
+                s.source = "bench";
+                s.path = relPath;
+                s.line = n;
+                out.push_back(s);
+            } else if (line == "}" && !out.empty()) {
+                out.back().endLine = n;
+            }
+        }
+        return out;
+    }
+    bool supportsExtension(const std::string& ext) const override { return ext == ".cpp"; }
+};
+
+static std::string funcName(size_t i) { return "fn_" + std::to_string(i); }
+
+// 每个函数调用两个其它函数；函数体填充若干行，使读取有实际开销
+static std::vector<Func> generateProject(const fs::path& root, size_t files, size_t perFile, std::mt19937& rng) {
+    const size_t total = files * perFile;
+    std::vector<Func> funcs(total);
+    std::uniform_int_distribution<size_t> pick(0, total - 1);
+    for (size_t i = 0; i < total; ++i) {
+        funcs[i].file = "src/mod" + std::to_string(i / perFile) + ".cpp";
+        funcs[i].name = funcName(i);
+        for (int k = 0; k < 2; ++k) {
+            size_t c = pick(rng);
+            if (c != i) funcs[i].callees.push_back(c);
+        }
+    }
+    fs::create_directories(root / "src");
+    for (size_t f = 0; f < files; ++f) {
+        std::ofstream out(root / "src" / ("mod" + std::to_string(f) + ".cpp"));
+        for (size_t i = f * perFile; i < (f + 1) * perFile; ++i) {
+            for (size_t c : funcs[i].callees) out << "int " << funcName(c) << "(int v);\n";
+            out << "int " << funcs[i].name << "(int v) {\n";
+            out << "    int acc = v;\n";
+            for (int line = 0; line < 24; ++line) out << "    acc = (acc * 31 + " << line << ") % 1000003;\n";
+            for (size_t c : funcs[i].callees) out << "    acc += " << funcName(c) << "(acc);\n";
+            out << "    return acc;\n}\n\n";
+        }
+    }
+    return funcs;
+}
+
+struct Step {
+    std::string tool;
+    nlohmann::json args;
+};
+
+// grep 调用点 → 读命中所在函数；读函数 → 读它的被调用者
+static std::vector<Step> buildSession(const std::vector<Func>& funcs, size_t steps, std::mt19937& rng) {
+    std::vector<Step> session;
+    std::uniform_int_distribution<size_t> pick(0, funcs.size() - 1);
+    std::uniform_int_distribution<int> coin(0, 1);
+    auto read = [](const Func& f) {
+        return Step{"read_code_block", {{"file_path", f.file}, {"symbol_name", f.name}}};
+    };
+    while (session.size() < steps) {
+        const Func& target = funcs[pick(rng)];
+        if (coin(rng) == 0) {
+            // 找一个调用 target 的函数
+            const Func* caller = nullptr;
+            for (size_t tries = 0; tries < funcs.size() && !caller; ++tries) {
+                const Func& f = funcs[pick(rng)];
+                for (size_t c : f.callees) {
+                    if (funcs[c].name == target.name) caller = &f;
+                }
+            }
+            if (!caller) continue;
+            session.push_back({"grep", {{"pattern", "acc += " + target.name}}});
+            session.push_back(read(*caller));
+        } else {
+            session.push_back(read(target));
+            if (!target.callees.empty()) session.push_back(read(funcs[target.callees[coin(rng) % target.callees.size()]]));
+        }
+    }
+    session.resize(steps);
+    return session;
+}
+
+struct RunResult {
+    double readMs = 0.0;
+    size_t reads = 0;
+    ToolResultCache::Stats cache;
+    ToolPrefetcher::Stats prefetch;
+};
+
+static RunResult replay(const fs::path& root, SymbolManager& symbols, const std::vector<Step>& session, int thinkMs,
+                        bool prefetch) {
+    auto cache = std::make_shared<ToolResultCache>();
+    ToolRegistry registry;
+    registry.registerTool(std::make_unique<ReadCodeBlockTool>(root.u8string(), &symbols));
+    registry.registerTool(std::make_unique<GrepTool>(root.u8string()));
+    registry.setResultCache(cache);
+    std::unique_ptr<ToolPrefetcher> prefetcher;
+    if (prefetch) prefetcher = std::make_unique<ToolPrefetcher>(registry, &symbols);
+
+    RunResult run;
+    for (const auto& step : session) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(thinkMs));
+        auto t0 = Clock::now();
+        nlohmann::json result = registry.executeTool(step.tool, step.args);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (step.tool == "read_code_block") {
+            run.readMs += ms;
+            run.reads++;
+        }
+        if (prefetcher) prefetcher->observe(step.tool, step.args, result);
+    }
+    if (prefetcher) {
+        prefetcher->waitIdle(10000);
+        run.prefetch = prefetcher->getStats();
+    }
+    run.cache = cache->getStats();
+    return run;
+}
+
+int main(int argc, char** argv) {
+    const size_t steps = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    const int thinkMs = argc > 2 ? std::atoi(argv[2]) : 20;
+    const size_t files = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 40;
+    const size_t perFile = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 30;
+
+    fs::path root = fs::temp_directory_path() / "photon_bench_prefetch";
+    fs::remove_all(root);
+    std::mt19937 rng(42);
+    auto funcs = generateProject(root, files, perFile, rng);
+    auto session = buildSession(funcs, steps, rng);
+
+    RunResult off, on;
+    {
+        SymbolManager symbols(root.u8string());
+        symbols.registerProvider(std::make_unique<GeneratedFunctionProvider>());
+        auto t0 = Clock::now();
+        symbols.scanBlocking();
+        std::cout << "project: " << files << " files, " << funcs.size() << " functions, indexed in "
+                  << std::chrono::duration<double, std::milli>(Clock::now() - t0).count() << " ms\n";
+        std::cout << "session: " << session.size() << " calls, think time " << thinkMs << " ms\n\n";
+
+        off = replay(root, symbols, session, thinkMs, false);
+        on = replay(root, symbols, session, thinkMs, true);
+    }
+    fs::remove_all(root);
+
+    auto report = [](const char* label, const RunResult& r) {
+        std::cout << std::left << std::setw(14) << label << std::right << std::fixed << std::setprecision(3)
+                  << "read avg " << std::setw(8) << (r.reads ? r.readMs / r.reads : 0.0) << " ms   cache hits "
+                  << std::setw(4) << r.cache.hits << "/" << (r.cache.hits + r.cache.misses) << "\n";
+    };
+    report("prefetch off", off);
+    report("prefetch on", on);
+    std::cout << std::fixed << std::setprecision(1) << "\nprefetched " << on.cache.prefetched << ", used "
+              << on.cache.prefetchHits << " ("
+              << (on.cache.prefetched ? 100.0 * on.cache.prefetchHits / on.cache.prefetched : 0.0) << "%), saved "
+              << on.cache.prefetchSavedMs << " ms on the critical path, " << on.prefetch.busyMs
+              << " ms spent in background\n";
+    std::cout << "read latency saved: " << (off.readMs - on.readMs) << " ms over " << on.reads << " reads\n";
+    return 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * read_code_block 批量读取基准：20 条混合请求（按符号 / 按行范围，分布在若干文件上，部分文件被多次请求），
+ * 对比逐条调用与 requests 批量模式（按文件分组、一次符号快照、文件间并行）的延迟。
+ * cold 在每轮前清空 FileContentCache（文件内容需重新读盘，页缓存仍命中），warm 为缓存命中时的延迟。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_read_batch
+ * 运行：./bench_read_batch [iterations=50] [files=8] [funcsPerFile=400]
+ */
+#include "analysis/SymbolManager.h"
+#include "tools/CoreTools.h"
+#include "utils/FileContentCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// 识别生成代码中的函数定义（"int fn_N(int v) {" 到 "}"），给出完整行范围
+class GeneratedFunctionProvider : public ISymbolProvider {
+public:
+    std::vector<Symbol> extractSymbols(const std::string& content, const std::string& relPath) const override {
+        std::vector<Symbol> out;
+        std::istringstream in(content);
+        std::string line;
+        for (int n = 1; std::getline(in, line); ++n) {
+            if (line.rfind("int ", 0) == 0 && line.back() == '{') {
+                Symbol s;
+                s.name = line.substr(4, line.find('(') - 4);
+                s.type = "function";
+                s.source = "bench";
+                s.path = relPath;
+                s.line = n;
+                out.push_back(s);
+            } else if (line == "}" && !out.empty()) {
+                out.back().endLine = n;
+            }
+        }
+        return out;
+    }
+    bool supportsExtension(const std::string& ext) const override { return ext == ".cpp"; }
+};
+
+static std::string funcName(size_t file, size_t k) { return "fn_" + std::to_string(file) + "_" + std::to_string(k); }
+
+// 每个函数 12 行；mtime 调到一小时前，使文件内容可以进入缓存
+static void generateProject(const fs::path& root, size_t files, size_t perFile) {
+    fs::create_directories(root / "src");
+    for (size_t f = 0; f < files; ++f) {
+        fs::path path = root / "src" / ("mod" + std::to_string(f) + ".cpp");
+        {
+            std::ofstream out(path);
+            for (size_t k = 0; k < perFile; ++k) {
+                out << "int " << funcName(f, k) << "(int v) {\n";
+                for (int i = 0; i < 10; ++i) out << "    v = v * 31 + " << (k * 10 + i) << "; // padding line\n";
+                out << "}\n";
+            }
+        }
+        fs::last_write_time(path, fs::file_time_type::clock::now() - std::chrono::hours(1));
+    }
+}
+
+// 12 条按符号 + 8 条按行范围；文件按 0..files-1 轮转，使多数文件被请求 2-3 次
+static nlohmann::json makeRequests(size_t files, size_t perFile, std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> pickFunc(0, perFile - 1);
+    nlohmann::json requests = nlohmann::json::array();
+    for (size_t i = 0; i < 20; ++i) {
+        size_t f = i % files;
+        std::string path = "src/mod" + std::to_string(f) + ".cpp";
+        if (i % 5 < 3) {
+            requests.push_back({{"file_path", path}, {"symbol_name", funcName(f, pickFunc(rng))}});
+        } else {
+            int start = static_cast<int>(pickFunc(rng) * 12 + 1);
+            requests.push_back({{"file_path", path}, {"start_line", start}, {"end_line", start + 60}});
+        }
+    }
+    return requests;
+}
+
+struct Timing {
+    double median = 0;
+    double mean = 0;
+};
+
+template <typename Fn>
+static Timing measure(int iterations, bool cold, Fn&& fn) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        if (cold) FileContentCache::getInstance().clear();
+        auto t0 = Clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    Timing t;
+    t.median = samples[samples.size() / 2];
+    for (double s : samples) t.mean += s;
+    t.mean /= samples.size();
+    return t;
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+    const size_t files = argc > 2 ? std::max(1, std::atoi(argv[2])) : 8;
+    const size_t perFile = argc > 3 ? std::max(1, std::atoi(argv[3])) : 400;
+
+    fs::path root = fs::temp_directory_path() / "photon_bench_read_batch";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    generateProject(root, files, perFile);
+
+    SymbolManager symbolManager(root.u8string());
+    symbolManager.registerProvider(std::make_unique<GeneratedFunctionProvider>());
+    symbolManager.scanBlocking();
+    ReadCodeBlockTool tool(root.u8string(), &symbolManager);
+
+    std::mt19937 rng(42);
+    nlohmann::json requests = makeRequests(files, perFile, rng);
+
+    // 校验两种方式输出一致
+    auto batch = tool.execute({{"requests", requests}});
+    for (size_t i = 0; i < requests.size(); ++i) {
+        auto single = tool.execute(requests[i]);
+        if (batch["items"][i]["result"] != single) {
+            std::cerr << "mismatch at request " << i << "\n";
+            return 1;
+        }
+    }
+
+    auto sequential = [&] {
+        for (const auto& req : requests) tool.execute(req);
+    };
+    auto batched = [&] { tool.execute({{"requests", requests}}); };
+
+    std::cout << "20 mixed requests over " << std::min<size_t>(files, 20) << " files (" << perFile * 12
+              << " lines each), " << iterations << " iterations\n\n";
+    std::cout << std::left << std::setw(14) << "mode" << std::right << std::setw(16) << "sequential ms" << std::setw(12)
+              << "batch ms" << std::setw(10) << "speedup" << "   (median / mean)\n";
+    for (bool cold : {true, false}) {
+        Timing seq = measure(iterations, cold, sequential);
+        Timing bat = measure(iterations, cold, batched);
+        std::cout << std::left << std::setw(14) << (cold ? "cold cache" : "warm cache") << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(8) << seq.median << " / " << std::setw(5) << seq.mean
+                  << std::setw(6) << bat.median << " / " << std::setw(5) << bat.mean << std::setw(9)
+                  << (bat.median > 0 ? seq.median / bat.median : 0) << "x\n";
+    }
+    fs::remove_all(root, ec);
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * 请求体组装基准：随历史长度增长，对比
+ *   full   —— 每轮对整段历史 normalizeMessageForKimi + 整体 dump（Conversation 之前的做法）
+ *   cached —— Conversation 逐条缓存序列化片段，每轮只序列化新追加的消息并拼接
+ * 两种方式产出的 messages 文本逐字节比对。历史按 user / assistant(tool_calls) / tool(代码片段) 循环构造。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_request_body
+ * 运行：./bench_request_body [maxMessages=1600]
+ */
+#include "core/Conversation.h"
+#include "core/LLMClient.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static nlohmann::json makeMessage(size_t i) {
+    switch (i % 3) {
+        case 0:
+            return {{"role", "user"}, {"content", "第 " + std::to_string(i) + " 轮：请检查 src/core/main.cpp 中的 \"tool loop\" 并解释为什么会重复调用。"}};
+        case 1:
+            return {{"role", "assistant"},
+                    {"content", nullptr},
+                    {"tool_calls", nlohmann::json::array({{{"id", "call_" + std::to_string(i)},
+                                                           {"type", "function"},
+                                                           {"function", {{"name", "read_code_block"},
+                                                                         {"arguments", "{\"file_path\":\"src/core/main.cpp\",\"start_line\":" +
+                                                                                           std::to_string(i) + ",\"end_line\":" + std::to_string(i + 80) + "}"}}}}})}};
+        default: {
+            std::string code;
+            for (int line = 0; line < 60; ++line) {
+                code += "    if (messages[i].contains(\"role\") && messages[i][\"role\"] == \"system\") {\t// 行 " +
+                        std::to_string(line) + "\n";
+            }
+            return {{"role", "tool"}, {"tool_call_id", "call_" + std::to_string(i - 1)}, {"name", "read_code_block"}, {"content", code}};
+        }
+    }
+}
+
+static std::string fullBody(const nlohmann::json& head, const nlohmann::json& history) {
+    nlohmann::json body = head;
+    nlohmann::json normalized = nlohmann::json::array();
+    for (const auto& m : history) normalized.push_back(normalizeMessageForKimi(m));
+    body["messages"] = std::move(normalized);
+    return body.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+static std::string splicedBody(const nlohmann::json& head, const Conversation& conversation) {
+    std::string messagesJson = conversation.serializedMessages();
+    std::string body = head.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    body.pop_back();
+    body += ",\"messages\":";
+    body += messagesJson;
+    body += '}';
+    return body;
+}
+
+int main(int argc, char** argv) {
+    size_t maxMessages = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 1600;
+    const nlohmann::json head = {{"model", "bench-model"}, {"max_tokens", 4096}};
+
+    nlohmann::json history = nlohmann::json::array();
+    Conversation conversation;
+    history.push_back({{"role", "system"}, {"content", std::string(6000, 'S')}});
+    conversation.push_back(history.back());
+
+    std::cout << std::left << std::setw(10) << "messages" << std::setw(12) << "body KB" << std::setw(14) << "full ms"
+              << std::setw(14) << "cached ms" << "speedup" << std::endl;
+
+    size_t next = 1;
+    for (size_t target = 50; target <= maxMessages; target *= 2) {
+        // 逐轮追加到目标长度，每轮都组装一次请求体（与 agent 主循环一致）
+        double fullMs = 0, cachedMs = 0;
+        size_t rounds = 0;
+        std::string a, b;
+        while (history.size() < target) {
+            auto msg = makeMessage(next++);
+            history.push_back(msg);
+            conversation.push_back(std::move(msg));
+
+            auto t0 = Clock::now();
+            a = fullBody(head, history);
+            auto t1 = Clock::now();
+            b = splicedBody(head, conversation);
+            auto t2 = Clock::now();
+            fullMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            cachedMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+            ++rounds;
+        }
+        // 两者 messages 部分必须一致
+        if (nlohmann::json::parse(a) != nlohmann::json::parse(b)) {
+            std::cerr << "body mismatch at " << history.size() << " messages" << std::endl;
+            return 1;
+        }
+        fullMs /= rounds;
+        cachedMs /= rounds;
+        std::cout << std::left << std::setw(10) << history.size() << std::setw(12) << std::fixed << std::setprecision(1)
+                  << (b.size() / 1024.0) << std::setw(14) << std::setprecision(3) << fullMs << std::setw(14) << cachedMs
+                  << std::setprecision(1) << (fullMs / cachedMs) << "x" << std::endl;
+    }
+    std::cout << "fragments serialized: " << conversation.fragmentBuilds() << " (messages: " << conversation.size() << ")"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * SemanticManager 内存基准：在大规模 markdown 语料上建立索引，报告常驻内存（RSS）与索引落盘大小。
+ * 使用离线 LocalEmbeddingProvider，不联网。SQLite 可用时走 SQLite 存储，否则走 JSON + 内存 chunk。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_semantic_memory
+ * 运行：./bench_semantic_memory [files=1500] [sections=16]
+ */
+#include "analysis/SemanticManager.h"
+#include "analysis/providers/LocalEmbeddingProvider.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// 当前常驻内存（MB）：Linux 读 /proc/self/status，其它平台退回峰值 RSS
+static double residentMb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) return std::atof(line.c_str() + 6) / 1024.0;
+    }
+#ifndef _WIN32
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024.0 / 1024.0;
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#else
+    return 0.0;
+#endif
+}
+
+static double dirSizeMb(const fs::path& dir) {
+    std::uintmax_t total = 0;
+    std::error_code ec;
+    if (!fs::exists(dir, ec)) return 0.0;
+    for (const auto& e : fs::recursive_directory_iterator(dir, ec)) {
+        if (e.is_regular_file(ec)) total += e.file_size(ec);
+    }
+    return total / 1024.0 / 1024.0;
+}
+
+int main(int argc, char** argv) {
+    int fileCount = argc > 1 ? std::atoi(argv[1]) : 1500;
+    int sections = argc > 2 ? std::atoi(argv[2]) : 16;
+
+    fs::path root = fs::temp_directory_path() / "photon_bench_semantic_memory";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "docs");
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> word(0, 9999);
+    size_t corpusBytes = 0;
+    for (int i = 0; i < fileCount; ++i) {
+        std::string md;
+        for (int s = 0; s < sections; ++s) {
+            md += "## Section " + std::to_string(s) + " of document " + std::to_string(i) + "\n";
+            for (int l = 0; l < 12; ++l) {
+                md += "Line " + std::to_string(l) + " mentions term" + std::to_string(word(rng)) + " and term" +
+                      std::to_string(word(rng)) + " inside the generated benchmark corpus text.\n";
+            }
+            md += "\n";
+        }
+        corpusBytes += md.size();
+        std::ofstream(root / "docs" / ("doc_" + std::to_string(i) + ".md")) << md;
+    }
+
+    double rssStart = residentMb();
+    auto t0 = Clock::now();
+    {
+        SemanticManager mgr(root.u8string(), std::make_unique<LocalEmbeddingProvider>());
+        for (int i = 0; i < fileCount; ++i) {
+            mgr.indexFile("docs/doc_" + std::to_string(i) + ".md", "markdown");
+        }
+        double indexSec = std::chrono::duration<double>(Clock::now() - t0).count();
+        double rssIndexed = residentMb();
+
+        auto results = mgr.search("term42 generated corpus", 5);
+        size_t previewBytes = 0;
+        for (const auto& r : results) previewBytes += r.content.size();
+        mgr.saveIndex();
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "corpus:        " << fileCount << " files, " << corpusBytes / 1024.0 / 1024.0 << " MB\n";
+        std::cout << "index time:    " << indexSec << " s\n";
+        std::cout << "RSS start:     " << rssStart << " MB\n";
+        std::cout << "RSS indexed:   " << rssIndexed << " MB (+" << (rssIndexed - rssStart) << " MB)\n";
+        std::cout << "search:        " << results.size() << " results, " << previewBytes << " bytes materialized\n";
+    }
+    std::cout << "index on disk: " << dirSizeMb(root / ".photon" / "index") << " MB\n";
+    fs::remove_all(root, ec);
+    return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * Tokenizer 吞吐基准：对源码 / 文档语料测 count()、encode() 与无词表估算的 MB/s 和 tokens/s。
+ * 未提供词表时在语料上现场训练一个小型 BPE 词表（256 字节 + merges 条合并），写成 tiktoken 格式再加载，
+ * 因此加载 / 预分词 / 合并走的都是正式路径；提供 cl100k_base.tiktoken 等真实词表时结果更有代表性。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_tokenizer
+ * 运行：./bench_tokenizer [corpusDir=.] [vocab.tiktoken|-] [targetMB=16] [merges=8000]
+ */
+#include "utils/Tokenizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static std::string loadCorpus(const fs::path& root) {
+    std::string corpus;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(root, ec), end; it != end; it.increment(ec)) {
+        if (ec) break;
+        const auto& p = it->path();
+        std::string name = p.filename().string();
+        if (it->is_directory() && (name.rfind('.', 0) == 0 || name == "third_party" || name.rfind("_", 0) == 0 ||
+                                   name == "build")) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        std::string ext = p.extension().string();
+        if (!it->is_regular_file() || (ext != ".cpp" && ext != ".h" && ext != ".md")) continue;
+        std::ifstream in(p, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        corpus += ss.str();
+    }
+    return corpus;
+}
+
+static std::string base64(const std::string& in) {
+    static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    unsigned buf = 0;
+    int bits = 0;
+    for (unsigned char c : in) {
+        buf = (buf << 8) | c;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out += table[(buf >> bits) & 63];
+        }
+    }
+    if (bits > 0) out += table[(buf << (6 - bits)) & 63];
+    while (out.size() % 4) out += '=';
+    return out;
+}
+
+// BPE 训练：按片段频次统计相邻对，每轮合并频次最高的一对，只重算包含该对的片段
+static fs::path trainVocab(const std::string& corpus, size_t merges) {
+    std::unordered_map<std::string, size_t> freq;
+    for (auto piece : Tokenizer::splitPieces(corpus)) ++freq[std::string(piece)];
+
+    std::vector<std::string> vocab;
+    for (int b = 0; b < 256; ++b) vocab.emplace_back(1, static_cast<char>(b));
+
+    struct Word {
+        std::vector<uint32_t> symbols;
+        long count;
+    };
+    std::vector<Word> words;
+    words.reserve(freq.size());
+    for (const auto& [piece, n] : freq) {
+        Word w{{}, static_cast<long>(n)};
+        for (unsigned char c : piece) w.symbols.push_back(c);
+        words.push_back(std::move(w));
+    }
+
+    auto key = [](uint32_t a, uint32_t b) { return (static_cast<uint64_t>(a) << 32) | b; };
+    std::unordered_map<uint64_t, long> pairCounts;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> pairWords;  // 可能含重复 / 过期下标，使用时再校验
+    auto addPairs = [&](uint32_t wi, long sign) {
+        const auto& w = words[wi];
+        for (size_t i = 0; i + 1 < w.symbols.size(); ++i) {
+            uint64_t k = key(w.symbols[i], w.symbols[i + 1]);
+            pairCounts[k] += sign * w.count;
+            if (sign > 0) pairWords[k].push_back(wi);
+        }
+    };
+    for (uint32_t wi = 0; wi < words.size(); ++wi) addPairs(wi, 1);
+
+    for (size_t m = 0; m < merges; ++m) {
+        uint64_t best = 0;
+        long bestCount = 1;
+        for (const auto& [k, n] : pairCounts) {
+            if (n > bestCount || (n == bestCount && k < best)) {
+                best = k;
+                bestCount = n;
+            }
+        }
+        if (bestCount < 2) break;
+        const uint32_t left = static_cast<uint32_t>(best >> 32), right = static_cast<uint32_t>(best & 0xFFFFFFFF);
+        const uint32_t merged = static_cast<uint32_t>(vocab.size());
+        vocab.push_back(vocab[left] + vocab[right]);
+
+        std::vector<uint32_t> affected = std::move(pairWords[best]);
+        pairWords.erase(best);
+        std::sort(affected.begin(), affected.end());
+        affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+        for (uint32_t wi : affected) {
+            auto& syms = words[wi].symbols;
+            bool has = false;
+            for (size_t i = 0; i + 1 < syms.size() && !has; ++i) has = syms[i] == left && syms[i + 1] == right;
+            if (!has) continue;
+            addPairs(wi, -1);
+            std::vector<uint32_t> out;
+            for (size_t i = 0; i < syms.size(); ++i) {
+                if (i + 1 < syms.size() && syms[i] == left && syms[i + 1] == right) {
+                    out.push_back(merged);
+                    ++i;
+                } else {
+                    out.push_back(syms[i]);
+                }
+            }
+            syms = std::move(out);
+            addPairs(wi, 1);
+        }
+        for (auto it = pairCounts.begin(); it != pairCounts.end();) {
+            it = it->second <= 0 ? pairCounts.erase(it) : std::next(it);
+        }
+    }
+
+    fs::path path = fs::temp_directory_path() / "photon_bench_vocab.tiktoken";
+    std::ofstream out(path, std::ios::binary);
+    for (size_t r = 0; r < vocab.size(); ++r) out << base64(vocab[r]) << " " << r << "\n";
+    return path;
+}
+
+template <typename Fn>
+static double timeMs(Fn&& fn) {
+    auto t0 = Clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    fs::path root = argc > 1 ? argv[1] : ".";
+    std::string vocabPath = argc > 2 ? argv[2] : "-";
+    size_t targetMB = argc > 3 ? static_cast<size_t>(std::atol(argv[3])) : 16;
+    size_t merges = argc > 4 ? static_cast<size_t>(std::atol(argv[4])) : 8000;
+
+    std::string base = loadCorpus(root);
+    if (base.empty()) {
+        std::cerr << "no .cpp/.h/.md files under " << root << std::endl;
+        return 1;
+    }
+    if (vocabPath == "-") {
+        std::cout << "training " << merges << " merges on " << base.size() / 1024 << " KB corpus..." << std::flush;
+        double ms = timeMs([&] { vocabPath = trainVocab(base, merges).string(); });
+        std::cout << " " << std::fixed << std::setprecision(0) << ms << " ms" << std::endl;
+    }
+
+    std::string corpus;
+    while (corpus.size() < targetMB * 1024 * 1024) corpus += base;
+    const double mb = corpus.size() / (1024.0 * 1024.0);
+
+    Tokenizer tokenizer;
+    double loadMs = timeMs([&] { tokenizer.loadVocab(vocabPath); });
+    if (!tokenizer.hasVocab()) {
+        std::cerr << "failed to load vocab " << vocabPath << std::endl;
+        return 1;
+    }
+
+    size_t pieces = 0, counted = 0, encoded = 0, estimated = 0;
+    double splitMs = timeMs([&] { pieces = Tokenizer::splitPieces(corpus).size(); });
+    double countMs = timeMs([&] { counted = tokenizer.count(corpus); });
+    double encodeMs = timeMs([&] { encoded = tokenizer.encode(corpus).size(); });
+    double estimateMs = timeMs([&] { estimated = Tokenizer::estimate(corpus); });
+
+    std::cout << "vocab: " << tokenizer.vocabName() << " (load " << std::setprecision(1) << loadMs << " ms)"
+              << "  corpus: " << std::setprecision(1) << mb << " MB, " << pieces << " pieces" << std::endl;
+    auto row = [&](const char* name, double ms, size_t tokens) {
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(10) << std::setprecision(1) << ms
+                  << " ms" << std::setw(10) << std::setprecision(1) << (mb / (ms / 1000.0)) << " MB/s" << std::setw(12)
+                  << std::setprecision(2) << (tokens / (ms / 1000.0) / 1e6) << " Mtok/s" << std::setw(12) << tokens
+                  << " tokens" << std::endl;
+    };
+    row("split", splitMs, pieces);
+    row("count", countMs, counted);
+    row("encode", encodeMs, encoded);
+    row("estimate", estimateMs, estimated);
+    std::cout << "bytes/token: " << std::setprecision(2) << (static_cast<double>(corpus.size()) / counted)
+              << "  estimate error: " << std::setprecision(1)
+              << (100.0 * (static_cast<double>(estimated) - counted) / counted) << "%" << std::endl;
+    return counted == encoded ? 0 : 1;
+}
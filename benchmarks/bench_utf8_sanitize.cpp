@@ -0,0 +1,131 @@
+/**
+ * UTF8Utils::sanitize 吞吐基准：源码类纯 ASCII、中英混合、以及每 ~4KB 夹一个非法字节的三类输入，
+ * 对比逐字节的 sanitizeScalar 与快速路径（AVX2 / SSSE3 分块校验 + 整段复制）的 GB/s，
+ * 并单独给出各可用实现下 utf8ValidPrefix 的校验吞吐。
+ *
+ * 构建：cmake -DPHOTON_BUILD_BENCHMARKS=ON ... && cmake --build . --target bench_utf8_sanitize
+ * 运行：./bench_utf8_sanitize [megabytes=16] [iterations=10]
+ */
+#include "tools/CoreTools.h"
+#include "utils/Utf8Validate.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using UTF8Utils::Utf8Impl;
+
+static std::string makeAscii(size_t bytes) {
+    static const char* kLines[] = {
+        "    for (size_t i = 0; i < items.size(); ++i) {\n",
+        "        auto result = tool.execute({{\"file_path\", path}});\n",
+        "    }\n",
+        "// Returns the enclosing symbol for the given line.\n",
+        "static int helper(int value) { return value * 31 + 7; }\n",
+    };
+    std::string out;
+    for (size_t i = 0; out.size() < bytes; ++i) out += kLines[i % 5];
+    out.resize(bytes);
+    return out;
+}
+
+static std::string makeMixed(size_t bytes) {
+    static const char* kLines[] = {
+        "    // 读取文件内容并建立行索引\n",
+        "    std::string name = \"符号\"; // 名称\n",
+        "    int count = 0;\n",
+        "    log(\"完成 ✓ 😀\");\n",
+    };
+    std::string out;
+    for (size_t i = 0; out.size() < bytes; ++i) out += kLines[i % 4];
+    while (out.size() > bytes) out.pop_back();
+    while (!out.empty() && (static_cast<unsigned char>(out.back()) & 0xC0) == 0x80) out.pop_back();
+    if (!out.empty() && static_cast<unsigned char>(out.back()) >= 0xC0) out.pop_back();
+    return out;
+}
+
+static std::string makeSparseInvalid(size_t bytes) {
+    std::string out = makeMixed(bytes);
+    std::mt19937 rng(1);
+    for (size_t pos = 4096; pos < out.size(); pos += 4096) {
+        size_t p = pos + rng() % 64;
+        if (p < out.size()) out[p] = static_cast<char>(0xFF);
+    }
+    return out;
+}
+
+// 防止结果被优化掉
+static volatile size_t benchSink = 0;
+
+template <typename Fn>
+static double gbPerSec(const std::string& input, int iterations, Fn&& fn) {
+    std::vector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        auto t0 = Clock::now();
+        benchSink = benchSink + fn(input);
+        samples.push_back(std::chrono::duration<double>(Clock::now() - t0).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+    return median > 0 ? input.size() / median / 1e9 : 0;
+}
+
+int main(int argc, char** argv) {
+    const size_t megabytes = argc > 1 ? std::max(1, std::atoi(argv[1])) : 16;
+    const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 10;
+    const size_t bytes = megabytes * 1024 * 1024;
+
+    struct Corpus {
+        const char* name;
+        std::string text;
+    };
+    std::vector<Corpus> corpora = {
+        {"ascii", makeAscii(bytes)},
+        {"mixed cjk", makeMixed(bytes)},
+        {"sparse invalid", makeSparseInvalid(bytes)},
+    };
+
+    for (const auto& c : corpora) {
+        if (UTF8Utils::sanitize(c.text) != UTF8Utils::sanitizeScalar(c.text)) {
+            std::cerr << "mismatch on " << c.name << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << megabytes << " MB per input, " << iterations << " iterations, best impl: "
+              << UTF8Utils::utf8ImplName(UTF8Utils::bestUtf8Impl()) << "\n\n";
+    std::cout << std::left << std::setw(16) << "input" << std::right << std::setw(12) << "scalar" << std::setw(12)
+              << "sanitize" << std::setw(10) << "speedup" << "   (GB/s, median)\n";
+    for (const auto& c : corpora) {
+        double scalar = gbPerSec(c.text, iterations, [](const std::string& s) { return UTF8Utils::sanitizeScalar(s).size(); });
+        double fast = gbPerSec(c.text, iterations, [](const std::string& s) { return UTF8Utils::sanitize(s).size(); });
+        std::cout << std::left << std::setw(16) << c.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << scalar << std::setw(12) << fast << std::setw(9) << (scalar > 0 ? fast / scalar : 0)
+                  << "x\n";
+    }
+
+    std::cout << "\nutf8ValidPrefix only (GB/s, median)\n" << std::left << std::setw(16) << "input";
+    const Utf8Impl impls[] = {Utf8Impl::Scalar, Utf8Impl::SSSE3, Utf8Impl::AVX2};
+    for (Utf8Impl impl : impls) {
+        if (UTF8Utils::utf8ImplSupported(impl)) std::cout << std::right << std::setw(10) << UTF8Utils::utf8ImplName(impl);
+    }
+    std::cout << "\n";
+    for (const auto& c : corpora) {
+        if (std::string(c.name) == "sparse invalid") continue;
+        std::cout << std::left << std::setw(16) << c.name;
+        for (Utf8Impl impl : impls) {
+            if (!UTF8Utils::utf8ImplSupported(impl)) continue;
+            double gb = gbPerSec(c.text, iterations, [impl](const std::string& s) {
+                return UTF8Utils::utf8ValidPrefix(s.data(), s.size(), impl);
+            });
+            std::cout << std::right << std::fixed << std::setprecision(2) << std::setw(10) << gb;
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -33,7 +33,7 @@ AgentRuntime::AgentRuntime(
     toolSchemas = tools.listToolSchemas();
     
     // 初始化消息历史
-    messageHistory = nlohmann::json::array();
+    messageHistory.clear();
 }
 
 void AgentRuntime::executeTask(const std::string& userGoal) {
@@ -92,15 +92,9 @@ void AgentRuntime::runLoop() {
 void AgentRuntime::planPhase() {
     std::cout << "[Agent] Planning..." << std::endl;
     
-    // 动态注入激活的 Skill Prompt
+    // 动态注入激活的 Skill Prompt：放在末尾槽位（每轮替换），不在历史中逐轮累积，前缀保持稳定
     if (skillMgr) {
-        std::string activeSkillsPrompt = skillMgr->getActiveSkillsPrompt();
-        if (!activeSkillsPrompt.empty()) {
-            nlohmann::json skillPromptMsg;
-            skillPromptMsg["role"] = "system";
-            skillPromptMsg["content"] = activeSkillsPrompt;
-            messageHistory.push_back(skillPromptMsg);
-        }
+        messageHistory.setTrailingContext("skills", skillMgr->getActiveSkillsPrompt());
     }
     
     // 调用 LLM
@@ -110,7 +104,7 @@ void AgentRuntime::planPhase() {
             llmTools.push_back(schema);
         }
         
-        nlohmann::json response = llm->chatWithTools(messageHistory, llmTools);
+        nlohmann::json response = llm->plan(messageHistory, llmTools);
         
         if (response.is_null() || !response.contains("choices") || response["choices"].empty()) {
             std::cout << "[Agent] No response from LLM" << std::endl;
@@ -162,85 +156,76 @@ void AgentRuntime::actPhase() {
     
     state.observations.clear();
     
-    for (const auto& toolCall : state.plannedActions) {
-        std::string toolName = toolCall["function"]["name"].get<std::string>();
-        std::string argsStr = toolCall["function"]["arguments"].get<std::string>();
-        
-        std::cout << "[Agent]   - " << toolName << std::endl;
-        
+    // 先按顺序解析全部动作，再交给 ToolScheduler：互不冲突的调用并发执行，结果仍按动作顺序处理
+    struct Action {
+        std::string toolName;
         nlohmann::json args;
+    };
+    std::vector<Action> actions;
+    std::vector<ToolScheduler::Call> calls;
+    for (const auto& toolCall : state.plannedActions) {
+        Action action;
         try {
-            args = nlohmann::json::parse(argsStr);
-        } catch (...) {
-            args = nlohmann::json::object();
-            std::cerr << "[Agent]   ! Failed to parse arguments" << std::endl;
+            action.toolName = toolCall["function"]["name"].get<std::string>();
+            std::string argsStr = toolCall["function"]["arguments"].get<std::string>();
+            std::cout << "[Agent]   - " << action.toolName << std::endl;
+            try {
+                action.args = nlohmann::json::parse(argsStr);
+            } catch (...) {
+                action.args = nlohmann::json::object();
+                std::cerr << "[Agent]   ! Failed to parse arguments" << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[Agent]   ! Invalid tool call: " << e.what() << std::endl;
+            action.args = nlohmann::json::object();
         }
+        ToolScheduler::Call call;
+        call.effects = tools.getToolEffects(action.toolName, action.args);
+        call.run = [this, name = action.toolName, args = action.args]() { return tools.executeTool(name, args); };
+        calls.push_back(std::move(call));
+        actions.push_back(std::move(action));
+    }
+    std::vector<nlohmann::json> results = toolScheduler.runBatch(std::move(calls));
+    
+    for (size_t i = 0; i < actions.size(); ++i) {
+        const auto& toolCall = state.plannedActions[i];
+        const std::string& toolName = actions[i].toolName;
+        const nlohmann::json& args = actions[i].args;
+        nlohmann::json& result = results[i];
         
-        // 执行工具
-        try {
-            nlohmann::json result = tools.executeTool(toolName, args);
-            
-            // 检查是否失败
-            if (result.contains("error")) {
-                std::string error = result["error"].get<std::string>();
-                std::cerr << "[Agent]   ! Tool failed: " << error << std::endl;
-                
-                // 记录失败
-                state.recordFailure(toolName, args, error);
-                
-                // 检查是否有类似历史失败
-                if (hasSimilarFailure(error)) {
-                    std::string solution = getFailureSolution(error);
-                    std::cout << "[Agent]   * Similar failure found. Solution: " << solution << std::endl;
-                    result["failure_hint"] = solution;
-                }
-            }
-            
-            // 保存结果
-            state.observations.push_back(result);
+        // 检查是否失败
+        if (result.contains("error")) {
+            std::string error = result["error"].is_string() ? result["error"].get<std::string>() : result["error"].dump();
+            std::cerr << "[Agent]   ! Tool failed: " << error << std::endl;
             
-            // 添加到消息历史
-            nlohmann::json toolResult;
-            toolResult["role"] = "tool";
-            toolResult["tool_call_id"] = toolCall["id"];
-            toolResult["name"] = toolName;
+            // 记录失败
+            state.recordFailure(toolName, args, error);
             
-            // 直接赋值 JSON 对象，不要序列化成字符串
-            std::cout << "[Agent] Tool result type: " << result.type_name() << std::endl;
-            
-            try {
-                if (result.contains("content")) {
-                    std::cout << "[Agent] Extracting result['content']" << std::endl;
-                    toolResult["content"] = result["content"];
-                } else {
-                    std::cout << "[Agent] Using full result" << std::endl;
-                    toolResult["content"] = result;
-                }
-                std::cout << "[Agent] Assignment OK" << std::endl;
-            } catch (const std::exception& e) {
-                std::cerr << "[Agent] Assignment failed: " << e.what() << std::endl;
-                toolResult["content"] = "Tool result assignment failed";
+            // 检查是否有类似历史失败
+            if (hasSimilarFailure(error)) {
+                std::string solution = getFailureSolution(error);
+                std::cout << "[Agent]   * Similar failure found. Solution: " << solution << std::endl;
+                result["failure_hint"] = solution;
             }
-            
-            std::cout << "[Agent] Pushing to messageHistory..." << std::endl;
-            messageHistory.push_back(toolResult);
-            std::cout << "[Agent] Push OK, messageHistory size: " << messageHistory.size() << std::endl;
-            
+        }
+        
+        // 保存结果
+        state.observations.push_back(result);
+        
+        // 添加到消息历史
+        nlohmann::json toolResult;
+        toolResult["role"] = "tool";
+        toolResult["tool_call_id"] = toolCall.contains("id") ? toolCall["id"] : nlohmann::json();
+        toolResult["name"] = toolName;
+        
+        // 直接赋值 JSON 对象，不要序列化成字符串
+        try {
+            toolResult["content"] = result.contains("content") ? result["content"] : result;
         } catch (const std::exception& e) {
-            std::cerr << "[Agent]   ! Exception: " << e.what() << std::endl;
-            
-            nlohmann::json errorResult;
-            errorResult["error"] = std::string("Exception: ") + e.what();
-            state.observations.push_back(errorResult);
-            
-            // 添加错误到消息历史
-            nlohmann::json toolResult;
-            toolResult["role"] = "tool";
-            toolResult["tool_call_id"] = toolCall["id"];
-            toolResult["name"] = toolName;
-            toolResult["content"] = errorResult.dump();
-            messageHistory.push_back(toolResult);
+            std::cerr << "[Agent] Assignment failed: " << e.what() << std::endl;
+            toolResult["content"] = "Tool result assignment failed";
         }
+        messageHistory.push_back(toolResult);
     }
 }
 
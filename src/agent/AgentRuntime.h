@@ -5,7 +5,9 @@
 #include <nlohmann/json.hpp>
 #include "AgentState.h"
 #include "tools/ToolRegistry.h"
+#include "tools/ToolScheduler.h"
 #include "core/LLMClient.h"
+#include "core/Conversation.h"
 
 // 前向声明
 class SymbolManager;
@@ -67,7 +69,7 @@ public:
     /**
      * @brief 获取消息历史 (用于调试)
      */
-    const nlohmann::json& getMessageHistory() const { return messageHistory; }
+    nlohmann::json getMessageHistory() const { return messageHistory.toJson(); }
 
 private:
     // ========== 核心循环 ==========
@@ -212,9 +214,10 @@ private:
     MemoryManager* memory;
     SkillManager* skillMgr;
     SemanticManager* semanticMgr;
+    ToolScheduler toolScheduler;  // 同一轮的多个动作按副作用声明并行执行
     
     AgentState state;
-    nlohmann::json messageHistory;
+    Conversation messageHistory;  // 激活的 skill 提示放在末尾槽位，不追加进历史
     
     int maxIterations = 50;
     
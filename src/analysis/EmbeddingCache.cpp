@@ -0,0 +1,133 @@
+#include "analysis/EmbeddingCache.h"
+#include "utils/Hash.h"
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+EmbeddingCache::EmbeddingCache(fs::path cacheFile, size_t maxEntries)
+    : cacheFile(std::move(cacheFile)), maxEntries(maxEntries) {}
+
+std::string EmbeddingCache::normalize(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    size_t lineStart = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size() && text[i] != '\n') continue;
+        size_t end = i;
+        while (end > lineStart && (text[end - 1] == ' ' || text[end - 1] == '\t' || text[end - 1] == '\r')) {
+            --end;
+        }
+        out.append(text, lineStart, end - lineStart);
+        if (i < text.size()) out.push_back('\n');
+        lineStart = i + 1;
+    }
+    size_t first = out.find_first_not_of(" \t\n");
+    if (first == std::string::npos) return "";
+    size_t last = out.find_last_not_of(" \t\n");
+    return out.substr(first, last - first + 1);
+}
+
+std::string EmbeddingCache::makeKey(const std::string& model, const std::string& text) {
+    std::string normalized = normalize(text);
+    // 长度参与键，进一步降低 64 位哈希碰撞概率
+    return model + ":" + std::to_string(normalized.size()) + ":" + hashToHex(fnv1a64(normalized));
+}
+
+bool EmbeddingCache::get(const std::string& model, const std::string& text, std::vector<float>& out) {
+    std::string key = makeKey(model, text);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            out = it->second.embedding;
+            lru.splice(lru.begin(), lru, it->second.lruIt);
+            ++hits;
+            return true;
+        }
+    }
+    ++misses;
+    return false;
+}
+
+void EmbeddingCache::put(const std::string& model, const std::string& text, const std::vector<float>& embedding) {
+    if (embedding.empty()) return;
+    std::string key = makeKey(model, text);
+    std::lock_guard<std::mutex> lock(mtx);
+    insertLocked(key, embedding);
+    dirty = true;
+}
+
+void EmbeddingCache::insertLocked(const std::string& key, std::vector<float> embedding) {
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        it->second.embedding = std::move(embedding);
+        lru.splice(lru.begin(), lru, it->second.lruIt);
+        return;
+    }
+    lru.push_front(key);
+    entries.emplace(key, Entry{std::move(embedding), lru.begin()});
+    while (entries.size() > maxEntries && !lru.empty()) {
+        entries.erase(lru.back());
+        lru.pop_back();
+        ++evictions;
+    }
+}
+
+void EmbeddingCache::load() {
+    if (cacheFile.empty() || !fs::exists(cacheFile)) return;
+    std::ifstream file(cacheFile);
+    if (!file.is_open()) return;
+    try {
+        nlohmann::json j;
+        file >> j;
+        std::lock_guard<std::mutex> lock(mtx);
+        if (j.contains("entries") && j["entries"].is_array()) {
+            // version 2：[[key, embedding], ...]，最近使用在前；倒序插入以恢复 LRU 顺序
+            const auto& arr = j["entries"];
+            for (auto it = arr.rbegin(); it != arr.rend(); ++it) {
+                if (!it->is_array() || it->size() != 2) continue;
+                insertLocked((*it)[0].get<std::string>(), (*it)[1].get<std::vector<float>>());
+            }
+        } else if (j.contains("entries") && j["entries"].is_object()) {
+            // version 1：无顺序信息
+            for (auto& [key, val] : j["entries"].items()) {
+                insertLocked(key, val.get<std::vector<float>>());
+            }
+        } else {
+            return;
+        }
+        // 超出上限时已淘汰，需要重写文件
+        dirty = evictions > 0;
+    } catch (...) {}
+}
+
+void EmbeddingCache::save() {
+    if (cacheFile.empty()) return;
+    nlohmann::json j;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!dirty) return;
+        j["version"] = 2;
+        j["entries"] = nlohmann::json::array();
+        for (const auto& key : lru) {
+            j["entries"].push_back({key, entries.at(key).embedding});
+        }
+        dirty = false;
+    }
+    try {
+        fs::create_directories(cacheFile.parent_path());
+        std::ofstream file(cacheFile);
+        if (file.is_open()) {
+            file << j.dump();
+        }
+    } catch (...) {}
+}
+
+EmbeddingCache::Stats EmbeddingCache::getStats() const {
+    Stats s;
+    s.hits = hits.load();
+    s.misses = misses.load();
+    std::lock_guard<std::mutex> lock(mtx);
+    s.entries = entries.size();
+    s.evictions = evictions;
+    return s;
+}
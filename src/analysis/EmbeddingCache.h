@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/**
+ * Embedding 持久化缓存：键为「模型名 + 归一化文本哈希」。
+ * - 在调用任何 getEmbedding 之前查询，未变化的 chunk 在重建索引、跨会话、跨文件（相同文本）时直接复用。
+ * - 存储于 .photon/index/embedding_cache.json，仅在有新条目时落盘；cacheFile 为空时仅在内存中使用。
+ * - 条目数上限 maxEntries，超出时淘汰最久未使用的条目；落盘按最近使用顺序，重新加载后淘汰顺序不变。
+ * - 线程安全；命中/未命中计数用于观察命中率。
+ */
+class EmbeddingCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t entries = 0;
+        size_t evictions = 0;
+        double hitRate() const {
+            size_t total = hits + misses;
+            return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+        }
+    };
+
+    static constexpr size_t kDefaultMaxEntries = 20000;
+
+    explicit EmbeddingCache(fs::path cacheFile, size_t maxEntries = kDefaultMaxEntries);
+
+    /** 命中返回 true 并写入 out；未命中计入 misses */
+    bool get(const std::string& model, const std::string& text, std::vector<float>& out);
+    /** 空向量不缓存（远端失败时不应污染缓存） */
+    void put(const std::string& model, const std::string& text, const std::vector<float>& embedding);
+
+    void load();
+    void save();
+
+    Stats getStats() const;
+
+    /** 归一化：统一换行、去掉行尾空白与首尾空白，避免无意义差异导致重复计费 */
+    static std::string normalize(const std::string& text);
+    static std::string makeKey(const std::string& model, const std::string& text);
+
+private:
+    struct Entry {
+        std::vector<float> embedding;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    fs::path cacheFile;
+    size_t maxEntries;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;  // 头部为最近使用
+    size_t evictions = 0;
+    mutable std::mutex mtx;
+    bool dirty = false;
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+
+    void insertLocked(const std::string& key, std::vector<float> embedding);
+};
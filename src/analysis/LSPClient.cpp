@@ -1,4 +1,5 @@
 #include "analysis/LSPClient.h"
+#include "utils/FileContentCache.h"
 #include <fstream>
 #include <sstream>
 #include <chrono>
@@ -382,9 +383,9 @@ bool LSPClient::ensureDocumentOpen(const std::string& fileUri) {
         if (openedDocuments.find(fileUri) != openedDocuments.end()) return true;
     }
     std::string path = uriToPath(fileUri);
-    std::ifstream file(path);
-    if (!file.is_open()) return false;
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto cached = FileContentCache::getInstance().get(fs::u8path(path));
+    if (!cached) return false;
+    const std::string& content = cached->text();
     nlohmann::json params = {
         {"textDocument", {
             {"uri", fileUri},
@@ -0,0 +1,499 @@
+#include "analysis/LexicalIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+// BM25 参数
+constexpr double kBm25K1 = 1.2;
+constexpr double kBm25B = 0.75;
+// 墓碑压缩：文档槽位不少于该数量且存活文档不足一半时重新编号
+constexpr size_t kCompactMinDocs = 64;
+
+const std::unordered_set<std::string>& stopWords() {
+    static const std::unordered_set<std::string> words = {
+        "the", "a", "an", "is", "are", "was", "of", "to", "in", "on", "and", "or", "for", "how",
+        "what", "where", "which", "does", "do", "be", "this", "that", "with", "it", "by", "as"};
+    return words;
+}
+
+inline bool isIdentChar(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+inline bool isAlpha(unsigned char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+inline bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+inline bool isLower(char c) { return c >= 'a' && c <= 'z'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+std::string toLower(const char* p, size_t n) {
+    std::string out(p, n);
+    for (auto& c : out) {
+        if (isUpper(c)) c = static_cast<char>(c - 'A' + 'a');
+    }
+    return out;
+}
+
+void emitToken(std::vector<std::string>& out, std::string token) {
+    if (token.size() < 2) return;
+    if (stopWords().count(token)) return;
+    out.push_back(std::move(token));
+}
+
+// 子词：按 '_'、小写->大写、字母<->数字、"HTTPServer" 中的 P|S 边界切分；只有一个部分时不重复输出
+void emitSubwords(std::vector<std::string>& out, const char* word, size_t len) {
+    std::vector<std::pair<size_t, size_t>> parts;
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && word[i] == '_') ++i;
+        if (i >= len) break;
+        size_t start = i++;
+        while (i < len) {
+            char prev = word[i - 1];
+            char cur = word[i];
+            if (cur == '_') break;
+            if (isLower(prev) && isUpper(cur)) break;
+            if (isDigit(prev) != isDigit(cur)) break;
+            if (isUpper(prev) && isUpper(cur) && i + 1 < len && isLower(word[i + 1])) break;
+            ++i;
+        }
+        parts.emplace_back(start, i - start);
+    }
+    if (parts.size() < 2) return;
+    for (const auto& [start, n] : parts) emitToken(out, toLower(word + start, n));
+}
+
+inline size_t utf8Length(unsigned char lead) {
+    if (lead >= 0xF0) return 4;
+    if (lead >= 0xE0) return 3;
+    if (lead >= 0xC0) return 2;
+    return 1;
+}
+
+void putVarint(std::vector<std::uint8_t>& out, std::uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+std::uint32_t getVarint(const std::uint8_t*& p, const std::uint8_t* end) {
+    std::uint32_t v = 0;
+    int shift = 0;
+    while (p < end) {
+        std::uint8_t b = *p++;
+        v |= static_cast<std::uint32_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+        shift += 7;
+    }
+    return v;
+}
+
+// posting 解码：回调 (docId, tf)
+template <typename Fn>
+void forEachPosting(const std::vector<std::uint8_t>& bytes, Fn&& fn) {
+    const std::uint8_t* p = bytes.data();
+    const std::uint8_t* end = p + bytes.size();
+    std::uint32_t doc = 0;
+    while (p < end) {
+        doc += getVarint(p, end);
+        std::uint32_t tf = getVarint(p, end);
+        fn(doc, tf);
+    }
+}
+
+// 二进制持久化辅助
+void writeU32(std::ofstream& f, std::uint32_t v) { f.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+void writeStr(std::ofstream& f, const std::string& s) {
+    writeU32(f, static_cast<std::uint32_t>(s.size()));
+    f.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+bool readU32(std::ifstream& f, std::uint32_t& v) { return static_cast<bool>(f.read(reinterpret_cast<char*>(&v), sizeof(v))); }
+// 文件剩余字节数：读入的长度/计数先与之比较，损坏的文件不会触发巨大的 resize
+std::uint64_t bytesLeft(std::ifstream& f, std::uint64_t fileSize) {
+    auto pos = f.tellg();
+    if (pos < 0 || static_cast<std::uint64_t>(pos) > fileSize) return 0;
+    return fileSize - static_cast<std::uint64_t>(pos);
+}
+bool readStr(std::ifstream& f, std::uint64_t fileSize, std::string& s) {
+    std::uint32_t n = 0;
+    if (!readU32(f, n) || n > bytesLeft(f, fileSize)) return false;
+    s.resize(n);
+    return static_cast<bool>(f.read(&s[0], n));
+}
+// 严格解码一个 varint：截断或超过 32 位时返回 false
+bool getVarintChecked(const std::uint8_t*& p, const std::uint8_t* end, std::uint32_t& v) {
+    std::uint64_t acc = 0;
+    for (int shift = 0; p < end && shift <= 28; shift += 7) {
+        std::uint8_t b = *p++;
+        acc |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            if (acc > 0xFFFFFFFFu) return false;
+            v = static_cast<std::uint32_t>(acc);
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+std::vector<std::string> LexicalIndex::tokenize(const std::string& text) {
+    std::vector<std::string> out;
+    const char* data = text.data();
+    const size_t n = text.size();
+    size_t prevWide = std::string::npos;
+    size_t prevWideLen = 0;
+    size_t i = 0;
+    while (i < n) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if (isIdentChar(c)) {
+            size_t start = i;
+            while (i < n && isIdentChar(static_cast<unsigned char>(data[i]))) ++i;
+            emitToken(out, toLower(data + start, i - start));
+            emitSubwords(out, data + start, i - start);
+            // 路径/文件名 token：name.ext 整体保留，便于 "LLMClient.cpp" 之类的查询
+            if (i + 1 < n && data[i] == '.' && isAlpha(static_cast<unsigned char>(data[i + 1]))) {
+                size_t extEnd = i + 1;
+                while (extEnd < n && isIdentChar(static_cast<unsigned char>(data[extEnd]))) ++extEnd;
+                if (extEnd - i - 1 <= 5) emitToken(out, toLower(data + start, extEnd - start));
+            }
+            prevWide = std::string::npos;
+            continue;
+        }
+        if (c >= 0x80) {
+            // 非 ASCII（中文等）：单字 + 相邻双字
+            size_t len = std::min(utf8Length(c), n - i);
+            out.emplace_back(data + i, len);
+            if (prevWide != std::string::npos) out.emplace_back(data + prevWide, prevWideLen + len);
+            prevWide = i;
+            prevWideLen = len;
+            i += len;
+            continue;
+        }
+        prevWide = std::string::npos;
+        ++i;
+    }
+    return out;
+}
+
+void LexicalIndex::addDocument(const std::string& group, const std::string& key, const std::string& text) {
+    auto tokens = tokenize(text);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    auto existing = docByKey.find(key);
+    if (existing != docByKey.end()) removeDocLocked(existing->second);
+
+    std::unordered_map<std::uint32_t, std::uint32_t> tf;
+    for (auto& token : tokens) {
+        auto it = termIds.find(token);
+        std::uint32_t termId;
+        if (it == termIds.end()) {
+            termId = static_cast<std::uint32_t>(terms.size());
+            termIds.emplace(token, termId);
+            terms.push_back(token);
+            postings.emplace_back();
+        } else {
+            termId = it->second;
+        }
+        ++tf[termId];
+    }
+
+    DocId id = static_cast<DocId>(docs.size());
+    Doc doc;
+    doc.key = key;
+    doc.group = group;
+    doc.length = static_cast<std::uint32_t>(tokens.size());
+    doc.alive = true;
+    doc.terms.reserve(tf.size());
+    for (const auto& [termId, count] : tf) {
+        Postings& p = postings[termId];
+        putVarint(p.bytes, id - p.lastDoc);
+        putVarint(p.bytes, count);
+        p.lastDoc = id;
+        ++p.df;
+        doc.terms.push_back(termId);
+    }
+    docs.push_back(std::move(doc));
+    docByKey[key] = id;
+    docsByGroup[group].push_back(id);
+    totalLength += tokens.size();
+    ++aliveDocs;
+    if (existing != docByKey.end()) maybeCompactLocked();
+}
+
+void LexicalIndex::removeDocLocked(DocId id) {
+    Doc& doc = docs[id];
+    if (!doc.alive) return;
+    for (std::uint32_t termId : doc.terms) {
+        Postings& p = postings[termId];
+        std::vector<std::uint8_t> rebuilt;
+        rebuilt.reserve(p.bytes.size());
+        DocId last = 0;
+        forEachPosting(p.bytes, [&](std::uint32_t d, std::uint32_t tf) {
+            if (d == id) return;
+            putVarint(rebuilt, d - last);
+            putVarint(rebuilt, tf);
+            last = d;
+        });
+        p.bytes.swap(rebuilt);
+        p.lastDoc = last;
+        if (p.df > 0) --p.df;
+    }
+    totalLength -= doc.length;
+    --aliveDocs;
+    auto itKey = docByKey.find(doc.key);
+    if (itKey != docByKey.end() && itKey->second == id) docByKey.erase(itKey);
+    auto itGroup = docsByGroup.find(doc.group);
+    if (itGroup != docsByGroup.end()) {
+        auto& ids = itGroup->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+        if (ids.empty()) docsByGroup.erase(itGroup);
+    }
+    doc = Doc{};
+}
+
+void LexicalIndex::removeGroup(const std::string& group) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto it = docsByGroup.find(group);
+    if (it == docsByGroup.end()) return;
+    std::vector<DocId> ids = it->second;
+    for (DocId id : ids) removeDocLocked(id);
+    maybeCompactLocked();
+}
+
+void LexicalIndex::maybeCompactLocked() {
+    if (docs.size() >= kCompactMinDocs && aliveDocs * 2 < docs.size()) compactLocked();
+}
+
+// 重新编号：存活文档按原顺序编号（映射单调，posting 的差值编码保持有效），df 为 0 的词项丢弃
+void LexicalIndex::compactLocked() {
+    constexpr std::uint32_t kDropped = 0xFFFFFFFFu;
+    std::vector<DocId> newDoc(docs.size(), kDropped);
+    std::vector<Doc> keptDocs;
+    keptDocs.reserve(aliveDocs);
+    for (DocId d = 0; d < docs.size(); ++d) {
+        if (!docs[d].alive) continue;
+        newDoc[d] = static_cast<DocId>(keptDocs.size());
+        keptDocs.push_back(std::move(docs[d]));
+    }
+
+    std::vector<std::uint32_t> newTerm(terms.size(), kDropped);
+    std::vector<std::string> keptTerms;
+    std::vector<Postings> keptPostings;
+    for (std::uint32_t t = 0; t < terms.size(); ++t) {
+        if (postings[t].df == 0) continue;
+        newTerm[t] = static_cast<std::uint32_t>(keptTerms.size());
+        Postings rebuilt;
+        rebuilt.df = postings[t].df;
+        forEachPosting(postings[t].bytes, [&](std::uint32_t d, std::uint32_t tf) {
+            DocId id = newDoc[d];
+            putVarint(rebuilt.bytes, id - rebuilt.lastDoc);
+            putVarint(rebuilt.bytes, tf);
+            rebuilt.lastDoc = id;
+        });
+        keptTerms.push_back(std::move(terms[t]));
+        keptPostings.push_back(std::move(rebuilt));
+    }
+
+    termIds.clear();
+    for (std::uint32_t t = 0; t < keptTerms.size(); ++t) termIds.emplace(keptTerms[t], t);
+    docByKey.clear();
+    docsByGroup.clear();
+    for (DocId d = 0; d < keptDocs.size(); ++d) {
+        for (auto& t : keptDocs[d].terms) t = newTerm[t];
+        docByKey[keptDocs[d].key] = d;
+        docsByGroup[keptDocs[d].group].push_back(d);
+    }
+    terms = std::move(keptTerms);
+    postings = std::move(keptPostings);
+    docs = std::move(keptDocs);
+}
+
+void LexicalIndex::clear() {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    termIds.clear();
+    terms.clear();
+    postings.clear();
+    docs.clear();
+    docByKey.clear();
+    docsByGroup.clear();
+    totalLength = 0;
+    aliveDocs = 0;
+}
+
+std::vector<LexicalIndex::Hit> LexicalIndex::search(const std::string& query, size_t topK) const {
+    auto tokens = tokenize(query);
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    if (aliveDocs == 0 || topK == 0) return {};
+    const double n = static_cast<double>(aliveDocs);
+    const double avgdl = std::max(1.0, static_cast<double>(totalLength) / n);
+
+    std::unordered_map<DocId, double> scores;
+    for (const auto& token : tokens) {
+        auto it = termIds.find(token);
+        if (it == termIds.end()) continue;
+        const Postings& p = postings[it->second];
+        if (p.df == 0) continue;
+        double idf = std::log(1.0 + (n - p.df + 0.5) / (p.df + 0.5));
+        forEachPosting(p.bytes, [&](std::uint32_t d, std::uint32_t tf) {
+            double dl = static_cast<double>(docs[d].length);
+            double denom = tf + kBm25K1 * (1.0 - kBm25B + kBm25B * dl / avgdl);
+            scores[d] += idf * (tf * (kBm25K1 + 1.0)) / denom;
+        });
+    }
+
+    std::vector<std::pair<DocId, double>> ranked(scores.begin(), scores.end());
+    size_t k = std::min(topK, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(k), ranked.end(),
+                      [](const auto& a, const auto& b) {
+                          if (a.second != b.second) return a.second > b.second;
+                          return a.first < b.first;
+                      });
+    std::vector<Hit> hits;
+    hits.reserve(k);
+    for (size_t i = 0; i < k; ++i) hits.push_back({docs[ranked[i].first].key, ranked[i].second});
+    return hits;
+}
+
+size_t LexicalIndex::documentCount() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return aliveDocs;
+}
+
+size_t LexicalIndex::storedDocumentCount() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return docs.size();
+}
+
+size_t LexicalIndex::termCount() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return terms.size();
+}
+
+size_t LexicalIndex::postingBytes() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    size_t total = 0;
+    for (const auto& p : postings) total += p.bytes.size();
+    return total;
+}
+
+bool LexicalIndex::save(const fs::path& path) const {
+    try {
+        fs::create_directories(path.parent_path());
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) return false;
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        f.write("PLX1", 4);
+        writeU32(f, static_cast<std::uint32_t>(terms.size()));
+        for (size_t t = 0; t < terms.size(); ++t) {
+            writeStr(f, terms[t]);
+            writeU32(f, postings[t].df);
+            writeU32(f, postings[t].lastDoc);
+            writeU32(f, static_cast<std::uint32_t>(postings[t].bytes.size()));
+            f.write(reinterpret_cast<const char*>(postings[t].bytes.data()),
+                    static_cast<std::streamsize>(postings[t].bytes.size()));
+        }
+        writeU32(f, static_cast<std::uint32_t>(docs.size()));
+        for (const auto& doc : docs) {
+            f.put(doc.alive ? 1 : 0);
+            if (!doc.alive) continue;
+            writeStr(f, doc.key);
+            writeStr(f, doc.group);
+            writeU32(f, doc.length);
+            writeU32(f, static_cast<std::uint32_t>(doc.terms.size()));
+            for (auto t : doc.terms) writeU32(f, t);
+        }
+        return static_cast<bool>(f);
+    } catch (...) {
+        return false;
+    }
+}
+
+bool LexicalIndex::load(const fs::path& path) {
+    // 文件内容不可信：任何计数越界、posting 不一致都返回 false，由调用方重建索引
+    try {
+        std::error_code ec;
+        std::uint64_t fileSize = fs::file_size(path, ec);
+        if (ec) return false;
+        std::ifstream f(path, std::ios::binary);
+        if (!f.is_open()) return false;
+        char magic[4];
+        if (!f.read(magic, 4) || std::string(magic, 4) != "PLX1") return false;
+
+        LexicalIndex tmp;
+        std::uint32_t termCount = 0;
+        // 每个词项至少占 16 字节（词长、df、lastDoc、posting 长度）
+        if (!readU32(f, termCount) || static_cast<std::uint64_t>(termCount) * 16 > bytesLeft(f, fileSize)) return false;
+        tmp.terms.resize(termCount);
+        tmp.postings.resize(termCount);
+        for (std::uint32_t t = 0; t < termCount; ++t) {
+            std::uint32_t byteLen = 0;
+            if (!readStr(f, fileSize, tmp.terms[t]) || !readU32(f, tmp.postings[t].df) ||
+                !readU32(f, tmp.postings[t].lastDoc) || !readU32(f, byteLen) || byteLen > bytesLeft(f, fileSize)) {
+                return false;
+            }
+            tmp.postings[t].bytes.resize(byteLen);
+            if (byteLen && !f.read(reinterpret_cast<char*>(tmp.postings[t].bytes.data()), byteLen)) return false;
+            if (!tmp.termIds.emplace(tmp.terms[t], t).second) return false;
+        }
+        std::uint32_t docCount = 0;
+        // 每个文档槽位至少占 1 字节（存活标记）
+        if (!readU32(f, docCount) || docCount > bytesLeft(f, fileSize)) return false;
+        tmp.docs.resize(docCount);
+        for (std::uint32_t d = 0; d < docCount; ++d) {
+            char alive = 0;
+            if (!f.get(alive)) return false;
+            if (!alive) continue;
+            Doc& doc = tmp.docs[d];
+            std::uint32_t nterms = 0;
+            if (!readStr(f, fileSize, doc.key) || !readStr(f, fileSize, doc.group) || !readU32(f, doc.length) ||
+                !readU32(f, nterms) || static_cast<std::uint64_t>(nterms) * 4 > bytesLeft(f, fileSize)) {
+                return false;
+            }
+            doc.terms.resize(nterms);
+            for (auto& t : doc.terms) {
+                if (!readU32(f, t) || t >= termCount) return false;
+            }
+            doc.alive = true;
+            if (!tmp.docByKey.emplace(doc.key, d).second) return false;
+            tmp.docsByGroup[doc.group].push_back(d);
+            tmp.totalLength += doc.length;
+            ++tmp.aliveDocs;
+        }
+
+        // 逐条解码 posting：docId 严格递增、指向存活文档，条目数与 df、末尾 docId 与 lastDoc 一致
+        for (const auto& p : tmp.postings) {
+            const std::uint8_t* cur = p.bytes.data();
+            const std::uint8_t* end = cur + p.bytes.size();
+            std::uint64_t doc = 0;
+            std::uint32_t count = 0;
+            while (cur < end) {
+                std::uint32_t delta = 0, tf = 0;
+                if (!getVarintChecked(cur, end, delta) || !getVarintChecked(cur, end, tf)) return false;
+                if (count > 0 && delta == 0) return false;
+                doc += delta;
+                if (doc >= docCount || !tmp.docs[doc].alive || tf == 0) return false;
+                ++count;
+            }
+            if (count != p.df || (count > 0 && doc != p.lastDoc) || (count == 0 && p.lastDoc != 0)) return false;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        termIds = std::move(tmp.termIds);
+        terms = std::move(tmp.terms);
+        postings = std::move(tmp.postings);
+        docs = std::move(tmp.docs);
+        docByKey = std::move(tmp.docByKey);
+        docsByGroup = std::move(tmp.docsByGroup);
+        totalLength = tmp.totalLength;
+        aliveDocs = tmp.aliveDocs;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/**
+ * 进程内倒排索引 + BM25 打分，供 SemanticManager 做词法检索（与向量检索做 RRF 融合）。
+ * - 代码感知分词：标识符整体 + camelCase/snake_case 子词、路径/文件名 token、中文双字
+ * - 倒排表压缩：每个词项的 posting 为 varint(docId 差值) + varint(tf) 字节流
+ * - 按文件（group）增量更新：重新索引文件时只重写该文件涉及词项的 posting
+ * - 移除的文档先留作墓碑；墓碑超过一半时压缩（重新编号文档、丢弃 df 为 0 的词项），内存与持久化文件不随改动次数增长
+ * 线程安全（读写锁）。
+ */
+class LexicalIndex {
+public:
+    using DocId = std::uint32_t;
+
+    struct Hit {
+        std::string key;
+        double score = 0.0;
+    };
+
+    /** 代码感知分词（小写化），同时用于文档与查询 */
+    static std::vector<std::string> tokenize(const std::string& text);
+
+    /** 添加/替换文档。group 为所属文件（按文件整体移除），key 为文档唯一键 */
+    void addDocument(const std::string& group, const std::string& key, const std::string& text);
+    void removeGroup(const std::string& group);
+    void clear();
+
+    /** BM25 检索，按分数降序返回至多 topK 个文档键 */
+    std::vector<Hit> search(const std::string& query, size_t topK) const;
+
+    size_t documentCount() const;
+    /** 已分配的文档槽位（含未压缩的墓碑）与词项数，观察压缩效果用 */
+    size_t storedDocumentCount() const;
+    size_t termCount() const;
+    /** 所有 posting 字节流的总大小（压缩后） */
+    size_t postingBytes() const;
+
+    bool save(const fs::path& path) const;
+    bool load(const fs::path& path);
+
+private:
+    struct Doc {
+        std::string key;
+        std::string group;
+        std::uint32_t length = 0;
+        std::vector<std::uint32_t> terms;  // 该文档出现的词项 id（去重），移除时用于定位 posting
+        bool alive = false;
+    };
+    struct Postings {
+        std::vector<std::uint8_t> bytes;
+        std::uint32_t df = 0;
+        DocId lastDoc = 0;
+    };
+
+    std::unordered_map<std::string, std::uint32_t> termIds;
+    std::vector<std::string> terms;
+    std::vector<Postings> postings;
+    std::vector<Doc> docs;  // DocId 单调递增且不复用，保证 posting 差值编码只需追加
+    std::unordered_map<std::string, DocId> docByKey;
+    std::unordered_map<std::string, std::vector<DocId>> docsByGroup;
+    std::uint64_t totalLength = 0;
+    size_t aliveDocs = 0;
+    mutable std::shared_mutex mtx;
+
+    void removeDocLocked(DocId id);
+    void maybeCompactLocked();
+    void compactLocked();
+};
@@ -1,32 +1,77 @@
 #include "analysis/SemanticManager.h"
+#include "analysis/SymbolManager.h"
+#include "analysis/providers/RemoteEmbeddingProvider.h"
+#include "utils/FileContentCache.h"
+#include "utils/Hash.h"
 #include <fstream>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
 #include <nlohmann/json.hpp>
-#include <regex>
 #include <cstring>
+#include <unordered_map>
 
 #ifdef PHOTON_USE_SQLITE
 #include <sqlite3.h>
 #endif
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 SemanticManager::SemanticManager(const std::string& rootPath, std::shared_ptr<LLMClient> llmClient)
-    : rootPath(rootPath), llmClient(llmClient) {
+    : rootPath(rootPath), embeddingProvider(std::make_unique<RemoteEmbeddingProvider>(std::move(llmClient))) {
+    init();
+}
+
+SemanticManager::SemanticManager(const std::string& rootPath, std::unique_ptr<IEmbeddingProvider> provider)
+    : rootPath(rootPath), embeddingProvider(std::move(provider)) {
+    init();
+}
+
+void SemanticManager::init() {
+    embeddingCache = std::make_unique<EmbeddingCache>(getEmbeddingCachePath());
+    embeddingCache->load();
+    queryEmbeddingCache = std::make_unique<EmbeddingCache>(fs::path(), 256);
+    loadCodeState();
 #ifdef PHOTON_USE_SQLITE
     useSqlite = initDb();
 #endif
     loadIndex();
+    if (!lexicalIndex.load(getLexicalIndexPath())) {
+        rebuildLexicalIndex();
+    }
 }
 
 SemanticManager::~SemanticManager() {
+    stopRequested = true;
+    // 先等索引线程结束（它可能正在 requestCodeSync 中创建 syncThread），再 join syncThread
+    std::thread indexer;
+    {
+        std::lock_guard<std::mutex> lock(threadMtx);
+        indexer = std::move(indexingThread);
+    }
+    if (indexer.joinable()) indexer.join();
+    {
+        std::lock_guard<std::mutex> lock(threadMtx);
+        if (syncThread.joinable()) syncThread.join();
+    }
     saveIndex();
 #ifdef PHOTON_USE_SQLITE
     closeDb();
 #endif
 }
 
-void SemanticManager::addChunk(const SemanticChunk& chunk) {
+void SemanticManager::addChunk(const SemanticChunk& input) {
+    indexLexical(input);
+    // 文件来源的 chunk 只存 (offset, length, hash)，正文在返回结果时再读取
+    SemanticChunk chunk = input;
+    if (chunk.byteLength > 0) {
+        chunk.content.clear();
+        chunk.content.shrink_to_fit();
+    }
 #ifdef PHOTON_USE_SQLITE
     if (useSqlite) {
         upsertChunkDb(chunk);
@@ -54,46 +99,220 @@ float SemanticManager::cosineSimilarity(const std::vector<float>& v1, const std:
         n1 += v1[i] * v1[i];
         n2 += v2[i] * v2[i];
     }
+    if (n1 <= 0.0f || n2 <= 0.0f) return 0.0f;
     return dot / (std::sqrt(n1) * std::sqrt(n2));
 }
 
+std::string SemanticManager::chunkKey(const SemanticChunk& chunk) {
+    return chunk.path + "|" + std::to_string(chunk.startLine) + "|" + chunk.type;
+}
+
 std::vector<SemanticChunk> SemanticManager::search(const std::string& query, int topK) {
-    auto queryEmbedding = llmClient->getEmbedding(query);
-    if (queryEmbedding.empty()) return {};
+    if (topK <= 0) return {};
+    // 两路各取更多候选，再用 RRF 融合
+    const size_t candidateK = std::max<size_t>(static_cast<size_t>(topK) * 4, 50);
+
+    // 1) 词法：BM25（不依赖 embedding）
+    auto lexicalHits = lexicalIndex.search(query, candidateK);
 
+    // 2) 向量：embedding 后端不可用时为空，退化为纯词法
+    std::vector<SemanticChunk> vectorHits;
+    auto queryEmbedding = embedQuery(query);
+    if (!queryEmbedding.empty()) {
 #ifdef PHOTON_USE_SQLITE
-    if (useSqlite) {
-        return searchDb(queryEmbedding, topK);
-    }
+        if (useSqlite) {
+            vectorHits = searchDb(queryEmbedding, static_cast<int>(candidateK));
+        } else
 #endif
-    std::vector<SemanticChunk> results;
-    {
-        std::lock_guard<std::mutex> lock(mtx);
-        for (auto& chunk : chunks) {
-            if (chunk.embedding.empty()) continue;
-            chunk.score = cosineSimilarity(queryEmbedding, chunk.embedding);
-            results.push_back(chunk);
+        {
+            vectorHits = searchVectors(queryEmbedding, candidateK);
         }
     }
 
-    std::sort(results.begin(), results.end(), [](const SemanticChunk& a, const SemanticChunk& b) {
-        return a.score > b.score;
+    // 3) Reciprocal-rank fusion：score = Σ 1 / (k + rank)
+    constexpr double kRrfK = 60.0;
+    std::unordered_map<std::string, double> fused;
+    std::unordered_map<std::string, SemanticChunk> pool;
+    for (size_t r = 0; r < vectorHits.size(); ++r) {
+        std::string key = chunkKey(vectorHits[r]);
+        fused[key] += 1.0 / (kRrfK + static_cast<double>(r + 1));
+        pool.emplace(std::move(key), std::move(vectorHits[r]));
+    }
+    for (size_t r = 0; r < lexicalHits.size(); ++r) {
+        fused[lexicalHits[r].key] += 1.0 / (kRrfK + static_cast<double>(r + 1));
+    }
+
+    std::vector<std::pair<std::string, double>> ranked(fused.begin(), fused.end());
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+        if (a.second != b.second) return a.second > b.second;
+        return a.first < b.first;
     });
 
-    if (results.size() > static_cast<size_t>(topK)) {
-        results.resize(topK);
+    // 分数归一化到 [0,1]：在每一路都排第一时为 1
+    const double lists = queryEmbedding.empty() ? 1.0 : 2.0;
+    const double maxScore = lists / (kRrfK + 1.0);
+
+    // 只为最终返回的结果读取正文；内容哈希不符说明文件已变，跳过并交给后台重新索引
+    std::vector<SemanticChunk> results;
+    bool foundStale = false;
+    for (const auto& [key, score] : ranked) {
+        if (results.size() >= static_cast<size_t>(topK)) break;
+        SemanticChunk chunk;
+        auto it = pool.find(key);
+        if (it != pool.end()) {
+            chunk = std::move(it->second);
+        } else if (!findChunkByKey(key, chunk)) {
+            continue;  // 词法索引与存储短暂不一致（如正在重建）时跳过
+        }
+        if (!materialize(chunk)) {
+            std::lock_guard<std::mutex> lock(codeStateMtx);
+            auto item = std::make_pair(chunk.path, chunk.type);
+            if (std::find(staleFiles.begin(), staleFiles.end(), item) == staleFiles.end()) {
+                staleFiles.push_back(std::move(item));
+            }
+            foundStale = true;
+            continue;
+        }
+        chunk.score = static_cast<float>(score / maxScore);
+        results.push_back(std::move(chunk));
+    }
+    if (foundStale) requestCodeSync();
+    return results;
+}
+
+bool SemanticManager::materialize(SemanticChunk& chunk) const {
+    if (chunk.byteLength == 0) return true;  // 内联正文（fact 等）
+    if (!chunk.content.empty() && !chunk.stale) return true;
+
+    fs::path fullPath = fs::path(rootPath) / fs::u8path(chunk.path);
+    std::string buf(static_cast<size_t>(chunk.byteLength), '\0');
+    bool ok = false;
+#ifdef _WIN32
+    std::ifstream file(fullPath, std::ios::binary);
+    if (file.is_open()) {
+        file.seekg(static_cast<std::streamoff>(chunk.byteOffset));
+        ok = static_cast<bool>(file.read(&buf[0], static_cast<std::streamsize>(buf.size())));
+    }
+#else
+    int fd = ::open(fullPath.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        size_t done = 0;
+        while (done < buf.size()) {
+            ssize_t n = ::pread(fd, &buf[done], buf.size() - done, static_cast<off_t>(chunk.byteOffset + done));
+            if (n <= 0) break;
+            done += static_cast<size_t>(n);
+        }
+        ::close(fd);
+        ok = (done == buf.size());
+    }
+#endif
+    if (!ok || fnv1a64(buf) != chunk.contentHash) {
+        chunk.stale = true;
+        chunk.content.clear();
+        return false;
+    }
+    chunk.stale = false;
+    chunk.content = std::move(buf);
+    return true;
+}
+
+std::vector<SemanticChunk> SemanticManager::searchVectors(const std::vector<float>& queryEmbedding, size_t topK) {
+    // 先只算分数，再拷贝 top-K（避免为全部 chunk 复制 embedding）
+    std::vector<std::pair<float, size_t>> scored;
+    std::vector<SemanticChunk> results;
+    std::lock_guard<std::mutex> lock(mtx);
+    scored.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i].embedding.size() != queryEmbedding.size()) continue;
+        scored.emplace_back(cosineSimilarity(queryEmbedding, chunks[i].embedding), i);
+    }
+    size_t n = std::min(topK, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + n, scored.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+    results.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        results.push_back(chunks[scored[i].second]);
+        results.back().score = scored[i].first;
     }
     return results;
 }
 
+bool SemanticManager::findChunkByKey(const std::string& key, SemanticChunk& out) {
+    size_t typeSep = key.rfind('|');
+    if (typeSep == std::string::npos || typeSep == 0) return false;
+    size_t lineSep = key.rfind('|', typeSep - 1);
+    if (lineSep == std::string::npos) return false;
+    std::string path = key.substr(0, lineSep);
+    std::string type = key.substr(typeSep + 1);
+    int startLine = 0;
+    try {
+        startLine = std::stoi(key.substr(lineSep + 1, typeSep - lineSep - 1));
+    } catch (...) {
+        return false;
+    }
+#ifdef PHOTON_USE_SQLITE
+    if (useSqlite) return loadChunkDb(path, startLine, type, out);
+#endif
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const auto& chunk : chunks) {
+        if (chunk.startLine == startLine && chunk.path == path && chunk.type == type) {
+            out = chunk;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SemanticManager::rebuildLexicalIndex() {
+    lexicalIndex.clear();
+#ifdef PHOTON_USE_SQLITE
+    if (useSqlite) {
+        if (!db) return;
+        const char* sql =
+            "SELECT path, start_line, type, content, byte_offset, byte_length, content_hash FROM semantic_chunks;";
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            SemanticChunk chunk;
+            const unsigned char* path = sqlite3_column_text(stmt, 0);
+            const unsigned char* type = sqlite3_column_text(stmt, 2);
+            const unsigned char* content = sqlite3_column_text(stmt, 3);
+            chunk.path = path ? reinterpret_cast<const char*>(path) : "";
+            chunk.startLine = sqlite3_column_int(stmt, 1);
+            chunk.type = type ? reinterpret_cast<const char*>(type) : "";
+            chunk.content = content ? reinterpret_cast<const char*>(content) : "";
+            chunk.byteOffset = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 4));
+            chunk.byteLength = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 5));
+            chunk.contentHash = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 6));
+            if (materialize(chunk)) indexLexical(chunk);
+        }
+        sqlite3_finalize(stmt);
+        return;
+    }
+#endif
+    std::vector<SemanticChunk> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        snapshot = chunks;
+    }
+    for (auto& chunk : snapshot) {
+        if (materialize(chunk)) indexLexical(chunk);
+    }
+}
+
+void SemanticManager::indexLexical(const SemanticChunk& chunk) {
+    // 路径参与分词，使文件名/目录名也能命中
+    lexicalIndex.addDocument(chunk.path + "|" + chunk.type, chunkKey(chunk), chunk.path + "\n" + chunk.content);
+}
+
 void SemanticManager::indexFile(const std::string& relPath, const std::string& type) {
     fs::path fullPath = fs::path(rootPath) / fs::u8path(relPath);
     if (!fs::exists(fullPath)) return;
 
-    std::ifstream file(fullPath);
-    if (!file.is_open()) return;
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    file.close();
+    // 二进制读取（共享缓存按原始字节保存）：chunk 的 byteOffset 必须与磁盘字节一致（避免 CRLF 转换）
+    auto cached = FileContentCache::getInstance().get(fullPath);
+    if (!cached) return;
+    const std::string& content = cached->text();
 
     removeChunksForFile(relPath, type);
     if (type == "markdown") {
@@ -110,114 +329,330 @@ void SemanticManager::indexFact(const std::string& key, const std::string& value
     chunk.type = "fact";
     chunk.startLine = 0;
     chunk.endLine = 0;
-    chunk.embedding = llmClient->getEmbedding(chunk.content);
+    chunk.embedding = embed(chunk.content);
     addChunk(chunk);
 }
 
 void SemanticManager::chunkMarkdown(const std::string& content, const std::string& relPath) {
-    // Split by headers
-    std::regex headerRegex(R"(^#{1,3}\s+(.*)$)");
-    auto words_begin = std::sregex_iterator(content.begin(), content.end(), headerRegex);
-    auto words_end = std::sregex_iterator();
-
-    size_t lastPos = 0;
+    // 按 1~3 级标题切分（逐行扫描，跳过 ``` 代码块内的 "#" 行）
+    auto emit = [&](size_t begin, size_t end, int startLine, int endLine) {
+        if (end - begin <= 50) return;
+        SemanticChunk chunk;
+        chunk.content = content.substr(begin, end - begin);
+        chunk.path = relPath;
+        chunk.type = "markdown";
+        chunk.startLine = startLine;
+        chunk.endLine = endLine;
+        chunk.byteOffset = begin;
+        chunk.byteLength = end - begin;
+        chunk.contentHash = fnv1a64(chunk.content);
+        chunk.embedding = embed(chunk.content);
+        addChunk(chunk);
+    };
+
+    size_t sectionStart = 0;
+    int sectionLine = 1;
     int lineNum = 1;
-    
-    for (std::sregex_iterator i = words_begin; i != words_end; ++i) {
-        std::smatch match = *i;
-        size_t currentPos = match.position();
-        
-        if (currentPos > lastPos) {
-            std::string chunkText = content.substr(lastPos, currentPos - lastPos);
-            if (chunkText.length() > 50) {
-                int chunkLineCount = 1 + static_cast<int>(std::count(chunkText.begin(), chunkText.end(), '\n'));
-                SemanticChunk chunk;
-                chunk.content = chunkText;
-                chunk.path = relPath;
-                chunk.type = "markdown";
-                chunk.startLine = lineNum;
-                chunk.endLine = lineNum + chunkLineCount - 1;
-                chunk.embedding = llmClient->getEmbedding(chunk.content);
-                addChunk(chunk);
+    bool inFence = false;
+    size_t pos = 0;
+    while (pos < content.size()) {
+        size_t lineEnd = content.find('\n', pos);
+        if (lineEnd == std::string::npos) lineEnd = content.size();
+        if (content.compare(pos, 3, "```") == 0) inFence = !inFence;
+
+        size_t hashes = 0;
+        while (pos + hashes < lineEnd && content[pos + hashes] == '#') ++hashes;
+        bool isHeader = !inFence && hashes >= 1 && hashes <= 3 && pos + hashes < lineEnd &&
+                        (content[pos + hashes] == ' ' || content[pos + hashes] == '\t');
+        if (isHeader && pos > sectionStart) {
+            emit(sectionStart, pos, sectionLine, lineNum - 1);
+            sectionStart = pos;
+            sectionLine = lineNum;
+        }
+        pos = lineEnd + 1;
+        ++lineNum;
+    }
+    if (sectionStart < content.size()) {
+        emit(sectionStart, content.size(), sectionLine, lineNum - 1);
+    }
+}
+
+namespace {
+// 代码分块参数（按估算 token 计，约 4 字符 / token）
+constexpr size_t kMaxChunkTokens = 512;     // 单个函数超过则按行切分
+constexpr size_t kSmallChunkTokens = 96;    // 小于该值的相邻符号尝试合并
+constexpr size_t kMergeBudgetTokens = 320;  // 合并后的上限
+constexpr int kClassHeaderMaxLines = 40;    // 类头最多保留的行数
+
+size_t estimateTokens(size_t chars) { return (chars + 3) / 4; }
+
+bool isTypeSymbol(const std::string& type) {
+    return type == "class" || type == "struct" || type == "interface" || type == "enum";
+}
+
+struct CodeSpan {
+    int start = 0;
+    int end = 0;
+    std::string label;
+    bool header = false;
+    bool split = false;  // 由过大函数切分而来，不再与相邻符号合并
+};
+} // namespace
+
+void SemanticManager::chunkCode(const std::string& content, const std::string& relPath) {
+    // 行首偏移表：lineStarts[i] 为第 i+1 行起点，末尾追加 content.size() 作为哨兵
+    std::vector<size_t> lineStarts{0};
+    for (size_t i = 0; i < content.size(); ++i) {
+        if (content[i] == '\n' && i + 1 < content.size()) lineStarts.push_back(i + 1);
+    }
+    const int totalLines = static_cast<int>(lineStarts.size());
+    lineStarts.push_back(content.size());
+    auto spanChars = [&](int a, int b) { return lineStarts[b] - lineStarts[a - 1]; };
+
+    std::vector<Symbol> symbols;
+    if (symbolMgr) symbols = symbolMgr->getFileSymbols(relPath);
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) {
+        if (a.line != b.line) return a.line < b.line;
+        return a.endLine > b.endLine;
+    });
+
+    std::vector<CodeSpan> spans;
+    if (!symbols.empty()) {
+        // endLine 未知（如 regex provider）时，取下一个符号起始行之前
+        auto resolveEnd = [&](size_t idx) {
+            const Symbol& s = symbols[idx];
+            if (s.endLine >= s.line) return std::min(s.endLine, totalLines);
+            for (size_t j = idx + 1; j < symbols.size(); ++j) {
+                if (symbols[j].line > s.line) return std::min(symbols[j].line - 1, totalLines);
+            }
+            return totalLines;
+        };
+
+        int coveredUntil = 0;  // 已作为整体输出的函数范围，内部嵌套符号（lambda 等）跳过
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            const Symbol& s = symbols[i];
+            if (s.line <= coveredUntil || s.line > totalLines) continue;
+            int end = std::max(resolveEnd(i), s.line);
+            if (isTypeSymbol(s.type)) {
+                int firstMember = 0;
+                for (size_t j = i + 1; j < symbols.size(); ++j) {
+                    if (symbols[j].line > end) break;
+                    if (symbols[j].line > s.line) { firstMember = symbols[j].line; break; }
+                }
+                if (firstMember > 0) {
+                    // 类头（声明到第一个成员之前）单独成块，成员在后续迭代中各自成块
+                    int headerEnd = std::min(firstMember - 1, s.line + kClassHeaderMaxLines - 1);
+                    spans.push_back({s.line, std::max(headerEnd, s.line), s.name, true});
+                    continue;
+                }
+            }
+            spans.push_back({s.line, end, s.name, false});
+            coveredUntil = end;
+        }
+    } else {
+        // 无符号信息：按行窗口切分，优先在空行处断开
+        int start = 1;
+        size_t chars = 0;
+        for (int line = 1; line <= totalLines; ++line) {
+            chars += spanChars(line, line);
+            bool blank = spanChars(line, line) <= 1;
+            if (estimateTokens(chars) >= kMaxChunkTokens ||
+                (blank && estimateTokens(chars) >= kMaxChunkTokens / 2) || line == totalLines) {
+                spans.push_back({start, line, "", false});
+                start = line + 1;
+                chars = 0;
             }
         }
-        
-        lastPos = currentPos;
-        // Count lines to update lineNum
-        lineNum += std::count(content.begin() + lastPos, content.begin() + currentPos, '\n');
     }
-    
-    // Last chunk
-    if (lastPos < content.length()) {
-        std::string chunkText = content.substr(lastPos);
-        if (chunkText.length() > 50) {
-            int chunkLineCount = 1 + static_cast<int>(std::count(chunkText.begin(), chunkText.end(), '\n'));
-            SemanticChunk chunk;
-            chunk.content = chunkText;
-            chunk.path = relPath;
-            chunk.type = "markdown";
-            chunk.startLine = lineNum;
-            chunk.endLine = lineNum + chunkLineCount - 1;
-            chunk.embedding = llmClient->getEmbedding(chunk.content);
-            addChunk(chunk);
+
+    // 过大的函数按行切分
+    std::vector<CodeSpan> sized;
+    for (const auto& span : spans) {
+        if (estimateTokens(spanChars(span.start, span.end)) <= kMaxChunkTokens) {
+            sized.push_back(span);
+            continue;
         }
+        int pieceStart = span.start;
+        size_t chars = 0;
+        for (int line = span.start; line <= span.end; ++line) {
+            chars += spanChars(line, line);
+            if (estimateTokens(chars) >= kMaxChunkTokens || line == span.end) {
+                sized.push_back({pieceStart, line, span.label, span.header, true});
+                pieceStart = line + 1;
+                chars = 0;
+            }
+        }
+    }
+
+    // 相邻小符号合并到 token 预算内（类头与切分片段不参与合并）
+    std::vector<CodeSpan> merged;
+    for (const auto& span : sized) {
+        if (!merged.empty()) {
+            CodeSpan& prev = merged.back();
+            size_t prevTokens = estimateTokens(spanChars(prev.start, prev.end));
+            size_t curTokens = estimateTokens(spanChars(span.start, span.end));
+            bool adjacent = span.start > prev.end && span.start <= prev.end + 3;
+            if (!prev.header && !span.header && !prev.split && !span.split && adjacent &&
+                (prevTokens < kSmallChunkTokens || curTokens < kSmallChunkTokens) &&
+                estimateTokens(spanChars(prev.start, span.end)) <= kMergeBudgetTokens) {
+                prev.end = span.end;
+                if (!span.label.empty()) prev.label += prev.label.empty() ? span.label : "," + span.label;
+                continue;
+            }
+        }
+        merged.push_back(span);
+    }
+
+    for (const auto& span : merged) {
+        size_t begin = lineStarts[span.start - 1];
+        std::string chunkText = content.substr(begin, spanChars(span.start, span.end));
+        if (chunkText.find_first_not_of(" \t\r\n") == std::string::npos) continue;
+        SemanticChunk chunk;
+        chunk.id = span.label;
+        chunk.content = std::move(chunkText);
+        chunk.path = relPath;
+        chunk.type = "code";
+        chunk.startLine = span.start;
+        chunk.endLine = span.end;
+        chunk.byteOffset = begin;
+        chunk.byteLength = chunk.content.size();
+        chunk.contentHash = fnv1a64(chunk.content);
+        chunk.embedding = embed(chunk.content);
+        addChunk(chunk);
     }
 }
 
-void SemanticManager::chunkCode(const std::string& content, const std::string& relPath) {
-    // Basic code chunking: split by large blocks or functions
-    // For now, let's use a simple approach: split by double newlines if they contain logic
-    std::regex blockRegex(R"(\n\n)");
-    auto words_begin = std::sregex_iterator(content.begin(), content.end(), blockRegex);
-    auto words_end = std::sregex_iterator();
+void SemanticManager::syncCodeIndex() {
+    // 先处理 search 中发现的过期文件
+    std::vector<std::pair<std::string, std::string>> staleNow;
+    {
+        std::lock_guard<std::mutex> lock(codeStateMtx);
+        staleNow.swap(staleFiles);
+    }
+    for (const auto& [relPath, type] : staleNow) {
+        if (stopRequested) return;
+        if (type == "code" && symbolMgr) continue;  // 代码文件由下面的哈希比对统一处理
+        if (fs::exists(fs::path(rootPath) / fs::u8path(relPath))) {
+            indexFile(relPath, type);
+        } else {
+            removeChunksForFile(relPath, type);
+        }
+    }
+    if (!staleNow.empty()) saveIndex();
 
-    size_t lastPos = 0;
-    int lineNum = 1;
+    if (!symbolMgr) return;
+    auto current = symbolMgr->getIndexedFileHashes();
 
-    for (std::sregex_iterator i = words_begin; i != words_end; ++i) {
-        std::smatch match = *i;
-        size_t currentPos = match.position();
-        
-        if (currentPos - lastPos > 200) { // Only chunk if large enough
-            std::string chunkText = content.substr(lastPos, currentPos - lastPos);
-            int chunkLineCount = 1 + static_cast<int>(std::count(chunkText.begin(), chunkText.end(), '\n'));
-            SemanticChunk chunk;
-            chunk.content = chunkText;
-            chunk.path = relPath;
-            chunk.type = "code";
-            chunk.startLine = lineNum;
-            chunk.endLine = lineNum + chunkLineCount - 1;
-            chunk.embedding = llmClient->getEmbedding(chunk.content);
-            addChunk(chunk);
+    std::vector<std::string> changed;
+    std::vector<std::string> removed;
+    {
+        std::lock_guard<std::mutex> lock(codeStateMtx);
+        for (const auto& [relPath, hash] : current) {
+            auto it = codeFileHashes.find(relPath);
+            if (it == codeFileHashes.end() || it->second != hash) changed.push_back(relPath);
+        }
+        for (const auto& [relPath, hash] : codeFileHashes) {
+            if (current.find(relPath) == current.end()) removed.push_back(relPath);
         }
-        
-        lineNum += std::count(content.begin() + lastPos, content.begin() + currentPos, '\n');
-        lastPos = currentPos + 2;
     }
+    if (changed.empty() && removed.empty()) return;
+    std::sort(changed.begin(), changed.end());
 
-    if (lastPos < content.length()) {
-        std::string chunkText = content.substr(lastPos);
-        if (chunkText.length() > 200) {
-            int chunkLineCount = 1 + static_cast<int>(std::count(chunkText.begin(), chunkText.end(), '\n'));
-            SemanticChunk chunk;
-            chunk.content = chunkText;
-            chunk.path = relPath;
-            chunk.type = "code";
-            chunk.startLine = lineNum;
-            chunk.endLine = lineNum + chunkLineCount - 1;
-            chunk.embedding = llmClient->getEmbedding(chunk.content);
-            addChunk(chunk);
+    for (const auto& relPath : removed) {
+        removeChunksForFile(relPath, "code");
+        std::lock_guard<std::mutex> lock(codeStateMtx);
+        codeFileHashes.erase(relPath);
+    }
+    for (const auto& relPath : changed) {
+        if (stopRequested) break;
+        indexFile(relPath, "code");
+        std::lock_guard<std::mutex> lock(codeStateMtx);
+        codeFileHashes[relPath] = current[relPath];
+    }
+    saveCodeState();
+    saveIndex();
+}
+
+void SemanticManager::requestCodeSync() {
+    if (stopRequested) return;
+    syncPending = true;
+    bool expected = false;
+    if (!syncRunning.compare_exchange_strong(expected, true)) return;
+    std::lock_guard<std::mutex> lock(threadMtx);
+    // 析构可能已在等待 syncThread：持锁后再检查一次，不再创建新线程
+    if (stopRequested) {
+        syncRunning = false;
+        return;
+    }
+    if (syncThread.joinable()) syncThread.join();
+    syncThread = std::thread([this]() {
+        do {
+            while (syncPending.exchange(false) && !stopRequested) {
+                try { syncCodeIndex(); } catch (...) {}
+            }
+            syncRunning = false;
+            // 退出前再次检查，避免丢失在清除 syncRunning 之前到达的请求
+        } while (syncPending && !stopRequested && !syncRunning.exchange(true));
+    });
+}
+
+fs::path SemanticManager::getCodeStatePath() const {
+    return fs::path(rootPath) / ".photon" / "index" / "semantic_code_state.json";
+}
+
+void SemanticManager::loadCodeState() {
+    fs::path statePath = getCodeStatePath();
+    if (!fs::exists(statePath)) return;
+    std::ifstream file(statePath);
+    if (!file.is_open()) return;
+    try {
+        nlohmann::json j;
+        file >> j;
+        // 换了 embedding 模型则旧分块的向量不可比，全部重新分块
+        if (j.value("model", "") != embeddingProvider->modelId() || !j.contains("files")) return;
+        std::lock_guard<std::mutex> lock(codeStateMtx);
+        codeFileHashes.clear();
+        for (auto& [relPath, hash] : j["files"].items()) {
+            codeFileHashes[relPath] = hash.get<std::uint64_t>();
         }
+    } catch (...) {}
+}
+
+void SemanticManager::saveCodeState() {
+    nlohmann::json j;
+    j["model"] = embeddingProvider->modelId();
+    j["files"] = nlohmann::json::object();
+    {
+        std::lock_guard<std::mutex> lock(codeStateMtx);
+        for (const auto& [relPath, hash] : codeFileHashes) j["files"][relPath] = hash;
     }
+    try {
+        fs::path statePath = getCodeStatePath();
+        fs::create_directories(statePath.parent_path());
+        std::ofstream file(statePath);
+        if (file.is_open()) file << j.dump();
+    } catch (...) {}
 }
 
 void SemanticManager::startAsyncIndexing() {
-    if (indexing) return;
-    indexing = true;
+    if (indexing.exchange(true)) return;
+    // 上一轮索引线程已清除 indexing，最多只剩 requestCodeSync 尚未返回；它会取 threadMtx，须在锁外 join
+    std::thread previous;
+    {
+        std::lock_guard<std::mutex> lock(threadMtx);
+        previous = std::move(indexingThread);
+    }
+    if (previous.joinable()) previous.join();
+    std::lock_guard<std::mutex> lock(threadMtx);
+    if (stopRequested) {
+        indexing = false;
+        return;
+    }
     indexingThread = std::thread([this]() {
         try {
             // 1. Index Markdown files
             for (const auto& entry : fs::recursive_directory_iterator(rootPath)) {
+                if (stopRequested) break;
                 if (entry.is_regular_file()) {
                     std::string ext = entry.path().extension().string();
                     if (ext == ".md") {
@@ -241,14 +676,13 @@ void SemanticManager::startAsyncIndexing() {
                 }
             }
 
-            // 3. Index core code files (limited to avoid too many API calls)
-            // In a real scenario, we'd be more selective or use a local model
-            
             saveIndex();
         } catch (...) {}
         indexing = false;
+
+        // 3. Code files: chunked by symbol ranges, only files whose hash changed
+        requestCodeSync();
     });
-    indexingThread.detach();
 }
 
 fs::path SemanticManager::getIndexPath() const {
@@ -259,21 +693,60 @@ fs::path SemanticManager::getDbPath() const {
     return fs::path(rootPath) / ".photon" / "index" / "semantic_index.sqlite";
 }
 
+fs::path SemanticManager::getLexicalIndexPath() const {
+    return fs::path(rootPath) / ".photon" / "index" / "lexical_index.bin";
+}
+
+fs::path SemanticManager::getEmbeddingCachePath() const {
+    return fs::path(rootPath) / ".photon" / "index" / "embedding_cache.json";
+}
+
+std::vector<float> SemanticManager::embed(const std::string& text) {
+    const std::string model = embeddingProvider->modelId();
+    std::vector<float> embedding;
+    if (embeddingCache->get(model, text, embedding)) return embedding;
+    embedding = embeddingProvider->embed(text);
+    embeddingCache->put(model, text, embedding);
+    return embedding;
+}
+
+std::vector<float> SemanticManager::embedQuery(const std::string& query) {
+    const std::string model = embeddingProvider->modelId();
+    std::vector<float> embedding;
+    if (queryEmbeddingCache->get(model, query, embedding)) return embedding;
+    embedding = embeddingProvider->embed(query);
+    queryEmbeddingCache->put(model, query, embedding);
+    return embedding;
+}
+
+EmbeddingCache::Stats SemanticManager::getEmbeddingCacheStats() const {
+    return embeddingCache->getStats();
+}
+
 void SemanticManager::saveIndex() {
+    embeddingCache->save();
+    lexicalIndex.save(getLexicalIndexPath());
 #ifdef PHOTON_USE_SQLITE
     if (useSqlite) return;
 #endif
     nlohmann::json j = nlohmann::json::array();
     std::lock_guard<std::mutex> lock(mtx);
     for (const auto& chunk : chunks) {
-        j.push_back({
-            {"content", chunk.content},
+        nlohmann::json item = {
             {"path", chunk.path},
             {"startLine", chunk.startLine},
             {"endLine", chunk.endLine},
             {"type", chunk.type},
             {"embedding", chunk.embedding}
-        });
+        };
+        if (chunk.byteLength > 0) {
+            item["offset"] = chunk.byteOffset;
+            item["length"] = chunk.byteLength;
+            item["hash"] = chunk.contentHash;
+        } else {
+            item["content"] = chunk.content;
+        }
+        j.push_back(std::move(item));
     }
     
     fs::path indexPath = getIndexPath();
@@ -307,12 +780,16 @@ void SemanticManager::loadIndex() {
             chunk.endLine = item.value("endLine", chunk.startLine);
             chunk.type = item.value("type", "");
             chunk.embedding = item.value("embedding", std::vector<float>());
-            chunks.push_back(chunk);
+            chunk.byteOffset = item.value("offset", static_cast<std::uint64_t>(0));
+            chunk.byteLength = item.value("length", static_cast<std::uint64_t>(0));
+            chunk.contentHash = item.value("hash", static_cast<std::uint64_t>(0));
+            chunks.push_back(std::move(chunk));
         }
     } catch (...) {}
 }
 
 void SemanticManager::removeChunksForFile(const std::string& relPath, const std::string& type) {
+    lexicalIndex.removeGroup(relPath + "|" + type);
 #ifdef PHOTON_USE_SQLITE
     if (useSqlite) {
         removeChunksForFileDb(relPath, type);
@@ -350,6 +827,10 @@ bool SemanticManager::initDb() {
         closeDb();
         return false;
     }
+    // 旧库迁移：列已存在时 ALTER 会失败，忽略即可
+    sqlite3_exec(db, "ALTER TABLE semantic_chunks ADD COLUMN byte_offset INTEGER NOT NULL DEFAULT 0;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "ALTER TABLE semantic_chunks ADD COLUMN byte_length INTEGER NOT NULL DEFAULT 0;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "ALTER TABLE semantic_chunks ADD COLUMN content_hash INTEGER NOT NULL DEFAULT 0;", nullptr, nullptr, nullptr);
     sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
     sqlite3_exec(db, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
     return true;
@@ -366,8 +847,8 @@ void SemanticManager::upsertChunkDb(const SemanticChunk& chunk) {
     if (!db) return;
     const char* sql =
         "INSERT OR REPLACE INTO semantic_chunks "
-        "(path, start_line, end_line, type, content, embedding, embedding_dim) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?);";
+        "(path, start_line, end_line, type, content, embedding, embedding_dim, byte_offset, byte_length, content_hash) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
 
     sqlite3_stmt* stmt = nullptr;
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return;
@@ -386,6 +867,9 @@ void SemanticManager::upsertChunkDb(const SemanticChunk& chunk) {
         sqlite3_bind_null(stmt, 6);
         sqlite3_bind_null(stmt, 7);
     }
+    sqlite3_bind_int64(stmt, 8, static_cast<sqlite3_int64>(chunk.byteOffset));
+    sqlite3_bind_int64(stmt, 9, static_cast<sqlite3_int64>(chunk.byteLength));
+    sqlite3_bind_int64(stmt, 10, static_cast<sqlite3_int64>(chunk.contentHash));
 
     sqlite3_step(stmt);
     sqlite3_finalize(stmt);
@@ -402,49 +886,95 @@ void SemanticManager::removeChunksForFileDb(const std::string& relPath, const st
     sqlite3_finalize(stmt);
 }
 
+bool SemanticManager::loadChunkDb(const std::string& relPath, int startLine, const std::string& type, SemanticChunk& out) {
+    if (!db) return false;
+    const char* sql =
+        "SELECT content, end_line, embedding, embedding_dim, byte_offset, byte_length, content_hash FROM semantic_chunks "
+        "WHERE path = ? AND start_line = ? AND type = ?;";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    sqlite3_bind_text(stmt, 1, relPath.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, startLine);
+    sqlite3_bind_text(stmt, 3, type.c_str(), -1, SQLITE_TRANSIENT);
+
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* content = sqlite3_column_text(stmt, 0);
+        const void* blob = sqlite3_column_blob(stmt, 2);
+        int blobSize = sqlite3_column_bytes(stmt, 2);
+        int dim = sqlite3_column_int(stmt, 3);
+        out.content = content ? reinterpret_cast<const char*>(content) : "";
+        out.path = relPath;
+        out.startLine = startLine;
+        out.endLine = sqlite3_column_int(stmt, 1);
+        out.type = type;
+        out.byteOffset = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 4));
+        out.byteLength = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 5));
+        out.contentHash = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 6));
+        out.stale = false;
+        out.embedding.clear();
+        if (blob && dim > 0 && blobSize == dim * static_cast<int>(sizeof(float))) {
+            out.embedding.resize(static_cast<size_t>(dim));
+            std::memcpy(out.embedding.data(), blob, static_cast<size_t>(blobSize));
+        }
+        found = true;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
 std::vector<SemanticChunk> SemanticManager::searchDb(const std::vector<float>& queryEmbedding, int topK) {
     std::vector<SemanticChunk> results;
-    if (!db || queryEmbedding.empty()) return results;
+    if (!db || queryEmbedding.empty() || topK <= 0) return results;
 
-    const char* sql = "SELECT content, path, start_line, end_line, type, embedding, embedding_dim FROM semantic_chunks;";
+    // 不读取 content：正文只为最终结果按偏移量读取（见 materialize）
+    const char* sql =
+        "SELECT path, start_line, end_line, type, embedding, embedding_dim, content, "
+        "byte_offset, byte_length, content_hash FROM semantic_chunks;";
     sqlite3_stmt* stmt = nullptr;
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return results;
 
+    auto byScore = [](const SemanticChunk& a, const SemanticChunk& b) { return a.score > b.score; };
+    std::vector<float> embedding(queryEmbedding.size());
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const unsigned char* content = sqlite3_column_text(stmt, 0);
-        const unsigned char* path = sqlite3_column_text(stmt, 1);
-        int startLine = sqlite3_column_int(stmt, 2);
-        int endLine = sqlite3_column_int(stmt, 3);
-        const unsigned char* type = sqlite3_column_text(stmt, 4);
-        const void* blob = sqlite3_column_blob(stmt, 5);
-        int blobSize = sqlite3_column_bytes(stmt, 5);
-        int dim = sqlite3_column_int(stmt, 6);
-
+        const void* blob = sqlite3_column_blob(stmt, 4);
+        int blobSize = sqlite3_column_bytes(stmt, 4);
+        int dim = sqlite3_column_int(stmt, 5);
         if (!blob || blobSize <= 0 || dim <= 0) continue;
-        if (static_cast<size_t>(dim) != queryEmbedding.size()) continue;
+        if (static_cast<size_t>(dim) != queryEmbedding.size() ||
+            blobSize != dim * static_cast<int>(sizeof(float))) continue;
 
-        std::vector<float> embedding(dim);
         std::memcpy(embedding.data(), blob, static_cast<size_t>(blobSize));
+        float score = cosineSimilarity(queryEmbedding, embedding);
+        // 小顶堆维护 top-K，避免为全部行构造结果
+        if (results.size() >= static_cast<size_t>(topK) && score <= results.front().score) continue;
 
         SemanticChunk chunk;
-        chunk.content = content ? reinterpret_cast<const char*>(content) : "";
+        const unsigned char* path = sqlite3_column_text(stmt, 0);
+        const unsigned char* type = sqlite3_column_text(stmt, 3);
         chunk.path = path ? reinterpret_cast<const char*>(path) : "";
+        chunk.startLine = sqlite3_column_int(stmt, 1);
+        chunk.endLine = sqlite3_column_int(stmt, 2);
         chunk.type = type ? reinterpret_cast<const char*>(type) : "";
-        chunk.startLine = startLine;
-        chunk.endLine = endLine;
-        chunk.embedding = std::move(embedding);
-        chunk.score = cosineSimilarity(queryEmbedding, chunk.embedding);
-        results.push_back(std::move(chunk));
+        chunk.byteOffset = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 7));
+        chunk.byteLength = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 8));
+        chunk.contentHash = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 9));
+        if (chunk.byteLength == 0) {
+            const unsigned char* content = sqlite3_column_text(stmt, 6);
+            chunk.content = content ? reinterpret_cast<const char*>(content) : "";
+        }
+        chunk.score = score;
+        if (results.size() >= static_cast<size_t>(topK)) {
+            std::pop_heap(results.begin(), results.end(), byScore);
+            results.back() = std::move(chunk);
+        } else {
+            results.push_back(std::move(chunk));
+        }
+        std::push_heap(results.begin(), results.end(), byScore);
     }
 
     sqlite3_finalize(stmt);
-
-    std::sort(results.begin(), results.end(), [](const SemanticChunk& a, const SemanticChunk& b) {
-        return a.score > b.score;
-    });
-    if (results.size() > static_cast<size_t>(topK)) {
-        results.resize(topK);
-    }
+    std::sort_heap(results.begin(), results.end(), byScore);
     return results;
 }
 #endif
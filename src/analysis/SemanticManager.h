@@ -5,17 +5,27 @@
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <unordered_map>
 #include "core/LLMClient.h"
+#include "analysis/EmbeddingCache.h"
+#include "analysis/LexicalIndex.h"
 
 namespace fs = std::filesystem;
 
+class SymbolManager;
+
 #ifdef PHOTON_USE_SQLITE
 struct sqlite3;
 #endif
 
 struct SemanticChunk {
     std::string id;
+    /**
+     * 文件来源的 chunk（byteLength > 0）在索引中不保存正文，只保存 (path, byteOffset, byteLength, contentHash)；
+     * search 只为返回结果按需从文件读取并校验哈希。fact 等非文件 chunk 仍内联保存正文。
+     */
     std::string content;
     std::string path;
     int startLine;
@@ -23,11 +33,30 @@ struct SemanticChunk {
     std::string type; // "code", "markdown", "fact", "skill"
     std::vector<float> embedding;
     float score = 0.0f; // For search results
+    std::uint64_t byteOffset = 0;
+    std::uint64_t byteLength = 0;
+    std::uint64_t contentHash = 0;
+    bool stale = false; // 文件已变化，offset 处内容与哈希不符
+};
+
+/**
+ * Embedding 提供者：SemanticManager 通过它把文本转成向量。
+ * 内置两种实现：RemoteEmbeddingProvider（LLMClient 远端接口）与 LocalEmbeddingProvider（离线哈希投影）。
+ */
+class IEmbeddingProvider {
+public:
+    virtual ~IEmbeddingProvider() = default;
+    /** 失败时返回空向量 */
+    virtual std::vector<float> embed(const std::string& text) = 0;
+    /** 模型标识：参与 embedding 缓存键；算法或维度不同必须返回不同值 */
+    virtual std::string modelId() const = 0;
 };
 
 class SemanticManager {
 public:
+    /** 使用 LLMClient 远端 embedding（RemoteEmbeddingProvider） */
     SemanticManager(const std::string& rootPath, std::shared_ptr<LLMClient> llmClient);
+    SemanticManager(const std::string& rootPath, std::unique_ptr<IEmbeddingProvider> provider);
     ~SemanticManager();
 
     // Add or update a chunk in the index
@@ -37,7 +66,10 @@ public:
     void indexFile(const std::string& relPath, const std::string& type);
     void indexFact(const std::string& key, const std::string& value);
     
-    // Unify search across code and knowledge
+    /**
+     * 混合检索：BM25 词法索引与向量余弦相似度各取候选，按 reciprocal-rank fusion 融合。
+     * embedding 不可用（离线、远端失败）时退化为纯词法检索。score 归一化到 [0,1]。
+     */
     std::vector<SemanticChunk> search(const std::string& query, int topK = 5);
 
     // Save/Load index
@@ -47,14 +79,48 @@ public:
     // Background indexing
     void startAsyncIndexing();
 
+    /**
+     * 代码分块依赖 SymbolManager 的 line/endLine 范围：每个函数一个 chunk（过大则切分），
+     * 类头单独成块，相邻小符号合并到 token 预算内。未设置时退回按行窗口切分。
+     */
+    void setSymbolManager(SymbolManager* mgr) { symbolMgr = mgr; }
+
+    /** 增量同步代码索引：仅对内容哈希变化的文件重新分块，已删除文件移除其 chunk（阻塞） */
+    void syncCodeIndex();
+    /** 后台触发 syncCodeIndex；运行中再次请求会在本轮结束后补跑一次。供 SymbolManager::setOnIndexUpdated 使用 */
+    void requestCodeSync();
+
+    /** 为文件来源的 chunk 读取正文并校验哈希；不一致时标记 stale 并返回 false */
+    bool materialize(SemanticChunk& chunk) const;
+
+    // Embedding cache hit/miss counters
+    EmbeddingCache::Stats getEmbeddingCacheStats() const;
+
 private:
     std::string rootPath;
-    std::shared_ptr<LLMClient> llmClient;
+    std::unique_ptr<IEmbeddingProvider> embeddingProvider;
     std::vector<SemanticChunk> chunks;
-    std::thread indexingThread;
+    std::thread indexingThread;  // 由 threadMtx 保护；析构时先于 syncThread join
     std::atomic<bool> indexing{false};
     mutable std::mutex mtx;
     bool useSqlite = false;
+    std::unique_ptr<EmbeddingCache> embeddingCache;
+    // 查询文本的 embedding：只在内存中保留最近若干条，不写入 embedding_cache.json（否则文件随查询次数增长）
+    std::unique_ptr<EmbeddingCache> queryEmbeddingCache;
+    LexicalIndex lexicalIndex;
+    SymbolManager* symbolMgr = nullptr;
+
+    // 代码索引增量状态：relPath -> 上次分块时的内容哈希
+    std::unordered_map<std::string, std::uint64_t> codeFileHashes;
+    std::mutex codeStateMtx;
+    std::thread syncThread;  // 由 threadMtx 保护
+    // 保护 indexingThread / syncThread 的创建与 join：requestCodeSync 可能在索引线程上与析构并发
+    std::mutex threadMtx;
+    std::atomic<bool> syncRunning{false};
+    std::atomic<bool> syncPending{false};
+    std::atomic<bool> stopRequested{false};
+    // search 中发现过期的 (path, type)，由后台同步线程重新索引
+    std::vector<std::pair<std::string, std::string>> staleFiles;
 #ifdef PHOTON_USE_SQLITE
     sqlite3* db = nullptr;
     bool initDb();
@@ -62,11 +128,28 @@ private:
     void upsertChunkDb(const SemanticChunk& chunk);
     void removeChunksForFileDb(const std::string& relPath, const std::string& type);
     std::vector<SemanticChunk> searchDb(const std::vector<float>& queryEmbedding, int topK);
+    bool loadChunkDb(const std::string& relPath, int startLine, const std::string& type, SemanticChunk& out);
 #endif
     
     fs::path getIndexPath() const;
     fs::path getDbPath() const;
+    fs::path getEmbeddingCachePath() const;
+    fs::path getLexicalIndexPath() const;
+    void init();
+    fs::path getCodeStatePath() const;
+    void loadCodeState();
+    void saveCodeState();
+    // 先查 embedding 缓存，未命中再调用 embeddingProvider
+    std::vector<float> embed(const std::string& text);
+    std::vector<float> embedQuery(const std::string& query);
     float cosineSimilarity(const std::vector<float>& v1, const std::vector<float>& v2);
+
+    // Hybrid retrieval helpers
+    static std::string chunkKey(const SemanticChunk& chunk);
+    std::vector<SemanticChunk> searchVectors(const std::vector<float>& queryEmbedding, size_t topK);
+    bool findChunkByKey(const std::string& key, SemanticChunk& out);
+    void indexLexical(const SemanticChunk& chunk);
+    void rebuildLexicalIndex();
     
     // Chunking helpers
     void chunkMarkdown(const std::string& content, const std::string& relPath);
@@ -2,6 +2,8 @@
 #include "analysis/providers/TreeSitterSymbolProvider.h"
 #include "analysis/LSPClient.h"
 #include "utils/ScanIgnore.h"
+#include "utils/FileContentCache.h"
+#include "utils/Hash.h"
 #include <algorithm>
 #include <fstream>
 #include <iterator>
@@ -12,19 +14,6 @@
 #include <unordered_set>
 #include <limits>
 
-namespace {
-std::uint64_t fnv1a64(const std::string& data) {
-    const std::uint64_t offset = 1469598103934665603ull;
-    const std::uint64_t prime = 1099511628211ull;
-    std::uint64_t hash = offset;
-    for (unsigned char c : data) {
-        hash ^= static_cast<std::uint64_t>(c);
-        hash *= prime;
-    }
-    return hash;
-}
-} // namespace
-
 static std::string makeSymbolKey(const Symbol& s) {
     return s.path + ":" + std::to_string(s.line) + ":" + s.name;
 }
@@ -150,7 +139,9 @@ bool SymbolManager::isIndexUpToDate() {
         }
 
         // If we have tracked files that no longer exist (or became ignored), index is stale.
+        // 不支持的文件也记录了 meta（只用于变化检测），不参与判断
         for (const auto& pair : metaSnapshot) {
+            if (!supportsExt(fs::u8path(pair.first).extension().string())) continue;
             if (seen.find(pair.first) == seen.end()) {
                 return false;
             }
@@ -246,11 +237,16 @@ void SymbolManager::performScan() {
         std::vector<std::string> filesToRemove;
         {
             std::unique_lock<std::shared_mutex> lock(mtx);
-            for (const auto& [path, _] : fileSymbols) {
+            for (const auto& [path, _] : fileMeta) {
                 if (seenFiles.find(path) == seenFiles.end()) {
                     filesToRemove.push_back(path);
                 }
             }
+            for (const auto& [path, _] : fileSymbols) {
+                if (seenFiles.find(path) == seenFiles.end() && fileMeta.find(path) == fileMeta.end()) {
+                    filesToRemove.push_back(path);
+                }
+            }
         }
         
         // 一次性更新所有数据（持有锁时间最短）
@@ -288,6 +284,7 @@ void SymbolManager::performScan() {
         std::cout << "[SymbolManager] Index saved" << std::endl;
     }
     scanning = false;
+    if (onFilesChanged) onFilesChanged({});
     if (onIndexUpdated) onIndexUpdated();
 }
 
@@ -373,11 +370,16 @@ void SymbolManager::checkFileChanges() {
         std::vector<std::string> filesToRemove;
         {
             std::unique_lock<std::shared_mutex> lock(mtx);
-            for (const auto& [path, _] : fileSymbols) {
+            for (const auto& [path, _] : fileMeta) {
                 if (currentFiles.find(path) == currentFiles.end()) {
                     filesToRemove.push_back(path);
                 }
             }
+            for (const auto& [path, _] : fileSymbols) {
+                if (currentFiles.find(path) == currentFiles.end() && fileMeta.find(path) == fileMeta.end()) {
+                    filesToRemove.push_back(path);
+                }
+            }
         }
         
         // 一次性更新（持有锁时间最短）
@@ -411,6 +413,11 @@ void SymbolManager::checkFileChanges() {
         
         if (!filesToUpdate.empty() || !filesToRemove.empty()) {
             saveIndex();
+            if (onFilesChanged) {
+                std::vector<std::string> changed = filesToRemove;
+                for (const auto& pair : updatedFiles) changed.push_back(pair.first);
+                onFilesChanged(changed);
+            }
             if (onIndexUpdated) onIndexUpdated();
         }
     } catch (...) {}
@@ -474,16 +481,6 @@ void SymbolManager::scanFile(const fs::path& filePath, std::vector<Symbol>& loca
     std::transform(extLower.begin(), extLower.end(), extLower.begin(), ::tolower);
     bool lspSupported = (lspByExtSnapshot.find(extLower) != lspByExtSnapshot.end()) || (lspFallbackSnapshot != nullptr);
     
-    // 策略：只依赖 providers 决定是否扫描
-    // LSP 仅用于符号提取的回退，不影响扫描决策
-    if (!supported) {
-        return;
-    }
-    const std::vector<ISymbolProvider*>& primaryProviders =
-        !treeProviders.empty() ? treeProviders : fallbackProviders;
-    const std::vector<ISymbolProvider*>& secondaryProviders =
-        (!treeProviders.empty() && !fallbackProviders.empty()) ? fallbackProviders : treeProviders;
-
     FileMeta meta;
     try {
         meta.size = fs::file_size(filePath);
@@ -493,10 +490,22 @@ void SymbolManager::scanFile(const fs::path& filePath, std::vector<Symbol>& loca
         meta.mtime = std::chrono::system_clock::to_time_t(sctp);
     } catch (...) {}
 
-    std::ifstream file(filePath);
-    if (!file.is_open()) return;
+    // 策略：只依赖 providers 决定是否扫描
+    // LSP 仅用于符号提取的回退，不影响扫描决策
+    // 不支持的文件不读内容，但记录 size / mtime，否则 checkFileChanges 每轮都把它当作已修改
+    if (!supported) {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        fileMeta[relPath] = meta;
+        return;
+    }
+    const std::vector<ISymbolProvider*>& primaryProviders =
+        !treeProviders.empty() ? treeProviders : fallbackProviders;
+    const std::vector<ISymbolProvider*>& secondaryProviders =
+        (!treeProviders.empty() && !fallbackProviders.empty()) ? fallbackProviders : treeProviders;
 
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto cached = FileContentCache::getInstance().get(filePath);
+    if (!cached) return;
+    const std::string& content = cached->text();
     meta.hash = fnv1a64(content);
 
     {
@@ -505,6 +514,8 @@ void SymbolManager::scanFile(const fs::path& filePath, std::vector<Symbol>& loca
         auto itSymbols = fileSymbols.find(relPath);
         if (itMeta != fileMeta.end() && itSymbols != fileSymbols.end()) {
             if (itMeta->second.hash == meta.hash) {
+                // 内容未变（如仅 touch）：刷新 size / mtime，下一轮不再报告变化
+                itMeta->second = meta;
                 localSymbols.insert(localSymbols.end(), itSymbols->second.begin(), itSymbols->second.end());
                 return;
             }
@@ -1095,13 +1106,19 @@ void SymbolManager::getFileSymbolsBatch(const std::vector<std::string>& relPaths
     }
 }
 
-std::optional<SymbolManager::Symbol> SymbolManager::findEnclosingSymbol(const std::string& relPath, int line) {
-    if (line <= 0) return std::nullopt;
+std::unordered_map<std::string, std::uint64_t> SymbolManager::getIndexedFileHashes() const {
+    std::unordered_map<std::string, std::uint64_t> out;
     std::shared_lock<std::shared_mutex> lock(mtx);
-    auto it = fileSymbols.find(relPath);
-    if (it == fileSymbols.end()) return std::nullopt;
+    for (const auto& [relPath, syms] : fileSymbols) {
+        if (syms.empty()) continue;
+        auto itMeta = fileMeta.find(relPath);
+        out[relPath] = (itMeta != fileMeta.end()) ? itMeta->second.hash : 0;
+    }
+    return out;
+}
 
-    const auto& symbols = it->second;
+// 包含 line 的最内层符号：范围最小者优先，范围相同取起始行靠后者；endLine 未知视为延伸到文件末尾
+static const Symbol* pickEnclosing(const std::vector<Symbol>& symbols, int line) {
     const Symbol* best = nullptr;
     int bestSpan = std::numeric_limits<int>::max();
     int bestStart = -1;
@@ -1118,11 +1135,49 @@ std::optional<SymbolManager::Symbol> SymbolManager::findEnclosingSymbol(const st
             bestStart = s.line;
         }
     }
+    return best;
+}
+
+std::optional<SymbolManager::Symbol> SymbolManager::findEnclosingSymbol(const std::string& relPath, int line) {
+    if (line <= 0) return std::nullopt;
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = fileSymbols.find(relPath);
+    if (it == fileSymbols.end()) return std::nullopt;
 
+    const Symbol* best = pickEnclosing(it->second, line);
     if (!best) return std::nullopt;
     return *best;
 }
 
+std::vector<std::optional<SymbolManager::Symbol>> SymbolManager::findEnclosingSymbols(
+    const std::vector<std::pair<std::string, int>>& queries) {
+    std::vector<std::optional<Symbol>> out(queries.size());
+    if (queries.empty()) return out;
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    // 同一文件的查询通常相邻（grep 结果按文件有序）：只在文件变化时查一次 fileSymbols，同一行的结果复用
+    const std::vector<Symbol>* symbols = nullptr;
+    const std::string* currentFile = nullptr;
+    const Symbol* lastBest = nullptr;
+    int lastLine = -1;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto& [relPath, line] = queries[i];
+        if (line <= 0) continue;
+        if (!currentFile || *currentFile != relPath) {
+            auto it = fileSymbols.find(relPath);
+            symbols = it == fileSymbols.end() ? nullptr : &it->second;
+            currentFile = &relPath;
+            lastLine = -1;
+        }
+        if (!symbols) continue;
+        if (line != lastLine) {
+            lastBest = pickEnclosing(*symbols, line);
+            lastLine = line;
+        }
+        if (lastBest) out[i] = *lastBest;
+    }
+    return out;
+}
+
 std::vector<SymbolManager::CallInfo> SymbolManager::getCallsForSymbol(const Symbol& symbol) {
     std::shared_lock<std::shared_mutex> lock(mtx);
     auto it = symbolCalls.find(makeSymbolKey(symbol));
@@ -1161,10 +1216,9 @@ std::vector<std::string> SymbolManager::getCallerKeysForSymbol(const Symbol& sym
 
 std::vector<SymbolManager::CallInfo> SymbolManager::extractCalls(const std::string& relPath, int startLine, int endLine) {
     fs::path fullPath = fs::path(rootPath) / fs::u8path(relPath);
-    std::ifstream file(fullPath);
-    if (!file.is_open()) return {};
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    file.close();
+    auto cached = FileContentCache::getInstance().get(fullPath);
+    if (!cached) return {};
+    const std::string& content = cached->text();
 
     std::vector<CallInfo> allCalls;
     std::unique_lock<std::shared_mutex> lock(mtx);
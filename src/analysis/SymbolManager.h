@@ -13,6 +13,7 @@
 #include <atomic>
 #include <unordered_map>
 #include <optional>
+#include <utility>
 
 namespace fs = std::filesystem;
 
@@ -55,6 +56,13 @@ public:
 
     /** 当符号索引更新后调用（全量扫描或 watch 增量更新）；用于同步刷新 dictionary 等。可设为 nullptr 禁用。 */
     void setOnIndexUpdated(std::function<void()> cb) { onIndexUpdated = std::move(cb); }
+    /**
+     * 检测到文件变化时调用（在扫描 / watch 线程上），参数为变化或删除的相对路径；
+     * 全量扫描完成时参数为空，表示变化范围未知。应在 startWatching 前设置。
+     */
+    void setOnFilesChanged(std::function<void(const std::vector<std::string>& relPaths)> cb) {
+        onFilesChanged = std::move(cb);
+    }
 
     // Start asynchronous full scan
     void startAsyncScan();
@@ -87,9 +95,15 @@ public:
     void getFileSymbolsBatch(const std::vector<std::string>& relPaths,
                             std::unordered_map<std::string, std::vector<Symbol>>& out);
 
+    /** 有符号的已索引文件的内容哈希快照（relPath -> hash），供语义索引判断哪些文件需要重新分块 */
+    std::unordered_map<std::string, std::uint64_t> getIndexedFileHashes() const;
+
     // Find the most specific symbol that encloses a line
     std::optional<Symbol> findEnclosingSymbol(const std::string& relPath, int line);
 
+    /** 批量版 findEnclosingSymbol：一次读锁，结果与 queries（relPath, line）下标一一对应；grep 标注等大量查询使用 */
+    std::vector<std::optional<Symbol>> findEnclosingSymbols(const std::vector<std::pair<std::string, int>>& queries);
+
     struct CallInfo {
         std::string name;
         int line;
@@ -142,6 +156,7 @@ private:
     int watchInterval = 5;
 
     std::function<void()> onIndexUpdated;
+    std::function<void(const std::vector<std::string>&)> onFilesChanged;
 
     void performScan();
     void watchLoop();
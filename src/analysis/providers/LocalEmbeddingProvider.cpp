@@ -0,0 +1,139 @@
+#include "analysis/providers/LocalEmbeddingProvider.h"
+#include "utils/Hash.h"
+#include <cmath>
+
+namespace {
+// 不同特征类别使用不同盐值，避免同一字符串在不同类别中落到同一维度
+constexpr std::uint64_t kWordSalt = 0x9e3779b97f4a7c15ull;
+constexpr std::uint64_t kSubwordSalt = 0xc2b2ae3d27d4eb4full;
+constexpr std::uint64_t kGramSalt = 0x165667b19e3779f9ull;
+constexpr std::uint64_t kWideSalt = 0x27d4eb2f165667c5ull;
+
+constexpr float kWordWeight = 1.0f;
+constexpr float kSubwordWeight = 1.0f;
+constexpr float kGramWeight = 0.35f;
+constexpr float kWideUnigramWeight = 0.5f;
+constexpr float kWideBigramWeight = 1.0f;
+
+inline std::uint64_t mix64(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+inline void addFeature(std::vector<float>& v, const char* data, size_t size, std::uint64_t salt, float weight) {
+    std::uint64_t h = mix64(fnv1a64(data, size) ^ salt);
+    float sign = (h >> 63) ? -1.0f : 1.0f;
+    v[static_cast<size_t>(h % v.size())] += sign * weight;
+}
+
+inline bool isIdentChar(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+inline bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+inline bool isLower(char c) { return c >= 'a' && c <= 'z'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline size_t utf8Length(unsigned char lead) {
+    if (lead >= 0xF0) return 4;
+    if (lead >= 0xE0) return 3;
+    if (lead >= 0xC0) return 2;
+    return 1;
+}
+
+void addWordFeatures(std::vector<float>& v, const char* word, size_t len, std::string& lower, std::string& gram) {
+    lower.assign(word, len);
+    for (auto& c : lower) {
+        if (isUpper(c)) c = static_cast<char>(c - 'A' + 'a');
+    }
+    if (len >= 2) addFeature(v, lower.data(), len, kWordSalt, kWordWeight);
+
+    // 子词：按 '_'、小写->大写、字母<->数字、"HTTPServer" 中的 P|S 边界切分；与整词相同则不重复计入
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && word[i] == '_') ++i;
+        if (i >= len) break;
+        size_t start = i++;
+        while (i < len) {
+            char prev = word[i - 1];
+            char cur = word[i];
+            if (cur == '_') break;
+            if (isLower(prev) && isUpper(cur)) break;
+            if (isDigit(prev) != isDigit(cur)) break;
+            if (isUpper(prev) && isUpper(cur) && i + 1 < len && isLower(word[i + 1])) break;
+            ++i;
+        }
+        if (i - start >= 2 && i - start < len) {
+            addFeature(v, lower.data() + start, i - start, kSubwordSalt, kSubwordWeight);
+        }
+    }
+
+    // 字符三元组（带词边界），对拼写变体/词形变化鲁棒
+    if (len >= 3) {
+        gram.assign(1, '^');
+        gram += lower;
+        gram += '$';
+        for (size_t i = 0; i + 3 <= gram.size(); ++i) {
+            addFeature(v, gram.data() + i, 3, kGramSalt, kGramWeight);
+        }
+    }
+}
+} // namespace
+
+LocalEmbeddingProvider::LocalEmbeddingProvider(size_t dimensions) : dims(dimensions == 0 ? 384 : dimensions) {}
+
+std::string LocalEmbeddingProvider::modelId() const {
+    return "local-hash-v1-" + std::to_string(dims);
+}
+
+std::vector<float> LocalEmbeddingProvider::embed(const std::string& text) {
+    std::vector<float> v(dims, 0.0f);
+    std::string lower;
+    std::string gram;
+    const char* data = text.data();
+    const size_t n = text.size();
+
+    size_t prevWideStart = std::string::npos;
+    size_t prevWideLen = 0;
+    size_t i = 0;
+    while (i < n) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if (isIdentChar(c)) {
+            size_t start = i;
+            while (i < n && isIdentChar(static_cast<unsigned char>(data[i]))) ++i;
+            addWordFeatures(v, data + start, i - start, lower, gram);
+            prevWideStart = std::string::npos;
+            continue;
+        }
+        if (c >= 0x80) {
+            // 非 ASCII（中文等）：单字 + 相邻双字
+            size_t len = utf8Length(c);
+            if (i + len > n) len = n - i;
+            addFeature(v, data + i, len, kWideSalt, kWideUnigramWeight);
+            if (prevWideStart != std::string::npos) {
+                addFeature(v, data + prevWideStart, prevWideLen + len, kWideSalt, kWideBigramWeight);
+            }
+            prevWideStart = i;
+            prevWideLen = len;
+            i += len;
+            continue;
+        }
+        prevWideStart = std::string::npos;
+        ++i;
+    }
+
+    // 次线性缩放（抑制高频词），再 L2 归一化
+    double norm = 0.0;
+    for (auto& x : v) {
+        x = x >= 0.0f ? std::sqrt(x) : -std::sqrt(-x);
+        norm += static_cast<double>(x) * x;
+    }
+    if (norm > 0.0) {
+        float inv = static_cast<float>(1.0 / std::sqrt(norm));
+        for (auto& x : v) x *= inv;
+    }
+    return v;
+}
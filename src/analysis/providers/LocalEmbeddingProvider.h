@@ -0,0 +1,19 @@
+#pragma once
+#include "analysis/SemanticManager.h"
+
+/**
+ * 离线 embedding：无需网络与 GPU。
+ * 特征 = 标识符整体 + camelCase/snake_case 子词 + 字符三元组 + 非 ASCII（中文等）单字/双字，
+ * 经签名特征哈希投影到固定维度的稠密向量，做次线性缩放后 L2 归一化。
+ * 语义能力弱于远端模型，但对代码标识符与关键词的相似度足够稳定，适合 CI / 离线环境。
+ */
+class LocalEmbeddingProvider : public IEmbeddingProvider {
+public:
+    explicit LocalEmbeddingProvider(size_t dimensions = 384);
+
+    std::vector<float> embed(const std::string& text) override;
+    std::string modelId() const override;
+
+private:
+    size_t dims;
+};
@@ -0,0 +1,13 @@
+#include "analysis/providers/RemoteEmbeddingProvider.h"
+
+RemoteEmbeddingProvider::RemoteEmbeddingProvider(std::shared_ptr<LLMClient> llmClient)
+    : llmClient(std::move(llmClient)) {}
+
+std::vector<float> RemoteEmbeddingProvider::embed(const std::string& text) {
+    if (!llmClient) return {};
+    return llmClient->getEmbedding(text);
+}
+
+std::string RemoteEmbeddingProvider::modelId() const {
+    return llmClient ? llmClient->getEmbeddingModel() : "remote";
+}
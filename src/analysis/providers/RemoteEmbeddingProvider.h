@@ -0,0 +1,14 @@
+#pragma once
+#include "analysis/SemanticManager.h"
+
+/** 远端 embedding：转发到 LLMClient::getEmbedding（需要网络与 API Key） */
+class RemoteEmbeddingProvider : public IEmbeddingProvider {
+public:
+    explicit RemoteEmbeddingProvider(std::shared_ptr<LLMClient> llmClient);
+
+    std::vector<float> embed(const std::string& text) override;
+    std::string modelId() const override;
+
+private:
+    std::shared_ptr<LLMClient> llmClient;
+};
@@ -13,10 +13,57 @@ struct Config {
         std::string systemRole;
         /** 单次回复最大 token 数，0 表示不传（用 API 默认）。写大文件时若被截断可调大，如 8192、16384。 */
         int maxTokens = 0;
+        /** 每个 host 的 keep-alive 连接上限；0 表示不复用连接（每次请求新建） */
+        int poolMaxPerHost = 4;
+        /** 空闲连接超过该秒数后关闭重建 */
+        int poolIdleTimeoutSec = 60;
+        /** 新连接复用最近的 TLS 会话，跳过完整握手 */
+        bool tlsSessionReuse = true;
+        /** 校验服务器证书；仅在对接自签名的本地网关/测试服务时关闭 */
+        bool verifyTls = true;
+        /** 流式输出（SSE）：边生成边渲染，只读工具在参数到齐后提前执行 */
+        bool stream = true;
+        /** LLM 请求调度器的 worker 线程数（同步调用在 worker 上执行，异步调用在此排队） */
+        int schedulerWorkers = 4;
+        /** chat/completions 与 embeddings 各自的并发上限（非交互请求至多占用上限-1） */
+        int maxConcurrentChat = 2;
+        int maxConcurrentEmbeddings = 2;
+        /** 模型上下文窗口（token）；>0 时压缩阈值不超过 context_window - max_tokens，0 表示未知 */
+        int contextWindow = 0;
+        /**
+         * 按用途路由（planner / summarizer / embedder）：每项可单独指定 model、base_url、api_key、
+         * timeout_sec、max_tokens、max_concurrent，未写的字段沿用上面的主配置。
+         * 典型用法是给 summarizer 配一个小而快的模型，压缩与读取摘要不拖慢主循环。
+         */
+        struct Route {
+            std::string purpose;
+            std::string model;
+            std::string baseUrl;
+            std::string apiKey;
+            int timeoutSec = 0;
+            int maxTokens = -1;
+            int maxConcurrent = 0;
+        };
+        std::vector<Route> routes;
     } llm;
 
     struct Agent {
+        /** 上下文超过该 token 数时压缩中间历史 */
         size_t contextThreshold;
+        /** 软水位（占 context_threshold 的比例）：超过后在后台把最旧的消息折叠进滚动摘要 */
+        double contextSoftWatermark = 0.75;
+        /** 超过该字节数的工具输出存入 .photon/results 会话目录，对话中只留预览与 handle（fetch_result 分页读取）；0 表示不外置 */
+        size_t toolResultInlineBytes = 16 * 1024;
+        /** 外置结果的会话目录磁盘上限（MB），超出时删除最旧的结果 */
+        size_t toolResultStoreMB = 256;
+        /** 只读工具（read_code_block / grep / list_project_files）结果缓存的上限；0 关闭缓存 */
+        size_t toolCacheMB = 64;
+        /** 预取（读完符号后预先读取其调用者 / 被调用者、grep 命中所在符号）占用缓存的上限；0 关闭预取 */
+        size_t prefetchMB = 16;
+        /** 文件内容缓存（按行读取、符号扫描、LSP、语义索引共用）的上限；0 关闭缓存 */
+        size_t fileCacheMB = 64;
+        /** tiktoken 格式词表（如 cl100k_base.tiktoken）；为空或加载失败时按字节估算 token */
+        std::string tokenizerVocab;
         std::vector<std::string> fileExtensions;
         bool useBuiltinTools;
         std::string searchApiKey;
@@ -25,7 +72,10 @@ struct Config {
         bool symbolFallbackOnEmpty = false;
         bool enableLSP = true;  // 是否启用 LSP 功能
         bool enableDebug = false;  // 是否启用调试日志
-        bool enableReadSummary = false;  // 是否在每次 read 后调用 LLM 做摘要（默认关闭，减少延迟）
+        bool enableReadSummary = false;  // 是否在每次 read 后调用 LLM 做摘要（后台生成、按内容哈希落盘缓存，不阻塞主循环；默认关闭以节省调用）
+        bool enableSemanticIndex = false;  // 是否建立语义索引并注册 semantic_search（代码按符号范围分块，随符号索引增量更新）
+        /** 语义索引的 embedding 来源："local"（离线哈希投影，默认，无需网络）或 "remote"（LLM 服务的 /embeddings） */
+        std::string semanticEmbeddingProvider = "local";
         std::string lspServerPath;
         std::string lspRootUri;
         struct LSPServer {
@@ -75,8 +125,38 @@ struct Config {
         cfg.llm.model = j.at("llm").at("model").get<std::string>();
         cfg.llm.systemRole = j.at("llm").at("system_role").get<std::string>();
         cfg.llm.maxTokens = j.at("llm").value("max_tokens", 0);
+        cfg.llm.poolMaxPerHost = j.at("llm").value("pool_max_per_host", 4);
+        cfg.llm.poolIdleTimeoutSec = j.at("llm").value("pool_idle_timeout_sec", 60);
+        cfg.llm.tlsSessionReuse = j.at("llm").value("tls_session_reuse", true);
+        cfg.llm.verifyTls = j.at("llm").value("verify_tls", true);
+        cfg.llm.stream = j.at("llm").value("stream", true);
+        cfg.llm.schedulerWorkers = j.at("llm").value("scheduler_workers", 4);
+        cfg.llm.maxConcurrentChat = j.at("llm").value("max_concurrent_chat", 2);
+        cfg.llm.maxConcurrentEmbeddings = j.at("llm").value("max_concurrent_embeddings", 2);
+        cfg.llm.contextWindow = j.at("llm").value("context_window", 0);
+        if (j.at("llm").contains("routes") && j.at("llm")["routes"].is_object()) {
+            for (const auto& [purpose, item] : j.at("llm")["routes"].items()) {
+                if (!item.is_object()) continue;
+                LLM::Route route;
+                route.purpose = purpose;
+                route.model = item.value("model", "");
+                route.baseUrl = item.value("base_url", "");
+                route.apiKey = item.value("api_key", "");
+                route.timeoutSec = item.value("timeout_sec", 0);
+                route.maxTokens = item.value("max_tokens", -1);
+                route.maxConcurrent = item.value("max_concurrent", 0);
+                cfg.llm.routes.push_back(std::move(route));
+            }
+        }
         
         cfg.agent.contextThreshold = j.at("agent").at("context_threshold").get<size_t>();
+        cfg.agent.contextSoftWatermark = j.at("agent").value("context_soft_watermark", 0.75);
+        cfg.agent.tokenizerVocab = j.at("agent").value("tokenizer_vocab", "");
+        cfg.agent.toolResultInlineBytes = j.at("agent").value("tool_result_inline_bytes", static_cast<size_t>(16 * 1024));
+        cfg.agent.toolResultStoreMB = j.at("agent").value("tool_result_store_mb", static_cast<size_t>(256));
+        cfg.agent.toolCacheMB = j.at("agent").value("tool_cache_mb", static_cast<size_t>(64));
+        cfg.agent.prefetchMB = j.at("agent").value("prefetch_mb", static_cast<size_t>(16));
+        cfg.agent.fileCacheMB = j.at("agent").value("file_cache_mb", static_cast<size_t>(64));
         cfg.agent.fileExtensions = j.at("agent").at("file_extensions").get<std::vector<std::string>>();
         cfg.agent.useBuiltinTools = j.at("agent").value("use_builtin_tools", true);
         cfg.agent.searchApiKey = j.at("agent").value("search_api_key", "");
@@ -85,6 +165,8 @@ struct Config {
         cfg.agent.enableLSP = j.at("agent").value("enable_lsp", true);
         cfg.agent.enableDebug = j.at("agent").value("enable_debug", false);
         cfg.agent.enableReadSummary = j.at("agent").value("enable_read_summary", false);
+        cfg.agent.enableSemanticIndex = j.at("agent").value("enable_semantic_index", false);
+        cfg.agent.semanticEmbeddingProvider = j.at("agent").value("semantic_embedding_provider", "local");
         cfg.agent.lspServerPath = j.at("agent").value("lsp_server_path", "");
         cfg.agent.lspRootUri = j.at("agent").value("lsp_root_uri", "");
         if (j.at("agent").contains("lsp_servers")) {
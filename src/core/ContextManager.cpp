@@ -1,25 +1,92 @@
 #include "core/ContextManager.h"
+#include "utils/Tokenizer.h"
+#include <algorithm>
+#include <chrono>
 #include <numeric>
 #include <iostream>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
 
 // ANSI Color Codes
 const std::string RESET = "\033[0m";
 const std::string YELLOW = "\033[33m";
 const std::string GREEN = "\033[32m";
 
-ContextManager::ContextManager(std::shared_ptr<LLMClient> client, size_t thresholdChars)
-    : llmClient(client), threshold(thresholdChars) {}
+namespace {
 
-size_t ContextManager::calculateSize(const nlohmann::json& messages) const {
-    size_t total = 0;
-    for (const auto& msg : messages) {
-        if (msg.contains("content") && msg["content"].is_string()) {
-            total += msg["content"].get<std::string>().length();
+// 短结果（"ok"、错误信息等）不值得去重或标记
+constexpr size_t kMinDedupBytes = 200;
+
+std::string toolResultText(const nlohmann::json& msg) {
+    if (!msg.contains("content")) return "";
+    const auto& content = msg["content"];
+    if (content.is_string()) return content.get<std::string>();
+    std::string text;
+    if (content.is_array()) {
+        for (const auto& part : content) {
+            if (part.is_object() && part.contains("text") && part["text"].is_string()) {
+                text += part["text"].get<std::string>();
+            }
         }
-        if (msg.contains("tool_calls")) {
-            total += msg["tool_calls"].dump().length();
+    }
+    return text;
+}
+
+// 规范化：去掉 \r 与行尾空白，使仅换行风格 / 尾随空格不同的输出视为相同
+std::string normalizeResultText(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    size_t lineStart = 0;
+    for (char c : text) {
+        if (c == '\r') continue;
+        if (c == '\n') {
+            while (out.size() > lineStart && (out.back() == ' ' || out.back() == '\t')) out.pop_back();
+            out += c;
+            lineStart = out.size();
+            continue;
         }
+        out += c;
     }
+    while (out.size() > lineStart && (out.back() == ' ' || out.back() == '\t')) out.pop_back();
+    return out;
+}
+
+// 参数中的文件路径：file_path / path 字段，含批量请求数组中的条目
+void collectPaths(const nlohmann::json& args, std::vector<std::string>& out, int depth = 0) {
+    if (depth > 2) return;
+    if (args.is_object()) {
+        for (const char* key : {"file_path", "path"}) {
+            if (args.contains(key) && args[key].is_string()) out.push_back(args[key].get<std::string>());
+        }
+        for (const auto& item : args.items()) {
+            if (item.value().is_structured()) collectPaths(item.value(), out, depth + 1);
+        }
+    } else if (args.is_array()) {
+        for (const auto& item : args) collectPaths(item, out, depth + 1);
+    }
+}
+
+}  // namespace
+
+ContextManager::ContextManager(std::shared_ptr<LLMClient> client, size_t thresholdTokens)
+    : llmClient(client), threshold(thresholdTokens) {}
+
+void ContextManager::setContextWindow(size_t windowTokens, size_t reservedOutputTokens) {
+    contextWindow = windowTokens;
+    reservedOutput = reservedOutputTokens;
+}
+
+size_t ContextManager::getEffectiveThreshold() const {
+    if (contextWindow == 0) return threshold;
+    size_t budget = contextWindow > reservedOutput ? contextWindow - reservedOutput : 0;
+    return std::min(threshold, budget);
+}
+
+size_t ContextManager::calculateSize(const nlohmann::json& messages) const {
+    const Tokenizer& tokenizer = Tokenizer::getInstance();
+    size_t total = 0;
+    for (const auto& msg : messages) total += tokenizer.countMessage(msg);
     return total;
 }
 
@@ -27,12 +94,291 @@ size_t ContextManager::getSize(const nlohmann::json& messages) const {
     return calculateSize(messages);
 }
 
+size_t ContextManager::getSize(const Conversation& conversation) const {
+    return conversation.tokenCount();
+}
+
+ContextManager::~ContextManager() {
+    // 在途的后台折叠持有 llmClient 的 this，等它结束再释放
+    if (pending) {
+        pending->cancel.cancel();
+        if (pending->summary.valid()) pending->summary.wait();
+    }
+}
+
+void ContextManager::setSoftWatermark(double ratio) {
+    softWatermark = std::clamp(ratio, 0.0, 1.0);
+}
+
+void ContextManager::reset() {
+    if (pending) pending->cancel.cancel();
+    pending.reset();
+    runningSummary.clear();
+    summaryMessageId = 0;
+    toolResults.clear();
+}
+
+void ContextManager::setProjectRoot(const std::string& root) {
+    projectRoot = fs::u8path(root.empty() ? "." : root);
+}
+
+ContextManager::ToolResultInfo ContextManager::inspectToolResult(
+    const Conversation& conversation, size_t index,
+    const std::unordered_map<std::string, const nlohmann::json*>& calls) const {
+    ToolResultInfo info;
+    const auto& msg = conversation[index];
+    std::string text = toolResultText(msg);
+    if (text.size() < kMinDedupBytes) return info;
+    info.eligible = true;
+    info.contentHash = std::hash<std::string>{}(normalizeResultText(text));
+
+    auto call = calls.find(msg.value("tool_call_id", ""));
+    if (call == calls.end()) return info;
+    const auto& function = *call->second;
+    nlohmann::json args = nlohmann::json::object();
+    if (function.contains("arguments")) {
+        const auto& raw = function["arguments"];
+        args = raw.is_string() ? nlohmann::json::parse(raw.get<std::string>(), nullptr, false) : raw;
+        if (args.is_discarded()) args = raw;
+    }
+    // nlohmann 的 object 按键排序，dump 即为规范形式
+    info.callKey = function.value("name", "") + "\n" + args.dump();
+
+    std::vector<std::string> paths;
+    collectPaths(args, paths);
+    for (const auto& p : paths) {
+        fs::path resolved = fs::u8path(p);
+        if (resolved.is_relative()) resolved = projectRoot / resolved;
+        std::error_code ec;
+        if (!fs::is_regular_file(resolved, ec)) continue;
+        auto mtime = fs::last_write_time(resolved, ec);
+        if (!ec) info.files.push_back({p, resolved, mtime});
+    }
+    return info;
+}
+
+size_t ContextManager::dedupToolResults(Conversation& conversation) {
+    // tool_call id -> function（assistant 消息的 tool_calls）；只替换 tool 消息，指针在本轮内有效
+    std::unordered_map<std::string, const nlohmann::json*> calls;
+    for (size_t i = 1; i < conversation.size(); ++i) {
+        const auto& msg = conversation[i];
+        if (!msg.contains("tool_calls") || !msg["tool_calls"].is_array()) continue;
+        for (const auto& call : msg["tool_calls"]) {
+            if (call.is_object() && call.contains("id") && call["id"].is_string() && call.contains("function")) {
+                calls[call["id"].get<std::string>()] = &call["function"];
+            }
+        }
+    }
+
+    // 从新到旧：较早的结果若与更新的结果内容相同，或是同一调用的旧结果，替换为引用
+    std::unordered_map<size_t, std::string> newerByHash;
+    std::unordered_map<std::string, std::string> newerByCall;
+    std::unordered_set<uint64_t> live;
+    size_t saved = 0;
+    for (size_t i = conversation.size(); i-- > 1;) {
+        if (conversation[i].value("role", "") != "tool") continue;
+        const uint64_t id = conversation.idAt(i);
+        live.insert(id);
+        auto it = toolResults.find(id);
+        if (it == toolResults.end()) it = toolResults.emplace(id, inspectToolResult(conversation, i, calls)).first;
+        ToolResultInfo& info = it->second;
+        if (!info.eligible || info.elided) continue;
+
+        const std::string callId = conversation[i].value("tool_call_id", "");
+        std::string note;
+        auto byHash = newerByHash.find(info.contentHash);
+        auto byCall = info.callKey.empty() ? newerByCall.end() : newerByCall.find(info.callKey);
+        if (byHash != newerByHash.end()) {
+            note = "[Duplicate tool result elided: identical to the later result of call " + byHash->second + "]";
+            ++stats.duplicateResults;
+        } else if (byCall != newerByCall.end()) {
+            note = "[Earlier result elided: the same call was repeated later (call " + byCall->second +
+                   "); see that result]";
+            ++stats.supersededResults;
+        }
+        if (!note.empty()) {
+            const size_t before = conversation.messageTokens(i);
+            nlohmann::json replaced = conversation[i];
+            replaced["content"] = note;
+            conversation.replace(i, std::move(replaced));
+            const size_t after = conversation.messageTokens(i);
+            if (before > after) saved += before - after;
+            info.elided = true;
+            continue;
+        }
+        newerByHash.emplace(info.contentHash, callId);
+        if (!info.callKey.empty()) newerByCall.emplace(info.callKey, callId);
+
+        if (info.stale) continue;
+        for (const auto& file : info.files) {
+            std::error_code ec;
+            auto mtime = fs::last_write_time(file.resolved, ec);
+            if (!ec && mtime == file.mtime) continue;
+            nlohmann::json marked = conversation[i];
+            marked["content"] = "[Stale: " + file.path +
+                                " has been modified since this result was produced; re-read it before relying on it]\n" +
+                                toolResultText(marked);
+            conversation.replace(i, std::move(marked));
+            info.stale = true;
+            ++stats.staleResults;
+            break;
+        }
+    }
+    for (auto it = toolResults.begin(); it != toolResults.end();) {
+        it = live.count(it->first) ? std::next(it) : toolResults.erase(it);
+    }
+    stats.tokensSaved += saved;
+    return saved;
+}
+
+std::vector<uint64_t> ContextManager::selectEvictions(const Conversation& conversation, size_t targetTokens,
+                                                      size_t keepLast) const {
+    // 候选：除 system 消息（system prompt、已读摘要、滚动摘要）之外的对话消息，从旧到新
+    std::vector<size_t> candidates;
+    size_t tail = 0;
+    for (size_t i = 1; i < conversation.size(); ++i) {
+        if (conversation[i].value("role", "") == "system") continue;
+        candidates.push_back(i);
+        tail += conversation.messageTokens(i);
+    }
+    size_t cut = 0;
+    while (cut < candidates.size() && candidates.size() - cut > keepLast && tail > targetTokens) {
+        tail -= conversation.messageTokens(candidates[cut]);
+        ++cut;
+    }
+    // 不在 tool 消息处切开：保留的第一条若是工具结果，回退到发起调用的 assistant 消息
+    while (cut > 0 && cut < candidates.size() && conversation[candidates[cut]].value("role", "") == "tool") --cut;
+
+    std::vector<uint64_t> evicted;
+    evicted.reserve(cut);
+    for (size_t k = 0; k < cut; ++k) evicted.push_back(conversation.idAt(candidates[k]));
+    return evicted;
+}
+
+std::string ContextManager::buildFoldInput(const Conversation& conversation,
+                                           const std::vector<uint64_t>& evicted) const {
+    nlohmann::json toSummarize = nlohmann::json::array();
+    for (uint64_t id : evicted) {
+        size_t i = conversation.indexOf(id);
+        if (i < conversation.size()) toSummarize.push_back(conversation[i]);
+    }
+    std::string text = messagesToText(toSummarize);
+    if (runningSummary.empty()) return text;
+    // 只把新淘汰的消息折叠进已有摘要
+    return "Summary of the conversation so far:\n" + runningSummary +
+           "\n\nNew messages to merge into the summary:\n" + text;
+}
+
+void ContextManager::applyFold(Conversation& conversation, const std::string& summary,
+                               const std::vector<uint64_t>& evicted) {
+    if (!summary.empty()) runningSummary = summary;
+    ++stats.summaryFolds;
+    std::unordered_set<uint64_t> drop(evicted.begin(), evicted.end());
+    if (summaryMessageId != 0) drop.insert(summaryMessageId);
+    for (size_t i = conversation.size(); i-- > 1;) {
+        if (drop.count(conversation.idAt(i))) conversation.erase(i);
+    }
+    summaryMessageId = 0;
+    if (runningSummary.empty()) return;
+    // 摘要放在开头的 system 消息之后，其余消息（及其缓存的片段）不动
+    size_t pos = 1;
+    while (pos < conversation.size() && conversation[pos].value("role", "") == "system") ++pos;
+    conversation.insert(pos, {{"role", "system"}, {"content", "Summary of earlier conversation: " + runningSummary}});
+    summaryMessageId = conversation.idAt(pos);
+}
+
+bool ContextManager::applyPending(Conversation& conversation) {
+    if (!pending) return false;
+    PendingFold fold = std::move(*pending);
+    pending.reset();
+    std::string summary;
+    try {
+        summary = fold.summary.get();
+    } catch (...) {
+    }
+    // 后台折叠失败：保留原消息，下次越过软水位时重试
+    if (summary.empty()) return false;
+    applyFold(conversation, summary, fold.evicted);
+    std::cout << GREEN << "✔ Context compressed (rolling summary). New size: " << getSize(conversation) << " tokens"
+              << RESET << std::endl;
+    return true;
+}
+
+bool ContextManager::waitForPendingSummary(Conversation& conversation) {
+    if (!pending) return false;
+    if (pending->summary.valid()) pending->summary.wait();
+    return applyPending(conversation);
+}
+
+bool ContextManager::manage(Conversation& conversation) {
+    bool changed = dedupToolResults(conversation) > 0;
+    // 后台折叠已完成：直接换上压缩后的历史，不等待
+    if (pending && pending->summary.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        changed = applyPending(conversation) || changed;
+    }
+    if (conversation.size() <= 6) return changed;
+
+    const size_t limit = getEffectiveThreshold();
+    const size_t soft = static_cast<size_t>(static_cast<double>(limit) * softWatermark);
+    // 折叠后保留的近期消息压到软水位的一半，留出余量，避免每轮都触发一次小折叠
+    const size_t target = soft / 2;
+    size_t currentSize = getSize(conversation);
+    if (currentSize > limit) {
+        // 超过阈值：先用在途的折叠，仍超出再同步折叠
+        if (pending) {
+            changed = waitForPendingSummary(conversation) || changed;
+            currentSize = getSize(conversation);
+            if (currentSize <= limit) return changed;
+        }
+        auto evicted = selectEvictions(conversation, target, 4);
+        if (evicted.empty()) return changed;
+        std::cout << YELLOW << "[ContextManager] Threshold reached (" << currentSize << " > " << limit
+                  << " tokens). Compressing " << evicted.size() << " older messages..." << RESET << std::endl;
+        // 同步路径：摘要失败也淘汰（保证不超出窗口）
+        applyFold(conversation, llmClient->summarize(buildFoldInput(conversation, evicted)), evicted);
+        std::cout << GREEN << "✔ Context compressed. New size: " << getSize(conversation) << " tokens" << RESET
+                  << std::endl;
+        return true;
+    }
+
+    if (!pending && currentSize > soft) {
+        auto evicted = selectEvictions(conversation, target, 4);
+        if (evicted.empty()) return changed;
+        PendingFold fold;
+        fold.evicted = std::move(evicted);
+        fold.summary = llmClient->summarizeAsync(buildFoldInput(conversation, fold.evicted), fold.cancel);
+        std::cout << YELLOW << "[ContextManager] Soft watermark reached (" << currentSize << " > " << soft
+                  << " tokens). Summarizing " << fold.evicted.size() << " older messages in background..." << RESET
+                  << std::endl;
+        pending = std::move(fold);
+    }
+    return changed;
+}
+
+void ContextManager::forceCompress(Conversation& conversation) {
+    if (conversation.size() <= 2) return;
+    waitForPendingSummary(conversation);
+    // 只保留最后一条（若为工具结果则连同其调用一起保留）
+    auto evicted = selectEvictions(conversation, 0, 1);
+    if (evicted.empty()) return;
+    std::cout << YELLOW << "[ContextManager] Manual compression triggered..." << RESET << std::endl;
+    applyFold(conversation, llmClient->summarize(buildFoldInput(conversation, evicted)), evicted);
+    std::cout << GREEN << "✔ Context manually compressed." << RESET << std::endl;
+}
+
 std::string ContextManager::messagesToText(const nlohmann::json& messages) const {
     std::string text;
     for (const auto& msg : messages) {
         std::string role = msg["role"];
         if (msg.contains("content") && msg["content"].is_string()) {
             text += role + ": " + msg["content"].get<std::string>() + "\n";
+        } else if (msg.contains("content") && msg["content"].is_array()) {
+            // 工具结果：[{"type":"text","text":...}]
+            for (const auto& part : msg["content"]) {
+                if (part.is_object() && part.contains("text") && part["text"].is_string()) {
+                    text += role + ": " + part["text"].get<std::string>() + "\n";
+                }
+            }
         }
     }
     return text;
@@ -69,12 +415,13 @@ nlohmann::json ContextManager::forceCompress(const nlohmann::json& messages) {
 
 nlohmann::json ContextManager::manage(const nlohmann::json& messages) {
     size_t currentSize = calculateSize(messages);
-    if (currentSize <= threshold || messages.size() <= 6) {
+    const size_t limit = getEffectiveThreshold();
+    if (currentSize <= limit || messages.size() <= 6) {
         return messages;
     }
 
-    std::cout << YELLOW << "[ContextManager] Threshold reached (" << currentSize << " > " << threshold 
-              << "). Compressing intermediate history..." << RESET << std::endl;
+    std::cout << YELLOW << "[ContextManager] Threshold reached (" << currentSize << " > " << limit
+              << " tokens). Compressing intermediate history..." << RESET << std::endl;
 
     nlohmann::json managedMessages = nlohmann::json::array();
     nlohmann::json toSummarize = nlohmann::json::array();
@@ -106,6 +453,6 @@ nlohmann::json ContextManager::manage(const nlohmann::json& messages) {
         managedMessages.push_back(messages[i]);
     }
 
-    std::cout << GREEN << "✔ Context compressed. New size: " << calculateSize(managedMessages) << RESET << std::endl;
+    std::cout << GREEN << "✔ Context compressed. New size: " << calculateSize(managedMessages) << " tokens" << RESET << std::endl;
     return managedMessages;
 }
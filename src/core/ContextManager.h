@@ -2,13 +2,36 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
+#include <future>
+#include <filesystem>
+#include <unordered_map>
 #include "core/LLMClient.h"
 
 #include <nlohmann/json.hpp>
 
+/**
+ * 上下文压缩。Conversation 版本为滚动式增量摘要：
+ * - 维护一份运行中的摘要（runningSummary），每次只把新淘汰的旧消息折叠进去，而不是重新总结整段历史
+ * - 超过软水位（threshold * softWatermark）时在后台（summarizeAsync）准备下一次折叠，
+ *   下一轮请求前若已完成则直接换上压缩后的历史，不阻塞
+ * - 超过阈值时才同步等待（优先等已在途的后台折叠）
+ * - 淘汰边界不落在 tool 消息上：assistant 的 tool_calls 与其工具结果一起保留或一起淘汰
+ * 每轮还会对工具结果去重：内容（规范化后）相同、或同一工具以相同参数（路径 / 行区间）再次调用时，
+ * 较早的副本替换为指向最新结果的简短引用；结果引用的文件此后被修改时标记为过期。
+ */
 class ContextManager {
 public:
-    ContextManager(std::shared_ptr<LLMClient> client, size_t thresholdChars = 4000);
+    /** thresholdTokens：上下文超过该 token 数（Tokenizer 计数）时压缩中间历史 */
+    ContextManager(std::shared_ptr<LLMClient> client, size_t thresholdTokens = 4000);
+    ~ContextManager();
+
+    /**
+     * 模型上下文窗口与预留给回复的 max_tokens：压缩阈值取 min(threshold, window - reserved)，
+     * 保证 prompt + max_tokens 不超过窗口。window 为 0 表示未知（只用 threshold）。
+     */
+    void setContextWindow(size_t windowTokens, size_t reservedOutputTokens);
+    size_t getEffectiveThreshold() const;
 
     // 检查并压缩消息列表
     nlohmann::json manage(const nlohmann::json& messages);
@@ -16,12 +39,77 @@ public:
     // 强制压缩当前消息列表
     nlohmann::json forceCompress(const nlohmann::json& messages);
 
-    // 获取当前上下文大小
+    // 获取当前上下文大小（token）
     size_t getSize(const nlohmann::json& messages) const;
 
+    // Conversation 版本：只删除被淘汰的消息并更新摘要消息，保留其余消息的缓存（返回本次是否修改了历史）
+    bool manage(Conversation& conversation);
+    void forceCompress(Conversation& conversation);
+    size_t getSize(const Conversation& conversation) const;
+
+    /** 软水位占阈值的比例（0~1，默认 0.75）；超过后在后台开始折叠 */
+    void setSoftWatermark(double ratio);
+    bool hasPendingSummary() const { return pending.has_value(); }
+    /** 等待在途的后台折叠完成并应用到 conversation（无在途任务时直接返回 false） */
+    bool waitForPendingSummary(Conversation& conversation);
+    /** 清空运行中的摘要并取消在途折叠（对话被 clear 时调用） */
+    void reset();
+    const std::string& getRunningSummary() const { return runningSummary; }
+
+    /** 工具结果中的相对路径按此目录解析（用于检测文件修改），默认当前目录 */
+    void setProjectRoot(const std::string& root);
+    /** 对工具结果去重 / 标记过期，返回本次节省的 token 数（manage 开头自动调用） */
+    size_t dedupToolResults(Conversation& conversation);
+
+    struct Stats {
+        size_t duplicateResults = 0;   // 内容相同而被替换为引用的旧结果
+        size_t supersededResults = 0;  // 同一调用（工具 + 参数）被再次执行而替换的旧结果
+        size_t staleResults = 0;       // 引用的文件已被修改而标记过期的结果
+        size_t tokensSaved = 0;        // 去重累计节省的 token（本次会话）
+        size_t summaryFolds = 0;       // 折叠进滚动摘要的次数
+    };
+    Stats getStats() const { return stats; }
+
 private:
     std::shared_ptr<LLMClient> llmClient;
     size_t threshold;
+    size_t contextWindow = 0;
+    size_t reservedOutput = 0;
+    double softWatermark = 0.75;
+
+    struct PendingFold {
+        std::vector<uint64_t> evicted;  // 被淘汰消息的 Conversation id
+        std::future<std::string> summary;
+        CancellationToken cancel;
+    };
+    std::optional<PendingFold> pending;
+    std::string runningSummary;
+    uint64_t summaryMessageId = 0;  // 摘要消息在 Conversation 中的 id（0 表示没有）
+
+    struct ToolResultInfo {
+        size_t contentHash = 0;
+        std::string callKey;  // 工具名 + 规范化参数；找不到对应 tool_call 时为空
+        struct FileStamp {
+            std::string path;  // 参数中的原始路径（用于提示）
+            std::filesystem::path resolved;
+            std::filesystem::file_time_type mtime;  // 首次见到该结果时的修改时间
+        };
+        std::vector<FileStamp> files;
+        bool eligible = false;  // 结果足够长才参与去重 / 过期标记
+        bool elided = false;
+        bool stale = false;
+    };
+    std::unordered_map<uint64_t, ToolResultInfo> toolResults;  // 按消息 id
+    std::filesystem::path projectRoot = ".";
+    Stats stats;
+
+    ToolResultInfo inspectToolResult(const Conversation& conversation, size_t index,
+                                     const std::unordered_map<std::string, const nlohmann::json*>& calls) const;
+
+    std::vector<uint64_t> selectEvictions(const Conversation& conversation, size_t targetTokens, size_t keepLast) const;
+    std::string buildFoldInput(const Conversation& conversation, const std::vector<uint64_t>& evicted) const;
+    void applyFold(Conversation& conversation, const std::string& summary, const std::vector<uint64_t>& evicted);
+    bool applyPending(Conversation& conversation);
     
     size_t calculateSize(const nlohmann::json& messages) const;
     std::string messagesToText(const nlohmann::json& messages) const;
@@ -0,0 +1,121 @@
+#include "core/Conversation.h"
+#include "core/LLMClient.h"
+#include "utils/Tokenizer.h"
+
+void Conversation::push_back(nlohmann::json message) {
+    entries.push_back(Entry{std::move(message), nextId++, {}});
+}
+
+void Conversation::insert(size_t pos, nlohmann::json message) {
+    if (pos > entries.size()) pos = entries.size();
+    entries.insert(entries.begin() + static_cast<std::ptrdiff_t>(pos), Entry{std::move(message), nextId++, {}});
+}
+
+void Conversation::replace(size_t pos, nlohmann::json message) {
+    if (pos >= entries.size()) return;
+    entries[pos] = Entry{std::move(message), entries[pos].id, {}};
+}
+
+void Conversation::erase(size_t pos) {
+    if (pos < entries.size()) entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(pos));
+}
+
+void Conversation::assign(const nlohmann::json& messages) {
+    entries.clear();
+    if (!messages.is_array()) return;
+    entries.reserve(messages.size());
+    for (const auto& m : messages) entries.push_back(Entry{m, nextId++, {}});
+}
+
+size_t Conversation::indexOf(uint64_t id) const {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].id == id) return i;
+    }
+    return entries.size();
+}
+
+void Conversation::setTrailingContext(const std::string& key, const std::string& content) {
+    auto it = trailingSections.find(key);
+    if (content.empty()) {
+        if (it == trailingSections.end()) return;
+        trailingSections.erase(it);
+    } else {
+        if (it != trailingSections.end() && it->second == content) return;
+        trailingSections[key] = content;
+    }
+    if (trailingSections.empty()) {
+        trailing.reset();
+        return;
+    }
+    std::string merged;
+    for (const auto& [name, text] : trailingSections) {
+        if (!merged.empty()) merged += "\n\n";
+        merged += text;
+    }
+    trailing = Entry{{{"role", "system"}, {"content", merged}}, 0, {}};
+}
+
+std::string Conversation::getTrailingContext(const std::string& key) const {
+    auto it = trailingSections.find(key);
+    return it == trailingSections.end() ? "" : it->second;
+}
+
+nlohmann::json Conversation::trailingMessage() const {
+    return trailing ? trailing->message : nlohmann::json();
+}
+
+nlohmann::json Conversation::toJson() const {
+    nlohmann::json out = nlohmann::json::array();
+    for (const auto& e : entries) out.push_back(e.message);
+    if (trailing) out.push_back(trailing->message);
+    return out;
+}
+
+const std::string& Conversation::fragmentOf(const Entry& e) const {
+    if (e.fragment.empty() && e.message.is_object()) {
+        e.fragment = normalizeMessageForKimi(e.message).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        ++builds;
+    }
+    return e.fragment;
+}
+
+std::string Conversation::serializedMessages() const {
+    size_t total = 2;
+    for (const auto& e : entries) total += fragmentOf(e).size() + 1;
+    if (trailing) total += fragmentOf(*trailing).size() + 1;
+    std::string out;
+    out.reserve(total);
+    out += '[';
+    bool first = true;
+    auto append = [&](const Entry& e) {
+        if (e.fragment.empty()) return;  // 非对象消息与 normalizeForKimi 一样丢弃
+        if (!first) out += ',';
+        out += e.fragment;
+        first = false;
+    };
+    for (const auto& e : entries) append(e);
+    if (trailing) append(*trailing);
+    out += ']';
+    return out;
+}
+
+size_t Conversation::tokensOf(const Entry& e) const {
+    // 代数从 1 开始，避免与「未计数」的 0 混淆
+    const uint64_t generation = Tokenizer::getInstance().generation() + 1;
+    if (e.tokenGeneration != generation) {
+        e.tokens = Tokenizer::getInstance().countMessage(e.message);
+        e.tokenGeneration = generation;
+    }
+    return e.tokens;
+}
+
+size_t Conversation::messageTokens(size_t i) const {
+    return i < entries.size() ? tokensOf(entries[i]) : 0;
+}
+
+size_t Conversation::tokenCount() const {
+    size_t total = 0;
+    for (const auto& e : entries) total += tokensOf(e);
+    if (trailing) total += tokensOf(*trailing);
+    return total;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/**
+ * 对话历史：接口与 main 中原先的 json 数组一致（push_back / insert / erase / operator[]），
+ * 额外为每条消息缓存「规范化（normalizeMessageForKimi）+ 序列化」后的 JSON 片段与 token 数。
+ * 组装请求体时只拼接片段，新消息只序列化 / 分词一次，避免每轮对整段历史重新规范化和 dump。
+ * 易变的上下文（已读摘要、激活的 skill 等）放在末尾的单一槽位（setTrailingContext），不插入历史中间，
+ * 使 system prompt 与历史消息在相邻请求间保持字节稳定，命中服务端的前缀缓存。
+ * 非线程安全（由 agent 主循环独占）。
+ */
+class Conversation {
+public:
+    Conversation() = default;
+    explicit Conversation(const nlohmann::json& messages) { assign(messages); }
+
+    void push_back(nlohmann::json message);
+    void insert(size_t pos, nlohmann::json message);
+    void erase(size_t pos);
+    /** 原位替换一条消息（保留 id，只让这一条的缓存失效） */
+    void replace(size_t pos, nlohmann::json message);
+    void clear() {
+        entries.clear();
+        trailingSections.clear();
+        trailing.reset();
+    }
+    /** 整体替换（如上下文压缩后），片段缓存随之失效 */
+    void assign(const nlohmann::json& messages);
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    const nlohmann::json& operator[](size_t i) const { return entries[i].message; }
+    const nlohmann::json& back() const { return entries.back().message; }
+    /** 消息的稳定 id（插入时分配，删除 / 插入其它消息后不变），用于跨修改定位同一条消息 */
+    uint64_t idAt(size_t i) const { return entries[i].id; }
+    /** id 对应的下标；不存在时返回 size() */
+    size_t indexOf(uint64_t id) const;
+
+    /**
+     * 末尾易变槽位：各段按 key 排序合成一条 system 消息，始终排在所有消息之后发送；
+     * 不计入 size()、不参与压缩。content 为空表示移除该段。
+     */
+    void setTrailingContext(const std::string& key, const std::string& content);
+    std::string getTrailingContext(const std::string& key) const;
+    /** 合成后的末尾消息；没有任何段时为 null */
+    nlohmann::json trailingMessage() const;
+
+    /** 历史消息（含末尾槽位，与实际发送的顺序一致） */
+    nlohmann::json toJson() const;
+
+    /** 规范化后的 messages 数组 JSON 文本（"[...]"），只序列化尚未缓存的消息 */
+    std::string serializedMessages() const;
+
+    /** 单条 / 全部消息（含末尾槽位）的 token 数（Tokenizer::countMessage，按消息缓存；换词表后自动重算） */
+    size_t messageTokens(size_t i) const;
+    size_t tokenCount() const;
+
+    /** 累计序列化过的消息条数（用于观察缓存是否生效） */
+    size_t fragmentBuilds() const { return builds; }
+
+private:
+    struct Entry {
+        nlohmann::json message;
+        uint64_t id = 0;
+        mutable std::string fragment;  // 为空表示尚未序列化
+        mutable size_t tokens = 0;
+        mutable uint64_t tokenGeneration = 0;  // 0 表示尚未计数
+    };
+    std::vector<Entry> entries;
+    std::map<std::string, std::string> trailingSections;
+    std::optional<Entry> trailing;
+    uint64_t nextId = 1;
+    mutable size_t builds = 0;
+
+    const std::string& fragmentOf(const Entry& e) const;
+    size_t tokensOf(const Entry& e) const;
+};
@@ -0,0 +1,202 @@
+#include "core/HttpClientPool.h"
+#ifdef _WIN32
+    #include <winsock2.h>
+#endif
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "httplib.h"
+#include <atomic>
+
+using Clock = std::chrono::steady_clock;
+
+struct HttpClientPool::HostPool {
+    bool ssl = false;
+    std::string host;
+    int port = 0;
+
+    // 以下两项由 HttpClientPool::mtx 保护
+    struct Idle {
+        std::unique_ptr<httplib::ClientImpl> client;
+        Clock::time_point lastUsed;
+    };
+    std::vector<Idle> idle;
+    size_t inUse = 0;
+    std::condition_variable cv;
+
+    // 最近一次拿到的 TLS 会话（由 OpenSSL 回调写入，同 host 的新连接复用）
+    std::mutex sessionMtx;
+    SSL_SESSION* session = nullptr;
+    bool sessionReuse = true;
+
+    std::atomic<size_t> created{0};
+    std::atomic<size_t> reused{0};
+    std::atomic<size_t> evictedIdle{0};
+    std::atomic<size_t> tlsHandshakes{0};
+    std::atomic<size_t> tlsResumed{0};
+
+    ~HostPool() {
+        idle.clear();  // 先关闭连接，再释放会话
+        if (session) SSL_SESSION_free(session);
+    }
+};
+
+namespace {
+
+HttpClientPool::HostPool* hostOf(const SSL* ssl) {
+    return static_cast<HttpClientPool::HostPool*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+}
+
+// 客户端会话缓存回调：保存服务器下发的会话（TLS 1.3 为握手后的 NewSessionTicket）
+int onNewSession(SSL* ssl, SSL_SESSION* session) {
+    auto* host = hostOf(ssl);
+    if (!host) return 0;
+    std::lock_guard<std::mutex> lock(host->sessionMtx);
+    if (host->session) SSL_SESSION_free(host->session);
+    host->session = session;
+    return 1;  // 接管引用
+}
+
+// httplib 没有在 SSL_connect 之前暴露 SSL*，借助 info 回调在握手开始时挂上已保存的会话
+void onInfo(const SSL* ssl, int where, int /*ret*/) {
+    auto* host = hostOf(ssl);
+    if (!host) return;
+    if (where & SSL_CB_HANDSHAKE_START) {
+        if (!host->sessionReuse) return;
+        std::lock_guard<std::mutex> lock(host->sessionMtx);
+        if (host->session && SSL_SESSION_is_resumable(host->session)) {
+            SSL_set_session(const_cast<SSL*>(ssl), host->session);
+        }
+    } else if (where & SSL_CB_HANDSHAKE_DONE) {
+        ++host->tlsHandshakes;
+        if (SSL_session_reused(const_cast<SSL*>(ssl))) ++host->tlsResumed;
+    }
+}
+
+}  // namespace
+
+HttpClientPool::Lease::Lease(Lease&& other) noexcept
+    : pool(other.pool), host(other.host), client(std::move(other.client)), discarded(other.discarded) {
+    other.pool = nullptr;
+    other.host = nullptr;
+}
+
+HttpClientPool::Lease& HttpClientPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        host = other.host;
+        client = std::move(other.client);
+        discarded = other.discarded;
+        other.pool = nullptr;
+        other.host = nullptr;
+    }
+    return *this;
+}
+
+HttpClientPool::Lease::~Lease() { release(); }
+
+void HttpClientPool::Lease::release() {
+    if (pool && host) pool->giveBack(*host, std::move(client), discarded);
+    pool = nullptr;
+    host = nullptr;
+    client.reset();
+}
+
+HttpClientPool::HttpClientPool() = default;
+
+HttpClientPool::HttpClientPool(Options options) : opts(options) {}
+
+HttpClientPool::~HttpClientPool() = default;
+
+std::unique_ptr<httplib::ClientImpl> HttpClientPool::createClient(HostPool& host) {
+    std::unique_ptr<httplib::ClientImpl> cli;
+    if (host.ssl) {
+        auto ssl = std::make_unique<httplib::SSLClient>(host.host, host.port);
+        if (!opts.verifyCertificate) ssl->enable_server_certificate_verification(false);
+        if (SSL_CTX* ctx = ssl->ssl_context()) {
+            SSL_CTX_set_app_data(ctx, &host);
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(ctx, onNewSession);
+            SSL_CTX_set_info_callback(ctx, onInfo);
+        }
+        cli = std::move(ssl);
+    } else {
+        cli = std::make_unique<httplib::ClientImpl>(host.host, host.port);
+    }
+    cli->set_follow_location(true);
+    cli->set_connection_timeout(opts.connectTimeoutSec);
+    cli->set_read_timeout(opts.readTimeoutSec);
+    cli->set_keep_alive(opts.maxPerHost > 0);
+    // 请求头与 body 分两次写出，开启 Nagle 时长连接上会叠加 delayed-ACK 的 ~40ms 停顿
+    cli->set_tcp_nodelay(true);
+    ++host.created;
+    return cli;
+}
+
+HttpClientPool::Lease HttpClientPool::acquire(bool ssl, const std::string& hostName, int port) {
+    Lease lease;
+    lease.pool = this;
+    std::vector<std::unique_ptr<httplib::ClientImpl>> expired;  // 在锁外关闭
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        std::string key = std::string(ssl ? "https://" : "http://") + hostName + ":" + std::to_string(port);
+        auto& slot = hosts[key];
+        if (!slot) {
+            slot = std::make_unique<HostPool>();
+            slot->ssl = ssl;
+            slot->host = hostName;
+            slot->port = port;
+            slot->sessionReuse = opts.tlsSessionReuse;
+        }
+        HostPool& host = *slot;
+        lease.host = &host;
+
+        if (opts.maxPerHost > 0) {
+            host.cv.wait(lock, [&] { return !host.idle.empty() || host.inUse < opts.maxPerHost; });
+            auto cutoff = Clock::now() - std::chrono::seconds(opts.idleTimeoutSec);
+            for (auto it = host.idle.begin(); it != host.idle.end();) {
+                if (it->lastUsed < cutoff) {
+                    expired.push_back(std::move(it->client));
+                    it = host.idle.erase(it);
+                    ++host.evictedIdle;
+                } else {
+                    ++it;
+                }
+            }
+            if (!host.idle.empty()) {
+                // 取最近归还的连接：最可能仍然存活
+                lease.client = std::move(host.idle.back().client);
+                host.idle.pop_back();
+                ++host.reused;
+            }
+        }
+        ++host.inUse;
+    }
+    expired.clear();
+    if (!lease.client) lease.client = createClient(*lease.host);
+    return lease;
+}
+
+void HttpClientPool::giveBack(HostPool& host, std::unique_ptr<httplib::ClientImpl> client, bool discarded) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        --host.inUse;
+        if (client && !discarded && opts.maxPerHost > 0 && host.idle.size() < opts.maxPerHost) {
+            host.idle.push_back({std::move(client), Clock::now()});
+        }
+    }
+    host.cv.notify_one();
+    client.reset();
+}
+
+HttpClientPool::Stats HttpClientPool::getStats() const {
+    Stats s;
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const auto& [key, host] : hosts) {
+        s.created += host->created;
+        s.reused += host->reused;
+        s.evictedIdle += host->evictedIdle;
+        s.tlsHandshakes += host->tlsHandshakes;
+        s.tlsResumed += host->tlsResumed;
+    }
+    return s;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace httplib {
+class ClientImpl;
+}
+
+/**
+ * 按 host 复用的 keep-alive HTTP(S) 连接池，供 LLMClient 的 chat / summarize / embedding 共用。
+ * - 每个 (scheme, host, port) 最多 maxPerHost 个客户端；取用时独占（httplib 客户端不支持并发请求），用完归还
+ * - 空闲超过 idleTimeoutSec 的连接在下次取用时关闭
+ * - TLS 会话复用：同 host 的新连接携带最近一次的会话票据，跳过完整握手（仅 OpenSSL）
+ * 线程安全。maxPerHost == 0 表示不池化：每次请求新建连接（旧行为）。
+ */
+class HttpClientPool {
+public:
+    struct Options {
+        size_t maxPerHost = 4;
+        int idleTimeoutSec = 60;
+        int connectTimeoutSec = 10;
+        int readTimeoutSec = 60;
+        bool tlsSessionReuse = true;
+        bool verifyCertificate = true;
+    };
+
+    struct Stats {
+        size_t created = 0;          // 新建的客户端数
+        size_t reused = 0;           // 取用时命中空闲客户端的次数
+        size_t evictedIdle = 0;      // 因空闲超时关闭的客户端数
+        size_t tlsHandshakes = 0;    // 完成的 TLS 握手数
+        size_t tlsResumed = 0;       // 其中复用会话的握手数
+    };
+
+    struct HostPool;
+
+    /** 独占租用的客户端；析构时归还。请求失败后调用 discard() 丢弃，避免复用坏连接 */
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        httplib::ClientImpl* operator->() const { return client.get(); }
+        httplib::ClientImpl& operator*() const { return *client; }
+        explicit operator bool() const { return client != nullptr; }
+        void discard() { discarded = true; }
+
+    private:
+        friend class HttpClientPool;
+        HttpClientPool* pool = nullptr;
+        HostPool* host = nullptr;
+        std::unique_ptr<httplib::ClientImpl> client;
+        bool discarded = false;
+        void release();
+    };
+
+    HttpClientPool();
+    explicit HttpClientPool(Options options);
+    ~HttpClientPool();
+    HttpClientPool(const HttpClientPool&) = delete;
+    HttpClientPool& operator=(const HttpClientPool&) = delete;
+
+    /** 取用 (ssl, host, port) 的客户端；达到上限时阻塞等待其它请求归还 */
+    Lease acquire(bool ssl, const std::string& host, int port);
+
+    const Options& options() const { return opts; }
+    Stats getStats() const;
+
+private:
+    Options opts;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, std::unique_ptr<HostPool>> hosts;
+
+    std::unique_ptr<httplib::ClientImpl> createClient(HostPool& host);
+    void giveBack(HostPool& host, std::unique_ptr<httplib::ClientImpl> client, bool discarded);
+};
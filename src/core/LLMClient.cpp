@@ -4,8 +4,13 @@
 #endif
 #define CPPHTTPLIB_OPENSSL_SUPPORT
 #include "httplib.h"
+#include "core/SseParser.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <iostream>
 #include <regex>
+#include <thread>
 
 // ANSI Color Codes
 static const std::string RED = "\033[31m";
@@ -13,10 +18,156 @@ static const std::string YELLOW = "\033[33m";
 static const std::string RESET = "\033[0m";
 
 LLMClient::LLMClient(const std::string& apiKey, const std::string& baseUrl, const std::string& model, int maxTokens)
-    : apiKey(apiKey), baseUrl(baseUrl), modelName(model), maxTokens(maxTokens) {
+    : apiKey(apiKey), baseUrl(baseUrl), modelName(model), maxTokens(maxTokens),
+      connectionPool(std::make_shared<HttpClientPool>()), scheduler(std::make_shared<RequestScheduler>()) {
     parseBaseUrl(baseUrl);
 }
 
+void LLMClient::configureConnectionPool(const HttpClientPool::Options& options) {
+    connectionPool = std::make_shared<HttpClientPool>(options);
+    rebuildRoutes();
+}
+
+void LLMClient::setConnectionPool(std::shared_ptr<HttpClientPool> pool) {
+    if (pool) connectionPool = std::move(pool);
+    rebuildRoutes();
+}
+
+void LLMClient::configureRequestScheduler(const RequestScheduler::Options& options) {
+    scheduler = std::make_shared<RequestScheduler>(options);
+    rebuildRoutes();
+}
+
+void LLMClient::setRequestScheduler(std::shared_ptr<RequestScheduler> s) {
+    if (s) scheduler = std::move(s);
+    rebuildRoutes();
+}
+
+std::string LLMClient::chatEndpoint() const {
+    return host + ":" + std::to_string(port) + pathPrefix + "/chat/completions" + endpointTag;
+}
+
+std::string LLMClient::embeddingEndpoint() const {
+    return host + ":" + std::to_string(port) + pathPrefix + "/embeddings" + endpointTag;
+}
+
+// ---- 按用途路由 ----
+
+void LatencyHistogram::record(double ms) {
+    size_t i = 0;
+    while (i < kBoundsMs.size() && ms > kBoundsMs[i]) ++i;
+    buckets[i]++;
+    count++;
+    totalMs += ms;
+    maxMs = std::max(maxMs, ms);
+}
+
+double LatencyHistogram::percentile(double p) const {
+    if (count == 0) return 0.0;
+    const double rank = std::max(1.0, p * static_cast<double>(count));
+    size_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (static_cast<double>(seen) >= rank) return i < kBoundsMs.size() ? std::min(kBoundsMs[i], maxMs) : maxMs;
+    }
+    return maxMs;
+}
+
+const char* LLMClient::purposeName(LLMPurpose purpose) {
+    switch (purpose) {
+        case LLMPurpose::Planner: return "planner";
+        case LLMPurpose::Summarizer: return "summarizer";
+        case LLMPurpose::Embedder: return "embedder";
+    }
+    return "";
+}
+
+bool LLMClient::parsePurpose(const std::string& name, LLMPurpose& purpose) {
+    for (LLMPurpose p : {LLMPurpose::Planner, LLMPurpose::Summarizer, LLMPurpose::Embedder}) {
+        if (name == purposeName(p)) {
+            purpose = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LLMClient::setRoute(LLMPurpose purpose, const LLMRoute& route) {
+    routes[purpose].route = route;
+    rebuildRoutes();
+}
+
+void LLMClient::rebuildRoutes() {
+    for (auto& [purpose, state] : routes) {
+        const LLMRoute& r = state.route;
+        const bool embedder = purpose == LLMPurpose::Embedder;
+        auto child = std::make_shared<LLMClient>(r.apiKey.empty() ? apiKey : r.apiKey,
+                                                 r.baseUrl.empty() ? baseUrl : r.baseUrl,
+                                                 (r.model.empty() || embedder) ? modelName : r.model,
+                                                 r.maxTokens >= 0 ? r.maxTokens : maxTokens);
+        child->embeddingModel = (embedder && !r.model.empty()) ? r.model : embeddingModel;
+        child->connectionPool = connectionPool;
+        child->scheduler = scheduler;
+        child->readTimeoutSec = r.timeoutSec;
+        child->endpointTag = std::string("#") + purposeName(purpose);
+        if (r.maxConcurrent > 0) {
+            scheduler->setEndpointLimit(embedder ? child->embeddingEndpoint() : child->chatEndpoint(), r.maxConcurrent);
+        }
+        state.client = std::move(child);
+    }
+}
+
+LLMClient* LLMClient::routed(LLMPurpose purpose) const {
+    auto it = routes.find(purpose);
+    return it == routes.end() ? nullptr : it->second.client.get();
+}
+
+std::string LLMClient::routeModel(LLMPurpose purpose) const {
+    if (purpose == LLMPurpose::Embedder) return getEmbeddingModel();
+    LLMClient* r = routed(purpose);
+    return r ? r->modelName : modelName;
+}
+
+std::string LLMClient::getEmbeddingModel() const {
+    LLMClient* r = routed(LLMPurpose::Embedder);
+    return r ? r->embeddingModel : embeddingModel;
+}
+
+void LLMClient::recordLatency(LLMPurpose purpose, double ms) {
+    std::lock_guard<std::mutex> lock(metricsMtx);
+    latency[purpose].record(ms);
+}
+
+LatencyHistogram LLMClient::getLatencyHistogram(LLMPurpose purpose) const {
+    std::lock_guard<std::mutex> lock(metricsMtx);
+    auto it = latency.find(purpose);
+    return it == latency.end() ? LatencyHistogram() : it->second;
+}
+
+// 连接归还后会被其它路由复用，因此每次请求都按本客户端的设置重新指定读超时
+void LLMClient::applyReadTimeout(HttpClientPool::Lease& cli) const {
+    const int sec = readTimeoutSec > 0 ? readTimeoutSec : connectionPool->options().readTimeoutSec;
+    cli->set_read_timeout(sec, 0);
+}
+
+namespace {
+
+// 记录一次调用的时延（析构时，异常返回同样计入）
+class LatencyScope {
+public:
+    explicit LatencyScope(std::function<void(double)> sink)
+        : sink(std::move(sink)), start(std::chrono::steady_clock::now()) {}
+    ~LatencyScope() {
+        sink(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    std::function<void(double)> sink;
+    std::chrono::steady_clock::time_point start;
+};
+
+}  // namespace
+
 void LLMClient::parseBaseUrl(const std::string& url) {
     std::regex urlRegex(R"((http|https)://([^/:]+)(?::(\d+))?(.*))");
     std::smatch match;
@@ -65,61 +216,117 @@ std::string LLMClient::chat(const std::string& prompt, const std::string& system
 // ---------------------------------------------------------------------------
 static const std::string kEmptyContentPlaceholder = "{\"message\":\"(no output)\"}";
 
-static nlohmann::json normalizeForKimi(const nlohmann::json& messages) {
-    if (!messages.is_array()) return messages;
-    nlohmann::json out = nlohmann::json::array();
-    for (const auto& msg : messages) {
-        if (!msg.is_object()) continue;
-        nlohmann::json m = msg;
-        if (m.contains("content")) {
-            if (m["content"].is_null()) {
-                m["content"] = nlohmann::json::array({nlohmann::json::object({{"type", "text"}, {"text", kEmptyContentPlaceholder}})});
-            } else if (m["content"].is_string()) {
-                std::string s = m["content"].get<std::string>();
-                if (s.empty()) s = kEmptyContentPlaceholder;
-                m["content"] = nlohmann::json::array({
-                    nlohmann::json::object({{"type", "text"}, {"text", s}})
-                });
-            } else if (!m["content"].is_array() || m["content"].empty()) {
-                m["content"] = nlohmann::json::array({nlohmann::json::object({{"type", "text"}, {"text", kEmptyContentPlaceholder}})});
-            } else {
-                // 已是 array：确保 content[0].text 等非空（按索引修改保证写回）
-                for (size_t i = 0; i < m["content"].size(); ++i) {
-                    auto& part = m["content"][i];
-                    if (part.is_object() && part.contains("text") && part["text"].is_string()) {
-                        std::string t = part["text"].get<std::string>();
-                        if (t.empty()) part["text"] = kEmptyContentPlaceholder;
-                    }
+nlohmann::json normalizeMessageForKimi(const nlohmann::json& msg) {
+    nlohmann::json m = msg;
+    if (m.contains("content")) {
+        if (m["content"].is_null()) {
+            m["content"] = nlohmann::json::array({nlohmann::json::object({{"type", "text"}, {"text", kEmptyContentPlaceholder}})});
+        } else if (m["content"].is_string()) {
+            std::string s = m["content"].get<std::string>();
+            if (s.empty()) s = kEmptyContentPlaceholder;
+            m["content"] = nlohmann::json::array({
+                nlohmann::json::object({{"type", "text"}, {"text", s}})
+            });
+        } else if (!m["content"].is_array() || m["content"].empty()) {
+            m["content"] = nlohmann::json::array({nlohmann::json::object({{"type", "text"}, {"text", kEmptyContentPlaceholder}})});
+        } else {
+            // 已是 array：确保 content[0].text 等非空（按索引修改保证写回）
+            for (size_t i = 0; i < m["content"].size(); ++i) {
+                auto& part = m["content"][i];
+                if (part.is_object() && part.contains("text") && part["text"].is_string()) {
+                    std::string t = part["text"].get<std::string>();
+                    if (t.empty()) part["text"] = kEmptyContentPlaceholder;
                 }
             }
         }
-        if (m.contains("role") && m["role"] == "tool" && m.contains("name"))
-            m.erase("name");
-        out.push_back(m);
     }
-    return out;
+    if (m.contains("role") && m["role"] == "tool" && m.contains("name"))
+        m.erase("name");
+    return m;
 }
 
-nlohmann::json LLMClient::chatWithTools(const nlohmann::json& messages, const nlohmann::json& tools) {
-    httplib::Headers headers = {
-        {"Authorization", "Bearer " + apiKey},
-        {"Content-Type", "application/json"}
-    };
+static std::string serializeMessagesForKimi(const nlohmann::json& messages) {
+    nlohmann::json out = nlohmann::json::array();
+    if (messages.is_array()) {
+        for (const auto& msg : messages) {
+            if (msg.is_object()) out.push_back(normalizeMessageForKimi(msg));
+        }
+    }
+    return out.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
 
-    nlohmann::json body = {
-        {"model", modelName},
-        {"messages", normalizeForKimi(messages)}
-    };
+// 请求体按字符串拼接：messages 部分直接使用（可能已缓存的）序列化文本，不再整体 dump
+std::string LLMClient::dumpTools(const nlohmann::json& tools) {
+    return tools.empty() ? std::string() : tools.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+std::string LLMClient::buildChatBody(const std::string& messagesJson, const std::string& toolsJson, bool stream) const {
+    nlohmann::json head = {{"model", modelName}};
     if (maxTokens > 0) {
-        body["max_tokens"] = maxTokens;
+        head["max_tokens"] = maxTokens;
     }
-
-    if (!tools.empty()) {
-        body["tools"] = tools;
+    if (stream) {
+        head["stream"] = true;
     }
+    std::string body = head.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    body.pop_back();  // 去掉 '}'
+    body.reserve(body.size() + messagesJson.size() + toolsJson.size() + 64);
+    body += ",\"messages\":";
+    body += messagesJson;
+    if (!toolsJson.empty()) {
+        body += ",\"tools\":";
+        body += toolsJson;
+    }
+    body += '}';
+    return body;
+}
+
+// 同步接口：请求体在调用线程上组装，发送经调度器排队（在 worker 上调用时内联执行）
+nlohmann::json LLMClient::chatWithTools(const nlohmann::json& messages, const nlohmann::json& tools) {
+    std::string body = buildChatBody(serializeMessagesForKimi(messages), dumpTools(tools), false);
+    return scheduler->run(RequestPriority::Interactive, chatEndpoint(), [&] { return postChat(body); });
+}
+
+nlohmann::json LLMClient::chatWithTools(const Conversation& conversation, const nlohmann::json& tools) {
+    const std::string messagesJson = conversation.serializedMessages();
+    const std::string toolsJson = dumpTools(tools);
+    recordPrefix(messagesJson, toolsJson);
+    std::string body = buildChatBody(messagesJson, toolsJson, false);
+    return scheduler->run(RequestPriority::Interactive, chatEndpoint(), [&] { return postChat(body); });
+}
+
+nlohmann::json LLMClient::plan(const Conversation& conversation, const nlohmann::json& tools) {
+    LatencyScope timing([this](double ms) { recordLatency(LLMPurpose::Planner, ms); });
+    LLMClient* r = routed(LLMPurpose::Planner);
+    return r ? r->chatWithTools(conversation, tools) : chatWithTools(conversation, tools);
+}
+
+// 只统计 agent 主循环（Conversation 版本）的请求；chat() / summarize 走 json 版本，不打断相邻比较
+void LLMClient::recordPrefix(const std::string& messagesJson, const std::string& toolsJson) {
+    std::string prompt;
+    prompt.reserve(toolsJson.size() + messagesJson.size());
+    prompt += toolsJson;
+    prompt += messagesJson;
+    std::lock_guard<std::mutex> lock(metricsMtx);
+    const size_t limit = std::min(prompt.size(), lastPrompt.size());
+    const auto mismatch = std::mismatch(prompt.begin(), prompt.begin() + static_cast<std::ptrdiff_t>(limit), lastPrompt.begin());
+    lastPrefixMetrics.commonPrefixBytes = static_cast<size_t>(mismatch.first - prompt.begin());
+    lastPrefixMetrics.promptBytes = prompt.size();
+    lastPrefixMetrics.requests++;
+    lastPrompt = std::move(prompt);
+}
 
+PrefixMetrics LLMClient::getLastPrefixMetrics() const {
+    std::lock_guard<std::mutex> lock(metricsMtx);
+    return lastPrefixMetrics;
+}
+
+nlohmann::json LLMClient::postChat(const std::string& bodyStr) {
+    httplib::Headers headers = {
+        {"Authorization", "Bearer " + apiKey},
+        {"Content-Type", "application/json"}
+    };
     std::string endpoint = pathPrefix + "/chat/completions";
-    std::string bodyStr = body.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
 
     httplib::Result res;
     int retryCount = 0;
@@ -127,18 +334,12 @@ nlohmann::json LLMClient::chatWithTools(const nlohmann::json& messages, const nl
     
     while (retryCount < maxRetries) {
         try {
-            if (isSsl) {
-                httplib::SSLClient cli(host, port);
-                cli.set_follow_location(true);
-                cli.set_connection_timeout(10);
-                cli.set_read_timeout(60);
-                res = cli.Post(endpoint.c_str(), headers, bodyStr, "application/json");
-            } else {
-                httplib::Client cli(host, port);
-                cli.set_follow_location(true);
-                cli.set_connection_timeout(10);
-                cli.set_read_timeout(60);
-                res = cli.Post(endpoint.c_str(), headers, bodyStr, "application/json");
+            {
+                auto cli = connectionPool->acquire(isSsl, host, port);
+                applyReadTimeout(cli);
+                res = cli->Post(endpoint, headers, bodyStr, "application/json");
+                // 连接级失败时丢弃该连接，重试走新连接
+                if (!res) cli.discard();
             }
             
             if (res && res->status == 200) break;
@@ -167,19 +368,272 @@ nlohmann::json LLMClient::chatWithTools(const nlohmann::json& messages, const nl
     }
 }
 
+// ---------------------------------------------------------------------------
+// Streaming: SSE 增量拼装
+// ---------------------------------------------------------------------------
+namespace {
+
+// 参数串是否已是完整 JSON：完整对象之后不可能再合法追加字符，因此可提前判定
+bool argumentsComplete(const std::string& args) {
+    size_t last = args.find_last_not_of(" \t\r\n");
+    if (last == std::string::npos || args[last] != '}') return false;
+    return nlohmann::json::accept(args);
+}
+
+class ChatStreamAssembler {
+public:
+    explicit ChatStreamAssembler(const ChatStreamCallbacks& callbacks) : cb(callbacks) {}
+
+    /** 处理一个 SSE data 负载；返回 true 表示本次产生了 token（正文或 tool_call 增量） */
+    bool onChunk(const nlohmann::json& chunk) {
+        if (chunk.contains("usage") && chunk["usage"].is_object()) usage = chunk["usage"];
+        if (!chunk.contains("choices") || !chunk["choices"].is_array() || chunk["choices"].empty()) return false;
+        const auto& choice = chunk["choices"][0];
+        if (choice.contains("finish_reason") && choice["finish_reason"].is_string()) {
+            finishReason = choice["finish_reason"].get<std::string>();
+        }
+        const auto* delta = choice.contains("delta") ? &choice["delta"] : nullptr;
+        if (!delta || !delta->is_object()) return false;
+
+        bool produced = false;
+        if (delta->contains("content") && (*delta)["content"].is_string()) {
+            const std::string piece = (*delta)["content"].get<std::string>();
+            if (!piece.empty()) {
+                content += piece;
+                hasContent = true;
+                produced = true;
+                if (cb.onContent) cb.onContent(piece);
+            }
+        }
+        if (delta->contains("tool_calls") && (*delta)["tool_calls"].is_array()) {
+            for (const auto& tc : (*delta)["tool_calls"]) {
+                size_t index = tc.value("index", static_cast<size_t>(toolCalls.size() ? toolCalls.size() - 1 : 0));
+                // 进入下一个 tool_call：之前的都已结束
+                for (size_t i = 0; i < index && i < toolCalls.size(); ++i) markReady(i);
+                if (index >= toolCalls.size()) toolCalls.resize(index + 1);
+                auto& slot = toolCalls[index];
+                if (tc.contains("id") && tc["id"].is_string()) slot.id = tc["id"].get<std::string>();
+                if (tc.contains("function") && tc["function"].is_object()) {
+                    const auto& fn = tc["function"];
+                    if (fn.contains("name") && fn["name"].is_string()) slot.name += fn["name"].get<std::string>();
+                    if (fn.contains("arguments") && fn["arguments"].is_string()) {
+                        const std::string piece = fn["arguments"].get<std::string>();
+                        if (!piece.empty()) {
+                            slot.arguments += piece;
+                            produced = true;
+                            if (cb.onToolCallDelta) cb.onToolCallDelta(index, piece);
+                            if (argumentsComplete(slot.arguments)) markReady(index);
+                        }
+                    }
+                }
+            }
+        }
+        return produced;
+    }
+
+    nlohmann::json finish() {
+        for (size_t i = 0; i < toolCalls.size(); ++i) markReady(i);
+        nlohmann::json message = {{"role", "assistant"}};
+        message["content"] = hasContent ? nlohmann::json(content) : nlohmann::json(nullptr);
+        if (!toolCalls.empty()) {
+            nlohmann::json arr = nlohmann::json::array();
+            for (size_t i = 0; i < toolCalls.size(); ++i) arr.push_back(toolCallJson(i));
+            message["tool_calls"] = std::move(arr);
+        }
+        nlohmann::json choice = {{"index", 0}, {"message", std::move(message)}};
+        choice["finish_reason"] = finishReason.empty() ? nlohmann::json(nullptr) : nlohmann::json(finishReason);
+        nlohmann::json res = {{"choices", nlohmann::json::array({std::move(choice)})}};
+        if (!usage.is_null()) res["usage"] = usage;
+        return res;
+    }
+
+private:
+    struct PendingToolCall {
+        std::string id, name, arguments;
+        bool ready = false;
+    };
+    const ChatStreamCallbacks& cb;
+    std::string content;
+    bool hasContent = false;
+    std::string finishReason;
+    nlohmann::json usage;
+    std::vector<PendingToolCall> toolCalls;
+
+    nlohmann::json toolCallJson(size_t i) const {
+        const auto& t = toolCalls[i];
+        return {{"id", t.id}, {"type", "function"}, {"function", {{"name", t.name}, {"arguments", t.arguments}}}};
+    }
+
+    void markReady(size_t i) {
+        if (toolCalls[i].ready) return;
+        toolCalls[i].ready = true;
+        if (cb.onToolCallReady) cb.onToolCallReady(i, toolCallJson(i));
+    }
+};
+
+}  // namespace
+
+nlohmann::json LLMClient::chatWithToolsStream(const nlohmann::json& messages, const nlohmann::json& tools,
+                                              const ChatStreamCallbacks& callbacks) {
+    std::string body = buildChatBody(serializeMessagesForKimi(messages), dumpTools(tools), true);
+    return scheduler->run(RequestPriority::Interactive, chatEndpoint(), [&] { return postChatStream(body, callbacks); });
+}
+
+nlohmann::json LLMClient::chatWithToolsStream(const Conversation& conversation, const nlohmann::json& tools,
+                                              const ChatStreamCallbacks& callbacks) {
+    const std::string messagesJson = conversation.serializedMessages();
+    const std::string toolsJson = dumpTools(tools);
+    recordPrefix(messagesJson, toolsJson);
+    std::string body = buildChatBody(messagesJson, toolsJson, true);
+    return scheduler->run(RequestPriority::Interactive, chatEndpoint(), [&] { return postChatStream(body, callbacks); });
+}
+
+nlohmann::json LLMClient::postChatStream(const std::string& bodyStr, const ChatStreamCallbacks& callbacks) {
+    httplib::Headers headers = {
+        {"Authorization", "Bearer " + apiKey},
+        {"Content-Type", "application/json"},
+        {"Accept", "text/event-stream"}
+    };
+    std::string endpoint = pathPrefix + "/chat/completions";
+
+    const int maxRetries = 3;
+    for (int attempt = 1; attempt <= maxRetries; ++attempt) {
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        StreamMetrics metrics;
+        ChatStreamAssembler assembler(callbacks);
+        bool produced = false;   // 已向调用方交付过增量：此后失败不能再重试
+        enum class Mode { Unknown, Sse, Json } mode = Mode::Unknown;
+        std::string raw;         // 非 SSE 响应（JSON 或错误体）原样保留
+
+        SseParser parser([&](const SseParser::Event& ev) {
+            ++metrics.events;
+            if (ev.data == "[DONE]") return;
+            try {
+                if (assembler.onChunk(nlohmann::json::parse(ev.data))) {
+                    produced = true;
+                    if (metrics.ttftMs < 0) {
+                        metrics.ttftMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                    }
+                }
+            } catch (...) {}
+        });
+
+        httplib::Result res;
+        try {
+            auto cli = connectionPool->acquire(isSsl, host, port);
+            applyReadTimeout(cli);
+            res = cli->Post(endpoint, headers, bodyStr, "application/json",
+                [&](const char* data, size_t len) {
+                    // 请求被取消：中止读取（已交付的增量保留）
+                    const CancellationToken* token = RequestScheduler::currentToken();
+                    if (token && token->isCancelled()) return false;
+                    if (mode == Mode::Unknown) {
+                        size_t i = 0;
+                        while (i < len && std::isspace(static_cast<unsigned char>(data[i]))) ++i;
+                        if (i < len) mode = (data[i] == '{') ? Mode::Json : Mode::Sse;
+                    }
+                    if (mode == Mode::Sse) parser.feed(data, len);
+                    else raw.append(data, len);
+                    return true;
+                });
+            if (!res) cli.discard();
+        } catch (...) {
+            if (produced || attempt >= maxRetries) throw;
+        }
+
+        if (res && res->status == 200) {
+            nlohmann::json out;
+            if (mode == Mode::Json) {
+                try { out = nlohmann::json::parse(raw); } catch (...) { out = nlohmann::json::object(); }
+                // 非流式响应：一次性交付正文
+                if (out.contains("choices") && !out["choices"].empty()) {
+                    const auto& msg = out["choices"][0]["message"];
+                    if (msg.contains("content") && msg["content"].is_string() && callbacks.onContent) {
+                        metrics.ttftMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                        callbacks.onContent(msg["content"].get<std::string>());
+                    }
+                }
+            } else {
+                parser.finish();
+                out = assembler.finish();
+            }
+            metrics.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            std::lock_guard<std::mutex> lock(metricsMtx);
+            lastStreamMetrics = metrics;
+            return out;
+        }
+
+        if (produced || attempt >= maxRetries) {
+            std::cerr << RED << "✖ API Error (stream): " << (res ? std::to_string(res->status) : "Connection failed")
+                      << RESET << std::endl;
+            if (!raw.empty()) std::cerr << "  Body: " << raw << std::endl;
+            break;
+        }
+        std::cerr << YELLOW << "  ⚠ API request failed (Status: " << (res ? std::to_string(res->status) : "Timeout")
+                  << "). Retrying (" << attempt << "/" << maxRetries << ")..." << RESET << "\r" << std::flush;
+        std::this_thread::sleep_for(std::chrono::seconds(2 * attempt));
+    }
+    return nlohmann::json::object();
+}
+
+StreamMetrics LLMClient::getLastStreamMetrics() const {
+    std::lock_guard<std::mutex> lock(metricsMtx);
+    return lastStreamMetrics;
+}
+
 std::string LLMClient::summarize(const std::string& text) {
+    LatencyScope timing([this](double ms) { recordLatency(LLMPurpose::Summarizer, ms); });
+    LLMClient* r = routed(LLMPurpose::Summarizer);
+    LLMClient& target = r ? *r : *this;
     std::string prompt = "Please summarize the following content briefly while preserving key information:\n\n" + text;
-    return chat(prompt, "You are an expert summarizer. Your goal is to compress information while maintaining context.");
+    return scheduler->run(RequestPriority::Summarization, target.chatEndpoint(), [&] {
+        return target.chat(prompt, "You are an expert summarizer. Your goal is to compress information while maintaining context.");
+    });
+}
+
+std::future<std::string> LLMClient::chatAsync(const std::string& prompt, const std::string& systemRole,
+                                              CancellationToken token) {
+    return scheduler->submit(RequestPriority::Interactive, chatEndpoint(),
+                             [this, prompt, systemRole] { return chat(prompt, systemRole); }, std::move(token));
+}
+
+std::future<nlohmann::json> LLMClient::chatWithToolsAsync(nlohmann::json messages, nlohmann::json tools,
+                                                          CancellationToken token) {
+    return scheduler->submit(RequestPriority::Interactive, chatEndpoint(),
+                             [this, messages = std::move(messages), tools = std::move(tools)] {
+                                 return chatWithTools(messages, tools);
+                             },
+                             std::move(token));
+}
+
+// 异步入口按路由的 endpoint 排队，路由的并发上限在排队阶段即生效
+std::future<std::string> LLMClient::summarizeAsync(const std::string& text, CancellationToken token) {
+    LLMClient* r = routed(LLMPurpose::Summarizer);
+    return scheduler->submit(RequestPriority::Summarization, (r ? r : this)->chatEndpoint(),
+                             [this, text] { return summarize(text); }, std::move(token));
+}
+
+std::future<std::vector<float>> LLMClient::getEmbeddingAsync(const std::string& text, CancellationToken token) {
+    LLMClient* r = routed(LLMPurpose::Embedder);
+    return scheduler->submit(RequestPriority::Background, (r ? r : this)->embeddingEndpoint(),
+                             [this, text] { return getEmbedding(text); }, std::move(token));
 }
 
 std::vector<float> LLMClient::getEmbedding(const std::string& text) {
+    LatencyScope timing([this](double ms) { recordLatency(LLMPurpose::Embedder, ms); });
+    if (LLMClient* r = routed(LLMPurpose::Embedder)) return r->getEmbedding(text);
+    return scheduler->run(RequestPriority::Background, embeddingEndpoint(), [&] { return postEmbedding(text); });
+}
+
+std::vector<float> LLMClient::postEmbedding(const std::string& text) {
     httplib::Headers headers = {
         {"Authorization", "Bearer " + apiKey},
         {"Content-Type", "application/json"}
     };
 
     nlohmann::json body = {
-        {"model", "text-embedding-3-small"}, // Default embedding model
+        {"model", embeddingModel},
         {"input", text}
     };
 
@@ -188,19 +642,10 @@ std::vector<float> LLMClient::getEmbedding(const std::string& text) {
 
     httplib::Result res;
     try {
-        if (isSsl) {
-            httplib::SSLClient cli(host, port);
-            cli.set_follow_location(true);
-            cli.set_connection_timeout(10);
-            cli.set_read_timeout(60);
-            res = cli.Post(endpoint.c_str(), headers, bodyStr, "application/json");
-        } else {
-            httplib::Client cli(host, port);
-            cli.set_follow_location(true);
-            cli.set_connection_timeout(10);
-            cli.set_read_timeout(60);
-            res = cli.Post(endpoint.c_str(), headers, bodyStr, "application/json");
-        }
+        auto cli = connectionPool->acquire(isSsl, host, port);
+        applyReadTimeout(cli);
+        res = cli->Post(endpoint, headers, bodyStr, "application/json");
+        if (!res) cli.discard();
     } catch (...) {
         return {};
     }
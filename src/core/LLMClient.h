@@ -1,6 +1,78 @@
 #pragma once
+#include <array>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
+#include "core/Conversation.h"
+#include "core/HttpClientPool.h"
+#include "core/RequestScheduler.h"
+
+/**
+ * 单条消息发送前的规范化（content 统一为非空 text part 数组，tool 消息去掉 name）。
+ * Conversation 用它生成并缓存每条消息的序列化片段。
+ */
+nlohmann::json normalizeMessageForKimi(const nlohmann::json& message);
+
+/** 流式回调（在调度器 worker 线程上触发，调用方此时阻塞等待） */
+struct ChatStreamCallbacks {
+    /** 正文增量 */
+    std::function<void(const std::string& delta)> onContent;
+    /** tool_call 参数增量（index 为该调用在 tool_calls 中的位置） */
+    std::function<void(size_t index, const std::string& argumentsDelta)> onToolCallDelta;
+    /** 某个 tool_call 的参数已完整（可解析为 JSON）时触发，可早于整条消息结束 */
+    std::function<void(size_t index, const nlohmann::json& toolCall)> onToolCallReady;
+};
+
+/** 最近一次流式请求的时延指标 */
+struct StreamMetrics {
+    double ttftMs = -1.0;   // 发出请求到首个 token（正文或 tool_call 增量）；-1 表示没有收到
+    double totalMs = 0.0;
+    size_t events = 0;      // 收到的 SSE 事件数
+};
+
+/**
+ * 相邻两次（Conversation 版本）chat 请求的前缀稳定性：按服务端渲染顺序（tools 在前、messages 在后）
+ * 比较字节，最长相同前缀越长，服务端前缀缓存命中越多、首 token 越快。
+ */
+struct PrefixMetrics {
+    size_t promptBytes = 0;        // 本次 tools + messages 的字节数
+    size_t commonPrefixBytes = 0;  // 与上一次请求相同的最长前缀
+    size_t requests = 0;
+};
+
+/** 辅助调用的用途：各自可路由到独立的模型 / endpoint，未配置时使用主模型 */
+enum class LLMPurpose { Planner, Summarizer, Embedder };
+
+/**
+ * 某一用途的路由。字段为空 / 0 / -1 时沿用主客户端的设置；
+ * 例如 summarizer 配一个小而快的模型，压缩与读取摘要就不再占用主模型的时延与并发。
+ */
+struct LLMRoute {
+    std::string model;          // embedder 路由中为 embedding 模型名
+    std::string baseUrl;
+    std::string apiKey;
+    int timeoutSec = 0;         // 读超时
+    int maxTokens = -1;
+    size_t maxConcurrent = 0;   // 该路由 endpoint 在调度器中的并发上限
+};
+
+/** 请求时延直方图（毫秒，固定的对数分桶，最后一桶为超过 30s） */
+struct LatencyHistogram {
+    static constexpr std::array<double, 9> kBoundsMs = {50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000};
+    std::array<size_t, kBoundsMs.size() + 1> buckets{};
+    size_t count = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+
+    void record(double ms);
+    /** 近似分位数：返回 p 所在桶的上界（最后一桶返回 maxMs） */
+    double percentile(double p) const;
+};
 
 class LLMClient {
 public:
@@ -12,10 +84,71 @@ public:
     
     virtual std::string chat(const std::string& prompt, const std::string& systemRole = "");
     virtual nlohmann::json chatWithTools(const nlohmann::json& messages, const nlohmann::json& tools);
+    /** 使用 Conversation 缓存的消息片段拼装请求体（长对话下不再每轮重新序列化全部历史） */
+    virtual nlohmann::json chatWithTools(const Conversation& conversation, const nlohmann::json& tools);
+    /**
+     * 规划调用（planner 路由，如 AgentRuntime 的 Plan 阶段）：与 chatWithTools 同构，有 planner 路由时发往路由的模型。
+     * agent 主循环的 chatWithTools / chatWithToolsStream 及其指标始终使用主模型。
+     */
+    virtual nlohmann::json plan(const Conversation& conversation, const nlohmann::json& tools);
+    /**
+     * 流式（SSE, stream: true）版本：增量通过 callbacks 交付，返回值与 chatWithTools 同构
+     * （choices[0].message 含拼好的 content / tool_calls，以及 finish_reason）。
+     * 服务端不支持流式而直接返回 JSON 时按普通响应解析。
+     */
+    virtual nlohmann::json chatWithToolsStream(const nlohmann::json& messages, const nlohmann::json& tools,
+                                               const ChatStreamCallbacks& callbacks);
+    virtual nlohmann::json chatWithToolsStream(const Conversation& conversation, const nlohmann::json& tools,
+                                               const ChatStreamCallbacks& callbacks);
+    StreamMetrics getLastStreamMetrics() const;
+    PrefixMetrics getLastPrefixMetrics() const;
     
     virtual std::string summarize(const std::string& text);
     virtual std::vector<float> getEmbedding(const std::string& text);
 
+    /**
+     * 异步版本：经 RequestScheduler 排队（chat / chatWithTools 为 interactive，summarize 为 summarization，
+     * getEmbedding 为 background），在 worker 上调用对应的同步虚函数（子类覆盖同样生效）。
+     * 取消仅对尚未开始的请求生效（流式请求会在下一个数据块处中止）。LLMClient 须比其未完成的请求活得久。
+     */
+    std::future<std::string> chatAsync(const std::string& prompt, const std::string& systemRole = "",
+                                       CancellationToken token = CancellationToken());
+    std::future<nlohmann::json> chatWithToolsAsync(nlohmann::json messages, nlohmann::json tools,
+                                                   CancellationToken token = CancellationToken());
+    std::future<std::string> summarizeAsync(const std::string& text, CancellationToken token = CancellationToken());
+    std::future<std::vector<float>> getEmbeddingAsync(const std::string& text,
+                                                      CancellationToken token = CancellationToken());
+    /** getEmbedding 使用的模型名（用作 embedding 缓存键的一部分；有 embedder 路由时为路由的模型） */
+    virtual std::string getEmbeddingModel() const;
+
+    /**
+     * 为某一用途设置路由：planner 接管 plan，summarizer 接管 summarize，embedder 接管 getEmbedding。
+     * 路由客户端共用本客户端的连接池与调度器，在调度器中有独立的 endpoint 键（并发上限互不挤占）。
+     * 应在首次请求前调用；替换连接池 / 调度器后路由随之更新。
+     */
+    void setRoute(LLMPurpose purpose, const LLMRoute& route);
+    bool hasRoute(LLMPurpose purpose) const { return routes.count(purpose) > 0; }
+    /** 该用途实际使用的模型名 */
+    std::string routeModel(LLMPurpose purpose) const;
+    static const char* purposeName(LLMPurpose purpose);
+    static bool parsePurpose(const std::string& name, LLMPurpose& purpose);
+    /** 各用途的调用时延（从调用到返回，含排队），按用途累计 */
+    LatencyHistogram getLatencyHistogram(LLMPurpose purpose) const;
+
+    /** 替换连接池配置（大小、空闲超时、TLS 会话复用、证书校验）；应在首次请求前调用 */
+    void configureConnectionPool(const HttpClientPool::Options& options);
+    /** 与其它 LLMClient 共用同一个连接池（同 host 的连接跨客户端复用） */
+    void setConnectionPool(std::shared_ptr<HttpClientPool> pool);
+    std::shared_ptr<HttpClientPool> getConnectionPool() const { return connectionPool; }
+
+    /** 替换请求调度器（worker 数、各 endpoint 并发上限）；应在首次请求前调用 */
+    void configureRequestScheduler(const RequestScheduler::Options& options);
+    void setRequestScheduler(std::shared_ptr<RequestScheduler> scheduler);
+    std::shared_ptr<RequestScheduler> getRequestScheduler() const { return scheduler; }
+    /** 调度器中 chat / embedding 请求使用的 endpoint 键（用于设置并发上限） */
+    std::string chatEndpoint() const;
+    std::string embeddingEndpoint() const;
+
 private:
     std::string apiKey;
     std::string baseUrl;
@@ -25,6 +158,35 @@ private:
     int port;
     std::string pathPrefix;
     int maxTokens;
+    std::string embeddingModel = "text-embedding-3-small";
+    std::shared_ptr<HttpClientPool> connectionPool;
+    std::shared_ptr<RequestScheduler> scheduler;
+    int readTimeoutSec = 0;     // 非 0 时覆盖连接池的读超时（路由客户端）
+    std::string endpointTag;    // 路由客户端的调度器 endpoint 后缀
+
+    struct RouteState {
+        LLMRoute route;
+        std::shared_ptr<LLMClient> client;
+    };
+    std::map<LLMPurpose, RouteState> routes;
+
+    mutable std::mutex metricsMtx;
+    StreamMetrics lastStreamMetrics;
+    PrefixMetrics lastPrefixMetrics;
+    std::string lastPrompt;  // 上一次的 tools + messages，用于计算相同前缀
+    std::map<LLMPurpose, LatencyHistogram> latency;
+
+    /** 该用途的路由客户端；未配置时为 nullptr */
+    LLMClient* routed(LLMPurpose purpose) const;
+    void rebuildRoutes();
+    void recordLatency(LLMPurpose purpose, double ms);
+    void applyReadTimeout(HttpClientPool::Lease& cli) const;
 
     void parseBaseUrl(const std::string& url);
+    std::string buildChatBody(const std::string& messagesJson, const std::string& toolsJson, bool stream) const;
+    static std::string dumpTools(const nlohmann::json& tools);
+    void recordPrefix(const std::string& messagesJson, const std::string& toolsJson);
+    nlohmann::json postChat(const std::string& bodyStr);
+    nlohmann::json postChatStream(const std::string& bodyStr, const ChatStreamCallbacks& callbacks);
+    std::vector<float> postEmbedding(const std::string& text);
 };
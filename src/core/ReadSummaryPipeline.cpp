@@ -0,0 +1,176 @@
+#include "ReadSummaryPipeline.h"
+#include "utils/Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+ReadSummaryPipeline::ReadSummaryPipeline(fs::path cacheFile, std::string model, SummarizeFn summarize, Options opts)
+    : cacheFile(std::move(cacheFile)), model(std::move(model)), summarize(std::move(summarize)), options(opts) {
+    load();
+    worker = std::thread([this] { workerLoop(); });
+}
+
+ReadSummaryPipeline::~ReadSummaryPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+        queue.clear();
+    }
+    cv.notify_all();
+    if (worker.joinable()) worker.join();
+    save();
+}
+
+std::string ReadSummaryPipeline::makeKey(const std::string& model, const std::string& label, const std::string& readText) {
+    std::string material = label + "\n" + readText;
+    // 长度参与键，进一步降低 64 位哈希碰撞概率
+    return model + ":" + std::to_string(material.size()) + ":" + hashToHex(fnv1a64(material));
+}
+
+void ReadSummaryPipeline::request(const std::string& label, const std::string& readText) {
+    if (label.empty() || readText.empty()) return;
+    std::string text = readText.size() > options.maxInputBytes ? readText.substr(0, options.maxInputBytes) : readText;
+    std::string key = makeKey(model, label, text);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.requested++;
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            it->second.lastUsed = ++useCounter;
+            stats.cacheHits++;
+            ready.emplace_back(label, it->second.summary);
+            return;
+        }
+        for (const auto& job : queue) {
+            if (job.key == key) return;
+        }
+        queue.push_back({std::move(key), label, std::move(text)});
+        while (queue.size() > options.maxQueue) {
+            queue.pop_front();
+            stats.dropped++;
+        }
+    }
+    cv.notify_all();
+}
+
+std::vector<std::pair<std::string, std::string>> ReadSummaryPipeline::takeReady() {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<std::pair<std::string, std::string>> out;
+    out.swap(ready);
+    return out;
+}
+
+void ReadSummaryPipeline::workerLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) return;
+        // 最新的读取优先
+        Job job = std::move(queue.back());
+        queue.pop_back();
+        const uint64_t jobEpoch = epoch;
+        busy = true;
+        lock.unlock();
+
+        std::string summary;
+        try {
+            summary = summarize("请对以下 read 结果做 1-3 条要点摘要，保留文件路径/范围或标签：\n" + job.text);
+        } catch (...) {
+            summary.clear();
+        }
+
+        lock.lock();
+        busy = false;
+        if (jobEpoch != epoch) {
+            stats.dropped++;
+        } else if (summary.empty()) {
+            stats.failed++;
+        } else {
+            stats.completed++;
+            cache[job.key] = {summary, ++useCounter};
+            evictLocked();
+            dirty = true;
+            ready.emplace_back(job.label, std::move(summary));
+        }
+        const bool needSave = dirty && !stopping;
+        lock.unlock();
+        if (needSave) save();
+        lock.lock();
+        cv.notify_all();
+    }
+}
+
+bool ReadSummaryPipeline::waitIdle(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return queue.empty() && !busy; });
+}
+
+void ReadSummaryPipeline::cancelAll() {
+    std::lock_guard<std::mutex> lock(mtx);
+    stats.dropped += queue.size();
+    queue.clear();
+    ready.clear();
+    epoch++;
+}
+
+ReadSummaryPipeline::Stats ReadSummaryPipeline::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
+
+void ReadSummaryPipeline::evictLocked() {
+    if (cache.size() <= options.maxEntries) return;
+    std::vector<std::pair<uint64_t, std::string>> order;
+    order.reserve(cache.size());
+    for (const auto& [key, entry] : cache) order.emplace_back(entry.lastUsed, key);
+    std::sort(order.begin(), order.end());
+    for (size_t i = 0; i < order.size() && cache.size() > options.maxEntries; ++i) cache.erase(order[i].second);
+}
+
+void ReadSummaryPipeline::load() {
+    std::ifstream file(cacheFile);
+    if (!file.is_open()) return;
+    try {
+        nlohmann::json j;
+        file >> j;
+        if (!j.contains("entries") || !j["entries"].is_object()) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& [key, val] : j["entries"].items()) {
+            if (!val.is_object() || !val.contains("summary") || !val["summary"].is_string()) continue;
+            CacheEntry entry;
+            entry.summary = val["summary"].get<std::string>();
+            entry.lastUsed = val.value("last_used", static_cast<uint64_t>(0));
+            useCounter = std::max(useCounter, entry.lastUsed);
+            cache[key] = std::move(entry);
+        }
+        evictLocked();
+    } catch (...) {}
+}
+
+void ReadSummaryPipeline::save() {
+    nlohmann::json j;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!dirty) return;
+        j["version"] = 1;
+        j["entries"] = nlohmann::json::object();
+        for (const auto& [key, entry] : cache) {
+            j["entries"][key] = {{"summary", entry.summary}, {"last_used", entry.lastUsed}};
+        }
+        dirty = false;
+    }
+    try {
+        std::error_code ec;
+        fs::create_directories(cacheFile.parent_path(), ec);
+        // 先写临时文件再替换，进程中途退出不会留下截断的缓存
+        fs::path tmp = cacheFile;
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (!out.is_open()) return;
+            out << j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        }
+        fs::rename(tmp, cacheFile, ec);
+    } catch (...) {}
+}
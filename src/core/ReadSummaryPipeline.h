@@ -0,0 +1,104 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief read 结果摘要的后台流水线 + 跨会话磁盘缓存
+ *
+ * enable_read_summary 打开时，每次 read 之后都要为结果生成 1-3 条要点摘要。request() 只做哈希与入队，
+ * 摘要由后台线程逐个生成，主循环从不等待；injectReadSummaries 每轮用 takeReady() 收取已经完成的部分。
+ * - 缓存键为「摘要模型 + 标签（路径 / 范围）+ read 文本」的哈希：read 文本带行号与文件内容，
+ *   代码未变时重复读取（包括下一次会话）直接复用摘要，内容变化后自然失效
+ * - 存储于 .photon/index/read_summaries.json，按最近使用保留 maxEntries 条，有新条目时落盘
+ * - 等待队列有上限，超出时丢弃最旧的请求（越新的读取越可能与下一步相关）；cancelAll 清空队列并丢弃进行中的结果
+ * 线程安全。
+ */
+class ReadSummaryPipeline {
+public:
+    /** 同步生成摘要（在后台线程上调用）；返回空串视为失败，不缓存 */
+    using SummarizeFn = std::function<std::string(const std::string& prompt)>;
+
+    struct Options {
+        size_t maxEntries = 2000;     // 磁盘缓存条目上限
+        size_t maxQueue = 16;         // 等待生成的请求上限
+        size_t maxInputBytes = 6000;  // 送去摘要的 read 文本上限
+    };
+
+    struct Stats {
+        size_t requested = 0;
+        size_t cacheHits = 0;
+        size_t completed = 0;  // 新生成的摘要
+        size_t failed = 0;
+        size_t dropped = 0;    // 因队列已满或取消被丢弃
+    };
+
+    ReadSummaryPipeline(fs::path cacheFile, std::string model, SummarizeFn summarize)
+        : ReadSummaryPipeline(std::move(cacheFile), std::move(model), std::move(summarize), Options()) {}
+    ReadSummaryPipeline(fs::path cacheFile, std::string model, SummarizeFn summarize, Options options);
+    ~ReadSummaryPipeline();
+
+    ReadSummaryPipeline(const ReadSummaryPipeline&) = delete;
+    ReadSummaryPipeline& operator=(const ReadSummaryPipeline&) = delete;
+
+    /** 请求为一次 read 结果生成摘要；label 用于展示（如 "src/a.cpp:foo"）。不阻塞 */
+    void request(const std::string& label, const std::string& readText);
+
+    /** 取走已就绪的摘要（label, summary），按就绪顺序；不等待 */
+    std::vector<std::pair<std::string, std::string>> takeReady();
+
+    /** 等待队列清空且没有摘要在生成（测试使用）；超时返回 false */
+    bool waitIdle(int timeoutMs);
+
+    /** 丢弃等待中的请求与进行中的结果（clear 命令使用）；已缓存的摘要保留 */
+    void cancelAll();
+
+    Stats getStats() const;
+
+    static std::string makeKey(const std::string& model, const std::string& label, const std::string& readText);
+
+private:
+    struct Job {
+        std::string key;
+        std::string label;
+        std::string text;
+    };
+    struct CacheEntry {
+        std::string summary;
+        uint64_t lastUsed = 0;
+    };
+
+    fs::path cacheFile;
+    std::string model;
+    SummarizeFn summarize;
+    Options options;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Job> queue;
+    std::vector<std::pair<std::string, std::string>> ready;
+    std::unordered_map<std::string, CacheEntry> cache;
+    uint64_t useCounter = 0;
+    uint64_t epoch = 0;  // cancelAll 递增；进行中的任务完成时代数不同则丢弃结果
+    bool busy = false;
+    bool stopping = false;
+    bool dirty = false;
+    Stats stats;
+    std::thread worker;
+
+    void workerLoop();
+    void load();
+    void save();
+    void evictLocked();
+};
@@ -0,0 +1,168 @@
+#include "core/RequestScheduler.h"
+#include <algorithm>
+
+namespace {
+thread_local bool tlsOnWorker = false;
+thread_local const CancellationToken* tlsCurrentToken = nullptr;
+}  // namespace
+
+RequestScheduler::RequestScheduler() : RequestScheduler(Options()) {}
+
+RequestScheduler::RequestScheduler(Options options) : core(std::make_shared<Core>()) {
+    core->opts = std::move(options);
+    if (core->opts.workerThreads == 0) core->opts.workerThreads = 1;
+    if (core->opts.defaultEndpointLimit == 0) core->opts.defaultEndpointLimit = 1;
+}
+
+RequestScheduler::~RequestScheduler() {
+    std::vector<Task> pending;
+    {
+        std::lock_guard<std::mutex> lock(core->mtx);
+        core->stopping = true;
+        for (auto& q : core->queues) {
+            for (auto& t : q) pending.push_back(std::move(t));
+            q.clear();
+        }
+    }
+    core->cv.notify_all();
+    for (auto& t : pending) t.cancel();
+    for (auto& w : workers) {
+        if (!w.joinable()) continue;
+        // 最后一个引用在 worker 自身上释放时不能 join 自己：detach 后它只访问自己持有的 core，随后退出
+        if (w.get_id() == std::this_thread::get_id()) w.detach();
+        else w.join();
+    }
+}
+
+bool RequestScheduler::onWorkerThread() { return tlsOnWorker; }
+
+const CancellationToken* RequestScheduler::currentToken() { return tlsCurrentToken; }
+
+RequestScheduler::TokenScope::TokenScope(const CancellationToken* token) : previous(tlsCurrentToken) {
+    tlsCurrentToken = token;
+}
+
+RequestScheduler::TokenScope::~TokenScope() { tlsCurrentToken = previous; }
+
+void RequestScheduler::setEndpointLimit(const std::string& endpoint, size_t limit) {
+    {
+        std::lock_guard<std::mutex> lock(core->mtx);
+        core->opts.endpointLimits[endpoint] = std::max<size_t>(1, limit);
+    }
+    core->cv.notify_all();
+}
+
+RequestScheduler::Stats RequestScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(core->mtx);
+    Stats s = core->stats;
+    s.queued = 0;
+    for (const auto& q : core->queues) s.queued += q.size();
+    s.running = 0;
+    for (const auto& kv : core->runningPerEndpoint) s.running += kv.second;
+    return s;
+}
+
+void RequestScheduler::countInline() {
+    std::lock_guard<std::mutex> lock(core->mtx);
+    ++core->stats.inlineRuns;
+}
+
+void RequestScheduler::Core::wakeWorkers() {
+    // 持锁一次：保证 worker 不会在检查谓词与进入等待之间错过这次通知
+    { std::lock_guard<std::mutex> lock(mtx); }
+    cv.notify_all();
+}
+
+void RequestScheduler::enqueue(Task task) {
+    // 排队中的请求被取消时唤醒 worker，由其出队并以 RequestCancelled 结束（须在持有 mtx 之前注册：已取消时会立即回调）
+    task.token.onCancel([weak = std::weak_ptr<Core>(core)] {
+        if (auto c = weak.lock()) c->wakeWorkers();
+    });
+    {
+        std::lock_guard<std::mutex> lock(core->mtx);
+        if (!core->stopping) {
+            ++core->stats.submitted;
+            core->queues[static_cast<size_t>(task.priority)].push_back(std::move(task));
+            if (workers.empty()) {
+                for (size_t i = 0; i < core->opts.workerThreads; ++i) workers.emplace_back([c = core] { c->workerLoop(); });
+            }
+            core->cv.notify_all();
+            return;
+        }
+    }
+    task.cancel();
+}
+
+size_t RequestScheduler::Core::endpointLimitLocked(const std::string& endpoint) const {
+    auto it = opts.endpointLimits.find(endpoint);
+    return it != opts.endpointLimits.end() ? it->second : opts.defaultEndpointLimit;
+}
+
+bool RequestScheduler::Core::canStartLocked(const Task& task) const {
+    size_t limit = endpointLimitLocked(task.endpoint);
+    auto it = runningPerEndpoint.find(task.endpoint);
+    size_t running = it != runningPerEndpoint.end() ? it->second : 0;
+    if (task.priority == RequestPriority::Interactive) return running < limit;
+    // 非交互请求给交互请求各留一个名额
+    size_t cap = limit > 1 ? limit - 1 : limit;
+    size_t workerCap = opts.workerThreads > 1 ? opts.workerThreads - 1 : opts.workerThreads;
+    return running < cap && runningNonInteractive < workerCap;
+}
+
+bool RequestScheduler::Core::takeNextLocked(Task& out, std::vector<Task>& cancelled) {
+    for (auto& q : queues) {
+        for (auto it = q.begin(); it != q.end();) {
+            if (it->token.isCancelled()) {
+                cancelled.push_back(std::move(*it));
+                it = q.erase(it);
+                continue;
+            }
+            if (canStartLocked(*it)) {
+                out = std::move(*it);
+                q.erase(it);
+                return true;
+            }
+            ++it;
+        }
+    }
+    return false;
+}
+
+void RequestScheduler::Core::workerLoop() {
+    tlsOnWorker = true;
+    while (true) {
+        Task task;
+        std::vector<Task> cancelled;
+        bool found = false;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            // 提交、完成、取消与关闭都会通知；空闲时不轮询
+            cv.wait(lock, [&] {
+                if (stopping) return true;
+                found = takeNextLocked(task, cancelled);
+                return found || !cancelled.empty();
+            });
+            if (stopping && !found && cancelled.empty()) return;
+            stats.cancelled += cancelled.size();
+            if (found) {
+                ++runningPerEndpoint[task.endpoint];
+                if (task.priority != RequestPriority::Interactive) ++runningNonInteractive;
+            }
+        }
+        for (auto& t : cancelled) t.cancel();
+        if (!found) continue;
+
+        {
+            TokenScope scope(&task.token);
+            task.run();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--runningPerEndpoint[task.endpoint] == 0) runningPerEndpoint.erase(task.endpoint);
+            if (task.priority != RequestPriority::Interactive) --runningNonInteractive;
+            ++stats.completed;
+        }
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/** 请求优先级：数值越小越先调度 */
+enum class RequestPriority { Interactive = 0, Summarization = 1, Background = 2 };
+
+/** 请求在开始执行前被取消（或调度器已关闭）时，future 抛出此异常 */
+class RequestCancelled : public std::runtime_error {
+public:
+    RequestCancelled() : std::runtime_error("request cancelled") {}
+};
+
+/** 可复制、共享状态的取消标记 */
+class CancellationToken {
+public:
+    CancellationToken() : state(std::make_shared<State>()) {}
+    void cancel() const {
+        std::vector<std::function<void()>> listeners;
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            if (state->flag.exchange(true)) return;
+            listeners.swap(state->listeners);
+        }
+        for (auto& fn : listeners) fn();
+    }
+    bool isCancelled() const { return state->flag.load(); }
+    /** 取消时回调一次（已取消则立即调用）；调度器以此唤醒空闲 worker 清理队列 */
+    void onCancel(std::function<void()> fn) const {
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            if (!state->flag.load()) {
+                state->listeners.push_back(std::move(fn));
+                return;
+            }
+        }
+        fn();
+    }
+
+private:
+    struct State {
+        std::atomic<bool> flag{false};
+        std::mutex mtx;
+        std::vector<std::function<void()>> listeners;
+    };
+    std::shared_ptr<State> state;
+};
+
+/**
+ * LLM 请求调度器：固定数量的 worker 线程 + 按优先级（interactive > summarization > background）排队。
+ * - 每个 endpoint（如 "api.x.com:443/v1/chat/completions"）有并发上限，超限的请求留在队列中
+ * - 非交互请求最多占用 workers-1 个线程、endpoint 上限-1 个名额（上限 > 1 时），交互请求总能及时开始
+ * - 取消：尚未开始的请求出队时以 RequestCancelled 结束；执行中的请求可通过 currentToken() 自行检查
+ * - 在 worker 线程上调用 run() 直接内联执行（嵌套请求不会占满 worker 造成死锁）
+ * worker 线程在首次提交时才启动。线程安全。
+ */
+class RequestScheduler {
+public:
+    struct Options {
+        size_t workerThreads = 4;
+        size_t defaultEndpointLimit = 2;
+        std::unordered_map<std::string, size_t> endpointLimits;
+    };
+
+    struct Stats {
+        size_t submitted = 0;
+        size_t completed = 0;
+        size_t cancelled = 0;
+        size_t inlineRuns = 0;   // 在 worker 线程上被内联执行的 run()
+        size_t queued = 0;
+        size_t running = 0;
+    };
+
+    RequestScheduler();
+    explicit RequestScheduler(Options options);
+    /** 停止 worker；仍在排队的请求以 RequestCancelled 结束 */
+    ~RequestScheduler();
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    /** 异步提交；fn 在 worker 线程上执行，其返回值 / 异常经 future 交付 */
+    template <typename Fn>
+    auto submit(RequestPriority priority, const std::string& endpoint, Fn fn,
+                CancellationToken token = CancellationToken()) -> std::future<decltype(fn())> {
+        using R = decltype(fn());
+        auto promise = std::make_shared<std::promise<R>>();
+        auto future = promise->get_future();
+        Task task;
+        task.priority = priority;
+        task.endpoint = endpoint;
+        task.token = std::move(token);
+        task.run = [promise, fn = std::move(fn)]() mutable {
+            try {
+                if constexpr (std::is_void_v<R>) {
+                    fn();
+                    promise->set_value();
+                } else {
+                    promise->set_value(fn());
+                }
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        };
+        task.cancel = [promise]() { promise->set_exception(std::make_exception_ptr(RequestCancelled())); };
+        enqueue(std::move(task));
+        return future;
+    }
+
+    /** 同步执行：不在 worker 线程上时排队并等待；在 worker 线程上时直接内联执行 */
+    template <typename Fn>
+    auto run(RequestPriority priority, const std::string& endpoint, Fn fn,
+             CancellationToken token = CancellationToken()) -> decltype(fn()) {
+        if (!onWorkerThread()) return submit(priority, endpoint, std::move(fn), std::move(token)).get();
+        if (token.isCancelled()) throw RequestCancelled();
+        countInline();
+        TokenScope scope(&token);
+        return fn();
+    }
+
+    /** 当前线程是否为（任意）调度器的 worker */
+    static bool onWorkerThread();
+    /** 当前 worker 上正在执行的请求的取消标记；不在 worker 上时为 nullptr */
+    static const CancellationToken* currentToken();
+
+    void setEndpointLimit(const std::string& endpoint, size_t limit);
+    const Options& options() const { return core->opts; }
+    Stats getStats() const;
+
+private:
+    struct Task {
+        RequestPriority priority = RequestPriority::Interactive;
+        std::string endpoint;
+        CancellationToken token;
+        std::function<void()> run;
+        std::function<void()> cancel;
+    };
+
+    /** 在作用域内替换当前线程的取消标记（内联执行时使用） */
+    class TokenScope {
+    public:
+        explicit TokenScope(const CancellationToken* token);
+        ~TokenScope();
+
+    private:
+        const CancellationToken* previous;
+    };
+
+    /**
+     * 队列、计数与同步原语放在共享状态中，每个 worker 持有一份 shared_ptr：
+     * 最后一个引用在 worker 自身（如任务持有 LLMClient）上释放时，析构函数 detach 该 worker，
+     * 它返回后仍可安全地更新计数并退出，而不会访问已析构的调度器。取消回调只持有 weak_ptr。
+     */
+    struct Core {
+        Options opts;
+        mutable std::mutex mtx;
+        std::condition_variable cv;
+        std::array<std::deque<Task>, 3> queues;
+        std::unordered_map<std::string, size_t> runningPerEndpoint;
+        size_t runningNonInteractive = 0;
+        bool stopping = false;
+        Stats stats;
+
+        void wakeWorkers();
+        void workerLoop();
+        size_t endpointLimitLocked(const std::string& endpoint) const;
+        bool canStartLocked(const Task& task) const;
+        /** 取出下一个可执行的请求；顺带把已取消的请求移入 cancelled */
+        bool takeNextLocked(Task& out, std::vector<Task>& cancelled);
+    };
+
+    std::shared_ptr<Core> core;
+    std::vector<std::thread> workers;  // 由 core->mtx 保护
+
+    void enqueue(Task task);
+    void countInline();
+};
@@ -0,0 +1,66 @@
+#include "core/SseParser.h"
+
+SseParser::SseParser(Handler handler) : handler(std::move(handler)) {}
+
+void SseParser::feed(const char* data, size_t len) {
+    size_t start = 0;
+    for (size_t i = 0; i < len; ++i) {
+        char c = data[i];
+        if (c != '\n' && c != '\r') continue;
+        if (c == '\n' && lastWasCR && i == start && line.empty()) {
+            // 上一块以 \r 结尾、本块以 \n 开头：同一个 \r\n
+            lastWasCR = false;
+            start = i + 1;
+            continue;
+        }
+        line.append(data + start, i - start);
+        processLine();
+        line.clear();
+        if (c == '\r' && i + 1 < len && data[i + 1] == '\n') ++i;
+        lastWasCR = (c == '\r' && i + 1 >= len);
+        start = i + 1;
+    }
+    if (start < len) {
+        line.append(data + start, len - start);
+        lastWasCR = false;
+    }
+}
+
+void SseParser::finish() {
+    if (!line.empty()) {
+        processLine();
+        line.clear();
+    }
+    dispatch();
+}
+
+void SseParser::processLine() {
+    if (line.empty()) {
+        dispatch();
+        return;
+    }
+    if (line[0] == ':') return;  // 注释 / 心跳
+
+    size_t colon = line.find(':');
+    std::string field = line.substr(0, colon);
+    std::string value;
+    if (colon != std::string::npos) {
+        size_t v = colon + 1;
+        if (v < line.size() && line[v] == ' ') ++v;
+        value = line.substr(v);
+    }
+
+    if (field == "data") {
+        if (hasData) pending.data += '\n';
+        pending.data += value;
+        hasData = true;
+    } else if (field == "event") {
+        pending.event = value;
+    }
+}
+
+void SseParser::dispatch() {
+    if (hasData && handler) handler(pending);
+    pending = Event();
+    hasData = false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <functional>
+#include <string>
+
+/**
+ * 增量 Server-Sent Events 解析器：按任意切分的字节块喂入，遇到空行派发一个事件。
+ * - 行结束符支持 \n、\r\n、\r（\r\n 跨块切开也能正确识别）
+ * - 多行 data 以 \n 连接；":" 开头的注释行忽略；字段名后的单个空格去掉
+ * 不做重连 / id 处理（LLM 流式响应用不到）。
+ */
+class SseParser {
+public:
+    struct Event {
+        std::string event;  // 为空表示默认的 "message"
+        std::string data;
+    };
+    using Handler = std::function<void(const Event&)>;
+
+    explicit SseParser(Handler handler);
+
+    void feed(const char* data, size_t len);
+    void feed(const std::string& chunk) { feed(chunk.data(), chunk.size()); }
+    /** 流结束：派发尚未以空行结尾的最后一个事件 */
+    void finish();
+
+private:
+    Handler handler;
+    std::string line;
+    Event pending;
+    bool hasData = false;
+    bool lastWasCR = false;
+
+    void processLine();
+    void dispatch();
+};
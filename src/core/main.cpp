@@ -25,19 +25,30 @@
 // FileManager.h 已删除,功能由 CoreTools 提供
 #include "core/LLMClient.h"
 #include "core/ContextManager.h"
+#include "core/Conversation.h"
 #include "core/ConfigManager.h"
+#include "core/ReadSummaryPipeline.h"
 #include "mcp/MCPClient.h"
 #include "mcp/MCPManager.h"
 #include "analysis/LSPClient.h"
 #include "utils/SkillManager.h"
 #include "analysis/SymbolManager.h"
+#include "analysis/SemanticManager.h"
+#include "analysis/providers/LocalEmbeddingProvider.h"
 #include "utils/Logger.h"
 #include "analysis/providers/RegexSymbolProvider.h"
 #include "analysis/providers/TreeSitterSymbolProvider.h"
 // 新架构: Tools 层
 #include "tools/ToolRegistry.h"
 #include "tools/CoreTools.h"
+#include "tools/SemanticSearchTool.h"
+#include "tools/ToolResultStore.h"
+#include "tools/FetchResultTool.h"
+#include "tools/ToolScheduler.h"
+#include "tools/ToolPrefetcher.h"
+#include "utils/FileContentCache.h"
 #include "utils/ScanIgnore.h"
+#include "utils/Tokenizer.h"
 // Agent 层: Constitution 校验
 #include "agent/ConstitutionValidator.h"
 #ifdef PHOTON_ENABLE_TREESITTER
@@ -274,6 +285,14 @@ bool isRiskyTool(const std::string& toolName) {
     return risky.count(toolName) > 0;
 }
 
+// 只读工具：无副作用，流式响应中参数一到齐即可提前执行
+bool isReadOnlyTool(const std::string& toolName) {
+    static const std::unordered_set<std::string> readOnly = {
+        "read_code_block", "list_project_files", "grep", "semantic_search", "fetch_result"
+    };
+    return readOnly.count(toolName) > 0;
+}
+
 static std::string toLowerCopy(const std::string& s) {
     std::string out = s;
     std::transform(out.begin(), out.end(), out.begin(), ::tolower);
@@ -470,6 +489,51 @@ std::string renderMarkdown(const std::string& input) {
     return output;
 }
 
+// 流式正文输出：按完整行交给 renderMarkdown；``` 代码块等闭合后整体渲染，避免半截代码块被当作普通文本
+class StreamingMarkdownPrinter {
+public:
+    void onDelta(const std::string& delta) {
+        pending += delta;
+        size_t nl;
+        while ((nl = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, nl);
+            pending.erase(0, nl + 1);
+            size_t first = line.find_first_not_of(" \t");
+            if (first != std::string::npos && line.compare(first, 3, "```") == 0) inFence = !inFence;
+            block += line + "\n";
+            if (!inFence) flushBlock();
+        }
+    }
+
+    void finish() {
+        block += pending;
+        pending.clear();
+        flushBlock();
+    }
+
+    bool hasOutput() const { return started; }
+
+private:
+    std::string pending;
+    std::string block;
+    bool inFence = false;
+    bool started = false;
+
+    void flushBlock() {
+        if (block.find_first_not_of(" \t\r\n") == std::string::npos) {
+            if (started) std::cout << block << std::flush;
+            block.clear();
+            return;
+        }
+        if (!started) {
+            std::cout << "\n" << MAGENTA << BOLD << "φ Photon " << RESET << GRAY << "> " << RESET;
+            started = true;
+        }
+        std::cout << renderMarkdown(block) << std::endl;
+        block.clear();
+    }
+};
+
 void printLogo() {
     std::string frame = CYAN + "  ====================================================================" + RESET;
     std::vector<std::string> lines = {
@@ -618,7 +682,48 @@ int main(int argc, char* argv[]) {
     }
 
     auto llmClient = std::make_shared<LLMClient>(cfg.llm.apiKey, cfg.llm.baseUrl, cfg.llm.model, cfg.llm.maxTokens);
+    {
+        HttpClientPool::Options poolOptions;
+        poolOptions.maxPerHost = static_cast<size_t>(std::max(0, cfg.llm.poolMaxPerHost));
+        poolOptions.idleTimeoutSec = cfg.llm.poolIdleTimeoutSec;
+        poolOptions.tlsSessionReuse = cfg.llm.tlsSessionReuse;
+        poolOptions.verifyCertificate = cfg.llm.verifyTls;
+        llmClient->configureConnectionPool(poolOptions);
+
+        RequestScheduler::Options schedulerOptions;
+        schedulerOptions.workerThreads = static_cast<size_t>(std::max(1, cfg.llm.schedulerWorkers));
+        schedulerOptions.endpointLimits[llmClient->chatEndpoint()] = static_cast<size_t>(std::max(1, cfg.llm.maxConcurrentChat));
+        schedulerOptions.endpointLimits[llmClient->embeddingEndpoint()] =
+            static_cast<size_t>(std::max(1, cfg.llm.maxConcurrentEmbeddings));
+        llmClient->configureRequestScheduler(schedulerOptions);
+
+        for (const auto& r : cfg.llm.routes) {
+            LLMPurpose purpose;
+            if (!LLMClient::parsePurpose(r.purpose, purpose)) {
+                std::cout << YELLOW << "⚠ Unknown llm route: " << r.purpose
+                          << " (expected planner / summarizer / embedder)" << RESET << std::endl;
+                continue;
+            }
+            LLMRoute route;
+            route.model = r.model;
+            route.baseUrl = r.baseUrl;
+            route.apiKey = r.apiKey;
+            route.timeoutSec = r.timeoutSec;
+            route.maxTokens = r.maxTokens;
+            route.maxConcurrent = static_cast<size_t>(std::max(0, r.maxConcurrent));
+            llmClient->setRoute(purpose, route);
+        }
+    }
+    if (!cfg.agent.tokenizerVocab.empty() && !Tokenizer::getInstance().loadVocab(cfg.agent.tokenizerVocab)) {
+        std::cout << YELLOW << "⚠ Failed to load tokenizer vocab: " << cfg.agent.tokenizerVocab
+                  << " (token counts are estimated)" << RESET << std::endl;
+    }
     ContextManager contextManager(llmClient, cfg.agent.contextThreshold);
+    // 未配置 max_tokens 时按 4096 预留回复空间
+    contextManager.setContextWindow(static_cast<size_t>(std::max(0, cfg.llm.contextWindow)),
+                                    static_cast<size_t>(cfg.llm.maxTokens > 0 ? cfg.llm.maxTokens : 4096));
+    contextManager.setSoftWatermark(cfg.agent.contextSoftWatermark);
+    contextManager.setProjectRoot(path);
 
     // Initialize MCP Manager and connect all servers
     MCPManager mcpManager;
@@ -680,6 +785,8 @@ int main(int argc, char* argv[]) {
     // Initialize Symbol Manager and start async scan
     // Ensure path is absolute so symbols are generated in the correct directory
     fs::path absolutePath = fs::absolute(fs::u8path(path));
+    // 文件内容缓存：read_code_block / 符号扫描 / LSP / 语义索引共用
+    FileContentCache::getInstance().setMaxBytes(cfg.agent.fileCacheMB * 1024 * 1024);
     SymbolManager symbolManager(absolutePath.u8string());
     symbolManager.setFallbackOnEmpty(cfg.agent.symbolFallbackOnEmpty);
 
@@ -712,13 +819,50 @@ int main(int argc, char* argv[]) {
     }
     std::cout << "[Init] Symbol index ready: " << symbolManager.getSymbolCount() << " symbols" << std::endl;
 
-    // 启动时生成 dictionary；之后 symbol 自动更新（全量/增量）时通过回调同步刷新 dictionary
+    // 语义索引（可选）：markdown/记忆 + 按符号范围分块的代码；代码部分随符号索引增量同步
+    std::shared_ptr<SemanticManager> semanticManager;
+    if (cfg.agent.enableSemanticIndex) {
+        if (cfg.agent.semanticEmbeddingProvider == "remote") {
+            semanticManager = std::make_shared<SemanticManager>(absolutePath.u8string(), llmClient);
+        } else {
+            semanticManager = std::make_shared<SemanticManager>(absolutePath.u8string(),
+                                                                std::make_unique<LocalEmbeddingProvider>());
+        }
+        semanticManager->setSymbolManager(&symbolManager);
+        semanticManager->startAsyncIndexing();
+    }
+
+    // 启动时生成 dictionary；之后 symbol 自动更新（全量/增量）时通过回调同步刷新 dictionary 与语义索引
     ListProjectFilesTool::buildAndSaveCache(absolutePath.u8string(), &symbolManager, 3, 8, scanIgnoreRules);
-    symbolManager.setOnIndexUpdated([path = absolutePath.u8string(), &symbolManager, scanIgnoreRules]() {
+    std::weak_ptr<SemanticManager> semanticWeak = semanticManager;
+    symbolManager.setOnIndexUpdated([path = absolutePath.u8string(), &symbolManager, scanIgnoreRules, semanticWeak]() {
         (void)std::async(std::launch::async, [path, &symbolManager, scanIgnoreRules]() {
             ListProjectFilesTool::buildAndSaveCache(path, &symbolManager, 3, 8, scanIgnoreRules);
         });
+        if (auto semantic = semanticWeak.lock()) semantic->requestCodeSync();
     });
+    // 只读工具结果缓存：文件变化时按路径失效（全量扫描完成时全部失效）
+    std::shared_ptr<ToolResultCache> toolCache;
+    if (cfg.agent.toolCacheMB > 0) {
+        ToolResultCache::Options cacheOptions;
+        cacheOptions.maxBytes = cfg.agent.toolCacheMB * 1024 * 1024;
+        cacheOptions.maxSpeculativeBytes = std::min(cfg.agent.prefetchMB, cfg.agent.toolCacheMB) * 1024 * 1024;
+        cacheOptions.ignoreRules = scanIgnoreRules;
+        cacheOptions.projectRoot = absolutePath.u8string();
+        toolCache = std::make_shared<ToolResultCache>(cacheOptions);
+        std::weak_ptr<ToolResultCache> cacheWeak = toolCache;
+        symbolManager.setOnFilesChanged([root = absolutePath, cacheWeak](const std::vector<std::string>& relPaths) {
+            auto cache = cacheWeak.lock();
+            if (!cache) return;
+            if (relPaths.empty()) {
+                cache->invalidateAll();
+                return;
+            }
+            std::vector<std::string> paths;
+            for (const auto& rel : relPaths) paths.push_back((root / fs::u8path(rel)).lexically_normal().generic_u8string());
+            cache->invalidatePaths(paths);
+        });
+    }
 
     // 启动文件监听
     symbolManager.startWatching(5);
@@ -804,6 +948,8 @@ int main(int argc, char* argv[]) {
     // 新架构: ToolRegistry 初始化
     // ============================================================
     ToolRegistry toolRegistry;
+    toolRegistry.setResultCache(toolCache);
+    ToolScheduler toolScheduler;
     
     // 注册核心工具
     std::cout << CYAN << "  → Registering core tools..." << RESET << std::endl;
@@ -811,8 +957,19 @@ int main(int argc, char* argv[]) {
     toolRegistry.registerTool(std::make_unique<ApplyPatchTool>(path, g_hasGit));  // 唯一写工具：files[] 直接写入/行号编辑，支持多文件
     toolRegistry.registerTool(std::make_unique<RunCommandTool>(path));
     toolRegistry.registerTool(std::make_unique<ListProjectFilesTool>(path, &symbolManager, 8, scanIgnoreRules));
-    toolRegistry.registerTool(std::make_unique<GrepTool>(path, scanIgnoreRules));  // 代码搜索：grep，与 list 共用忽略规则
+    toolRegistry.registerTool(std::make_unique<GrepTool>(path, scanIgnoreRules, &symbolManager));  // 代码搜索：grep，与 list 共用忽略规则，匹配标注所在符号
     toolRegistry.registerTool(std::make_unique<AttemptTool>(path));  // 用户 attempt：持久化意图与任务状态，防遗忘
+    if (semanticManager) {
+        toolRegistry.registerTool(std::make_unique<SemanticSearchTool>(semanticManager.get()));  // 语义搜索：需 enable_semantic_index
+    }
+    ToolResultStore::Options resultStoreOptions;
+    resultStoreOptions.inlineLimitBytes = cfg.agent.toolResultInlineBytes;
+    resultStoreOptions.maxTotalBytes = static_cast<uint64_t>(cfg.agent.toolResultStoreMB) * 1024 * 1024;
+    auto resultStore = std::make_shared<ToolResultStore>((fs::u8path(path) / ".photon" / "results").u8string(),
+                                                         resultStoreOptions);
+    if (resultStoreOptions.inlineLimitBytes > 0) {
+        toolRegistry.registerTool(std::make_unique<FetchResultTool>(resultStore));  // 大结果外置后按行 / 字节分页读取
+    }
     {
         SyntaxCheckTool::LspDiagnosticsFn lspDiagFn = [&lspByExt, &lspFallback](const std::string& relPath) -> std::string {
             if (lspByExt.empty() && !lspFallback) return "";
@@ -835,6 +992,11 @@ int main(int argc, char* argv[]) {
     }
     
     std::cout << GREEN << "  ✔ Registered " << toolRegistry.getToolCount() << " core tools" << RESET << std::endl;
+    // 预取在工具注册完成后启动（后台线程会查询注册表）
+    std::unique_ptr<ToolPrefetcher> toolPrefetcher;
+    if (toolCache && cfg.agent.prefetchMB > 0) {
+        toolPrefetcher = std::make_unique<ToolPrefetcher>(toolRegistry, &symbolManager);
+    }
 
     // 获取工具的 Schema (给 LLM 使用)
     auto toolSchemas = toolRegistry.listToolSchemas();
@@ -863,6 +1025,11 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // 工具 schema 按名称排序，整个会话保持字节稳定（请求前缀缓存）
+    std::sort(llmTools.begin(), llmTools.end(), [](const nlohmann::json& a, const nlohmann::json& b) {
+        return a["function"]["name"].get<std::string>() < b["function"]["name"].get<std::string>();
+    });
+
     std::cout << GREEN << "  ✔ Engine active. Total tools: " << llmTools.size() << RESET << std::endl;
 
     std::cout << "  " << CYAN << "Model  " << RESET << " : " << PURPLE << cfg.llm.model << RESET << std::endl;
@@ -879,6 +1046,8 @@ int main(int argc, char* argv[]) {
               << "│ " << RESET << BOLD << "memory  " << RESET << GRAY << " Show long-term mem " << "│" << RESET << std::endl;
     std::cout << GRAY << "  │ " << RESET << BOLD << "clear   " << RESET << GRAY << " Reset context      " 
               << "│ " << RESET << BOLD << "exit    " << RESET << GRAY << " Terminate agent    " << "│" << RESET << std::endl;
+    std::cout << GRAY << "  │ " << RESET << BOLD << "stats   " << RESET << GRAY << " Context stats      " 
+              << "│ " << std::string(28, ' ') << "│" << RESET << std::endl;
     std::cout << GRAY << "  └───────────────────────────────────────────────────────────┘" << RESET << std::endl;
 
     // Optimization: Define the core identity as an Autonomous Agent.
@@ -909,7 +1078,7 @@ int main(int argc, char* argv[]) {
         "You are Photon.\n"
         "You must operate under Photon Agent Constitution v2.0.\n"
         "**Always think before acting.** In every reply that includes tool_calls, you MUST write a short reasoning block first (2–5 sentences): what you are about to do and why, what you expect to learn or change. This is shown as [Think] and reduces wrong moves. After receiving tool results, briefly reflect (what the result implies, whether to read more or patch, or if you need to correct course) before the next tool_calls or final answer.\n"
-        "Reason about what information you need, then use tools to get it—do not guess or ask the user for what tools can provide. Use run_command to perceive the environment (list dirs, check versions, inspect state, view logs)—not only for build and test. When list_project_files or grep returned symbols and line numbers (:L42, F:name:L10), use read_code_block with symbol_name or start_line/end_line—do not read the full file.\n"
+        "Reason about what information you need, then use tools to get it—do not guess or ask the user for what tools can provide. Use run_command to perceive the environment (list dirs, check versions, inspect state, view logs)—not only for build and test. When list_project_files or grep returned symbols and line numbers (:L42, F:name:L10), use read_code_block with symbol_name or start_line/end_line—do not read the full file. Large tool outputs are stored out of line: you see a preview plus a handle (e.g. \"r3\"); use fetch_result to read only the lines you need.\n"
         "Use the attempt tool to avoid forgetting: call attempt(action=get) at the start of a turn to recall current task; call attempt(action=update, intent=..., read_scope=...) when the user gives a new requirement; call attempt(action=update, step_done=...) after completing a step; call attempt(action=clear) when the task is done so the next task starts clean.\n"
         "All behavior is governed by the constitution and validated configuration.\n\n" +
         (constitutionText.empty() ? std::string("") : (std::string("# Constitution v2.0\n\n") + constitutionText + "\n\n")) +
@@ -924,7 +1093,7 @@ int main(int argc, char* argv[]) {
         "Working directory: " + path + "\n" +
         "Current time: " + date_ss.str() + "\n";
     
-    nlohmann::json messages = nlohmann::json::array();
+    Conversation messages;
     messages.push_back({{"role", "system"}, {"content", systemPrompt}});
 
     // Lazy initialization flag
@@ -933,11 +1102,16 @@ int main(int argc, char* argv[]) {
     std::unordered_map<std::string, std::string> readSummaries;
     std::vector<std::string> readSummaryOrder;
     const size_t maxReadSummaries = 20;
+    // read 摘要在后台线程生成并按内容哈希落盘缓存，下一轮注入前收取已完成的结果
+    std::unique_ptr<ReadSummaryPipeline> readSummaryPipeline;
+    if (cfg.agent.enableReadSummary) {
+        readSummaryPipeline = std::make_unique<ReadSummaryPipeline>(
+            fs::u8path(path) / ".photon" / "index" / "read_summaries.json",
+            llmClient->routeModel(LLMPurpose::Summarizer),
+            [client = llmClient](const std::string& prompt) { return client->summarize(prompt); });
+    }
     const std::string readSummaryTag = "[READ_SUMMARY]";
 
-    auto startsWith = [](const std::string& s, const std::string& prefix) {
-        return s.rfind(prefix, 0) == 0;
-    };
     auto isReadRejection = [&](const std::string& text) {
         return text.find("❌ READ_FAIL") != std::string::npos ||
                text.find("⚠️ READ_EMPTY") != std::string::npos ||
@@ -962,18 +1136,26 @@ int main(int argc, char* argv[]) {
         return text;
     };
     auto buildReadKey = [](const nlohmann::json& args) -> std::string {
+        // read_code_block 用 file_path / symbol_name，旧的 read 工具用 path
+        auto readPath = [](const nlohmann::json& a) {
+            if (a.contains("file_path") && a["file_path"].is_string()) return a["file_path"].get<std::string>();
+            return a.value("path", "");
+        };
+        auto readScope = [&](const nlohmann::json& a) {
+            if (a.contains("symbol_name") && a["symbol_name"].is_string()) return readPath(a) + ":" + a["symbol_name"].get<std::string>();
+            return readPath(a) + ":" + std::to_string(a.value("start_line", 0)) + "-" + std::to_string(a.value("end_line", 0));
+        };
         if (args.contains("requests") && args["requests"].is_array()) {
             std::string key = "batch:";
             int count = 0;
             for (const auto& req : args["requests"]) {
+                if (!req.is_object()) continue;
                 if (count++ > 0) key += ";";
-                std::string path = req.value("path", "");
-                int start = req.value("start_line", 0);
-                int end = req.value("end_line", 0);
-                key += path + ":" + std::to_string(start) + "-" + std::to_string(end);
+                key += readScope(req);
             }
             return key;
         }
+        if (args.contains("file_path") && args["file_path"].is_string()) return readScope(args);
         if (args.contains("mode") && args["mode"].is_object()) {
             std::string type = args["mode"].value("type", "");
             std::string path = args.value("path", "");
@@ -1015,29 +1197,20 @@ int main(int argc, char* argv[]) {
         readSummaries[key] = summary;
     };
     auto injectReadSummaries = [&]() {
-        for (size_t i = 0; i < messages.size(); ) {
-            if (messages[i].contains("role") && messages[i]["role"] == "system" &&
-                messages[i].contains("content") && messages[i]["content"].is_string()) {
-                std::string content = messages[i]["content"].get<std::string>();
-                if (startsWith(content, readSummaryTag)) {
-                    messages.erase(messages.begin() + i);
-                    continue;
-                }
-            }
-            ++i;
-        }
-        if (readSummaryOrder.empty()) return;
-        std::string content = readSummaryTag + "\n已读摘要：\n";
-        for (const auto& key : readSummaryOrder) {
-            auto it = readSummaries.find(key);
-            if (it == readSummaries.end()) continue;
-            content += "- " + key + ": " + it->second + "\n";
+        if (readSummaryPipeline) {
+            for (const auto& [key, summary] : readSummaryPipeline->takeReady()) storeReadSummary(key, summary);
         }
-        if (messages.size() >= 1) {
-            messages.insert(messages.begin() + 1, {{"role", "system"}, {"content", content}});
-        } else {
-            messages.push_back({{"role", "system"}, {"content", content}});
+        std::string content;
+        if (!readSummaryOrder.empty()) {
+            content = readSummaryTag + "\n已读摘要：\n";
+            for (const auto& key : readSummaryOrder) {
+                auto it = readSummaries.find(key);
+                if (it == readSummaries.end()) continue;
+                content += "- " + key + ": " + it->second + "\n";
+            }
         }
+        // 放在末尾的易变槽位而非历史中间：system prompt 与历史保持字节稳定，摘要变化只影响请求末尾
+        messages.setTrailingContext("read_summaries", content);
     };
 
     while (true) {
@@ -1124,16 +1297,83 @@ int main(int argc, char* argv[]) {
         }
         
         if (userInput == "clear") {
-            messages = nlohmann::json::array();
+            messages.clear();
             messages.push_back({{"role", "system"}, {"content", systemPrompt}});
+            contextManager.reset();
             readSummaries.clear();
             readSummaryOrder.clear();
+            if (readSummaryPipeline) readSummaryPipeline->cancelAll();
             std::cout << GREEN << "✔ Context cleared (Forgotten)." << RESET << std::endl;
             continue;
         }
 
         if (userInput == "compress") {
-            messages = contextManager.forceCompress(messages);
+            contextManager.forceCompress(messages);
+            continue;
+        }
+
+        if (userInput == "stats") {
+            auto ctxStats = contextManager.getStats();
+            std::cout << CYAN << "\n--- Context Stats ---" << RESET << std::endl;
+            std::cout << "  Context:            " << (Tokenizer::getInstance().hasVocab() ? "" : "~")
+                      << contextManager.getSize(messages) << " tokens, " << messages.size() << " messages" << std::endl;
+            std::cout << "  Tokenizer:          " << Tokenizer::getInstance().vocabName() << std::endl;
+            std::cout << "  Summary folds:      " << ctxStats.summaryFolds
+                      << (contextManager.hasPendingSummary() ? " (1 in progress)" : "") << std::endl;
+            std::cout << "  Duplicate results:  " << ctxStats.duplicateResults << " elided" << std::endl;
+            std::cout << "  Repeated calls:     " << ctxStats.supersededResults << " elided" << std::endl;
+            std::cout << "  Stale results:      " << ctxStats.staleResults << " marked" << std::endl;
+            std::cout << "  Tokens saved:       " << ctxStats.tokensSaved << std::endl;
+            {
+                auto fileStats = FileContentCache::getInstance().getStats();
+                const size_t lookups = fileStats.hits + fileStats.misses;
+                std::cout << "  File cache:         " << fileStats.hits << "/" << lookups << " hits ("
+                          << (lookups ? 100 * fileStats.hits / lookups : 0) << "%), " << fileStats.entries << " files, "
+                          << fileStats.bytes / 1024 << " KB, " << fileStats.evictions << " evicted" << std::endl;
+            }
+            if (toolCache) {
+                auto cacheStats = toolCache->getStats();
+                const size_t lookups = cacheStats.hits + cacheStats.misses;
+                std::cout << "  Tool cache:         " << cacheStats.hits << "/" << lookups << " hits ("
+                          << (lookups ? 100 * cacheStats.hits / lookups : 0) << "%), "
+                          << static_cast<long long>(cacheStats.savedMs) << " ms saved, " << toolCache->size()
+                          << " entries, " << cacheStats.invalidated << " invalidated" << std::endl;
+                if (toolPrefetcher) {
+                    auto prefetchStats = toolPrefetcher->getStats();
+                    std::cout << "  Prefetch:           " << cacheStats.prefetchHits << "/" << cacheStats.prefetched
+                              << " used (" << (cacheStats.prefetched ? 100 * cacheStats.prefetchHits / cacheStats.prefetched : 0)
+                              << "%), " << static_cast<long long>(cacheStats.prefetchSavedMs) << " ms saved, "
+                              << static_cast<long long>(prefetchStats.busyMs) << " ms in background" << std::endl;
+                }
+            }
+            auto toolStats = toolScheduler.getStats();
+            std::cout << "  Tool batches:       " << toolStats.batches << " (" << toolStats.calls << " calls, up to "
+                      << toolStats.maxConcurrent << " at once, "
+                      << static_cast<long long>(std::max(0.0, toolStats.busyMs - toolStats.wallMs)) << " ms saved)"
+                      << std::endl;
+            std::cout << CYAN << "\n--- LLM Latency ---" << RESET << std::endl;
+            for (LLMPurpose purpose : {LLMPurpose::Planner, LLMPurpose::Summarizer, LLMPurpose::Embedder}) {
+                LatencyHistogram h = llmClient->getLatencyHistogram(purpose);
+                std::cout << "  " << std::left << std::setw(11) << LLMClient::purposeName(purpose) << std::right
+                          << GRAY << "(" << llmClient->routeModel(purpose) << ")" << RESET;
+                if (h.count == 0) {
+                    std::cout << "  no calls" << std::endl;
+                    continue;
+                }
+                auto ms = [](double v) { return std::to_string(static_cast<long long>(v + 0.5)); };
+                std::cout << "  n=" << h.count << "  avg " << ms(h.totalMs / h.count) << " ms  p50≤"
+                          << ms(h.percentile(0.5)) << "  p95≤" << ms(h.percentile(0.95)) << "  max " << ms(h.maxMs)
+                          << " ms" << std::endl;
+                std::cout << GRAY << "    ";
+                for (size_t i = 0; i < h.buckets.size(); ++i) {
+                    if (h.buckets[i] == 0) continue;
+                    if (i < LatencyHistogram::kBoundsMs.size()) std::cout << "≤" << ms(LatencyHistogram::kBoundsMs[i]);
+                    else std::cout << ">" << ms(LatencyHistogram::kBoundsMs.back());
+                    std::cout << "ms:" << h.buckets[i] << "  ";
+                }
+                std::cout << RESET << std::endl;
+            }
+            std::cout << CYAN << "---------------------\n" << RESET << std::endl;
             continue;
         }
 
@@ -1210,8 +1450,8 @@ int main(int argc, char* argv[]) {
                         }
                         fs::path backupPath = backupDir / backupRel;
                         if (fs::exists(backupPath)) {
-                            std::ifstream bFile(backupPath);
-                            std::string bContent((std::istreambuf_iterator<char>(bFile)), std::istreambuf_iterator<char>());
+                            auto backup = FileContentCache::getInstance().get(backupPath);
+                            std::string bContent = backup ? backup->text() : std::string();
                             std::cout << CYAN << "\n--- Last File Diff (no last.patch, via backup) ---" << RESET << std::endl;
                             showGitDiff(lastFile, bContent, true);
                             std::cout << CYAN << "-------------------------------------------------\n" << RESET << std::endl;
@@ -1567,8 +1807,8 @@ int main(int argc, char* argv[]) {
                     system(("git diff --color=always \"" + lastFile + "\"").c_str());
 #endif
                 } else {
-                    std::ifstream bFile(backupPath);
-                    std::string bContent((std::istreambuf_iterator<char>(bFile)), std::istreambuf_iterator<char>());
+                    auto backup = FileContentCache::getInstance().get(backupPath);
+                    std::string bContent = backup ? backup->text() : std::string();
                     showGitDiff(lastFile, bContent);
                 }
 
@@ -1593,8 +1833,8 @@ int main(int argc, char* argv[]) {
                             system(("git diff --color=always \"" + lastFile + "\"").c_str());
 #endif
                         } else {
-                            std::ifstream bFile(backupPath);
-                            std::string bContent((std::istreambuf_iterator<char>(bFile)), std::istreambuf_iterator<char>());
+                            auto backup = FileContentCache::getInstance().get(backupPath);
+                            std::string bContent = backup ? backup->text() : std::string();
                             showGitDiff(lastFile, bContent, true);
                         }
                         continue;
@@ -1645,12 +1885,79 @@ int main(int argc, char* argv[]) {
             // Inject read summaries before context management
             injectReadSummaries();
             // Apply context management
-            messages = contextManager.manage(messages);
+            contextManager.manage(messages);
 
         // Update status bar during thinking
         // UIManager::getInstance().updateStatus(cfg.llm.model, (int)contextManager.getSize(messages), mcpManager.getTotalTaskCount());
 
-        nlohmann::json response = llmClient->chatWithTools(messages, llmTools);
+        // 流式：正文边到边渲染；只读工具的参数一旦完整就在后台提前执行（结果按 tool_call id 取用）
+        std::unordered_map<std::string, std::future<nlohmann::json>> earlyToolResults;
+        // 本条消息中各 tool_call 是否只读（按 index）：只有之前的调用全部只读时才提前执行，
+        // 否则提前读取可能早于同一消息中先出现的写入
+        std::vector<char> readyCallReadOnly;
+        std::vector<char> readyCallSeen;
+        bool contentStreamed = false;
+        nlohmann::json response;
+        if (cfg.llm.stream) {
+            StreamingMarkdownPrinter printer;
+            ChatStreamCallbacks callbacks;
+            callbacks.onContent = [&](const std::string& delta) { printer.onDelta(delta); };
+            callbacks.onToolCallReady = [&](size_t index, const nlohmann::json& toolCall) {
+                std::string toolName;
+                if (toolCall.contains("function") && toolCall["function"].is_object()) {
+                    toolName = toolCall["function"].value("name", "");
+                }
+                size_t sep = toolName.find("__");
+                if (sep != std::string::npos) toolName = toolName.substr(sep + 2);
+                if (toolName.find("::") != std::string::npos) toolName = toolName.substr(toolName.rfind("::") + 2);
+                if (index >= readyCallSeen.size()) {
+                    readyCallSeen.resize(index + 1, 0);
+                    readyCallReadOnly.resize(index + 1, 0);
+                }
+                readyCallSeen[index] = 1;
+                readyCallReadOnly[index] = isReadOnlyTool(toolName) ? 1 : 0;
+                for (size_t j = 0; j < index; ++j) {
+                    if (!readyCallSeen[j] || !readyCallReadOnly[j]) return;
+                }
+                if (!toolCall.contains("id") || !toolCall["id"].is_string()) return;
+                if (!isReadOnlyTool(toolName) || !toolRegistry.hasTool(toolName)) return;
+                nlohmann::json args;
+                try { args = nlohmann::json::parse(toolCall["function"].value("arguments", "")); } catch (...) { return; }
+                if (!ConstitutionValidator::validateToolCall(toolName, args).valid) return;
+                earlyToolResults[toolCall["id"].get<std::string>()] = std::async(std::launch::async, [&toolRegistry, toolName, args]() {
+                    return toolRegistry.executeTool(toolName, args);
+                });
+            };
+            response = llmClient->chatWithToolsStream(messages, llmTools, callbacks);
+            printer.finish();
+            contentStreamed = printer.hasOutput();
+            if (cfg.agent.enableDebug) {
+                auto metrics = llmClient->getLastStreamMetrics();
+                std::cout << GRAY << "[Debug] stream: TTFT " << static_cast<long long>(metrics.ttftMs) << " ms, total "
+                          << static_cast<long long>(metrics.totalMs) << " ms, " << metrics.events << " events, "
+                          << earlyToolResults.size() << " tool(s) started early" << RESET << std::endl;
+            }
+        } else {
+            response = llmClient->chatWithTools(messages, llmTools);
+        }
+        if (cfg.agent.enableDebug) {
+            auto prefix = llmClient->getLastPrefixMetrics();
+            if (prefix.requests > 1 && prefix.promptBytes > 0) {
+                std::cout << GRAY << "[Debug] prompt prefix: " << prefix.commonPrefixBytes << "/" << prefix.promptBytes
+                          << " bytes unchanged since last request ("
+                          << static_cast<int>(100.0 * prefix.commonPrefixBytes / prefix.promptBytes) << "%)" << RESET
+                          << std::endl;
+            }
+        }
+        // 取用提前执行的结果；没有则返回空，由调用方正常执行
+        auto takeEarlyResult = [&](const nlohmann::json& toolCall) -> std::optional<std::future<nlohmann::json>> {
+            if (!toolCall.contains("id") || !toolCall["id"].is_string()) return std::nullopt;
+            auto it = earlyToolResults.find(toolCall["id"].get<std::string>());
+            if (it == earlyToolResults.end()) return std::nullopt;
+            std::future<nlohmann::json> f = std::move(it->second);
+            earlyToolResults.erase(it);
+            return f;
+        };
             
             if (response.is_null() || !response.contains("choices") || response["choices"].empty()) {
                 break;
@@ -1688,7 +1995,7 @@ int main(int argc, char* argv[]) {
                 bool isEmptyOrPlaceholder = content.empty()
                     || content == kEmptyPlaceholder
                     || (content.size() >= 3 && content.front() == '{' && content.find("(no output)") != std::string::npos);
-                if (!isEmptyOrPlaceholder) {
+                if (!isEmptyOrPlaceholder && !contentStreamed) {
                     if (message.contains("tool_calls") && !message["tool_calls"].is_null()) {
                         Logger::getInstance().thought(renderMarkdown(content));
                     } else {
@@ -1701,11 +2008,10 @@ int main(int argc, char* argv[]) {
             // 2. Handle Tool Calls
             // 策略：本轮所有 tool_calls 执行完后，下一轮循环会再次调用 LLM（chatWithTools）。
             // 若本轮只有 1 个工具 → 一次工具后必有一次 LLM；若本轮有多个工具 → 全部执行后只调一次 LLM，避免 N 次往返。
-            // 当本批 2+ 个工具且已授权全部时，并行执行以缩短耗时。
+            // 分三步：① 按顺序解析、校验，并只对高风险工具请求确认；② 交给 ToolScheduler 按各工具声明的副作用
+            // 并行执行（只读调用并发，写同一路径的调用与外部进程保持顺序）；③ 按 tool_calls 顺序输出并写回 messages。
             if (message.contains("tool_calls") && !message["tool_calls"].is_null()) {
                 continues = true;
-                const auto& toolCallsArray = message["tool_calls"];
-                const bool useParallel = (toolCallsArray.size() >= 2 && authorizeAll);
 
                 auto debugPrintApplyPatch = [&](const nlohmann::json& a) {
                     if (!cfg.agent.enableDebug) return;
@@ -1738,262 +2044,167 @@ int main(int argc, char* argv[]) {
                     }
                 };
 
-                if (useParallel) {
-                    // 并行路径：先校验并收集任务，再并行执行，最后按顺序写回 messages
-                    struct OneTask { nlohmann::json toolCall; std::string serverName, toolName, fullName; nlohmann::json args; };
-                    std::vector<nlohmann::json> orderedResults(toolCallsArray.size());
-                    std::vector<std::optional<OneTask>> tasks(toolCallsArray.size());
-                    std::vector<bool> isError(toolCallsArray.size(), false);
-
-                    for (size_t i = 0; i < toolCallsArray.size(); i++) {
-                        const auto& toolCall = toolCallsArray[i];
-                        if (!toolCall.is_object() || !toolCall.contains("function")) {
-                            orderedResults[i] = nlohmann::json::object({{"error", "Invalid tool_call format"}});
-                            isError[i] = true;
-                            continue;
-                        }
-                        const auto& func = toolCall["function"];
-                        if (!func.is_object() || !func.contains("name") || !func.contains("arguments")) {
-                            orderedResults[i] = nlohmann::json::object({{"error", "Invalid function in tool_call"}});
-                            isError[i] = true;
-                            continue;
-                        }
-                        std::string fullName = func["name"].get<std::string>();
-                        std::string argsStr = func["arguments"].is_string() ? func["arguments"].get<std::string>() : func["arguments"].dump();
-                        nlohmann::json args;
-                        try { args = nlohmann::json::parse(argsStr); } catch (...) { args = nlohmann::json::object(); }
-                        size_t pos = fullName.find("__");
-                        std::string serverName = (pos != std::string::npos) ? fullName.substr(0, pos) : "core";
-                        std::string toolName = (pos != std::string::npos) ? fullName.substr(pos + 2) : fullName;
-                        if (toolName.find("::") != std::string::npos)
-                            toolName = toolName.substr(toolName.rfind("::") + 2);
-
-                        if (toolName == "bash_execute" && args.contains("command")) {
-                            std::string cmd = args["command"].get<std::string>();
-                            if (isBashReadCommand(cmd)) {
-                                orderedResults[i] = nlohmann::json::object({{"error", "Bash read commands are disabled. Use read/search instead."}});
-                                isError[i] = true;
-                                continue;
-                            }
-                        }
-                        if (toolName.find("search") != std::string::npos) {
-                            std::string query = args.value("query", "");
-                            if (!query.empty() && recentQueries.count(query)) {
-                                orderedResults[i] = nlohmann::json::object({{"error", "Repetitive search detected. Change strategy."}});
-                                isError[i] = true;
-                                continue;
-                            }
-                            if (!query.empty()) recentQueries.insert(query);
-                        }
-                        auto validation = ConstitutionValidator::validateToolCall(toolName, args);
-                        if (!validation.valid) {
-                            orderedResults[i] = nlohmann::json::object({{"error", "Constitution violation: " + validation.error}});
-                            isError[i] = true;
-                            continue;
-                        }
-                        tasks[i] = OneTask{toolCall, serverName, toolName, fullName, args};
-                    }
+                struct PlannedCall {
+                    nlohmann::json toolCall;
+                    std::string serverName, toolName, fullName;
+                    nlohmann::json args;
+                    std::optional<nlohmann::json> result;  // 执行前已确定的结果（校验失败、用户取消）
+                };
+                std::vector<PlannedCall> planned;
+                bool cancelled = false;
 
-                    std::vector<size_t> runIndices;
-                    std::vector<std::future<nlohmann::json>> futures;
-                    for (size_t i = 0; i < tasks.size(); i++) {
-                        if (!tasks[i] || isError[i]) continue;
-                        OneTask t = *tasks[i];
-                        runIndices.push_back(i);
-                        futures.push_back(std::async(std::launch::async, [&toolRegistry, &mcpManager, t]() {
-                            if (toolRegistry.hasTool(t.toolName))
-                                return toolRegistry.executeTool(t.toolName, t.args);
-                            return mcpManager.callTool(t.serverName, t.toolName, t.args);
-                        }));
-                    }
-                    for (size_t j = 0; j < futures.size(); j++)
-                        orderedResults[runIndices[j]] = futures[j].get();
-
-                    for (size_t i = 0; i < toolCallsArray.size(); i++) {
-                        const auto& toolCall = toolCallsArray[i];
-                        nlohmann::json result = orderedResults[i];
-                        std::string toolName = tasks[i] ? (*tasks[i]).toolName : "";
-                        if (cfg.agent.enableDebug && (toolName == "apply_patch" || toolName.find("apply_patch") != std::string::npos)) {
-                            nlohmann::json debugArgs = tasks[i] ? (*tasks[i]).args : nlohmann::json::object();
-                            if (debugArgs.empty() && toolCall.contains("function") && toolCall["function"].contains("arguments")) {
-                                try {
-                                    const auto& fa = toolCall["function"]["arguments"];
-                                    debugArgs = fa.is_string() ? nlohmann::json::parse(fa.get<std::string>()) : fa;
-                                } catch (...) {}
-                            }
-                            debugPrintApplyPatch(debugArgs);
-                        }
-                        if (toolName == "apply_patch" && !result.contains("error")) {
-                            std::string msg = result.value("message", "");
-                            if (result.contains("affected_files") && result["affected_files"].is_array() && !result["affected_files"].empty()) {
-                                std::string files;
-                                for (const auto& f : result["affected_files"])
-                                    files += (files.empty() ? "" : ", ") + f.get<std::string>();
-                                std::cout << GREEN << "✔ apply_patch: " << files << (msg.empty() ? "" : " — " + msg) << RESET << std::endl;
-                            } else
-                                std::cout << GREEN << "✔ apply_patch: " << (msg.empty() ? "OK" : msg) << RESET << std::endl;
-                        }
-                        if (cfg.agent.enableReadSummary && tasks[i] && (toolName == "read" || toolName.rfind("read_", 0) == 0) && !result.contains("error")) {
-                            std::string readText = extractReadText(result);
-                            if (!readText.empty() && !isReadRejection(readText)) {
-                                std::string key = buildReadKey((*tasks[i]).args);
-                                std::string summaryPrompt = "请对以下 read 结果做 1-3 条要点摘要，保留文件路径/范围或标签：\n" + (readText.size() > 6000 ? readText.substr(0, 6000) : readText);
-                                std::string summary = llmClient->summarize(summaryPrompt);
-                                storeReadSummary(key, summary);
-                            }
-                        }
-                        std::string textContent;
-                        try {
-                            if (result.contains("content") && result["content"].is_array() && !result["content"].empty()) {
-                                const auto& first = result["content"][0];
-                                textContent = first.contains("text") && first["text"].is_string() ? first["text"].get<std::string>() : first.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
-                            } else if (result.contains("error"))
-                                textContent = result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
-                            else
-                                textContent = result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
-                        } catch (...) { textContent = "[Tool result serialization failed]"; }
-                        nlohmann::json contentArray = nlohmann::json::array({nlohmann::json::object({{"type", "text"}, {"text", textContent}})});
-                        messages.push_back({{"role", "tool"}, {"tool_call_id", toolCall["id"]}, {"content", contentArray}});
-                    }
-                } else {
                 for (auto& toolCall : message["tool_calls"]) {
                     // 安全检查: 确保 toolCall 是对象且包含 function
                     if (!toolCall.is_object() || !toolCall.contains("function")) {
                         Logger::getInstance().error("Invalid tool_call format: " + toolCall.dump());
                         continue;
                     }
-                    
+
                     auto& func = toolCall["function"];
                     if (!func.is_object() || !func.contains("name") || !func.contains("arguments")) {
                         Logger::getInstance().error("Invalid function format in tool_call: " + func.dump());
                         continue;
                     }
-                    
-                    std::string fullName = func["name"].get<std::string>();
-                    std::string argsStr = func["arguments"].is_string() ? 
+
+                    PlannedCall call;
+                    call.toolCall = toolCall;
+                    call.fullName = func["name"].get<std::string>();
+                    std::string argsStr = func["arguments"].is_string() ?
                         func["arguments"].get<std::string>() : func["arguments"].dump();
-                    nlohmann::json args;
                     try {
-                        args = nlohmann::json::parse(argsStr);
+                        call.args = nlohmann::json::parse(argsStr);
                     } catch (...) {
-                        args = nlohmann::json::object();
-                        Logger::getInstance().warn("Tool args parse failed for " + fullName + ": " + argsStr);
-                    }
-
-                    // Policy Enforcement: Discourage full-file overwrites in tool calls
-                    if (fullName == "builtin__write" || fullName == "write") {
-                        if (args.contains("path") && args.contains("content") && 
-                            !args.contains("operation") && !args.contains("search") && 
-                            fs::exists(fs::absolute(fs::u8path(path)) / fs::u8path(args["path"].get<std::string>()))) {
-                            
-                            // Check if it's a very small file or a new file (not exists is already checked)
-                            // We'll allow it but add a warning to the next message
-                            // Actually, let's just log it for now to see how often it happens
-                            // Logger::getInstance().warning("Full-file overwrite detected for: " + args["path"].get<std::string>());
-                        }
+                        call.args = nlohmann::json::object();
+                        Logger::getInstance().warn("Tool args parse failed for " + call.fullName + ": " + argsStr);
                     }
 
                     // Split server_name__tool_name
-                    size_t pos = fullName.find("__");
-                    std::string serverName;
-                    std::string toolName;
-                    
-                    if (pos != std::string::npos) {
-                        serverName = fullName.substr(0, pos);
-                        toolName = fullName.substr(pos + 2);
-                    } else {
-                        serverName = "core";
-                        toolName = fullName;
+                    size_t pos = call.fullName.find("__");
+                    call.serverName = (pos != std::string::npos) ? call.fullName.substr(0, pos) : "core";
+                    call.toolName = (pos != std::string::npos) ? call.fullName.substr(pos + 2) : call.fullName;
+                    if (call.toolName.find("::") != std::string::npos)
+                        call.toolName = call.toolName.substr(call.toolName.rfind("::") + 2);
+                    const std::string& serverName = call.serverName;
+                    const std::string& toolName = call.toolName;
+                    const nlohmann::json& args = call.args;
+
+                    if (cancelled) {
+                        call.result = nlohmann::json{{"error", "Skipped: an earlier action in this batch was cancelled by user."}};
+                        planned.push_back(std::move(call));
+                        continue;
                     }
-                    if (toolName.find("::") != std::string::npos)
-                        toolName = toolName.substr(toolName.rfind("::") + 2);
-
-                        if (toolName == "bash_execute" && args.contains("command")) {
-                            std::string cmd = args["command"];
-                            if (isBashReadCommand(cmd)) {
-                                nlohmann::json loopError = {
-                                    {"error", "Bash read commands are disabled. Use read/search/plan instead."}
-                                };
-                                messages.push_back({
-                                    {"role", "tool"},
-                                    {"tool_call_id", toolCall["id"]},
-                                    {"name", fullName},
-                                    {"content", loopError.dump()}
-                                });
-                                continue;
-                            }
+
+                    if (toolName == "bash_execute" && args.contains("command") && args["command"].is_string()) {
+                        if (isBashReadCommand(args["command"].get<std::string>())) {
+                            call.result = nlohmann::json{{"error", "Bash read commands are disabled. Use read/search/plan instead."}};
+                            planned.push_back(std::move(call));
+                            continue;
                         }
+                    }
 
-                        // 优化：检测重复搜索死循环
-                        if (toolName.find("search") != std::string::npos) {
-                            std::string query = args.value("query", "");
-                            if (!query.empty()) {
-                                if (recentQueries.count(query)) {
-                                    std::cout << YELLOW << "  ⚠ Detected repetitive search loop. Forcing strategy shift." << RESET << std::endl;
-                                    nlohmann::json loopError = {{"error", "Repetitive search detected. Please change your search strategy or use web_fetch to read existing results."}};
-                                    messages.push_back({{"role", "tool"}, {"tool_call_id", toolCall["id"]}, {"name", fullName}, {"content", loopError.dump()}});
-                                    continue;
-                                }
-                                recentQueries.insert(query);
+                    // 优化：检测重复搜索死循环
+                    if (toolName.find("search") != std::string::npos) {
+                        std::string query = args.value("query", "");
+                        if (!query.empty()) {
+                            if (recentQueries.count(query)) {
+                                std::cout << YELLOW << "  ⚠ Detected repetitive search loop. Forcing strategy shift." << RESET << std::endl;
+                                call.result = nlohmann::json{{"error", "Repetitive search detected. Please change your search strategy or use web_fetch to read existing results."}};
+                                planned.push_back(std::move(call));
+                                continue;
                             }
+                            recentQueries.insert(query);
                         }
+                    }
 
-                        if (toolName == "apply_patch") {
-                            if (cfg.agent.enableDebug) {
-                                Logger::getInstance().action(serverName + "::" + toolName + " " + args.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+                    if (toolName == "apply_patch") {
+                        if (cfg.agent.enableDebug) {
+                            Logger::getInstance().action(serverName + "::" + toolName + " " + args.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+                        } else {
+                            size_t diffLen = 0;
+                            if (args.contains("diff_content") && args["diff_content"].is_string())
+                                diffLen = args["diff_content"].get<std::string>().size();
+                            if (args.contains("files") && args["files"].is_array()) {
+                                size_t nFiles = args["files"].size();
+                                Logger::getInstance().action(serverName + "::" + toolName + " (files content hidden, " + std::to_string(nFiles) + " file(s))");
                             } else {
-                                size_t diffLen = 0;
-                                if (args.contains("diff_content") && args["diff_content"].is_string())
-                                    diffLen = args["diff_content"].get<std::string>().size();
-                                if (args.contains("files") && args["files"].is_array()) {
-                                    size_t nFiles = args["files"].size();
-                                    Logger::getInstance().action(serverName + "::" + toolName + " (files content hidden, " + std::to_string(nFiles) + " file(s))");
-                                } else {
-                                    Logger::getInstance().action(serverName + "::" + toolName + " (diff_content hidden"
-                                        + (diffLen ? ", " + std::to_string(diffLen) + " chars)" : ")"));
-                                }
+                                Logger::getInstance().action(serverName + "::" + toolName + " (diff_content hidden"
+                                    + (diffLen ? ", " + std::to_string(diffLen) + " chars)" : ")"));
                             }
-                        } else {
-                            Logger::getInstance().action(serverName + "::" + toolName + " " + args.dump());
                         }
-                        
-                        // Human-in-the-loop: Confirmation for risky tools
-                        std::string confirm = "y"; // Default to yes for non-risky tools
-                        if (isRiskyTool(toolName) && !authorizeAll) {
-                            // 1. Pre-confirmation Preview (Optional, but helpful)
-                            // We don't automatically show diff here to avoid clutter, 
-                            // user can request it with 'v'.
-
-                            while (true) {
-                                std::cout << "\n " << YELLOW << BOLD << "⚠  CONFIRMATION REQUIRED" << RESET << std::endl;
-                                std::cout << GRAY << "   Tool: " << RESET << serverName << "::" << toolName << std::endl;
-                                std::cout << "   " << BOLD << "[y]" << RESET << " Yes  " 
-                                          << BOLD << "[n]" << RESET << " No  " 
-                                          << BOLD << "[a]" << RESET << " All  " 
-                                          << BOLD << "[v]" << RESET << " View Diff" << std::endl;
-                                std::cout << " " << CYAN << BOLD << "> " << RESET << std::flush;
-                                
-                                std::string input;
-                                std::getline(std::cin, input);
-                                std::transform(input.begin(), input.end(), input.begin(), ::tolower);
-                                
-                                if (input == "v") {
-                                    // Specialized Diff Preview for file operations
-                                    if ((toolName == "file_write" || toolName == "write") && args.contains("content") && args.contains("path") && !args.contains("operation") && !args.contains("search")) {
-                                        showGitDiff(args["path"], args["content"], true);
-                                    } else if ((toolName == "file_edit_lines" || toolName == "write") && args.contains("path") && args.contains("operation")) {
-                                        // Simulate line-based edit
-                                        std::string path = args["path"];
+                    } else {
+                        Logger::getInstance().action(serverName + "::" + toolName + " " + args.dump());
+                    }
+                    
+                    // Human-in-the-loop: Confirmation for risky tools（只读与普通工具不打断）
+                    if (isRiskyTool(toolName) && !authorizeAll) {
+                        // 1. Pre-confirmation Preview (Optional, but helpful)
+                        // We don't automatically show diff here to avoid clutter, 
+                        // user can request it with 'v'.
+
+                        while (true) {
+                            std::cout << "\n " << YELLOW << BOLD << "⚠  CONFIRMATION REQUIRED" << RESET << std::endl;
+                            std::cout << GRAY << "   Tool: " << RESET << serverName << "::" << toolName << std::endl;
+                            std::cout << "   " << BOLD << "[y]" << RESET << " Yes  " 
+                                      << BOLD << "[n]" << RESET << " No  " 
+                                      << BOLD << "[a]" << RESET << " All  " 
+                                      << BOLD << "[v]" << RESET << " View Diff" << std::endl;
+                            std::cout << " " << CYAN << BOLD << "> " << RESET << std::flush;
+                            
+                            std::string input;
+                            std::getline(std::cin, input);
+                            std::transform(input.begin(), input.end(), input.begin(), ::tolower);
+                            
+                            if (input == "v") {
+                                // Specialized Diff Preview for file operations
+                                if ((toolName == "file_write" || toolName == "write") && args.contains("content") && args.contains("path") && !args.contains("operation") && !args.contains("search")) {
+                                    showGitDiff(args["path"], args["content"], true);
+                                } else if ((toolName == "file_edit_lines" || toolName == "write") && args.contains("path") && args.contains("operation")) {
+                                    // Simulate line-based edit
+                                    std::string path = args["path"];
+                                    std::ifstream inFile(path);
+                                    if (inFile.is_open()) {
+                                        std::vector<std::string> lines;
+                                        std::string line;
+                                        while (std::getline(inFile, line)) lines.push_back(line);
+                                        inFile.close();
+                                        std::string op = args["operation"];
+                                        int start = args["start_line"];
+                                        int end = args.value("end_line", start);
+                                        std::string content = args.value("content", "");
+                                        std::vector<std::string> newLines;
+                                        std::istringstream iss(content);
+                                        std::string nl;
+                                        while (std::getline(iss, nl)) newLines.push_back(nl);
+                                        if (op == "replace" && start >= 1 && start <= (int)lines.size()) {
+                                            if (end > (int)lines.size()) end = (int)lines.size();
+                                            lines.erase(lines.begin() + start - 1, lines.begin() + end);
+                                            lines.insert(lines.begin() + start - 1, newLines.begin(), newLines.end());
+                                        } else if (op == "insert") {
+                                            if (start < 1) start = 1;
+                                            if (start > (int)lines.size() + 1) start = (int)lines.size() + 1;
+                                            lines.insert(lines.begin() + start - 1, newLines.begin(), newLines.end());
+                                        } else if (op == "delete" && start >= 1 && start <= (int)lines.size()) {
+                                            if (end > (int)lines.size()) end = (int)lines.size();
+                                            lines.erase(lines.begin() + start - 1, lines.begin() + end);
+                                        }
+                                        std::string simulated;
+                                        for (size_t i = 0; i < lines.size(); ++i) simulated += lines[i] + (i == lines.size() - 1 ? "" : "\n");
+                                        showGitDiff(path, simulated, true);
+                                    }
+                                } else if ((toolName == "edit_batch_lines" || toolName == "write") && args.contains("edits")) {
+                                    std::cout << YELLOW << BOLD << "\n📦 BATCH EDIT PREVIEW:" << RESET << std::endl;
+                                    for (const auto& edit : args["edits"]) {
+                                        std::string path = edit["path"];
                                         std::ifstream inFile(path);
                                         if (inFile.is_open()) {
                                             std::vector<std::string> lines;
                                             std::string line;
                                             while (std::getline(inFile, line)) lines.push_back(line);
                                             inFile.close();
-                                            std::string op = args["operation"];
-                                            int start = args["start_line"];
-                                            int end = args.value("end_line", start);
-                                            std::string content = args.value("content", "");
+                                            std::string op = edit["operation"];
+                                            int start = edit["start_line"];
+                                            int end = edit.value("end_line", start);
+                                            std::string content = edit.value("content", "");
                                             std::vector<std::string> newLines;
                                             std::istringstream iss(content);
                                             std::string nl;
@@ -2014,215 +2225,188 @@ int main(int argc, char* argv[]) {
                                             for (size_t i = 0; i < lines.size(); ++i) simulated += lines[i] + (i == lines.size() - 1 ? "" : "\n");
                                             showGitDiff(path, simulated, true);
                                         }
-                                    } else if ((toolName == "edit_batch_lines" || toolName == "write") && args.contains("edits")) {
-                                        std::cout << YELLOW << BOLD << "\n📦 BATCH EDIT PREVIEW:" << RESET << std::endl;
-                                        for (const auto& edit : args["edits"]) {
-                                            std::string path = edit["path"];
-                                            std::ifstream inFile(path);
-                                            if (inFile.is_open()) {
-                                                std::vector<std::string> lines;
-                                                std::string line;
-                                                while (std::getline(inFile, line)) lines.push_back(line);
-                                                inFile.close();
-                                                std::string op = edit["operation"];
-                                                int start = edit["start_line"];
-                                                int end = edit.value("end_line", start);
-                                                std::string content = edit.value("content", "");
-                                                std::vector<std::string> newLines;
-                                                std::istringstream iss(content);
-                                                std::string nl;
-                                                while (std::getline(iss, nl)) newLines.push_back(nl);
-                                                if (op == "replace" && start >= 1 && start <= (int)lines.size()) {
-                                                    if (end > (int)lines.size()) end = (int)lines.size();
-                                                    lines.erase(lines.begin() + start - 1, lines.begin() + end);
-                                                    lines.insert(lines.begin() + start - 1, newLines.begin(), newLines.end());
-                                                } else if (op == "insert") {
-                                                    if (start < 1) start = 1;
-                                                    if (start > (int)lines.size() + 1) start = (int)lines.size() + 1;
-                                                    lines.insert(lines.begin() + start - 1, newLines.begin(), newLines.end());
-                                                } else if (op == "delete" && start >= 1 && start <= (int)lines.size()) {
-                                                    if (end > (int)lines.size()) end = (int)lines.size();
-                                                    lines.erase(lines.begin() + start - 1, lines.begin() + end);
-                                                }
-                                                std::string simulated;
-                                                for (size_t i = 0; i < lines.size(); ++i) simulated += lines[i] + (i == lines.size() - 1 ? "" : "\n");
-                                                showGitDiff(path, simulated, true);
-                                            }
+                                    }
+                                } else if (toolName == "write" && args.contains("search") && args.contains("replace") && args.contains("path")) {
+                                    std::string path = args["path"];
+                                    std::ifstream inFile(path);
+                                    if (inFile.is_open()) {
+                                        std::string fullContent((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+                                        inFile.close();
+                                        std::string searchStr = args["search"];
+                                        std::string replaceStr = args["replace"];
+                                        size_t pos = fullContent.find(searchStr);
+                                        if (pos != std::string::npos) {
+                                            fullContent.replace(pos, searchStr.length(), replaceStr);
+                                            showGitDiff(path, fullContent, true);
                                         }
-                                    } else if (toolName == "write" && args.contains("search") && args.contains("replace") && args.contains("path")) {
-                                        std::string path = args["path"];
-                                        std::ifstream inFile(path);
-                                        if (inFile.is_open()) {
-                                            std::string fullContent((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
-                                            inFile.close();
-                                            std::string searchStr = args["search"];
-                                            std::string replaceStr = args["replace"];
-                                            size_t pos = fullContent.find(searchStr);
-                                            if (pos != std::string::npos) {
-                                                fullContent.replace(pos, searchStr.length(), replaceStr);
-                                                showGitDiff(path, fullContent, true);
-                                            }
 
-                                        }
-                                    } else {
-                                        std::cout << GRAY << "   (No preview available for this tool)" << RESET << std::endl;
                                     }
-                                    continue; // Ask again
-                                }
-
-                                if (input == "a" || input == "all") {
-                                    authorizeAll = true;
-                                    mcpManager.setAllAuthorized(true);
-                                    confirm = "y";
-                                    break;
-                                }
-
-                                if (input != "y" && input != "yes") {
-                                    std::cout << RED << "✖  Action cancelled by user." << RESET << std::endl;
-                                    messages.push_back({
-                                        {"role", "tool"},
-                                        {"tool_call_id", toolCall["id"]},
-                                        {"name", fullName},
-                                        {"content", "{\"error\": \"Action cancelled by user.\"}"}
-                                    });
-                                    continues = false; // Stop the loop for this turn
-                                    confirm = "n";
-                                    break;
+                                } else {
+                                    std::cout << GRAY << "   (No preview available for this tool)" << RESET << std::endl;
                                 }
-                                confirm = "y";
-                                break; // confirmed 'y'
+                                continue; // Ask again
                             }
-                            if (!continues) break; // Break out of tool call loop if cancelled
-                        }
 
-                        if (confirm == "y" || confirm == "yes") {
-                            nlohmann::json result;
-                            
-                            // ============================================================
-                            // Constitution v2.0: Hard Constraint Validation
-                            // ============================================================
-                            auto validation = ConstitutionValidator::validateToolCall(toolName, args);
-                            if (!validation.valid) {
-                                std::cout << RED << "✖ Constitution Violation" << RESET << std::endl;
-                                std::cout << GRAY << "  Constraint: " << validation.constraint << RESET << std::endl;
-                                std::cout << GRAY << "  Error: " << validation.error << RESET << std::endl;
-                                
-                                result["error"] = "Constitution violation: " + validation.error;
-                                Logger::getInstance().error("Constitution violation in " + toolName + ": " + validation.error);
-                                
-                                // Add error response to messages（格式由 LLMClient::normalizeForKimi 统一处理）
-                                std::string errorMsg = "Constitution violation (" + validation.constraint + "): " + validation.error;
-                                messages.push_back({
-                                    {"role", "tool"},
-                                    {"tool_call_id", toolCall["id"]},
-                                    {"content", errorMsg}
-                                });
-                                continue; // Skip execution, move to next tool call
-                            }
-                            
-                            // ============================================================
-                            // 新架构: 优先使用 ToolRegistry 中的核心工具
-                            // ============================================================
-                            if (toolRegistry.hasTool(toolName)) {
-                                // 使用新的 ToolRegistry
-                                std::cout << GRAY << "  [Using CoreTools::" << toolName << "]" << RESET << std::endl;
-                                if (cfg.agent.enableDebug && (toolName == "apply_patch" || toolName.find("apply_patch") != std::string::npos))
-                                    debugPrintApplyPatch(args);
-                                result = toolRegistry.executeTool(toolName, args);
-                            } else {
-                                // 回退到旧的 MCP 系统 (外部工具 / 遗留工具)
-                                bool tempAuth = (isRiskyTool(toolName) && !authorizeAll);
-                                if (tempAuth) mcpManager.setAllAuthorized(true);
-                                
-                                result = mcpManager.callTool(serverName, toolName, args);
-                                
-                                if (tempAuth) mcpManager.setAllAuthorized(false);
+                            if (input == "a" || input == "all") {
+                                authorizeAll = true;
+                                mcpManager.setAllAuthorized(true);
+                                break;
                             }
 
-                            if (toolName == "apply_patch") {
-                                if (result.contains("error")) {
-                                    std::cout << RED << "✖ apply_patch: " << result["error"].get<std::string>() << RESET << std::endl;
-                                } else {
-                                    std::string msg = result.value("message", "");
-                                    if (result.contains("affected_files") && result["affected_files"].is_array() && !result["affected_files"].empty()) {
-                                        std::string files;
-                                        for (const auto& f : result["affected_files"])
-                                            files += (files.empty() ? "" : ", ") + f.get<std::string>();
-                                        std::cout << GREEN << "✔ apply_patch: " << files << (msg.empty() ? "" : " — " + msg) << RESET << std::endl;
-                                    } else {
-                                        std::cout << GREEN << "✔ apply_patch: " << (msg.empty() ? "OK" : msg) << RESET << std::endl;
-                                    }
-                                }
+                            if (input != "y" && input != "yes") {
+                                std::cout << RED << "✖  Action cancelled by user." << RESET << std::endl;
+                                call.result = nlohmann::json{{"error", "Action cancelled by user."}};
+                                cancelled = true; // 本批其余调用不再执行
+                                break;
                             }
+                            break; // confirmed 'y'
+                        }
+                    }
 
-                            if (result.contains("error")) {
-                                Logger::getInstance().error("Tool " + toolName + " failed: " + result["error"].get<std::string>());
-                                try {
-                                    Logger::getInstance().error("Tool " + toolName + " args: " + args.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
-                                    Logger::getInstance().error("Tool " + toolName + " result: " + result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
-                                } catch (...) {
-                                    Logger::getInstance().error("Tool " + toolName + " - failed to serialize args/result");
-                                }
-                            } else if (result.is_null() || (result.is_object() && result.empty())) {
-                                Logger::getInstance().warn("Tool " + toolName + " returned empty result.");
-                                try {
-                                    Logger::getInstance().warn("Tool " + toolName + " args: " + args.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
-                                } catch (...) {
-                                    Logger::getInstance().warn("Tool " + toolName + " - failed to serialize args");
-                                }
-                            }
-                            
-                            if (cfg.agent.enableReadSummary && (toolName == "read" || toolName.rfind("read_", 0) == 0) && !result.contains("error")) {
-                                std::string readText = extractReadText(result);
-                                if (!readText.empty() && !isReadRejection(readText)) {
-                                    const size_t kMaxSummaryInput = 6000;
-                                    if (readText.size() > kMaxSummaryInput) readText = readText.substr(0, kMaxSummaryInput);
-                                    std::string key = buildReadKey(args);
-                                    std::string summaryPrompt = "请对以下 read 结果做 1-3 条要点摘要，保留文件路径/范围或标签：\n" + readText;
-                                    std::string summary = llmClient->summarize(summaryPrompt);
-                                    storeReadSummary(key, summary);
-                                }
-                            }
+                    if (!call.result) {
+                        // ============================================================
+                        // Constitution v2.0: Hard Constraint Validation
+                        // ============================================================
+                        auto validation = ConstitutionValidator::validateToolCall(toolName, args);
+                        if (!validation.valid) {
+                            std::cout << RED << "✖ Constitution Violation" << RESET << std::endl;
+                            std::cout << GRAY << "  Constraint: " << validation.constraint << RESET << std::endl;
+                            std::cout << GRAY << "  Error: " << validation.error << RESET << std::endl;
+                            Logger::getInstance().error("Constitution violation in " + toolName + ": " + validation.error);
+                            call.result = nlohmann::json{{"error", "Constitution violation (" + validation.constraint + "): " + validation.error}};
+                        }
+                    }
+                    planned.push_back(std::move(call));
+                }
 
-                            // Add tool result to messages
-                            // Kimi 要求 content 为 []object，即 [{"type":"text","text":"..."}]
-                            std::string textContent;
-                            try {
-                                if (result.contains("content") && result["content"].is_array() && !result["content"].empty()) {
-                                    const auto& first = result["content"][0];
-                                    if (first.contains("text") && first["text"].is_string()) {
-                                        textContent = first["text"].get<std::string>();
-                                    } else {
-                                        textContent = first.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
-                                    }
-                                } else if (result.contains("error")) {
-                                    textContent = result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
-                                } else {
-                                    textContent = result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
-                                }
-                            } catch (const std::exception& e) {
-                                textContent = "[Tool result serialization failed: invalid UTF-8]";
+                // ② 执行：优先使用 ToolRegistry 中的核心工具，其余回退到 MCP
+                std::vector<ToolScheduler::Call> batch;
+                std::vector<size_t> batchIndex;
+                // 被丢弃的提前结果在批次结束后才析构（std::async 的 future 析构时会等待其完成）
+                std::vector<std::shared_ptr<std::future<nlohmann::json>>> earlyKeepAlive;
+                for (size_t i = 0; i < planned.size(); ++i) {
+                    PlannedCall& call = planned[i];
+                    if (call.result) continue;
+                    ToolScheduler::Call scheduled;
+                    if (toolRegistry.hasTool(call.toolName)) {
+                        std::cout << GRAY << "  [Using CoreTools::" << call.toolName << "]" << RESET << std::endl;
+                        if (cfg.agent.enableDebug && call.toolName.find("apply_patch") != std::string::npos)
+                            debugPrintApplyPatch(call.args);
+                        scheduled.effects = toolRegistry.getToolEffects(call.toolName, call.args);
+                        scheduled.run = [&toolRegistry, name = call.toolName, args = call.args]() {
+                            return toolRegistry.executeTool(name, args);
+                        };
+                        // 提前执行的结果：本批中有更早的冲突调用（如写同一文件）时由 ToolScheduler 丢弃并重新执行
+                        if (auto early = takeEarlyResult(call.toolCall)) {
+                            auto future = std::make_shared<std::future<nlohmann::json>>(std::move(*early));
+                            earlyKeepAlive.push_back(future);
+                            scheduled.early = [future]() { return future->get(); };
+                        }
+                    } else {
+                        // MCP / 遗留工具的副作用未知：按 Process 独占执行，临时授权开关不会与其它调用交错
+                        scheduled.effects = ToolEffects::process();
+                        const bool tempAuth = (isRiskyTool(call.toolName) && !authorizeAll);
+                        scheduled.run = [&mcpManager, &toolCache, tempAuth, server = call.serverName, name = call.toolName, args = call.args]() {
+                            if (tempAuth) mcpManager.setAllAuthorized(true);
+                            nlohmann::json r = mcpManager.callTool(server, name, args);
+                            if (tempAuth) mcpManager.setAllAuthorized(false);
+                            if (toolCache) toolCache->invalidateAll();
+                            return r;
+                        };
+                    }
+                    batch.push_back(std::move(scheduled));
+                    batchIndex.push_back(i);
+                }
+                auto batchResults = toolScheduler.runBatch(std::move(batch));
+                for (size_t j = 0; j < batchResults.size(); ++j) planned[batchIndex[j]].result = std::move(batchResults[j]);
+
+                // ③ 按 tool_calls 顺序输出并写回 messages
+                for (PlannedCall& call : planned) {
+                    const std::string& toolName = call.toolName;
+                    const nlohmann::json& args = call.args;
+                    nlohmann::json result = call.result ? std::move(*call.result) : nlohmann::json::object();
+
+                    if (toolName == "apply_patch") {
+                        if (result.contains("error")) {
+                            std::cout << RED << "✖ apply_patch: " << result["error"].get<std::string>() << RESET << std::endl;
+                        } else {
+                            std::string msg = result.value("message", "");
+                            if (result.contains("affected_files") && result["affected_files"].is_array() && !result["affected_files"].empty()) {
+                                std::string files;
+                                for (const auto& f : result["affected_files"])
+                                    files += (files.empty() ? "" : ", ") + f.get<std::string>();
+                                std::cout << GREEN << "✔ apply_patch: " << files << (msg.empty() ? "" : " — " + msg) << RESET << std::endl;
+                            } else {
+                                std::cout << GREEN << "✔ apply_patch: " << (msg.empty() ? "OK" : msg) << RESET << std::endl;
                             }
-                            // 空 content 由 LLMClient::normalizeForKimi 在发送前统一占位，此处不再重复处理
+                        }
+                    }
 
-                            if (cfg.agent.enableDebug) {
-                                size_t preview = std::min(textContent.size(), size_t(800));
-                                std::cout << "[Debug] Tool result to model (length=" << textContent.size() << ", preview " << preview << " chars):\n---\n"
-                                          << textContent.substr(0, preview) << (textContent.size() > preview ? "\n..." : "") << "\n---\n" << std::endl;
+                    if (result.contains("error")) {
+                        Logger::getInstance().error("Tool " + toolName + " failed: " + result["error"].get<std::string>());
+                        try {
+                            Logger::getInstance().error("Tool " + toolName + " args: " + args.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+                            Logger::getInstance().error("Tool " + toolName + " result: " + result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+                        } catch (...) {
+                            Logger::getInstance().error("Tool " + toolName + " - failed to serialize args/result");
+                        }
+                    } else if (result.is_null() || (result.is_object() && result.empty())) {
+                        Logger::getInstance().warn("Tool " + toolName + " returned empty result.");
+                        try {
+                            Logger::getInstance().warn("Tool " + toolName + " args: " + args.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+                        } catch (...) {
+                            Logger::getInstance().warn("Tool " + toolName + " - failed to serialize args");
+                        }
+                    } else if (toolPrefetcher && toolRegistry.hasTool(toolName)) {
+                        toolPrefetcher->observe(toolName, args, result);
+                    }
+                    
+                    if (readSummaryPipeline && (toolName == "read" || toolName.rfind("read_", 0) == 0) && !result.contains("error")) {
+                        std::string readText = extractReadText(result);
+                        if (!readText.empty() && !isReadRejection(readText)) {
+                            readSummaryPipeline->request(buildReadKey(args), readText);
+                        }
+                    }
+
+                    // Add tool result to messages
+                    // Kimi 要求 content 为 []object，即 [{"type":"text","text":"..."}]
+                    std::string textContent;
+                    try {
+                        if (result.contains("content") && result["content"].is_array() && !result["content"].empty()) {
+                            const auto& first = result["content"][0];
+                            if (first.contains("text") && first["text"].is_string()) {
+                                textContent = first["text"].get<std::string>();
+                            } else {
+                                textContent = first.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
                             }
-                            
-                            nlohmann::json contentArray = nlohmann::json::array({
-                                nlohmann::json::object({{"type", "text"}, {"text", textContent}})
-                            });
-                            
-                            messages.push_back({
-                                {"role", "tool"},
-                                {"tool_call_id", toolCall["id"]},
-                                {"content", contentArray}
-                            });
+                        } else if (result.contains("error")) {
+                            textContent = result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+                        } else {
+                            textContent = result.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
                         }
+                    } catch (const std::exception& e) {
+                        textContent = "[Tool result serialization failed: invalid UTF-8]";
+                    }
+                    // 空 content 由 LLMClient::normalizeForKimi 在发送前统一占位，此处不再重复处理
+                    // 大结果存盘，对话中只保留预览与 handle（fetch_result 自身的输出已分页限长）
+                    if (toolName != "fetch_result") textContent = resultStore->maybeStore(toolName, textContent);
+
+                    if (cfg.agent.enableDebug) {
+                        size_t preview = std::min(textContent.size(), size_t(800));
+                        std::cout << "[Debug] Tool result to model (length=" << textContent.size() << ", preview " << preview << " chars):\n---\n"
+                                  << textContent.substr(0, preview) << (textContent.size() > preview ? "\n..." : "") << "\n---\n" << std::endl;
+                    }
+                    
+                    nlohmann::json contentArray = nlohmann::json::array({
+                        nlohmann::json::object({{"type", "text"}, {"text", textContent}})
+                    });
+                    
+                    messages.push_back({
+                        {"role", "tool"},
+                        {"tool_call_id", call.toolCall["id"]},
+                        {"content", contentArray}
+                    });
                 }
-                }  // end else (sequential tool loop)
                 continues = true;
             } else {
                 // No more tool calls, we are done
@@ -2259,9 +2443,16 @@ int main(int argc, char* argv[]) {
         int taskCount = mcpManager.getTotalTaskCount();
         std::cout << GRAY << "─── " 
                   << CYAN << "Model: " << BOLD << cfg.llm.model << RESET << GRAY << " | "
-                  << CYAN << "Context: " << BOLD << currentSize << RESET << GRAY << " chars | "
-                  << CYAN << "Tasks: " << BOLD << taskCount << RESET << GRAY << " active ───" 
-                  << RESET << std::endl;
+                  << CYAN << "Context: " << BOLD << (Tokenizer::getInstance().hasVocab() ? "" : "~") << currentSize;
+        if (cfg.llm.contextWindow > 0) std::cout << "/" << cfg.llm.contextWindow;
+        std::cout << RESET << GRAY << " tokens | "
+                  << CYAN << "Tasks: " << BOLD << taskCount << RESET << GRAY << " active";
+        if (cfg.llm.stream) {
+            auto streamMetrics = llmClient->getLastStreamMetrics();
+            if (streamMetrics.ttftMs >= 0)
+                std::cout << " | " << CYAN << "TTFT: " << BOLD << static_cast<long long>(streamMetrics.ttftMs) << RESET << GRAY << " ms";
+        }
+        std::cout << " ───" << RESET << std::endl;
     }
 
 #ifdef _WIN32
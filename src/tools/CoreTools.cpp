@@ -1,6 +1,9 @@
 #include "CoreTools.h"
 #include "analysis/SymbolManager.h"
 #include "utils/ScanIgnore.h"
+#include "utils/FileContentCache.h"
+#include "utils/Utf8Validate.h"
+#include "GrepEngine.h"
 #include <iostream>
 #include <vector>
 #include <cstdio>
@@ -16,11 +19,24 @@
 #include <cctype>
 #include <cstring>
 #include <sstream>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <mutex>
+#include <functional>
 
 // Windows compatibility
 #ifdef _WIN32
     #define popen _popen
     #define pclose _pclose
+#else
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <sys/stat.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+    #include <cerrno>
 #endif
 
 // 读取工具 debug 计时：返回自 t0 起的毫秒数
@@ -28,97 +44,129 @@ static int64_t readDebugMs(const std::chrono::steady_clock::time_point& t0) {
     return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
 }
 
+// 副作用声明中的路径：按项目根解析为规范化的绝对路径，便于 ToolScheduler / 结果缓存比较是否重叠
+static std::string effectPath(const fs::path& rootPath, const std::string& relPath) {
+    std::error_code ec;
+    fs::path p = fs::absolute(rootPath / fs::u8path(relPath.empty() ? "." : relPath), ec);
+    if (ec) p = rootPath / fs::u8path(relPath);
+    std::string out = p.lexically_normal().generic_u8string();
+    while (out.size() > 1 && out.back() == '/') out.pop_back();
+    return out;
+}
+
 // ============================================================================
 // UTF-8 Utilities
 // ============================================================================
 
 namespace UTF8Utils {
-    std::string sanitize(const std::string& input) {
-        std::string output;
-        output.reserve(input.size());
+    // 从 i 处理一个字符（合法则原样复制，否则写入 '?' 或跳过），返回下一个位置；sanitizeScalar 与慢路径共用
+    static size_t sanitizeStep(const std::string& input, size_t i, std::string& output) {
+        unsigned char c = static_cast<unsigned char>(input[i]);
         
-        size_t i = 0;
-        while (i < input.size()) {
-            unsigned char c = static_cast<unsigned char>(input[i]);
-            
-            // 单字节 ASCII (0x00-0x7F)
-            if (c <= 0x7F) {
-                output.push_back(static_cast<char>(c));
-                i++;
-            }
-            // 2 字节序列 (0xC2-0xDF) - 注意: 0xC0-0xC1 是无效的
-            else if (c >= 0xC2 && c <= 0xDF) {
-                if (i + 1 < input.size()) {
-                    unsigned char c1 = static_cast<unsigned char>(input[i + 1]);
-                    if ((c1 & 0xC0) == 0x80) {
-                        output.push_back(input[i]);
-                        output.push_back(input[i + 1]);
-                        i += 2;
-                        continue;
-                    }
+        // 单字节 ASCII (0x00-0x7F)
+        if (c <= 0x7F) {
+            output.push_back(static_cast<char>(c));
+            i++;
+        }
+        // 2 字节序列 (0xC2-0xDF) - 注意: 0xC0-0xC1 是无效的
+        else if (c >= 0xC2 && c <= 0xDF) {
+            if (i + 1 < input.size()) {
+                unsigned char c1 = static_cast<unsigned char>(input[i + 1]);
+                if ((c1 & 0xC0) == 0x80) {
+                    output.push_back(input[i]);
+                    output.push_back(input[i + 1]);
+                    i += 2;
+                    return i;
                 }
-                // 不完整或无效的序列
-                output.push_back('?');
-                i++;
             }
-            // 3 字节序列 (0xE0-0xEF)
-            else if (c >= 0xE0 && c <= 0xEF) {
-                if (i + 2 < input.size()) {
-                    unsigned char c1 = static_cast<unsigned char>(input[i + 1]);
-                    unsigned char c2 = static_cast<unsigned char>(input[i + 2]);
-                    
-                    // 验证续字节
-                    if ((c1 & 0xC0) == 0x80 && (c2 & 0xC0) == 0x80) {
-                        // 额外验证：避免过长编码
-                        if (c == 0xE0 && c1 < 0xA0) {
-                            output.push_back('?');
-                            i += 3;  // 跳过整个无效序列（3 字节）
-                            continue;
-                        }
-                        output.push_back(input[i]);
-                        output.push_back(input[i + 1]);
-                        output.push_back(input[i + 2]);
-                        i += 3;
-                        continue;
+            // 不完整或无效的序列
+            output.push_back('?');
+            i++;
+        }
+        // 3 字节序列 (0xE0-0xEF)
+        else if (c >= 0xE0 && c <= 0xEF) {
+            if (i + 2 < input.size()) {
+                unsigned char c1 = static_cast<unsigned char>(input[i + 1]);
+                unsigned char c2 = static_cast<unsigned char>(input[i + 2]);
+                
+                // 验证续字节
+                if ((c1 & 0xC0) == 0x80 && (c2 & 0xC0) == 0x80) {
+                    // 额外验证：避免过长编码
+                    if (c == 0xE0 && c1 < 0xA0) {
+                        output.push_back('?');
+                        i += 3;  // 跳过整个无效序列（3 字节）
+                        return i;
                     }
+                    output.push_back(input[i]);
+                    output.push_back(input[i + 1]);
+                    output.push_back(input[i + 2]);
+                    i += 3;
+                    return i;
                 }
-                // 不完整或无效的序列
-                output.push_back('?');
-                i++;
             }
-            // 4 字节序列 (0xF0-0xF4)
-            else if (c >= 0xF0 && c <= 0xF4) {
-                if (i + 3 < input.size()) {
-                    unsigned char c1 = static_cast<unsigned char>(input[i + 1]);
-                    unsigned char c2 = static_cast<unsigned char>(input[i + 2]);
-                    unsigned char c3 = static_cast<unsigned char>(input[i + 3]);
-                    
-                    // 验证续字节
-                    if ((c1 & 0xC0) == 0x80 && (c2 & 0xC0) == 0x80 && (c3 & 0xC0) == 0x80) {
-                        // 额外验证：避免过长编码和超出 Unicode 范围
-                        if ((c == 0xF0 && c1 < 0x90) || (c == 0xF4 && c1 > 0x8F)) {
-                            output.push_back('?');
-                            i += 4;  // 跳过整个无效序列（4 字节）
-                            continue;
-                        }
-                        output.push_back(input[i]);
-                        output.push_back(input[i + 1]);
-                        output.push_back(input[i + 2]);
-                        output.push_back(input[i + 3]);
-                        i += 4;
-                        continue;
+            // 不完整或无效的序列
+            output.push_back('?');
+            i++;
+        }
+        // 4 字节序列 (0xF0-0xF4)
+        else if (c >= 0xF0 && c <= 0xF4) {
+            if (i + 3 < input.size()) {
+                unsigned char c1 = static_cast<unsigned char>(input[i + 1]);
+                unsigned char c2 = static_cast<unsigned char>(input[i + 2]);
+                unsigned char c3 = static_cast<unsigned char>(input[i + 3]);
+                
+                // 验证续字节
+                if ((c1 & 0xC0) == 0x80 && (c2 & 0xC0) == 0x80 && (c3 & 0xC0) == 0x80) {
+                    // 额外验证：避免过长编码和超出 Unicode 范围
+                    if ((c == 0xF0 && c1 < 0x90) || (c == 0xF4 && c1 > 0x8F)) {
+                        output.push_back('?');
+                        i += 4;  // 跳过整个无效序列（4 字节）
+                        return i;
                     }
+                    output.push_back(input[i]);
+                    output.push_back(input[i + 1]);
+                    output.push_back(input[i + 2]);
+                    output.push_back(input[i + 3]);
+                    i += 4;
+                    return i;
                 }
-                // 不完整或无效的序列
-                output.push_back('?');
-                i++;
-            }
-            // 孤立的续字节 (0x80-0xBF) 或其他无效字节：直接跳过
-            else {
-                i++;
             }
+            // 不完整或无效的序列
+            output.push_back('?');
+            i++;
+        }
+        // 孤立的续字节 (0x80-0xBF) 或其他无效字节：直接跳过
+        else {
+            i++;
+        }
+        return i;
+    }
+
+    std::string sanitizeScalar(const std::string& input) {
+        std::string output;
+        output.reserve(input.size());
+        size_t i = 0;
+        while (i < input.size()) i = sanitizeStep(input, i, output);
+        return output;
+    }
+
+    std::string sanitize(const std::string& input) {
+        std::string output;
+        output.reserve(input.size());
+
+        const char* data = input.data();
+        const size_t size = input.size();
+        size_t i = 0;
+        while (i < size) {
+            // 合法段整段复制
+            size_t valid = utf8ValidPrefix(data + i, size - i);
+            output.append(data + i, valid);
+            i += valid;
+            if (i >= size) break;
+            // 含非法序列的一块逐字节处理后再回到快速路径（sanitizeStep 总是停在字符边界）
+            const size_t slowEnd = std::min(size, i + 64);
+            while (i < slowEnd) i = sanitizeStep(input, i, output);
         }
-        
         return output;
     }
 }
@@ -172,53 +220,27 @@ nlohmann::json ReadCodeBlockTool::getSchema() const {
     };
 }
 
+ToolEffects ReadCodeBlockTool::getEffects(const nlohmann::json& args) const {
+    std::vector<std::string> paths;
+    auto add = [&](const nlohmann::json& req) {
+        if (req.is_object() && req.contains("file_path") && req["file_path"].is_string())
+            paths.push_back(effectPath(rootPath, req["file_path"].get<std::string>()));
+    };
+    if (args.contains("requests") && args["requests"].is_array()) {
+        for (const auto& req : args["requests"]) add(req);
+    } else {
+        add(args);
+    }
+    return ToolEffects::readOnly(std::move(paths));
+}
+
 nlohmann::json ReadCodeBlockTool::execute(const nlohmann::json& args) {
     nlohmann::json result;
     auto tExecuteStart = std::chrono::steady_clock::now();
 
     // Batch mode: requests array
     if (args.contains("requests") && args["requests"].is_array()) {
-        const auto& requests = args["requests"];
-        const size_t maxItems = 20;
-        if (requests.size() > maxItems) {
-            result["error"] = "Too many requests: max " + std::to_string(maxItems) + ", got " + std::to_string(requests.size());
-            return result;
-        }
-        ReadCodeBlockTool single(rootPath.u8string(), symbolMgr, enableDebug);
-        std::stringstream combined;
-        nlohmann::json items = nlohmann::json::array();
-        for (size_t i = 0; i < requests.size(); ++i) {
-            const auto& req = requests[i];
-            if (!req.is_object() || !req.contains("file_path")) {
-                combined << "--- request[" << (i + 1) << "] invalid (missing file_path) ---\n\n";
-                items.push_back({{"index", static_cast<int>(i)}, {"error", "missing file_path"}});
-                continue;
-            }
-            bool hasScope = (req.contains("symbol_name") && !req["symbol_name"].is_null() && req["symbol_name"].is_string() && !req["symbol_name"].get<std::string>().empty())
-                || req.contains("start_line") || req.contains("end_line");
-            if (!hasScope) {
-                combined << "--- request[" << (i + 1) << "] invalid (missing symbol_name or start_line/end_line) ---\n\n";
-                items.push_back({{"index", static_cast<int>(i)}, {"error", "Each read must include symbol_name or start_line/end_line."}});
-                continue;
-            }
-            std::string filePath = req["file_path"].get<std::string>();
-            nlohmann::json one = single.execute(req);
-            items.push_back({{"file_path", filePath}, {"result", one}});
-            if (one.contains("error")) {
-                combined << "--- " << filePath << " (error) ---\n" << one["error"].get<std::string>() << "\n\n";
-            } else if (one.contains("content") && one["content"].is_array() && !one["content"].empty()
-                       && one["content"][0].contains("text") && one["content"][0]["text"].is_string()) {
-                combined << "--- " << filePath << " ---\n" << one["content"][0]["text"].get<std::string>() << "\n\n";
-            } else {
-                combined << "--- " << filePath << " ---\n" << one.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << "\n\n";
-            }
-        }
-        result["items"] = std::move(items);
-        std::string text = combined.str();
-        if (!text.empty() && text.back() == '\n') text.pop_back();
-        result["content"] = nlohmann::json::array({nlohmann::json::object({{"type", "text"}, {"text", UTF8Utils::sanitize(text)}})});
-        if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] batch total: " << readDebugMs(tExecuteStart) << " ms (" << requests.size() << " requests)" << std::endl;
-        return result;
+        return executeBatch(args["requests"]);
     }
 
     // Single-file mode
@@ -286,6 +308,161 @@ nlohmann::json ReadCodeBlockTool::execute(const nlohmann::json& args) {
     return readFullFile(filePath);
 }
 
+nlohmann::json ReadCodeBlockTool::executeBatch(const nlohmann::json& requests) {
+    nlohmann::json result;
+    auto tStart = std::chrono::steady_clock::now();
+    const size_t maxItems = 20;
+    if (requests.size() > maxItems) {
+        result["error"] = "Too many requests: max " + std::to_string(maxItems) + ", got " + std::to_string(requests.size());
+        return result;
+    }
+
+    // 1) 校验并按文件分组（同一文件的不同写法如 ./a.cpp 与 a.cpp 归为一组）
+    struct FileGroup {
+        std::string relPath;
+        std::vector<size_t> items;
+    };
+    const size_t count = requests.size();
+    std::vector<nlohmann::json> itemResults(count);
+    std::vector<std::string> invalid(count);
+    std::vector<FileGroup> groups;
+    std::unordered_map<std::string, size_t> groupOf;
+    const fs::path rootAbsPath = rootAbsolutePath();
+    for (size_t i = 0; i < count; ++i) {
+        const auto& req = requests[i];
+        if (!req.is_object() || !req.contains("file_path") || !req["file_path"].is_string()) {
+            invalid[i] = "missing file_path";
+            continue;
+        }
+        bool hasScope = (req.contains("symbol_name") && !req["symbol_name"].is_null() && req["symbol_name"].is_string() && !req["symbol_name"].get<std::string>().empty())
+            || req.contains("start_line") || req.contains("end_line");
+        if (!hasScope) {
+            invalid[i] = "missing symbol_name or start_line/end_line";
+            continue;
+        }
+        std::string rel = normalizeRelPath(req["file_path"].get<std::string>(), rootAbsPath);
+        auto [it, inserted] = groupOf.emplace(rel, groups.size());
+        if (inserted) groups.push_back({rel, {}});
+        groups[it->second].items.push_back(i);
+    }
+
+    // 2) 一次读锁取符号快照（只取有按符号读取请求的文件）
+    std::unordered_map<std::string, std::vector<Symbol>> symbolSnapshot;
+    if (symbolMgr && !groups.empty()) {
+        std::vector<std::string> relPaths;
+        for (const auto& g : groups) {
+            bool needsSymbols = std::any_of(g.items.begin(), g.items.end(), [&](size_t idx) {
+                return requests[idx].contains("symbol_name") && requests[idx]["symbol_name"].is_string();
+            });
+            if (needsSymbols) relPaths.push_back(g.relPath);
+        }
+        if (!relPaths.empty()) symbolMgr->getFileSymbolsBatch(relPaths, symbolSnapshot);
+    }
+    static const std::vector<Symbol> kNoSymbols;
+
+    // 3) 每个文件读一次，文件之间并行；结果写入各自的下标，输出顺序与请求一致
+    auto runGroup = [&](const FileGroup& group) {
+        const std::string firstPath = requests[group.items.front()]["file_path"].get<std::string>();
+        fs::path inputPath = fs::u8path(firstPath);
+        fs::path fullPath = inputPath.is_absolute() ? inputPath : rootPath / inputPath;
+        std::string fileError;
+        std::shared_ptr<const FileContentCache::File> file;
+        std::error_code ec;
+        if (!fs::exists(fullPath, ec)) fileError = "File not found: ";
+        else if (!fs::is_regular_file(fullPath, ec)) fileError = "Not a regular file: ";
+        else if (!(file = FileContentCache::getInstance().get(fullPath))) fileError = "Failed to open file: ";
+
+        auto symbolsIt = symbolSnapshot.find(group.relPath);
+        const auto& symbols = symbolsIt != symbolSnapshot.end() ? symbolsIt->second : kNoSymbols;
+        for (size_t idx : group.items) {
+            const auto& req = requests[idx];
+            const std::string filePath = req["file_path"].get<std::string>();
+            nlohmann::json one;
+            if (!fileError.empty()) {
+                one["error"] = fileError + filePath;
+            } else if (req.contains("symbol_name") && req["symbol_name"].is_string()) {
+                if (!symbolMgr) one["error"] = "SymbolManager not available";
+                else one = readSymbolFrom(filePath, req["symbol_name"].get<std::string>(), symbols, file.get());
+            } else {
+                one = formatLineRange(filePath, *file, req.value("start_line", 1), req.value("end_line", -1));
+            }
+            itemResults[idx] = std::move(one);
+        }
+    };
+    const size_t threads = std::min<size_t>({groups.size(), 8, std::max(1u, std::thread::hardware_concurrency())});
+    if (threads <= 1) {
+        for (const auto& g : groups) runGroup(g);
+    } else {
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&] {
+                for (size_t gi = next++; gi < groups.size(); gi = next++) {
+                    try {
+                        runGroup(groups[gi]);
+                    } catch (const std::exception& e) {
+                        for (size_t idx : groups[gi].items) itemResults[idx] = {{"error", std::string("Read failed: ") + e.what()}};
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+    }
+
+    // 4) 按请求顺序组装
+    std::stringstream combined;
+    nlohmann::json items = nlohmann::json::array();
+    for (size_t i = 0; i < count; ++i) {
+        if (!invalid[i].empty()) {
+            combined << "--- request[" << (i + 1) << "] invalid (" << invalid[i] << ") ---\n\n";
+            items.push_back({{"index", static_cast<int>(i)},
+                             {"error", invalid[i] == "missing file_path" ? invalid[i] : "Each read must include symbol_name or start_line/end_line."}});
+            continue;
+        }
+        std::string filePath = requests[i]["file_path"].get<std::string>();
+        nlohmann::json& one = itemResults[i];
+        if (one.contains("error")) {
+            combined << "--- " << filePath << " (error) ---\n" << one["error"].get<std::string>() << "\n\n";
+        } else if (one.contains("content") && one["content"].is_array() && !one["content"].empty()
+                   && one["content"][0].contains("text") && one["content"][0]["text"].is_string()) {
+            combined << "--- " << filePath << " ---\n" << one["content"][0]["text"].get_ref<const std::string&>() << "\n\n";
+        } else {
+            combined << "--- " << filePath << " ---\n" << one.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << "\n\n";
+        }
+        items.push_back({{"file_path", filePath}, {"result", std::move(one)}});
+    }
+    result["items"] = std::move(items);
+    std::string text = combined.str();
+    if (!text.empty() && text.back() == '\n') text.pop_back();
+    // 各项文本已经过 sanitize，路径与错误信息来自合法的 JSON 字符串，拼接结果无需再次清理
+    result["content"] = nlohmann::json::array({nlohmann::json::object({{"type", "text"}, {"text", std::move(text)}})});
+    if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] batch total: " << readDebugMs(tStart) << " ms (" << count << " requests, "
+                               << groups.size() << " files, " << threads << " threads)" << std::endl;
+    return result;
+}
+
+fs::path ReadCodeBlockTool::rootAbsolutePath() const {
+    try {
+        return fs::canonical(rootPath);
+    } catch (...) {
+        return fs::absolute(rootPath);
+    }
+}
+
+std::string ReadCodeBlockTool::normalizeRelPath(const std::string& filePath, const fs::path& rootAbsPath) {
+    fs::path inputPath = fs::u8path(filePath);
+    fs::path absPath = (inputPath.is_absolute() ? inputPath : fs::absolute(rootAbsPath / inputPath)).lexically_normal();
+    try {
+        auto relPath = absPath.lexically_relative(rootAbsPath);
+        if (!relPath.empty() && relPath.string() != ".." && relPath.string().find("..") != 0) {
+            // 使用 generic_string() 确保路径分隔符一致 (统一为 '/')
+            return relPath.generic_string();
+        }
+    } catch (...) {}
+    return filePath;
+}
+
 // ============================================================================
 // ReadCodeBlockTool - 辅助方法实现
 // ============================================================================
@@ -605,42 +782,19 @@ nlohmann::json ReadCodeBlockTool::readSymbolCode(const std::string& filePath, co
     }
     
     // 规范化路径: 统一转换为相对于 rootPath 的路径
-    std::string normalizedPath = filePath;
-    fs::path inputPath = fs::u8path(filePath);
-    
-    // 获取 rootPath 的规范化绝对路径（解析 . 和 .. 等）
-    fs::path rootAbsPath;
-    try {
-        rootAbsPath = fs::canonical(rootPath);
-    } catch (...) {
-        rootAbsPath = fs::absolute(rootPath);
-    }
-    
-    // 计算文件的绝对路径
-    fs::path absPath;
-    if (inputPath.is_absolute()) {
-        absPath = inputPath;
-    } else {
-        absPath = fs::absolute(rootAbsPath / inputPath);
-    }
-    
-    // 如果文件在 rootPath 下,计算相对路径
-    try {
-        auto relPath = absPath.lexically_relative(rootAbsPath);
-        if (!relPath.empty() && relPath.string() != ".." && relPath.string().find("..") != 0) {
-            // 使用 generic_string() 确保路径分隔符一致 (统一为 '/')
-            normalizedPath = relPath.generic_string();
-        }
-    } catch (...) {
-        normalizedPath = filePath;
-    }
+    std::string normalizedPath = normalizeRelPath(filePath, rootAbsolutePath());
     if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] readSymbolCode path_normalize: " << readDebugMs(t0) << " ms" << std::endl;
 
     auto t1 = std::chrono::steady_clock::now();
     // 查找符号
     auto symbols = symbolMgr->getFileSymbols(normalizedPath);
     if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] getFileSymbols: " << readDebugMs(t1) << " ms (symbols=" << symbols.size() << ")" << std::endl;
+    return readSymbolFrom(filePath, symbolName, symbols, nullptr);
+}
 
+nlohmann::json ReadCodeBlockTool::readSymbolFrom(const std::string& filePath, const std::string& symbolName,
+                                                 const std::vector<Symbol>& symbols, const FileContentCache::File* file) {
+    nlohmann::json result;
     const Symbol* targetSymbol = nullptr;
     auto t2 = std::chrono::steady_clock::now();
     for (const auto& sym : symbols) {
@@ -669,7 +823,8 @@ nlohmann::json ReadCodeBlockTool::readSymbolCode(const std::string& filePath, co
     
     // 读取符号对应的行范围
     auto t3 = std::chrono::steady_clock::now();
-    result = readLineRange(filePath, targetSymbol->line, targetSymbol->endLine);
+    result = file ? formatLineRange(filePath, *file, targetSymbol->line, targetSymbol->endLine)
+                  : readLineRange(filePath, targetSymbol->line, targetSymbol->endLine);
     if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] readLineRange(symbol): " << readDebugMs(t3) << " ms" << std::endl;
     if (result.contains("error")) return result;
 
@@ -728,30 +883,25 @@ nlohmann::json ReadCodeBlockTool::readLineRange(const std::string& filePath, int
         fullPath = rootPath / inputPath;
     }
     
-    // 读取文件（二进制模式以处理编码问题）
+    // 读取文件（二进制模式以处理编码问题）；经共享缓存，行偏移索引使按范围读取只触及所需的行
     if (enableDebug) std::cout << "[ReadCodeBlock] Opening file: " << fullPath.string() << std::endl;
     
     auto t1 = std::chrono::steady_clock::now();
-    std::ifstream file(fullPath, std::ios::binary);
-    if (!file.is_open()) {
+    auto file = FileContentCache::getInstance().get(fullPath);
+    if (!file) {
         result["error"] = "Failed to open file: " + filePath;
         return result;
     }
-    
-    std::vector<std::string> lines;
-    std::string line;
-    int lineNum = 0;
-    while (std::getline(file, line)) {
-        lineNum++;
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        lines.push_back(line);
-    }
-    file.close();
-    if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] readLineRange open+read_lines: " << readDebugMs(t1) << " ms (lines=" << lines.size() << ")" << std::endl;
-    
-    int totalLines = static_cast<int>(lines.size());
+    if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] readLineRange open: " << readDebugMs(t1) << " ms" << std::endl;
+    result = formatLineRange(filePath, *file, startLine, endLine);
+    if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] total readLineRange: " << readDebugMs(t0) << " ms" << std::endl;
+    return result;
+}
+
+nlohmann::json ReadCodeBlockTool::formatLineRange(const std::string& filePath, const FileContentCache::File& file,
+                                                  int startLine, int endLine) const {
+    nlohmann::json result;
+    int totalLines = static_cast<int>(file.lineCount());
     
     // 如果 endLine 未指定或为 -1,使用总行数
     if (endLine == -1) {
@@ -769,9 +919,9 @@ nlohmann::json ReadCodeBlockTool::readLineRange(const std::string& filePath, int
     // 构建内容
     auto t2 = std::chrono::steady_clock::now();
     std::ostringstream content;
-    for (int i = startLine - 1; i < endLine; ++i) {
-        content << (i + 1) << "|" << lines[i];
-        if (i < endLine - 1) content << "\n";
+    for (int i = startLine; i <= endLine; ++i) {
+        content << i << "|" << file.line(static_cast<size_t>(i));
+        if (i < endLine) content << "\n";
     }
     
     // 构建最终内容（每行前带行号 N|，便于 apply_patch 精确定位）
@@ -784,7 +934,7 @@ nlohmann::json ReadCodeBlockTool::readLineRange(const std::string& filePath, int
     // 始终清理无效 UTF-8
     auto t3 = std::chrono::steady_clock::now();
     std::string cleanContent = UTF8Utils::sanitize(finalContent);
-    if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] readLineRange sanitize: " << readDebugMs(t3) << " ms, total readLineRange: " << readDebugMs(t0) << " ms" << std::endl;
+    if (enableDebug) std::cout << "[ReadCodeBlock] [TIMING] readLineRange sanitize: " << readDebugMs(t3) << " ms" << std::endl;
     
     nlohmann::json contentItem;
     contentItem["type"] = "text";
@@ -891,6 +1041,17 @@ static std::string joinLines(const std::vector<std::string>& lines) {
     return o.str();
 }
 
+// 同批的两次 apply_patch 共用 .photon/patches（备份目录、last.patch），因此总是互相串行
+ToolEffects ApplyPatchTool::getEffects(const nlohmann::json& args) const {
+    std::vector<std::string> paths = {effectPath(rootPath, ".photon/patches")};
+    if (!args.contains("files") || !args["files"].is_array()) return ToolEffects::writes({});
+    for (const auto& item : args["files"]) {
+        if (item.is_object() && item.contains("path") && item["path"].is_string())
+            paths.push_back(effectPath(rootPath, item["path"].get<std::string>()));
+    }
+    return ToolEffects::writes(std::move(paths));
+}
+
 nlohmann::json ApplyPatchTool::execute(const nlohmann::json& args) {
     nlohmann::json result;
     if (!args.contains("files") || !args["files"].is_array() || args["files"].empty()) {
@@ -1068,6 +1229,11 @@ nlohmann::json WriteTool::getSchema() const {
     };
 }
 
+ToolEffects WriteTool::getEffects(const nlohmann::json& args) const {
+    if (!args.contains("path") || !args["path"].is_string()) return ToolEffects::writes({});
+    return ToolEffects::writes({effectPath(rootPath, args["path"].get<std::string>())});
+}
+
 nlohmann::json WriteTool::execute(const nlohmann::json& args) {
     nlohmann::json result;
     if (!args.contains("path") || !args.contains("content")) {
@@ -1884,6 +2050,10 @@ void ListProjectFilesTool::buildAndSaveCache(const std::string& rootPathStr, Sym
     tool.saveProjectTreeCache(res["tree"], text, maxDepth);
 }
 
+ToolEffects ListProjectFilesTool::getEffects(const nlohmann::json& args) const {
+    return ToolEffects::readOnly({effectPath(rootPath, args.value("path", "."))});
+}
+
 nlohmann::json ListProjectFilesTool::execute(const nlohmann::json& args) {
     nlohmann::json result;
     
@@ -1976,13 +2146,16 @@ nlohmann::json ListProjectFilesTool::execute(const nlohmann::json& args) {
 // GrepTool Implementation
 // ============================================================================
 
-GrepTool::GrepTool(const std::string& rootPath, std::shared_ptr<ScanIgnoreRules> ignoreRules)
-    : rootPath(fs::u8path(rootPath)), ignoreRules(std::move(ignoreRules)) {}
+GrepTool::GrepTool(const std::string& rootPath, std::shared_ptr<ScanIgnoreRules> ignoreRules, SymbolManager* symbolMgr)
+    : rootPath(fs::u8path(rootPath)), ignoreRules(std::move(ignoreRules)), symbolMgr(symbolMgr) {}
 
 std::string GrepTool::getDescription() const {
     return "Search project files by text or regex (grep). Returns file, line, and matching line content. "
            "Use when you do not know which file contains something; then use read_code_block with the returned path and line. "
-           "Parameters: pattern (required), path (optional, default '.'), include (optional glob, e.g. '*.cpp'), max_results (optional, default 200).";
+           "Matches are annotated with their enclosing symbol (function/class and its line range) and grouped by it, "
+           "so you usually know which function to read without another call. "
+           "Parameters: pattern (required), path (optional, default '.'), include (optional glob, e.g. '*.cpp'), max_results (optional, default 200), "
+           "with_symbols (optional, default true).";
 }
 
 nlohmann::json GrepTool::getSchema() const {
@@ -1991,7 +2164,7 @@ nlohmann::json GrepTool::getSchema() const {
         {"properties", {
             {"pattern", {
                 {"type", "string"},
-                {"description", "Search pattern (literal or regex). Escape for shell if needed."}
+                {"description", "Search pattern: literal text or regex (ECMAScript / rg style, e.g. 'foo\\(', 'class \\w+Tool')."}
             }},
             {"path", {
                 {"type", "string"},
@@ -2004,32 +2177,143 @@ nlohmann::json GrepTool::getSchema() const {
             {"max_results", {
                 {"type", "integer"},
                 {"description", "Maximum number of matches to return (default 200)."}
+            }},
+            {"with_symbols", {
+                {"type", "boolean"},
+                {"description", "Annotate matches with the enclosing symbol and group them by symbol (default true)."}
             }}
         }},
         {"required", {"pattern"}}
     };
 }
 
+#ifdef _WIN32
 static void parseGrepLine(const std::string& line, std::string& outPath, int& outLine, std::string& outContent) {
     outPath.clear();
     outLine = 0;
     outContent.clear();
     if (line.empty()) return;
-    // Format "path:line:content" — path may contain ':' (e.g. C:\a\b). Split from right: last ':' -> content, second-to-last -> line.
-    size_t lastColon = line.rfind(':');
-    if (lastColon == std::string::npos) return;
-    outContent = line.substr(lastColon + 1);
-    std::string rest = line.substr(0, lastColon);
-    size_t prevColon = rest.rfind(':');
-    if (prevColon == std::string::npos) return;
-    outPath = rest.substr(0, prevColon);
-    std::string lineStr = rest.substr(prevColon + 1);
-    try {
-        outLine = std::stoi(lineStr);
-    } catch (...) {
+    // findstr 输出 "path:line:content"：路径可能带盘符（C:\a\b），内容也可能含 ':'。
+    // 从左侧找第一个「:数字:」作为行号分隔（跳过盘符冒号）
+    size_t from = (line.size() > 2 && line[1] == ':') ? 2 : 0;
+    for (size_t colon = line.find(':', from); colon != std::string::npos; colon = line.find(':', colon + 1)) {
+        size_t digitsEnd = colon + 1;
+        while (digitsEnd < line.size() && std::isdigit(static_cast<unsigned char>(line[digitsEnd]))) ++digitsEnd;
+        if (digitsEnd == colon + 1 || digitsEnd >= line.size() || line[digitsEnd] != ':') continue;
+        try {
+            outLine = std::stoi(line.substr(colon + 1, digitsEnd - colon - 1));
+        } catch (...) {
+            outLine = 0;
+            return;
+        }
+        outPath = line.substr(0, colon);
+        outContent = line.substr(digitsEnd + 1);
         return;
     }
-    if (outLine < 0) outLine = 0;
+}
+#else
+// 在 PATH 中查找可执行文件；结果按名字缓存（含「未找到」），避免每次 grep 都经 shell 执行 which
+static std::string findExecutableCached(const std::string& name) {
+    static std::mutex cacheMutex;
+    static std::map<std::string, std::string> cache;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(name);
+    if (it != cache.end()) return it->second;
+    std::string found;
+    const char* pathEnv = std::getenv("PATH");
+    std::string paths = pathEnv ? pathEnv : "/usr/local/bin:/usr/bin:/bin";
+    size_t start = 0;
+    while (start <= paths.size() && found.empty()) {
+        size_t sep = paths.find(':', start);
+        std::string dir = paths.substr(start, sep == std::string::npos ? std::string::npos : sep - start);
+        if (!dir.empty()) {
+            std::string candidate = dir + "/" + name;
+            struct stat st;
+            if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(candidate.c_str(), X_OK) == 0) {
+                found = candidate;
+            }
+        }
+        if (sep == std::string::npos) break;
+        start = sep + 1;
+    }
+    cache[name] = found;
+    return found;
+}
+
+// 不经 shell 直接启动 argv（工作目录 cwd），stdout 与 stderr 合并后逐行交给 onLine；onLine 返回 false 时立即结束子进程。
+// 单行超过 maxLineBytes 的部分丢弃，因此内存占用与输出总量无关。返回退出码（无法启动为 -1），提前结束时 killed=true
+static int streamProcessLines(const std::vector<std::string>& args, const fs::path& cwd, size_t maxLineBytes,
+                              const std::function<bool(const std::string&)>& onLine, bool& killed) {
+    killed = false;
+    if (args.empty()) return -1;
+    std::vector<char*> argv;
+    argv.reserve(args.size() + 1);
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+    const std::string dir = cwd.u8string();
+
+    // 两端都 close-on-exec：其它线程同时 fork/exec 的子进程不会继承写端（否则读端要等那些进程退出才见到 EOF）；
+    // 本子进程的 stdout / stderr 由 dup2 得到，不受影响
+    int fds[2];
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) != 0) return -1;
+#else
+    if (pipe(fds) != 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (devNull >= 0) dup2(devNull, STDIN_FILENO);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        if (chdir(dir.c_str()) != 0) _exit(2);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    std::string line;
+    bool overflow = false;
+    char buffer[65536];
+    while (!killed) {
+        ssize_t n = read(fds[0], buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (const char* p = buffer, *end = buffer + n; p < end && !killed;) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            const char* chunkEnd = nl ? nl : end;
+            if (!overflow) {
+                size_t take = std::min(static_cast<size_t>(chunkEnd - p), maxLineBytes - line.size());
+                line.append(p, take);
+                overflow = line.size() >= maxLineBytes;
+            }
+            if (!nl) break;
+            if (!onLine(line)) killed = true;
+            line.clear();
+            overflow = false;
+            p = nl + 1;
+        }
+    }
+    if (!killed && !line.empty()) killed = !onLine(line);
+    if (killed) kill(pid, SIGTERM);
+    close(fds[0]);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+
+ToolEffects GrepTool::getEffects(const nlohmann::json& args) const {
+    std::string searchPath = args.contains("path") && args["path"].is_string() ? args["path"].get<std::string>() : ".";
+    return ToolEffects::readOnly({effectPath(rootPath, searchPath)});
 }
 
 nlohmann::json GrepTool::execute(const nlohmann::json& args) {
@@ -2048,6 +2332,133 @@ nlohmann::json GrepTool::execute(const nlohmann::json& args) {
     int maxResults = args.value("max_results", 200);
     if (maxResults <= 0 || maxResults > 2000) maxResults = 200;
 
+    GrepEngine::Options options;
+    options.include = include;
+    options.maxResults = static_cast<size_t>(maxResults);
+    GrepEngine::Result found = GrepEngine::search(rootPath, searchPath, pattern, options, ignoreRules.get());
+    nlohmann::json matches = nlohmann::json::array();
+    if (found.error.rfind("Invalid regex", 0) == 0) {
+        // ECMAScript 无法编译的写法（如 rg 的 (?i)、\p{..}）交给外部 rg/grep
+        nlohmann::json external = searchExternal(pattern, searchPath, include, maxResults);
+        if (external.contains("error")) return external;
+        matches = std::move(external["matches"]);
+    } else if (!found.error.empty()) {
+        result["error"] = found.error;
+        return result;
+    } else {
+        for (auto& m : found.matches) matches.push_back({{"file", m.file}, {"line", m.line}, {"content", m.content}});
+        if (found.truncated) result["truncated"] = true;
+    }
+    // 过长的行（压缩 / 生成的单行文件）没有运行正则：如实报告，不静默当作不匹配
+    constexpr size_t kMaxReportedSkips = 20;
+    nlohmann::json skippedLines = nlohmann::json::array();
+    for (const auto& s : found.skippedLines) {
+        if (skippedLines.size() >= kMaxReportedSkips) break;
+        skippedLines.push_back({{"file", s.file}, {"line", s.line}, {"bytes", s.bytes}});
+    }
+    if (!skippedLines.empty()) {
+        result["skipped_long_lines"] = skippedLines;
+        result["skipped_long_lines_total"] = static_cast<int>(found.skippedLines.size());
+    }
+    const bool withSymbols = symbolMgr && args.value("with_symbols", true);
+    if (withSymbols && !matches.empty()) annotateWithSymbols(matches);
+    result["matches"] = matches;
+    result["count"] = static_cast<int>(matches.size());
+    nlohmann::json contentItem;
+    contentItem["type"] = "text";
+    std::ostringstream text;
+    text << "grep pattern: " << pattern << "\nmatches: " << result["count"].get<int>() << "\n";
+    if (withSymbols) {
+        text << formatGroupedMatches(matches);
+    } else {
+        for (const auto& m : matches) {
+            text << m["file"].get<std::string>() << ":" << m["line"].get<int>() << ":" << m["content"].get<std::string>() << "\n";
+        }
+    }
+    if (!found.skippedLines.empty()) {
+        const auto& first = found.skippedLines.front();
+        text << "note: " << found.skippedLines.size() << " line(s) longer than " << options.maxRegexLineBytes
+             << " bytes were not searched with the regex (first: " << first.file << ":" << first.line << ", "
+             << first.bytes << " bytes); use a literal pattern to search them\n";
+    }
+    contentItem["text"] = text.str();
+    result["content"] = nlohmann::json::array({contentItem});
+    return result;
+}
+
+void GrepTool::annotateWithSymbols(nlohmann::json& matches) const {
+    std::vector<std::pair<std::string, int>> queries;
+    queries.reserve(matches.size());
+    for (const auto& m : matches) queries.emplace_back(m["file"].get<std::string>(), m["line"].get<int>());
+    // 一次读锁查完所有匹配（2000 条时仍是毫秒级）
+    auto enclosing = symbolMgr->findEnclosingSymbols(queries);
+    for (size_t i = 0; i < matches.size(); ++i) {
+        if (!enclosing[i]) continue;
+        const auto& sym = *enclosing[i];
+        nlohmann::json symbol = {{"name", sym.name}, {"type", sym.type}, {"line", sym.line}};
+        if (sym.endLine > 0) symbol["end_line"] = sym.endLine;
+        matches[i]["symbol"] = std::move(symbol);
+    }
+}
+
+std::string GrepTool::formatGroupedMatches(const nlohmann::json& matches) {
+    // 文件按首次出现顺序；文件内按所在符号分组（组按首条匹配的行号顺序），不在任何符号内的归入 (top level)
+    std::ostringstream text;
+    std::string currentFile;
+    std::vector<std::pair<std::string, std::vector<const nlohmann::json*>>> groups;
+    auto flushFile = [&] {
+        for (const auto& [header, items] : groups) {
+            text << "  " << header << "\n";
+            for (const auto* m : items) {
+                text << "    " << (*m)["line"].get<int>() << ": " << (*m)["content"].get<std::string>() << "\n";
+            }
+        }
+        groups.clear();
+    };
+    for (const auto& m : matches) {
+        const std::string& file = m["file"].get_ref<const std::string&>();
+        if (file != currentFile) {
+            flushFile();
+            currentFile = file;
+            text << file << "\n";
+        }
+        std::string header = "(top level)";
+        if (m.contains("symbol")) {
+            const auto& sym = m["symbol"];
+            header = sym.value("type", "symbol") + " " + sym.value("name", "") + " (" + std::to_string(sym.value("line", 0));
+            if (sym.contains("end_line")) header += "-" + std::to_string(sym["end_line"].get<int>());
+            header += ")";
+        }
+        auto it = std::find_if(groups.begin(), groups.end(), [&](const auto& g) { return g.first == header; });
+        if (it == groups.end()) {
+            groups.emplace_back(header, std::vector<const nlohmann::json*>{});
+            it = std::prev(groups.end());
+        }
+        it->second.push_back(&m);
+    }
+    flushFile();
+    return text.str();
+}
+
+nlohmann::json GrepTool::searchExternal(const std::string& pattern, const std::string& searchPath,
+                                       const std::string& include, int maxResults) const {
+    nlohmann::json result;
+    nlohmann::json matches = nlohmann::json::array();
+    const size_t kMaxContentBytes = 1000;
+    // 与 list/扫描共用忽略规则：名字形式的规则已交给外部命令排除，其余在这里逐条过滤
+    auto accept = [&](std::string path, int lineNo, std::string content) {
+        if (path.rfind("./", 0) == 0) path.erase(0, 2);
+        if (path.empty() || lineNo <= 0) return;
+        if (ignoreRules && ignoreRules->shouldIgnore(rootPath / fs::u8path(path))) return;
+        if (!content.empty() && content.back() == '\r') content.pop_back();
+        if (content.size() > kMaxContentBytes) {
+            size_t cut = kMaxContentBytes;
+            while (cut > 0 && (static_cast<unsigned char>(content[cut]) & 0xC0) == 0x80) --cut;
+            content = content.substr(0, cut) + "...";
+        }
+        matches.push_back({{"file", path}, {"line", lineNo}, {"content", content}});
+    };
+#ifdef _WIN32
     auto shellEscape = [](const std::string& s) -> std::string {
         if (s.find(' ') == std::string::npos && s.find('"') == std::string::npos && s.find('$') == std::string::npos) return s;
         std::string r;
@@ -2060,80 +2471,106 @@ nlohmann::json GrepTool::execute(const nlohmann::json& args) {
         r += '"';
         return r;
     };
-    std::string patternEsc = shellEscape(pattern);
-#ifdef _WIN32
     // /d 使 cd 可跨盘符切换，避免 CI 上当前在 D: 而 temp 在 C: 导致找不到文件
     std::string prefix = "cd /d \"" + rootPath.u8string() + "\" && ";
-#else
-    std::string prefix = "cd \"" + rootPath.u8string() + "\" && ";
-#endif
-    std::string cmd;
-    std::string out;
-    // 优先级：rg > grep（Git Bash / WSL 等）> Windows findstr
+    // 优先级：rg > grep（Git Bash 等）> findstr；输出逐行解析，够数即停止读取
     bool useRg = false;
     bool useGrep = false;
-#ifdef _WIN32
     { std::string d; if (execCaptureCoreTools("where rg 2>nul", d) == 0 && !d.empty()) useRg = true; }
     if (!useRg) { std::string d; if (execCaptureCoreTools("where grep 2>nul", d) == 0 && !d.empty()) useGrep = true; }
-#else
-    { std::string d; if (execCaptureCoreTools("which rg 2>/dev/null || command -v rg 2>/dev/null", d) == 0 && !d.empty()) useRg = true; }
-    if (!useRg) useGrep = true;  // Unix 通常都有 grep
-#endif
+    std::string cmd;
     if (useRg) {
-        cmd = prefix + "rg -n --no-heading --color never ";
+        cmd = prefix + "rg -n --no-heading --color never --max-count " + std::to_string(maxResults) + " ";
         if (!include.empty()) cmd += "-g " + shellEscape(include) + " ";
-        cmd += " -- " + patternEsc + " " + searchPath + " 2>&1";
+        cmd += "-- " + shellEscape(pattern) + " " + searchPath + " 2>&1";
     } else if (useGrep) {
-        cmd = prefix + "grep -rn ";
+        cmd = prefix + "grep -rnE -m " + std::to_string(maxResults) + " ";
         if (!include.empty()) cmd += "--include=" + shellEscape(include) + " ";
-        cmd += " -e " + patternEsc + " " + searchPath + " 2>&1";
+        cmd += "-e " + shellEscape(pattern) + " " + searchPath + " 2>&1";
     } else {
-#ifdef _WIN32
         std::string findstrPattern = pattern;
         for (size_t i = 0; i < findstrPattern.size(); ++i) {
             if (findstrPattern[i] == '"') { findstrPattern.insert(i, "\\"); ++i; }
         }
         cmd = prefix + "findstr /s /n /c:\"" + findstrPattern + "\" * 2>&1";
-#else
-        cmd = prefix + "grep -rn -e " + patternEsc + " " + searchPath + " 2>&1";
-#endif
     }
-    int code = execCaptureCoreTools(cmd, out);
-    if (code != 0 && code != 1) {
-        result["error"] = out.empty() ? "grep failed" : out;
+    FILE* pipe = _popen(cmd.c_str(), "r");
+    if (!pipe) {
+        result["error"] = "grep failed";
         return result;
     }
-    // Parse "path:line:content" lines；与 list/扫描共用忽略规则，跳过应忽略的文件
-    nlohmann::json matches = nlohmann::json::array();
-    std::istringstream iss(out);
+    std::string firstLine;
+    char buffer[4096];
     std::string line;
-    int count = 0;
-    while (count < maxResults && std::getline(iss, line)) {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-        if (line.empty()) continue;
+    while (static_cast<int>(matches.size()) < maxResults && fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+        line += buffer;
+        if (line.empty() || line.back() != '\n') {
+            if (line.size() < 8192) continue;  // 超长行只保留前 8KB
+        }
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
         std::string p, c;
         int ln = 0;
         parseGrepLine(line, p, ln, c);
-        if (!p.empty() && ln > 0) {
-            if (ignoreRules) {
-                fs::path fullPath = rootPath / fs::u8path(p);
-                if (ignoreRules->shouldIgnore(fullPath)) continue;
-            }
-            matches.push_back({{"file", p}, {"line", ln}, {"content", c}});
-            ++count;
-        }
+        if (!p.empty() && ln > 0) accept(p, ln, c);
+        else if (firstLine.empty()) firstLine = line;
+        line.clear();
     }
-    result["matches"] = matches;
-    result["count"] = static_cast<int>(matches.size());
-    nlohmann::json contentItem;
-    contentItem["type"] = "text";
-    std::ostringstream text;
-    text << "grep pattern: " << pattern << "\nmatches: " << result["count"].get<int>() << "\n";
-    for (const auto& m : matches) {
-        text << m["file"].get<std::string>() << ":" << m["line"].get<int>() << ":" << m["content"].get<std::string>() << "\n";
+    int code = _pclose(pipe);
+    if (code != 0 && code != 1 && matches.empty()) {
+        result["error"] = firstLine.empty() ? "grep failed" : firstLine;
+        return result;
     }
-    contentItem["text"] = text.str();
-    result["content"] = nlohmann::json::array({contentItem});
+#else
+    // 直接 fork/exec（不经 shell，无需转义），stdout 流式读取；够 maxResults 条（忽略过滤之后）即结束子进程
+    const std::string rg = findExecutableCached("rg");
+    const std::string grep = rg.empty() ? findExecutableCached("grep") : std::string();
+    if (rg.empty() && grep.empty()) {
+        result["error"] = "Regex not supported by the built-in engine, and neither rg nor grep is available";
+        return result;
+    }
+    std::vector<std::string> excludes = {".git"};
+    if (ignoreRules) {
+        for (auto& name : ignoreRules->literalNames()) excludes.push_back(std::move(name));
+    }
+    std::vector<std::string> args;
+    const std::string perFile = std::to_string(maxResults);
+    if (!rg.empty()) {
+        // --null：路径后输出 NUL 而不是 ':'，路径与内容中的 ':' 不影响解析
+        args = {rg, "-n", "--no-heading", "--color", "never", "--null", "--max-count", perFile};
+        if (!include.empty()) args.insert(args.end(), {"-g", include});
+        for (const auto& name : excludes) args.insert(args.end(), {"-g", "!" + name});
+    } else {
+        args = {grep, "-rnIE", "-Z", "-m", perFile};
+        if (!include.empty()) args.push_back("--include=" + include);
+        for (const auto& name : excludes) args.push_back("--exclude-dir=" + name);
+    }
+    args.insert(args.end(), {"-e", pattern, "--", searchPath});
+
+    std::string diagnostics;  // 非匹配行（错误信息），保留前 2KB
+    bool killed = false;
+    int code = streamProcessLines(args, rootPath, 8192, [&](const std::string& line) {
+        size_t nul = line.find('\0');
+        size_t colon = nul == std::string::npos ? std::string::npos : line.find(':', nul + 1);
+        if (colon == std::string::npos) {
+            if (diagnostics.size() < 2048) diagnostics += line.substr(0, 2048 - diagnostics.size()) + "\n";
+            return true;
+        }
+        int lineNo = 0;
+        try {
+            lineNo = std::stoi(line.substr(nul + 1, colon - nul - 1));
+        } catch (...) {
+            return true;
+        }
+        accept(line.substr(0, nul), lineNo, line.substr(colon + 1));
+        return static_cast<int>(matches.size()) < maxResults;
+    }, killed);
+    if (!killed && code != 0 && code != 1 && matches.empty()) {
+        while (!diagnostics.empty() && diagnostics.back() == '\n') diagnostics.pop_back();
+        result["error"] = diagnostics.empty() ? "grep failed" : diagnostics;
+        return result;
+    }
+#endif
+    result["matches"] = matches;
     return result;
 }
 
@@ -2185,6 +2622,12 @@ nlohmann::json AttemptTool::getSchema() const {
     };
 }
 
+ToolEffects AttemptTool::getEffects(const nlohmann::json& args) const {
+    std::string attemptPath = effectPath(rootPath, ".photon/current_attempt.json");
+    if (args.value("action", "") == "get") return ToolEffects::readOnly({attemptPath});
+    return ToolEffects::writes({attemptPath});
+}
+
 nlohmann::json AttemptTool::execute(const nlohmann::json& args) {
     nlohmann::json result;
     if (!args.contains("action") || !args["action"].is_string()) {
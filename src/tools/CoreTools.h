@@ -1,6 +1,7 @@
 #pragma once
 #include "ITool.h"
 #include "analysis/SymbolManager.h"
+#include "utils/FileContentCache.h"
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -18,8 +19,14 @@ class ScanIgnoreRules;
 namespace UTF8Utils {
     /**
      * @brief 验证并清理 UTF-8 字符串，替换无效字节为 '?'
+     * 合法段由 utf8ValidPrefix（AVX2 / SSSE3 分块校验）整段复制，只有含非法序列的块逐字节处理；输出与 sanitizeScalar 相同
      */
     std::string sanitize(const std::string& input);
+
+    /**
+     * @brief 逐字节的参考实现（等价性测试与基准使用）
+     */
+    std::string sanitizeScalar(const std::string& input);
 }
 
 /**
@@ -39,6 +46,8 @@ public:
     std::string getDescription() const override;
     nlohmann::json getSchema() const override;
     nlohmann::json execute(const nlohmann::json& args) override;
+    ToolEffects getEffects(const nlohmann::json& args) const override;
+    bool isCacheable() const override { return true; }
 
 private:
     fs::path rootPath;
@@ -56,9 +65,26 @@ private:
     
     // 读取指定符号的代码
     nlohmann::json readSymbolCode(const std::string& filePath, const std::string& symbolName);
+
+    // 在给定的符号列表中查找并读取符号；file 非空时直接使用已读取的内容（批量模式）
+    nlohmann::json readSymbolFrom(const std::string& filePath, const std::string& symbolName,
+                                  const std::vector<Symbol>& symbols, const FileContentCache::File* file);
     
     // 读取指定行范围
     nlohmann::json readLineRange(const std::string& filePath, int startLine, int endLine);
+
+    // 对已读取的文件按行范围生成结果（带行号前缀）
+    nlohmann::json formatLineRange(const std::string& filePath, const FileContentCache::File& file,
+                                   int startLine, int endLine) const;
+
+    // 批量读取：按文件分组（每个文件只读一次）、一次符号快照、文件间并行，结果按请求顺序输出
+    nlohmann::json executeBatch(const nlohmann::json& requests);
+
+    // rootPath 的 canonical 形式（失败时退回 absolute）
+    fs::path rootAbsolutePath() const;
+
+    // 转为相对 rootAbsPath 的 '/' 分隔路径（符号索引的键）；不在 root 下时原样返回
+    static std::string normalizeRelPath(const std::string& filePath, const fs::path& rootAbsPath);
     
     // 读取全文
     nlohmann::json readFullFile(const std::string& filePath);
@@ -85,6 +111,7 @@ public:
     std::string getDescription() const override;
     nlohmann::json getSchema() const override;
     nlohmann::json execute(const nlohmann::json& args) override;
+    ToolEffects getEffects(const nlohmann::json& args) const override;
 
 private:
     fs::path rootPath;
@@ -138,6 +165,7 @@ public:
     std::string getDescription() const override;
     nlohmann::json getSchema() const override;
     nlohmann::json execute(const nlohmann::json& args) override;
+    ToolEffects getEffects(const nlohmann::json& args) const override;
 private:
     fs::path rootPath;
 };
@@ -176,6 +204,8 @@ public:
     std::string getDescription() const override;
     nlohmann::json getSchema() const override;
     nlohmann::json execute(const nlohmann::json& args) override;
+    ToolEffects getEffects(const nlohmann::json& args) const override;
+    bool isCacheable() const override { return true; }
 
 private:
     fs::path rootPath;
@@ -203,15 +233,34 @@ public:
  */
 class GrepTool : public ITool {
 public:
-    /** ignoreRules 与 list/扫描共用，为空则不过滤结果 */
-    explicit GrepTool(const std::string& rootPath, std::shared_ptr<ScanIgnoreRules> ignoreRules = nullptr);
+    /**
+     * ignoreRules 与 list/扫描共用，为空则不过滤结果；
+     * 提供 symbolMgr 时为每条匹配标注所在符号（名称、类型、行范围），文本结果按符号分组
+     */
+    explicit GrepTool(const std::string& rootPath, std::shared_ptr<ScanIgnoreRules> ignoreRules = nullptr,
+                      SymbolManager* symbolMgr = nullptr);
     std::string getName() const override { return "grep"; }
     std::string getDescription() const override;
     nlohmann::json getSchema() const override;
     nlohmann::json execute(const nlohmann::json& args) override;
+    ToolEffects getEffects(const nlohmann::json& args) const override;
+    bool isCacheable() const override { return true; }
 private:
     fs::path rootPath;
     std::shared_ptr<ScanIgnoreRules> ignoreRules;
+    SymbolManager* symbolMgr;
+
+    /** 批量查询所在符号，写入每条匹配的 "symbol" 字段 */
+    void annotateWithSymbols(nlohmann::json& matches) const;
+    /** 文本结果：文件 -> 所在符号 -> 行 */
+    static std::string formatGroupedMatches(const nlohmann::json& matches);
+
+    /**
+     * 回退路径：正则无法由 GrepEngine 编译时调用外部 rg / grep（直接 exec，不经 shell），返回 {"matches"} 或 {"error"}。
+     * 输出流式逐行解析，够 maxResults 条即结束子进程；内存占用与匹配总数无关
+     */
+    nlohmann::json searchExternal(const std::string& pattern, const std::string& searchPath,
+                                  const std::string& include, int maxResults) const;
 };
 
 /**
@@ -227,6 +276,7 @@ public:
     std::string getDescription() const override;
     nlohmann::json getSchema() const override;
     nlohmann::json execute(const nlohmann::json& args) override;
+    ToolEffects getEffects(const nlohmann::json& args) const override;
 private:
     fs::path rootPath;
 };
@@ -0,0 +1,81 @@
+#include "FetchResultTool.h"
+#include "ToolResultStore.h"
+#include <algorithm>
+#include <sstream>
+
+FetchResultTool::FetchResultTool(std::shared_ptr<ToolResultStore> store) : store(std::move(store)) {}
+
+std::string FetchResultTool::getDescription() const {
+    return "Page through a large tool output that was stored out of line (the conversation only shows its preview "
+           "and a handle such as \"r3\"). Read by line range (start_line/end_line, 1-based, inclusive) or by byte range "
+           "(offset/length). Max " + std::to_string(ToolResultStore::kMaxFetchLines) + " lines or " +
+           std::to_string(ToolResultStore::kMaxFetchBytes / 1024) + " KB per call; the result tells you where to continue.";
+}
+
+nlohmann::json FetchResultTool::getSchema() const {
+    return {
+        {"type", "object"},
+        {"properties", {
+            {"handle", {{"type", "string"}, {"description", "Result handle from the stored-output notice, e.g. \"r3\"."}}},
+            {"start_line", {{"type", "integer"}, {"description", "First line to read (1-based). Default 1."}, {"minimum", 1}}},
+            {"end_line", {{"type", "integer"}, {"description", "Last line to read (inclusive). Default start_line + 199."}, {"minimum", 1}}},
+            {"offset", {{"type", "integer"}, {"description", "Byte offset to read from (use instead of lines for very long lines)."}, {"minimum", 0}}},
+            {"length", {{"type", "integer"}, {"description", "Number of bytes to read with offset."}, {"minimum", 1}}}
+        }},
+        {"required", {"handle"}}
+    };
+}
+
+ToolEffects FetchResultTool::getEffects(const nlohmann::json&) const {
+    return ToolEffects::readOnly({store->getSessionDir().lexically_normal().generic_u8string()});
+}
+
+nlohmann::json FetchResultTool::execute(const nlohmann::json& args) {
+    nlohmann::json result;
+    if (!args.contains("handle") || !args["handle"].is_string()) {
+        result["error"] = "Missing required parameter: handle";
+        return result;
+    }
+    if (!store) {
+        result["error"] = "Result store not available";
+        return result;
+    }
+    const std::string handle = args["handle"].get<std::string>();
+
+    nlohmann::json page;
+    std::ostringstream header;
+    try {
+        if (args.contains("offset")) {
+            const long long offset = args["offset"].get<long long>();
+            const long long length = args.value("length", static_cast<long long>(ToolResultStore::kMaxFetchBytes));
+            page = store->fetchBytes(handle, static_cast<uint64_t>(std::max(0LL, offset)),
+                                     static_cast<size_t>(std::max(0LL, length)));
+            if (page.contains("error")) return page;
+            header << "[" << handle << " bytes " << page["offset"].get<uint64_t>() << "-"
+                   << (page["offset"].get<uint64_t>() + page["length"].get<uint64_t>()) << " of "
+                   << page["total_bytes"].get<uint64_t>();
+            if (page.contains("next_offset")) header << "; continue with offset=" << page["next_offset"].get<uint64_t>();
+            header << "]\n";
+        } else {
+            const long long start = std::max(1LL, args.value("start_line", 1LL));
+            const long long end = args.value("end_line", start + 199);
+            const long long count = end >= start ? end - start + 1 : 1;
+            page = store->fetchLines(handle, static_cast<size_t>(start), static_cast<size_t>(count));
+            if (page.contains("error")) return page;
+            header << "[" << handle << " lines " << page["start_line"].get<size_t>() << "-"
+                   << page["end_line"].get<size_t>() << " of " << page["total_lines"].get<size_t>();
+            if (page.value("line_truncated", false)) {
+                header << "; line truncated, read it with offset=" << page["line_offset"].get<uint64_t>();
+            } else if (page.contains("next_line")) {
+                header << "; continue with start_line=" << page["next_line"].get<size_t>();
+            }
+            header << "]\n";
+        }
+    } catch (const std::exception& e) {
+        result["error"] = std::string("Invalid arguments: ") + e.what();
+        return result;
+    }
+
+    result["content"] = nlohmann::json::array({{{"type", "text"}, {"text", header.str() + page["text"].get<std::string>()}}});
+    return result;
+}
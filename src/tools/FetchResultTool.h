@@ -0,0 +1,27 @@
+#pragma once
+#include "ITool.h"
+#include <memory>
+#include <string>
+
+class ToolResultStore;
+
+/**
+ * @brief 外置结果分页读取工具
+ *
+ * 大的工具输出被 ToolResultStore 存盘后，对话中只有预览与 handle；
+ * 模型用本工具按行（start_line / end_line）或字节（offset / length）区间读取其余部分。
+ */
+class FetchResultTool : public ITool {
+public:
+    explicit FetchResultTool(std::shared_ptr<ToolResultStore> store);
+
+    std::string getName() const override { return "fetch_result"; }
+    std::string getDescription() const override;
+    nlohmann::json getSchema() const override;
+    nlohmann::json execute(const nlohmann::json& args) override;
+    /** 只读结果存储目录，与项目文件的读写互不冲突 */
+    ToolEffects getEffects(const nlohmann::json& args) const override;
+
+private:
+    std::shared_ptr<ToolResultStore> store;
+};
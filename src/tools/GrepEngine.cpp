@@ -0,0 +1,520 @@
+#include "GrepEngine.h"
+#include "utils/ScanIgnore.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <regex>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t kBinaryProbeBytes = 8192;
+// 小文件直接 read：mmap 的建立 / 解除映射比拷贝几十 KB 更贵
+constexpr size_t kMmapThreshold = 64 * 1024;
+
+class FileView {
+public:
+    FileView() = default;
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+    ~FileView() {
+#ifndef _WIN32
+        if (mapped) munmap(mapped, length);
+#endif
+    }
+
+    /** 打开失败或超过 maxBytes 时返回 false */
+    bool open(const fs::path& path, size_t maxBytes) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || static_cast<uint64_t>(st.st_size) > maxBytes) {
+            ::close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(st.st_size);
+        bool ok = true;
+        if (length >= kMmapThreshold) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ok = false;
+            } else {
+                mapped = p;
+                madvise(mapped, length, MADV_SEQUENTIAL);
+                bytes = static_cast<const char*>(p);
+            }
+        } else if (length > 0) {
+            buffer.resize(length);
+            size_t got = 0;
+            while (got < length) {
+                ssize_t n = ::read(fd, &buffer[got], length - got);
+                if (n <= 0) break;
+                got += static_cast<size_t>(n);
+            }
+            buffer.resize(got);
+            length = got;
+            bytes = buffer.data();
+        }
+        ::close(fd);
+        return ok;
+#else
+        std::error_code ec;
+        auto size = fs::file_size(path, ec);
+        if (ec || size > maxBytes) return false;
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        buffer.resize(static_cast<size_t>(size));
+        in.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+        buffer.resize(static_cast<size_t>(in.gcount()));
+        bytes = buffer.data();
+        length = buffer.size();
+        return true;
+#endif
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char* bytes = "";
+    size_t length = 0;
+    std::string buffer;
+#ifndef _WIN32
+    void* mapped = nullptr;
+#endif
+};
+
+// 源码中各字节的大致出现频率排名（越靠前越常见）；不在表中的字节视为最罕见。用于挑选 memchr 的目标字节
+const std::string kCommonBytes =
+    " etaoinsrlcdhupmfgbywvkxjqz_\n\tETAOINSRLCDHUPMFGBYWVKXJQZ();{}=,.\"0123456789-*/:<>&|!+[]#'";
+
+int byteFrequency(unsigned char c) {
+    size_t pos = kCommonBytes.find(static_cast<char>(c));
+    return pos == std::string::npos ? 0 : static_cast<int>(kCommonBytes.size() - pos);
+}
+
+size_t countNewlines(const char* p, const char* end) {
+    size_t n = 0;
+    while (p < end) {
+        const void* hit = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        if (!hit) break;
+        ++n;
+        p = static_cast<const char*>(hit) + 1;
+    }
+    return n;
+}
+
+// 截断到 UTF-8 字符边界
+std::string clipLine(const char* begin, const char* end, size_t maxBytes) {
+    if (end > begin && end[-1] == '\r') --end;
+    size_t n = static_cast<size_t>(end - begin);
+    if (n <= maxBytes) return std::string(begin, n);
+    size_t cut = maxBytes;
+    while (cut > 0 && (static_cast<unsigned char>(begin[cut]) & 0xC0) == 0x80) --cut;
+    return std::string(begin, cut) + "...";
+}
+
+struct Searcher {
+    std::string literal;
+    bool pureLiteral = false;
+    std::regex re;
+    size_t rareOffset = 0;
+    unsigned char rareByte = 0;
+    size_t maxLineBytes = 1000;
+    size_t maxRegexLineBytes = 4096;
+
+    void searchFile(const std::string& rel, const char* data, size_t size, size_t limit,
+                    std::vector<GrepEngine::Match>& out, std::vector<GrepEngine::SkippedLine>& skipped) const {
+        const char* end = data + size;
+        const char* counted = data;  // 已统计行号的位置
+        int lineNo = 1;
+        auto lineNumber = [&](const char* lineStart) {
+            lineNo += static_cast<int>(countNewlines(counted, lineStart));
+            counted = lineStart;
+            return lineNo;
+        };
+        auto emit = [&](const char* lineStart, const char* lineEnd) {
+            out.push_back({rel, lineNumber(lineStart), clipLine(lineStart, lineEnd, maxLineBytes)});
+        };
+        auto lineMatches = [&](const char* lineStart, const char* lineEnd) {
+            if (pureLiteral) return true;
+            if (lineEnd > lineStart && lineEnd[-1] == '\r') --lineEnd;
+            const size_t bytes = static_cast<size_t>(lineEnd - lineStart);
+            if (bytes > maxRegexLineBytes) {
+                skipped.push_back({rel, lineNumber(lineStart), bytes});
+                return false;
+            }
+            return std::regex_search(lineStart, lineEnd, re);
+        };
+
+        if (literal.empty()) {
+            for (const char* p = data; p < end && out.size() < limit;) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+                const char* lineEnd = nl ? nl : end;
+                if (lineMatches(p, lineEnd)) emit(p, lineEnd);
+                p = lineEnd + 1;
+            }
+            return;
+        }
+
+        const size_t len = literal.size();
+        const char* pos = data;
+        while (out.size() < limit && static_cast<size_t>(end - pos) >= len) {
+            const char* from = pos + rareOffset;
+            const char* last = end - (len - rareOffset) + 1;  // rareByte 可能出现的最后位置之后
+            if (from >= last) break;
+            const char* hit = static_cast<const char*>(std::memchr(from, rareByte, static_cast<size_t>(last - from)));
+            if (!hit) break;
+            const char* start = hit - rareOffset;
+            if (std::memcmp(start, literal.data(), len) != 0) {
+                pos = start + 1;
+                continue;
+            }
+            const char* lineStart = start;
+            while (lineStart > data && lineStart[-1] != '\n') --lineStart;
+            const char* nl = static_cast<const char*>(std::memchr(start + len, '\n', static_cast<size_t>(end - start - len)));
+            const char* lineEnd = nl ? nl : end;
+            if (lineMatches(lineStart, lineEnd)) emit(lineStart, lineEnd);
+            if (!nl) break;
+            pos = nl + 1;
+        }
+    }
+};
+
+bool isHidden(const std::string& name) { return !name.empty() && name[0] == '.' && name != "." && name != ".."; }
+
+// 并行遍历目录：遍历时即剪掉被忽略的目录；返回相对 root 的文件路径（已排序）
+std::vector<std::string> walk(const fs::path& root, const std::string& start, const GrepEngine::Options& options,
+                              const ScanIgnoreRules* ignore, size_t threads) {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::string> pending{start};
+    size_t active = 0;
+    std::vector<std::string> files;
+
+    auto keepFile = [&](const std::string& rel, const std::string& name) {
+        if (!options.include.empty()) {
+            const std::string& subject = options.include.find('/') != std::string::npos ? rel : name;
+            if (!GrepEngine::globMatch(options.include, subject)) return false;
+        }
+        return !(ignore && ignore->shouldIgnore(fs::u8path(rel)));
+    };
+
+    auto worker = [&] {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [&] { return !pending.empty() || active == 0; });
+            if (pending.empty()) return;
+            std::string dir = std::move(pending.front());
+            pending.pop_front();
+            active++;
+            lock.unlock();
+
+            std::vector<std::string> subdirs, found;
+            std::error_code ec;
+            fs::path abs = dir.empty() ? root : root / fs::u8path(dir);
+            for (fs::directory_iterator it(abs, ec), end; !ec && it != end; it.increment(ec)) {
+                std::string name = it->path().filename().u8string();
+                if (isHidden(name)) continue;
+                std::string rel = dir.empty() ? name : dir + "/" + name;
+                std::error_code typeEc;
+                auto status = it->symlink_status(typeEc);
+                if (typeEc) continue;
+                // 不跟随目录符号链接（避免环与重复）
+                if (fs::is_directory(status)) {
+                    if (!(ignore && ignore->shouldIgnore(fs::u8path(rel)))) subdirs.push_back(std::move(rel));
+                } else if (fs::is_regular_file(status) || fs::is_symlink(status)) {
+                    if (keepFile(rel, name)) found.push_back(std::move(rel));
+                }
+            }
+
+            lock.lock();
+            for (auto& d : subdirs) pending.push_back(std::move(d));
+            for (auto& f : found) files.push_back(std::move(f));
+            active--;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+}  // namespace
+
+std::string GrepEngine::requiredLiteral(const std::string& pattern, bool* isPureLiteral) {
+    std::string best, run;
+    bool pure = true;
+    auto flush = [&] {
+        if (run.size() > best.size()) best = run;
+        run.clear();
+    };
+    // 量词 * ? {n,m} 使前一个字符可选：从当前片段去掉它（整个 UTF-8 字符）
+    auto dropLastChar = [&] {
+        while (!run.empty() && (static_cast<unsigned char>(run.back()) & 0xC0) == 0x80) run.pop_back();
+        if (!run.empty()) run.pop_back();
+    };
+    auto lastChar = [&]() -> std::string {
+        size_t i = run.size();
+        while (i > 0 && (static_cast<unsigned char>(run[i - 1]) & 0xC0) == 0x80) --i;
+        return i > 0 ? run.substr(i - 1) : std::string();
+    };
+    bool lastWasLiteral = false;
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const char c = pattern[i];
+        if (c == '\\') {
+            if (i + 1 >= pattern.size()) return "";
+            const unsigned char n = static_cast<unsigned char>(pattern[++i]);
+            if (std::isalnum(n)) {
+                // \d \w \s \b \n \x41 等：不当作字面量
+                pure = false;
+                flush();
+                lastWasLiteral = false;
+            } else {
+                run += static_cast<char>(n);
+                lastWasLiteral = true;
+            }
+            continue;
+        }
+        switch (c) {
+        case '|':
+            if (isPureLiteral) *isPureLiteral = false;
+            return "";
+        case '*':
+        case '?':
+        case '{':
+            pure = false;
+            if (lastWasLiteral) dropLastChar();
+            flush();
+            if (c == '{') {
+                size_t close = pattern.find('}', i);
+                if (close == std::string::npos) return "";
+                i = close;
+            }
+            lastWasLiteral = false;
+            break;
+        case '+': {
+            pure = false;
+            // a+b：片段以 a 结束，a 又开始新片段（ab 必出现，a 之前的部分与 b 不一定相邻）
+            std::string tail = lastWasLiteral ? lastChar() : std::string();
+            flush();
+            run = tail;
+            lastWasLiteral = false;
+            break;
+        }
+        case '(': {
+            pure = false;
+            flush();
+            int depth = 1;
+            for (++i; i < pattern.size() && depth > 0; ++i) {
+                if (pattern[i] == '\\') ++i;
+                else if (pattern[i] == '[') {
+                    for (++i; i < pattern.size() && pattern[i] != ']'; ++i) if (pattern[i] == '\\') ++i;
+                } else if (pattern[i] == '(') ++depth;
+                else if (pattern[i] == ')') --depth;
+            }
+            if (depth != 0) return "";
+            --i;
+            lastWasLiteral = false;
+            break;
+        }
+        case ')':
+            return "";
+        case '[': {
+            pure = false;
+            flush();
+            size_t j = i + 1;
+            if (j < pattern.size() && pattern[j] == '^') ++j;
+            if (j < pattern.size() && pattern[j] == ']') ++j;
+            for (; j < pattern.size() && pattern[j] != ']'; ++j) if (pattern[j] == '\\') ++j;
+            if (j >= pattern.size()) return "";
+            i = j;
+            lastWasLiteral = false;
+            break;
+        }
+        case '.':
+        case '^':
+        case '$':
+            pure = false;
+            flush();
+            lastWasLiteral = false;
+            break;
+        default:
+            run += c;
+            lastWasLiteral = true;
+            break;
+        }
+    }
+    flush();
+    if (isPureLiteral) *isPureLiteral = pure && !best.empty();
+    return best;
+}
+
+bool GrepEngine::globMatch(const std::string& glob, const std::string& text) {
+    size_t g = 0, t = 0;
+    size_t starG = std::string::npos, starT = 0;
+    while (t < text.size()) {
+        if (g < glob.size()) {
+            const char gc = glob[g];
+            if (gc == '*') {
+                starG = g++;
+                starT = t;
+                continue;
+            }
+            if (gc == '[') {
+                size_t close = glob.find(']', g + 2);
+                if (close != std::string::npos) {
+                    bool negate = glob[g + 1] == '!' || glob[g + 1] == '^';
+                    size_t k = g + 1 + (negate ? 1 : 0);
+                    bool hit = false;
+                    for (; k < close; ++k) {
+                        if (k + 2 < close && glob[k + 1] == '-') {
+                            if (text[t] >= glob[k] && text[t] <= glob[k + 2]) hit = true;
+                            k += 2;
+                        } else if (glob[k] == text[t]) {
+                            hit = true;
+                        }
+                    }
+                    if (hit != negate && text[t] != '/') {
+                        g = close + 1;
+                        ++t;
+                        continue;
+                    }
+                }
+            } else if ((gc == '?' && text[t] != '/') || gc == text[t]) {
+                ++g;
+                ++t;
+                continue;
+            }
+        }
+        // 回溯到最近的 '*'，让它多吞一个字符（不跨越 '/'）
+        if (starG == std::string::npos || text[starT] == '/') return false;
+        g = starG + 1;
+        t = ++starT;
+    }
+    while (g < glob.size() && glob[g] == '*') ++g;
+    return g == glob.size();
+}
+
+bool GrepEngine::looksBinary(const char* data, size_t size) {
+    return std::memchr(data, '\0', std::min(size, kBinaryProbeBytes)) != nullptr;
+}
+
+GrepEngine::Result GrepEngine::search(const fs::path& root, const std::string& subPath, const std::string& pattern,
+                                      const Options& options, const ScanIgnoreRules* ignore) {
+    Result result;
+    Searcher searcher;
+    searcher.maxLineBytes = options.maxLineBytes;
+    searcher.maxRegexLineBytes = options.maxRegexLineBytes;
+    searcher.literal = requiredLiteral(pattern, &searcher.pureLiteral);
+    if (!searcher.pureLiteral) {
+        try {
+            searcher.re = std::regex(pattern, std::regex::ECMAScript | std::regex::optimize);
+        } catch (const std::regex_error& e) {
+            result.error = std::string("Invalid regex: ") + e.what();
+            return result;
+        }
+    }
+    if (!searcher.literal.empty()) {
+        // memchr 找字面量中最罕见的字节
+        for (size_t i = 0; i < searcher.literal.size(); ++i) {
+            unsigned char b = static_cast<unsigned char>(searcher.literal[i]);
+            if (i == 0 || byteFrequency(b) < byteFrequency(searcher.rareByte)) {
+                searcher.rareByte = b;
+                searcher.rareOffset = i;
+            }
+        }
+    }
+
+    // 起点：root 下的相对目录或单个文件
+    std::string start = fs::u8path(subPath.empty() ? "." : subPath).lexically_normal().generic_u8string();
+    while (!start.empty() && start.back() == '/') start.pop_back();
+    if (start == ".") start.clear();
+    if (start == ".." || start.rfind("../", 0) == 0 || fs::u8path(start).is_absolute()) {
+        result.error = "Path must be inside the project: " + subPath;
+        return result;
+    }
+    std::error_code ec;
+    fs::path startAbs = start.empty() ? root : root / fs::u8path(start);
+    if (!fs::exists(startAbs, ec)) {
+        result.error = "Path not found: " + subPath;
+        return result;
+    }
+
+    size_t threads = options.threads;
+    if (threads == 0) threads = std::max<size_t>(1, std::min<size_t>(8, std::thread::hardware_concurrency()));
+    std::vector<std::string> files;
+    if (fs::is_directory(startAbs, ec)) files = walk(root, start, options, ignore, threads);
+    else files.push_back(start);
+    if (files.empty() || options.maxResults == 0) return result;
+
+    // 按序领取文件；有序前缀的命中数达到上限后不再领取
+    std::vector<std::vector<Match>> perFile(files.size());
+    std::vector<std::vector<SkippedLine>> perFileSkipped(files.size());
+    std::vector<char> done(files.size(), 0);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> stop{false};
+    std::mutex mtx;
+    size_t prefixEnd = 0, prefixMatches = 0;
+    size_t scanned = 0, skipped = 0, bytes = 0;
+
+    auto worker = [&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            const size_t i = next.fetch_add(1);
+            if (i >= files.size()) break;
+            FileView view;
+            bool ok = view.open(root / fs::u8path(files[i]), options.maxFileBytes) && !looksBinary(view.data(), view.size());
+            if (ok) searcher.searchFile(files[i], view.data(), view.size(), options.maxResults, perFile[i], perFileSkipped[i]);
+
+            std::lock_guard<std::mutex> lock(mtx);
+            if (ok) {
+                scanned++;
+                bytes += view.size();
+            } else {
+                skipped++;
+            }
+            done[i] = 1;
+            while (prefixEnd < files.size() && done[prefixEnd]) prefixMatches += perFile[prefixEnd++].size();
+            if (prefixMatches >= options.maxResults) stop = true;
+        }
+    };
+    const size_t searchThreads = std::min(threads, files.size());
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < searchThreads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    for (size_t i = 0; i < perFile.size() && !result.truncated; ++i) {
+        for (auto& m : perFile[i]) {
+            if (result.matches.size() >= options.maxResults) {
+                result.truncated = true;
+                break;
+            }
+            result.matches.push_back(std::move(m));
+        }
+        for (auto& line : perFileSkipped[i]) result.skippedLines.push_back(std::move(line));
+    }
+    if (stop && prefixEnd < files.size()) result.truncated = true;
+    result.filesScanned = scanned;
+    result.filesSkipped = skipped;
+    result.bytesScanned = bytes;
+    return result;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class ScanIgnoreRules;
+
+/**
+ * @brief 进程内并行代码搜索（GrepTool 的默认实现）
+ *
+ * 取代「每次调用 popen(which rg) + shell + rg/grep、读完全部输出再逐条过滤忽略规则」的做法：
+ * - 并行遍历目录，遍历时即按 ScanIgnoreRules 剪掉被忽略的目录（不进入 build/、node_modules/ 等）
+ * - 文件以 mmap 读取（Windows 回退为整文件读入）；前 8KB 含 NUL 视为二进制文件跳过
+ * - 从正则中提取必须出现的字面子串，先用 memchr 找其中最罕见的字节、再 memcmp 确认，
+ *   只对候选行运行 std::regex；纯字面模式不运行正则
+ * - 超过 maxRegexLineBytes 的行不运行 std::regex（libstdc++ 的实现按字符递归，~100KB 的行即可栈溢出），
+ *   跳过并在 skippedLines 中报告
+ * - 文件按路径排序后由 worker 按序领取，结果按 (文件, 行) 有序；有序前缀已够 maxResults 时停止领取新文件，
+ *   因此提前终止后的结果与顺序搜索一致（可被 ToolResultCache 复用）
+ * 正则语法为 ECMAScript（与 rg 常用写法基本一致）；无法编译时返回 error，由调用方回退到外部命令。
+ */
+class GrepEngine {
+public:
+    struct Options {
+        std::string include;          // 文件名 glob（如 "*.cpp"）；含 '/' 时匹配相对路径
+        size_t maxResults = 200;
+        size_t threads = 0;           // 0 取 min(8, 硬件线程数)
+        size_t maxFileBytes = 32u * 1024 * 1024;  // 更大的文件跳过（生成物 / 数据文件）
+        size_t maxLineBytes = 1000;   // 返回的行内容截断长度（压缩过的单行文件）
+        size_t maxRegexLineBytes = 4096;  // 需要正则判定的行超过该长度时跳过（纯字面模式不受限）
+    };
+
+    struct Match {
+        std::string file;  // 相对 root 的路径，'/' 分隔
+        int line = 0;
+        std::string content;
+    };
+
+    /** 因过长未运行正则的行 */
+    struct SkippedLine {
+        std::string file;
+        int line = 0;
+        size_t bytes = 0;
+    };
+
+    struct Result {
+        std::vector<Match> matches;
+        std::vector<SkippedLine> skippedLines;  // 按 (文件, 行) 有序
+        size_t filesScanned = 0;
+        size_t filesSkipped = 0;  // 二进制 / 过大 / 无法读取
+        size_t bytesScanned = 0;
+        bool truncated = false;   // 达到 maxResults 提前停止
+        std::string error;
+    };
+
+    /** 在 root/subPath 下搜索；ignore 为空时只跳过以 . 开头的目录与文件 */
+    static Result search(const fs::path& root, const std::string& subPath, const std::string& pattern,
+                         const Options& options, const ScanIgnoreRules* ignore);
+
+    /** 正则中任何匹配都必须包含的最长字面子串；无法确定时为空（如顶层有 '|'） */
+    static std::string requiredLiteral(const std::string& pattern, bool* isPureLiteral = nullptr);
+
+    /** glob：* ? [abc] [a-z] [!x]；'*' 不跨越 '/' */
+    static bool globMatch(const std::string& glob, const std::string& text);
+
+    /** 前 8KB 含 NUL 字节视为二进制 */
+    static bool looksBinary(const char* data, size_t size);
+};
@@ -1,7 +1,38 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 
+/**
+ * @brief 单次工具调用的副作用声明
+ *
+ * ToolScheduler 据此判断同一批调用中哪些可以并发：只读调用之间互不冲突；
+ * 写入与读写同一路径（或其父目录）的调用冲突；Process 与任何调用冲突。
+ * paths 为按项目根解析后的绝对路径，为空表示可能涉及整个项目。
+ */
+struct ToolEffects {
+    enum class Kind {
+        ReadOnly,     // 只读取文件 / 索引
+        WritesPaths,  // 写入 paths 中的文件
+        Process       // 执行外部进程或改动全局状态
+    };
+    Kind kind = Kind::Process;
+    std::vector<std::string> paths;
+
+    static ToolEffects readOnly(std::vector<std::string> paths = {}) { return {Kind::ReadOnly, std::move(paths)}; }
+    static ToolEffects writes(std::vector<std::string> paths) { return {Kind::WritesPaths, std::move(paths)}; }
+    static ToolEffects process() { return {Kind::Process, {}}; }
+
+    /** 两个路径相同，或一方是另一方的父目录 */
+    static bool pathsOverlap(const std::string& a, const std::string& b) {
+        const std::string& shorter = a.size() <= b.size() ? a : b;
+        const std::string& longer = a.size() <= b.size() ? b : a;
+        if (shorter.empty()) return true;
+        if (longer.compare(0, shorter.size(), shorter) != 0) return false;
+        return longer.size() == shorter.size() || longer[shorter.size()] == '/' || shorter.back() == '/';
+    }
+};
+
 /**
  * @brief 工具接口定义
  * 
@@ -53,4 +84,22 @@ public:
      * }
      */
     virtual nlohmann::json execute(const nlohmann::json& args) = 0;
+
+    /**
+     * @brief 声明本次调用的副作用
+     * @param args 工具参数 (与 execute 相同)
+     *
+     * 默认为 Process（与同批其它调用串行执行）；只读或只写确定文件的工具应覆盖。
+     */
+    virtual ToolEffects getEffects(const nlohmann::json& args) const {
+        (void)args;
+        return ToolEffects::process();
+    }
+
+    /**
+     * @brief 结果能否被 ToolRegistry 缓存复用
+     *
+     * 仅对只读且结果完全由参数与 getEffects 声明的文件决定的工具返回 true。
+     */
+    virtual bool isCacheable() const { return false; }
 };
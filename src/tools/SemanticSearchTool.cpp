@@ -9,8 +9,8 @@ SemanticSearchTool::SemanticSearchTool(SemanticManager* semanticMgr)
 
 std::string SemanticSearchTool::getDescription() const {
     return "Search the codebase using natural language queries. "
-           "This tool finds relevant code snippets based on semantic similarity, "
-           "not just keyword matching. "
+           "This tool ranks code and docs by BM25 keyword/identifier matching fused with semantic similarity, "
+           "so identifier-heavy queries (e.g. 'where is parseUnifiedDiff called') work too. "
            "Use this when you need to find code by concept, functionality, or behavior. "
            "Parameters: query (string, required), top_k (int, optional, default 5).";
 }
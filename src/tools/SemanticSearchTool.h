@@ -21,6 +21,8 @@ public:
     std::string getDescription() const override;
     nlohmann::json getSchema() const override;
     nlohmann::json execute(const nlohmann::json& args) override;
+    /** 只读语义索引；索引覆盖整个项目，因此与同批的写入调用串行 */
+    ToolEffects getEffects(const nlohmann::json&) const override { return ToolEffects::readOnly(); }
 
 private:
     SemanticManager* semanticMgr;
@@ -0,0 +1,186 @@
+#include "ToolPrefetcher.h"
+#include "ToolRegistry.h"
+#include "analysis/SymbolManager.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 与 SymbolManager 的相对路径键一致：规范化 ./ 与 ..，统一分隔符
+std::string normalizeRelPath(const std::string& path) {
+    fs::path p = fs::u8path(path).lexically_normal();
+    if (p.is_absolute()) return "";
+    return p.generic_u8string();
+}
+
+constexpr size_t kMaxGrepFiles = 8;
+
+}  // namespace
+
+ToolPrefetcher::ToolPrefetcher(ToolRegistry& registry, SymbolManager* symbolMgr, Options opts)
+    : registry(registry), symbolMgr(symbolMgr), options(opts) {
+    worker = std::thread([this] { workerLoop(); });
+}
+
+ToolPrefetcher::~ToolPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+bool ToolPrefetcher::parseSymbolKey(const std::string& key, std::string& path, std::string& name) {
+    size_t last = key.rfind(':');
+    if (last == std::string::npos || last == 0 || last + 1 >= key.size()) return false;
+    size_t prev = key.rfind(':', last - 1);
+    if (prev == std::string::npos || prev == 0 || prev + 1 == last) return false;
+    for (size_t i = prev + 1; i < last; ++i) {
+        if (key[i] < '0' || key[i] > '9') return false;
+    }
+    path = key.substr(0, prev);
+    name = key.substr(last + 1);
+    return true;
+}
+
+void ToolPrefetcher::observe(const std::string& toolName, const nlohmann::json& args, const nlohmann::json& result) {
+    if (!symbolMgr || options.maxPredictions == 0 || result.contains("error")) return;
+    Observation observation;
+    try {
+        if (toolName == "read_code_block") {
+            auto add = [&](const nlohmann::json& req) {
+                if (!req.is_object() || !req.contains("file_path") || !req["file_path"].is_string()) return;
+                if (!req.contains("symbol_name") || !req["symbol_name"].is_string()) return;
+                std::string file = normalizeRelPath(req["file_path"].get<std::string>());
+                if (!file.empty()) observation.symbols.emplace_back(file, req["symbol_name"].get<std::string>());
+            };
+            if (args.contains("requests") && args["requests"].is_array()) {
+                for (const auto& req : args["requests"]) add(req);
+            } else {
+                add(args);
+            }
+        } else if (toolName == "grep" && result.contains("matches") && result["matches"].is_array()) {
+            std::unordered_set<std::string> files;
+            for (const auto& m : result["matches"]) {
+                if (!m.is_object() || !m.contains("file") || !m.contains("line")) continue;
+                if (!m["file"].is_string() || !m["line"].is_number_integer()) continue;
+                std::string file = normalizeRelPath(m["file"].get<std::string>());
+                if (file.empty()) continue;
+                if (!files.count(file)) {
+                    if (files.size() >= kMaxGrepFiles) break;
+                    files.insert(file);
+                }
+                observation.hits.emplace_back(file, m["line"].get<int>());
+            }
+        }
+    } catch (...) {
+        return;
+    }
+    if (observation.symbols.empty() && observation.hits.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.observed++;
+        observations.push_back(std::move(observation));
+    }
+    cv.notify_all();
+}
+
+std::vector<nlohmann::json> ToolPrefetcher::predict(const Observation& observation) const {
+    std::vector<nlohmann::json> out;
+    std::unordered_set<std::string> seen;
+    for (const auto& [file, name] : observation.symbols) seen.insert(file + "\n" + name);
+    auto push = [&](const std::string& file, const std::string& name) {
+        if (out.size() >= options.maxPredictions || file.empty() || name.empty()) return;
+        if (!seen.insert(file + "\n" + name).second) return;
+        out.push_back({{"file_path", file}, {"symbol_name", name}});
+    };
+
+    // 被调用者优先（继续往下读是最常见的下一步），其次调用者
+    for (const auto& [file, name] : observation.symbols) {
+        std::vector<Symbol> symbols;
+        if (!symbolMgr->tryGetFileSymbols(file, symbols)) continue;
+        auto it = std::find_if(symbols.begin(), symbols.end(), [&](const Symbol& s) { return s.name == name; });
+        if (it == symbols.end()) continue;
+        std::string path, callee;
+        for (const auto& key : symbolMgr->getCalleesForSymbol(*it)) {
+            if (parseSymbolKey(key, path, callee)) push(path, callee);
+        }
+        for (const auto& key : symbolMgr->getCallerKeysForSymbol(*it)) {
+            if (parseSymbolKey(key, path, callee)) push(path, callee);
+        }
+    }
+    // grep 之后读命中所在的符号
+    for (const auto& [file, line] : observation.hits) {
+        if (out.size() >= options.maxPredictions) break;
+        auto symbol = symbolMgr->findEnclosingSymbol(file, line);
+        if (symbol) push(symbol->path, symbol->name);
+    }
+    return out;
+}
+
+void ToolPrefetcher::workerLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !observations.empty() || !queue.empty(); });
+        if (stopping) return;
+
+        if (!observations.empty()) {
+            Observation observation = std::move(observations.front());
+            observations.pop_front();
+            lock.unlock();
+            std::vector<nlohmann::json> predicted;
+            try {
+                predicted = predict(observation);
+            } catch (...) {
+            }
+            lock.lock();
+            stats.predicted += predicted.size();
+            // 最新的预测排在最前；同样的调用只保留一份
+            for (auto it = predicted.rbegin(); it != predicted.rend(); ++it) {
+                queue.erase(std::remove(queue.begin(), queue.end(), *it), queue.end());
+                queue.push_front(std::move(*it));
+            }
+            while (queue.size() > options.maxQueue) queue.pop_back();
+            cv.notify_all();
+            continue;
+        }
+
+        nlohmann::json args = std::move(queue.front());
+        queue.pop_front();
+        busy = true;
+        lock.unlock();
+        // 前台有调用在执行时让路：预取只占用模型生成下一条消息的空闲时间
+        bool stop = false;
+        while (!stop && !registry.isIdle()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            std::lock_guard<std::mutex> stopLock(mtx);
+            stop = stopping;
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        const bool executed = !stop && registry.prefetchTool("read_code_block", args);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        lock.lock();
+        busy = false;
+        if (executed) {
+            stats.executed++;
+            stats.busyMs += ms;
+        }
+        cv.notify_all();
+    }
+}
+
+bool ToolPrefetcher::waitIdle(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cv.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                       [this] { return stopping || (observations.empty() && queue.empty() && !busy); });
+}
+
+ToolPrefetcher::Stats ToolPrefetcher::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class ToolRegistry;
+class SymbolManager;
+
+/**
+ * @brief 预测下一次读取并在空闲时预先执行
+ *
+ * 模型用 read_code_block 读完一个符号后，下一步常常是读它的某个被调用者（或调用者）；grep 之后则常读命中所在的函数。
+ * observe() 记录每次成功的工具调用，后台线程据此用 SymbolManager 的调用图 / 符号表预测接下来的
+ * read_code_block {file_path, symbol_name} 调用，在 ToolRegistry 空闲（没有前台调用在执行）时经
+ * prefetchTool 执行，结果以预取条目进入 ToolResultCache —— 模型真的发出同样的调用时直接命中缓存。
+ * 内存受缓存的 maxSpeculativeBytes 约束；执行期间有写入时结果不入缓存（见 ToolResultCache::generation）。
+ * 新的观察优先：队列超过上限时丢弃最旧的预测。
+ */
+class ToolPrefetcher {
+public:
+    struct Options {
+        size_t maxPredictions = 4;  // 每次观察最多预测的调用数（被调用者优先，其次调用者）
+        size_t maxQueue = 16;       // 待执行预测的上限
+    };
+
+    struct Stats {
+        size_t observed = 0;
+        size_t predicted = 0;
+        size_t executed = 0;  // 实际执行并存入缓存的预测（已缓存、失败的不计）
+        double busyMs = 0.0;  // 预取执行耗时之和（后台，不在关键路径上）
+    };
+
+    ToolPrefetcher(ToolRegistry& registry, SymbolManager* symbolMgr) : ToolPrefetcher(registry, symbolMgr, Options()) {}
+    ToolPrefetcher(ToolRegistry& registry, SymbolManager* symbolMgr, Options options);
+    ~ToolPrefetcher();
+
+    ToolPrefetcher(const ToolPrefetcher&) = delete;
+    ToolPrefetcher& operator=(const ToolPrefetcher&) = delete;
+
+    /** 记录一次成功的工具调用（只提取预测所需的少量信息，不阻塞调用方） */
+    void observe(const std::string& toolName, const nlohmann::json& args, const nlohmann::json& result);
+
+    /** 等待队列清空且没有预取在执行（测试 / 基准使用）；超时返回 false */
+    bool waitIdle(int timeoutMs);
+
+    Stats getStats() const;
+
+    /** 解析调用图键 "path:line:name"；未解析的键（unresolved:/ambiguous:）返回 false */
+    static bool parseSymbolKey(const std::string& key, std::string& path, std::string& name);
+
+private:
+    struct Observation {
+        std::vector<std::pair<std::string, std::string>> symbols;  // 读过的 (file, symbol)
+        std::vector<std::pair<std::string, int>> hits;             // grep 命中的 (file, line)
+    };
+
+    ToolRegistry& registry;
+    SymbolManager* symbolMgr;
+    Options options;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Observation> observations;
+    std::deque<nlohmann::json> queue;  // 预测的 read_code_block 参数，前端为最新
+    bool busy = false;
+    bool stopping = false;
+    Stats stats;
+    std::thread worker;
+
+    void workerLoop();
+    std::vector<nlohmann::json> predict(const Observation& observation) const;
+};
@@ -1,4 +1,6 @@
 #include "ToolRegistry.h"
+#include <algorithm>
+#include <chrono>
 
 void ToolRegistry::registerTool(std::unique_ptr<ITool> tool) {
     if (!tool) return;
@@ -35,7 +37,10 @@ std::vector<nlohmann::json> ToolRegistry::listToolSchemas() const {
         schema["function"] = function;
         schemas.push_back(schema);
     }
-    
+    // 按名称排序：unordered_map 的遍历顺序不稳定，schema 顺序变化会让请求前缀缓存失效
+    std::sort(schemas.begin(), schemas.end(), [](const nlohmann::json& a, const nlohmann::json& b) {
+        return a["function"]["name"].get<std::string>() < b["function"]["name"].get<std::string>();
+    });
     return schemas;
 }
 
@@ -47,15 +52,81 @@ nlohmann::json ToolRegistry::executeTool(const std::string& name, const nlohmann
         return error;
     }
     
+    struct ActiveScope {
+        std::atomic<int>& n;
+        explicit ActiveScope(std::atomic<int>& counter) : n(counter) { n++; }
+        ~ActiveScope() { n--; }
+    } active(activeCalls);
+
+    ToolEffects effects = getToolEffects(name, args);
+    const bool cacheable = resultCache && tool->isCacheable() && effects.kind == ToolEffects::Kind::ReadOnly;
+    std::string key;
+    uint64_t generation = 0;
+    if (cacheable) {
+        key = ToolResultCache::makeKey(name, args);
+        if (auto hit = resultCache->lookup(key)) return std::move(*hit);
+        generation = resultCache->generation();
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    nlohmann::json result;
     try {
-        return tool->execute(args);
+        result = tool->execute(args);
     } catch (const std::exception& e) {
         nlohmann::json error;
         error["error"] = std::string("Tool execution failed: ") + e.what();
-        return error;
+        result = error;
+    }
+
+    if (resultCache) {
+        if (cacheable) {
+            if (!result.contains("error")) {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                resultCache->store(key, result, effects.paths, ms, generation);
+            }
+        } else if (effects.kind == ToolEffects::Kind::WritesPaths && !effects.paths.empty()) {
+            // 失败的写入也可能已改动部分文件，同样失效
+            resultCache->invalidatePaths(effects.paths);
+        } else if (effects.kind != ToolEffects::Kind::ReadOnly) {
+            resultCache->invalidateAll();
+        }
+    }
+    return result;
+}
+
+bool ToolRegistry::prefetchTool(const std::string& name, const nlohmann::json& args) {
+    ITool* tool = getTool(name);
+    auto cache = resultCache;
+    if (!tool || !cache || !tool->isCacheable()) return false;
+    ToolEffects effects = getToolEffects(name, args);
+    if (effects.kind != ToolEffects::Kind::ReadOnly) return false;
+    const std::string key = ToolResultCache::makeKey(name, args);
+    if (cache->contains(key)) return false;
+
+    const uint64_t generation = cache->generation();
+    const auto t0 = std::chrono::steady_clock::now();
+    nlohmann::json result;
+    try {
+        result = tool->execute(args);
+    } catch (...) {
+        return false;
     }
+    if (result.contains("error")) return false;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    cache->store(key, result, effects.paths, ms, generation, true);
+    return true;
 }
 
 bool ToolRegistry::hasTool(const std::string& name) const {
     return tools.count(name) > 0;
 }
+
+ToolEffects ToolRegistry::getToolEffects(const std::string& name, const nlohmann::json& args) const {
+    auto it = tools.find(name);
+    if (it == tools.end()) return ToolEffects::process();
+    try {
+        return it->second->getEffects(args);
+    } catch (...) {
+        return ToolEffects::process();
+    }
+}
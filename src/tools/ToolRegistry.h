@@ -1,10 +1,12 @@
 #pragma once
+#include <atomic>
 #include <string>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 #include <nlohmann/json.hpp>
 #include "ITool.h"
+#include "ToolResultCache.h"
 
 /**
  * @brief 工具注册中心
@@ -31,7 +33,7 @@ public:
     ITool* getTool(const std::string& name);
 
     /**
-     * @brief 列出所有工具的 Schema
+     * @brief 列出所有工具的 Schema（按名称排序，保证相邻请求字节一致）
      * @return JSON 数组,每个元素包含工具的完整定义
      * 
      * 格式:
@@ -56,9 +58,33 @@ public:
      * 
      * 如果工具不存在,返回:
      * {"error": "Tool not found: xxx"}
+     *
+     * 启用结果缓存后，可缓存工具（isCacheable 且只读）的相同调用直接返回缓存结果；
+     * 写路径的调用执行后使相关条目失效，Process 类调用使全部条目失效。
      */
     nlohmann::json executeTool(const std::string& name, const nlohmann::json& args);
 
+    /**
+     * @brief 预取：在后台执行一次预测的只读调用，结果以 speculative 条目存入缓存
+     * @return 实际执行并存入时返回 true；无缓存、工具不可缓存、非只读、已缓存或执行出错时返回 false
+     */
+    bool prefetchTool(const std::string& name, const nlohmann::json& args);
+
+    /** 当前没有前台 executeTool 在执行（预取只在空闲时进行） */
+    bool isIdle() const { return activeCalls.load() == 0; }
+
+    /**
+     * @brief 设置结果缓存（默认无缓存；传 nullptr 关闭）
+     * 同一缓存可交给 SymbolManager 的文件变化回调按路径失效；外部（MCP）工具执行后应调用其 invalidateAll
+     */
+    void setResultCache(std::shared_ptr<ToolResultCache> cache) { resultCache = std::move(cache); }
+    std::shared_ptr<ToolResultCache> getResultCache() const { return resultCache; }
+
+    /**
+     * @brief 查询一次调用的副作用（未注册的工具按 Process 处理）
+     */
+    ToolEffects getToolEffects(const std::string& name, const nlohmann::json& args) const;
+
     /**
      * @brief 获取已注册工具数量
      */
@@ -71,4 +97,6 @@ public:
 
 private:
     std::unordered_map<std::string, std::unique_ptr<ITool>> tools;
+    std::shared_ptr<ToolResultCache> resultCache;
+    std::atomic<int> activeCalls{0};
 };
@@ -0,0 +1,265 @@
+#include "ToolResultCache.h"
+#include "ITool.h"
+#include "../utils/ScanIgnore.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+ToolResultCache::ToolResultCache(Options opts) : options(opts) {}
+
+std::string ToolResultCache::makeKey(const std::string& toolName, const nlohmann::json& args) {
+    return toolName + "\n" + args.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+namespace {
+
+void hashBytes(uint64_t& h, const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+}
+
+}  // namespace
+
+uint64_t ToolResultCache::treeStamp(const std::string& key, const fs::path& dir) {
+    uint64_t startGen;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = treeStamps.find(key);
+        if (it != treeStamps.end()) return it->second;
+        startGen = gen;
+    }
+    // 遍历不持锁
+    uint64_t stamp = walkTree(dir);
+    std::lock_guard<std::mutex> lock(mtx);
+    if (gen == startGen) treeStamps[key] = stamp;
+    return stamp;
+}
+
+uint64_t ToolResultCache::walkTree(const fs::path& dir) const {
+    uint64_t h = 1469598103934665603ull;
+    // 忽略规则按相对项目根的路径判断；目录不在项目根下时退回相对目录本身
+    fs::path ignoreBase = dir;
+    if (!options.projectRoot.empty()) {
+        fs::path root = fs::u8path(options.projectRoot).lexically_normal();
+        fs::path relToRoot = dir.lexically_normal().lexically_relative(root);
+        if (!relToRoot.empty() && *relToRoot.begin() != "..") ignoreBase = root;
+    }
+    std::error_code ec;
+    fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        const fs::path rel = it->path().lexically_relative(dir);
+        std::error_code typeEc;
+        const bool isDir = it->is_directory(typeEc) && !it->is_symlink(typeEc);
+        if (options.ignoreRules && options.ignoreRules->shouldIgnore(it->path().lexically_normal().lexically_relative(ignoreBase))) {
+            if (isDir) it.disable_recursion_pending();
+            continue;
+        }
+        const std::string name = rel.generic_u8string();
+        hashBytes(h, name.data(), name.size() + 1);
+        std::error_code statEc;
+        int64_t mtime = static_cast<int64_t>(it->last_write_time(statEc).time_since_epoch().count());
+        hashBytes(h, &mtime, sizeof(mtime));
+        if (!isDir) {
+            uint64_t size = it->is_regular_file(statEc) ? static_cast<uint64_t>(it->file_size(statEc)) : 0;
+            hashBytes(h, &size, sizeof(size));
+        }
+    }
+    return h;
+}
+
+ToolResultCache::Fingerprint ToolResultCache::fingerprint(const std::string& path) {
+    Fingerprint fp;
+    fp.path = path;
+    std::error_code ec;
+    fs::path p = fs::u8path(path);
+    auto status = fs::status(p, ec);
+    if (ec || !fs::exists(status)) return fp;
+    fp.exists = true;
+    auto mtime = fs::last_write_time(p, ec);
+    if (!ec) fp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    if (fs::is_regular_file(status)) {
+        auto size = fs::file_size(p, ec);
+        if (!ec) fp.size = static_cast<uint64_t>(size);
+    } else if (fs::is_directory(status)) {
+        fp.tree = treeStamp(path, p);
+    }
+    return fp;
+}
+
+size_t ToolResultCache::estimateBytes(const nlohmann::json& value) {
+    if (value.is_string()) return value.get_ref<const std::string&>().size();
+    if (value.is_structured()) {
+        size_t n = 16;
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            if (value.is_object()) n += it.key().size();
+            n += estimateBytes(*it);
+        }
+        return n;
+    }
+    return 8;
+}
+
+std::optional<nlohmann::json> ToolResultCache::lookup(const std::string& key) {
+    std::vector<Fingerprint> deps;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            stats.misses++;
+            return std::nullopt;
+        }
+        deps = it->second.deps;
+    }
+    // stat 不持锁
+    bool fresh = true;
+    for (const auto& dep : deps) {
+        Fingerprint now = fingerprint(dep.path);
+        if (now.exists != dep.exists || now.mtime != dep.mtime || now.size != dep.size || now.tree != dep.tree) {
+            fresh = false;
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(key);
+    if (it == entries.end() || !fresh) {
+        if (it != entries.end()) {
+            eraseLocked(it);
+            stats.invalidated++;
+        }
+        stats.misses++;
+        return std::nullopt;
+    }
+    lru.splice(lru.begin(), lru, it->second.lruIt);
+    stats.hits++;
+    stats.savedMs += it->second.costMs;
+    if (it->second.speculative) {
+        it->second.speculative = false;
+        speculativeBytes -= it->second.bytes;
+        stats.prefetchHits++;
+        stats.prefetchSavedMs += it->second.costMs;
+    }
+    return it->second.result;
+}
+
+bool ToolResultCache::contains(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return entries.count(key) > 0;
+}
+
+uint64_t ToolResultCache::generation() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return gen;
+}
+
+void ToolResultCache::store(const std::string& key, const nlohmann::json& result, const std::vector<std::string>& paths,
+                            double costMs, uint64_t generationAtStart, bool speculative) {
+    Entry entry;
+    entry.result = result;
+    entry.wholeProject = paths.empty();
+    for (const auto& path : paths) entry.deps.push_back(fingerprint(path));
+    entry.bytes = key.size() + estimateBytes(result);
+    entry.costMs = costMs;
+    entry.speculative = speculative;
+    if (entry.bytes > options.maxBytes || options.maxEntries == 0) return;
+    if (speculative && entry.bytes > options.maxSpeculativeBytes) return;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (gen != generationAtStart) return;
+    auto existing = entries.find(key);
+    if (existing != entries.end()) {
+        if (speculative) return;
+        eraseLocked(existing);
+    }
+    lru.push_front(key);
+    entry.lruIt = lru.begin();
+    totalBytes += entry.bytes;
+    if (speculative) {
+        speculativeBytes += entry.bytes;
+        stats.prefetched++;
+    } else {
+        stats.stored++;
+    }
+    entries.emplace(key, std::move(entry));
+    // 预取超出自己的预算时只淘汰预取条目（从最旧的开始）
+    for (auto it = lru.end(); speculativeBytes > options.maxSpeculativeBytes && it != lru.begin();) {
+        --it;
+        auto victim = entries.find(*it);
+        if (victim == entries.end() || !victim->second.speculative) continue;
+        auto next = std::next(it);
+        eraseLocked(victim);
+        stats.evicted++;
+        it = next;
+    }
+    while ((entries.size() > options.maxEntries || totalBytes > options.maxBytes) && !lru.empty()) {
+        eraseLocked(entries.find(lru.back()));
+        stats.evicted++;
+    }
+}
+
+void ToolResultCache::eraseLocked(std::unordered_map<std::string, Entry>::iterator it) {
+    if (it == entries.end()) return;
+    totalBytes -= it->second.bytes;
+    if (it->second.speculative) speculativeBytes -= it->second.bytes;
+    lru.erase(it->second.lruIt);
+    entries.erase(it);
+}
+
+void ToolResultCache::invalidatePaths(const std::vector<std::string>& paths) {
+    if (paths.empty()) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    gen++;
+    for (auto it = entries.begin(); it != entries.end();) {
+        bool hit = it->second.wholeProject;
+        for (size_t i = 0; !hit && i < it->second.deps.size(); ++i) {
+            for (const auto& path : paths) {
+                if (ToolEffects::pathsOverlap(it->second.deps[i].path, path)) {
+                    hit = true;
+                    break;
+                }
+            }
+        }
+        if (hit) {
+            auto next = std::next(it);
+            eraseLocked(it);
+            stats.invalidated++;
+            it = next;
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = treeStamps.begin(); it != treeStamps.end();) {
+        bool hit = false;
+        for (const auto& path : paths) {
+            if (ToolEffects::pathsOverlap(it->first, path)) {
+                hit = true;
+                break;
+            }
+        }
+        it = hit ? treeStamps.erase(it) : std::next(it);
+    }
+}
+
+void ToolResultCache::invalidateAll() {
+    std::lock_guard<std::mutex> lock(mtx);
+    gen++;
+    stats.invalidated += entries.size();
+    entries.clear();
+    treeStamps.clear();
+    lru.clear();
+    totalBytes = 0;
+    speculativeBytes = 0;
+}
+
+ToolResultCache::Stats ToolResultCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
+
+size_t ToolResultCache::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return entries.size();
+}
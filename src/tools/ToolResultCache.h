@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+class ScanIgnoreRules;
+
+/**
+ * @brief 只读工具调用的结果缓存（ToolRegistry::executeTool 使用）
+ *
+ * 会话中模型会反复发出相同的 read_code_block / grep / list_project_files 调用。
+ * 以「工具名 + 规范化参数」为键缓存结果，并记录调用依赖的文件指纹（mtime + 大小）：
+ * - 命中时重新 stat 依赖的文件，任一变化即视为未命中（覆盖两次 watch 轮询之间的外部修改）
+ * - 依赖目录（grep / list_project_files 的搜索根）时记录目录树指纹：递归汇总其下（未被忽略的）文件的
+ *   路径、mtime 与大小，目录内任一文件被原地修改、增删都会改变指纹。指纹按目录记忆，
+ *   只在 invalidatePaths（涉及该目录或其下路径）/ invalidateAll 后重新遍历，命中时不再遍历整棵树
+ * - 写工具执行后按写入路径失效（覆盖依赖路径或其父目录的条目）；外部进程类调用使全部条目失效
+ * - SymbolManager 检测到文件变化时按路径失效；路径未知（依赖整个项目）的条目在任何失效时一并清除
+ * 按最近使用淘汰，条目数与字节数都有上限。线程安全（并行工具执行会同时查询）。
+ *
+ * 预取（ToolPrefetcher）存入的条目标记为 speculative，单独受 maxSpeculativeBytes 约束，超出时先淘汰最旧的预取条目，
+ * 不挤占真实调用的结果；首次命中后转为普通条目并计入 prefetchHits。
+ */
+class ToolResultCache {
+public:
+    struct Options {
+        size_t maxEntries = 512;
+        size_t maxBytes = 64 * 1024 * 1024;
+        size_t maxSpeculativeBytes = 16 * 1024 * 1024;  // 尚未被命中的预取条目的字节上限
+        /** 目录树指纹跳过的路径（与工具遍历共用同一规则，不进入 build/ 等）；为空时遍历全部 */
+        std::shared_ptr<const ScanIgnoreRules> ignoreRules;
+        /** 项目根目录：忽略规则按相对它的路径判断（与 GrepEngine 一致）；为空时相对被遍历的目录 */
+        std::string projectRoot;
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t stored = 0;
+        size_t invalidated = 0;  // 因文件变化 / 写入而失效的条目
+        size_t evicted = 0;      // 因容量上限淘汰的条目
+        double savedMs = 0.0;    // 命中条目原本的执行耗时之和
+        size_t prefetched = 0;   // 预取存入的条目
+        size_t prefetchHits = 0; // 其中被真实调用命中的
+        double prefetchSavedMs = 0.0;
+    };
+
+    ToolResultCache() : ToolResultCache(Options()) {}
+    explicit ToolResultCache(Options options);
+
+    /** 缓存键：工具名 + 参数的规范化序列化（对象键有序） */
+    static std::string makeKey(const std::string& toolName, const nlohmann::json& args);
+
+    /** 命中且依赖文件未变化时返回结果 */
+    std::optional<nlohmann::json> lookup(const std::string& key);
+
+    /** 是否已有该键（不校验指纹、不计入统计；预取前去重用） */
+    bool contains(const std::string& key) const;
+
+    /** 当前失效代数；执行前取得，store 时代数已变化说明执行期间有写入，结果不入缓存 */
+    uint64_t generation() const;
+
+    /**
+     * 存入结果。paths 为调用依赖的绝对路径（ToolEffects::paths），为空表示依赖整个项目；
+     * costMs 为本次执行耗时（命中时计入 savedMs）；speculative 表示预取结果，不覆盖已有条目
+     */
+    void store(const std::string& key, const nlohmann::json& result, const std::vector<std::string>& paths,
+               double costMs, uint64_t generationAtStart, bool speculative = false);
+
+    /** 使依赖这些路径（或其子路径 / 父目录）的条目失效 */
+    void invalidatePaths(const std::vector<std::string>& paths);
+    void invalidateAll();
+
+    Stats getStats() const;
+    size_t size() const;
+
+private:
+    struct Fingerprint {
+        std::string path;
+        bool exists = false;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        uint64_t tree = 0;  // 目录：其下各项路径 / mtime / 大小的哈希
+    };
+    struct Entry {
+        nlohmann::json result;
+        std::vector<Fingerprint> deps;
+        bool wholeProject = false;
+        size_t bytes = 0;
+        double costMs = 0.0;
+        bool speculative = false;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    Options options;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;  // 前端为最近使用
+    size_t totalBytes = 0;
+    size_t speculativeBytes = 0;
+    uint64_t gen = 0;
+    Stats stats;
+    // 目录路径 -> 目录树指纹；失效时按路径清除，遍历期间代数变化则不记入
+    std::unordered_map<std::string, uint64_t> treeStamps;
+
+    Fingerprint fingerprint(const std::string& path);
+    uint64_t treeStamp(const std::string& key, const std::filesystem::path& dir);
+    uint64_t walkTree(const std::filesystem::path& dir) const;
+    static size_t estimateBytes(const nlohmann::json& value);
+    void eraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+};
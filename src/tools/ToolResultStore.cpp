@@ -0,0 +1,348 @@
+#include "ToolResultStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 截掉末尾不完整的 UTF-8 序列，返回可保留的长度
+size_t completeUtf8Prefix(const std::string& s) {
+    const size_t n = s.size();
+    size_t i = n;
+    size_t continuation = 0;
+    while (i > 0 && continuation < 4 && (static_cast<unsigned char>(s[i - 1]) & 0xC0) == 0x80) {
+        --i;
+        ++continuation;
+    }
+    if (i == 0) return n;
+    const unsigned char lead = static_cast<unsigned char>(s[i - 1]);
+    size_t need = 1;
+    if ((lead >> 5) == 0x6) need = 2;
+    else if ((lead >> 4) == 0xE) need = 3;
+    else if ((lead >> 3) == 0x1E) need = 4;
+    return continuation + 1 >= need ? n : i - 1;
+}
+
+std::string newSessionName() {
+    std::time_t now = std::time(nullptr);
+    std::tm tmNow{};
+#ifdef _WIN32
+    localtime_s(&tmNow, &now);
+#else
+    localtime_r(&now, &tmNow);
+#endif
+    std::random_device rd;
+    std::ostringstream ss;
+    ss << "session-" << std::put_time(&tmNow, "%Y%m%d-%H%M%S") << "-" << std::hex << (rd() & 0xFFFFFF);
+    return ss.str();
+}
+
+// 会话目录中记录所属进程的文件：进程仍在运行的会话不论多久未写入都不清理
+const char* const kOwnerFile = "owner.pid";
+
+long currentPid() {
+#ifdef _WIN32
+    return static_cast<long>(_getpid());
+#else
+    return static_cast<long>(getpid());
+#endif
+}
+
+bool ownerAlive(const fs::path& sessionDir) {
+    std::ifstream in(sessionDir / kOwnerFile);
+    long pid = 0;
+    if (!(in >> pid) || pid <= 0) return false;
+    if (pid == currentPid()) return true;
+#ifdef _WIN32
+    return false;  // 无法探测时按目录 mtime 判断（每次写入与读取都会刷新）
+#else
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+size_t countNewlines(const char* data, size_t size) {
+    size_t n = 0;
+    const char* end = data + size;
+    while (data < end) {
+        const void* hit = std::memchr(data, '\n', static_cast<size_t>(end - data));
+        if (!hit) break;
+        ++n;
+        data = static_cast<const char*>(hit) + 1;
+    }
+    return n;
+}
+
+}  // namespace
+
+ToolResultStore::ToolResultStore(const std::string& baseDir) : ToolResultStore(baseDir, Options()) {}
+
+ToolResultStore::ToolResultStore(const std::string& baseDir, Options opts) : options(opts) {
+    fs::path base = fs::u8path(baseDir);
+    std::error_code ec;
+    // 清理异常退出遗留的旧会话目录：所属进程已退出且 24 小时未写入 / 读取
+    if (fs::is_directory(base, ec)) {
+        const auto cutoff = fs::file_time_type::clock::now() - std::chrono::hours(24);
+        for (fs::directory_iterator it(base, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->path().filename().string().rfind("session-", 0) != 0) continue;
+            std::error_code timeEc;
+            auto mtime = fs::last_write_time(it->path(), timeEc);
+            if (!timeEc && mtime < cutoff && !ownerAlive(it->path())) {
+                std::error_code rmEc;
+                fs::remove_all(it->path(), rmEc);
+            }
+        }
+    }
+    sessionDir = base / newSessionName();
+}
+
+ToolResultStore::~ToolResultStore() {
+    std::error_code ec;
+    fs::remove_all(sessionDir, ec);
+}
+
+std::string ToolResultStore::store(const std::string& toolName, const std::string& text) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::error_code ec;
+    if (fs::create_directories(sessionDir, ec)) {
+        std::ofstream(sessionDir / kOwnerFile) << currentPid();
+    }
+    touchLocked();
+    const std::string handle = "r" + std::to_string(nextHandle++);
+    Entry entry;
+    entry.file = sessionDir / (handle + ".txt");
+    entry.toolName = toolName;
+    entry.bytes = text.size();
+    {
+        std::ofstream out(entry.file, std::ios::binary | std::ios::trunc);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!out) {
+            fs::remove(entry.file, ec);
+            return "";
+        }
+    }
+
+    entry.lineIndex.push_back(0);
+    const char* data = text.data();
+    const char* end = data + text.size();
+    const char* p = data;
+    size_t line = 0;
+    while (p < end) {
+        const void* hit = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        if (!hit) break;
+        p = static_cast<const char*>(hit) + 1;
+        ++line;
+        if (line % kLineStride == 0 && p < end) entry.lineIndex.push_back(static_cast<uint64_t>(p - data));
+    }
+    entry.lines = line + (text.empty() || text.back() == '\n' ? 0 : 1);
+
+    stats.stored++;
+    stats.bytesStored += entry.bytes;
+    stats.bytesOnDisk += entry.bytes;
+    entries.emplace(handle, std::move(entry));
+    order.push_back(handle);
+    evictLocked();
+    return handle;
+}
+
+void ToolResultStore::touchLocked() const {
+    std::error_code ec;
+    fs::last_write_time(sessionDir, fs::file_time_type::clock::now(), ec);
+}
+
+void ToolResultStore::evictLocked() {
+    // 至少保留刚存入的一条
+    while (stats.bytesOnDisk > options.maxTotalBytes && order.size() > 1) {
+        auto it = entries.find(order.front());
+        order.pop_front();
+        if (it == entries.end()) continue;
+        std::error_code ec;
+        fs::remove(it->second.file, ec);
+        stats.bytesOnDisk -= it->second.bytes;
+        stats.evicted++;
+        entries.erase(it);
+    }
+}
+
+std::string ToolResultStore::buildPreview(const std::string& handle, const Entry& entry, const std::string& text) const {
+    const size_t headBudget = options.previewBytes * 3 / 4;
+    const size_t tailBudget = options.previewBytes - headBudget;
+
+    // 开头按整行截取；第一行就超出预算时按字节截断
+    size_t headEnd = 0;
+    while (headEnd < text.size()) {
+        size_t nl = text.find('\n', headEnd);
+        size_t next = nl == std::string::npos ? text.size() : nl + 1;
+        if (next > headBudget) break;
+        headEnd = next;
+    }
+    bool headCut = false;
+    if (headEnd == 0) {
+        headEnd = completeUtf8Prefix(text.substr(0, std::min(headBudget, text.size())));
+        headCut = true;
+    }
+    // 结尾同样按整行
+    size_t tailStart = text.size();
+    while (tailStart > headEnd) {
+        size_t searchFrom = tailStart >= 2 ? tailStart - 2 : 0;
+        size_t nl = tailStart >= 2 ? text.rfind('\n', searchFrom) : std::string::npos;
+        size_t prev = nl == std::string::npos ? 0 : nl + 1;
+        if (text.size() - prev > tailBudget || prev < headEnd) break;
+        tailStart = prev;
+    }
+
+    const size_t headLines = countNewlines(text.data(), headEnd) + (headCut ? 1 : 0);
+    const size_t tailLines = tailStart < text.size() ? entry.lines - countNewlines(text.data(), tailStart) : 0;
+    std::ostringstream out;
+    out << "[Large output from " << (entry.toolName.empty() ? "tool" : entry.toolName) << " stored as result \""
+        << handle << "\" (" << entry.bytes << " bytes, " << entry.lines << " lines). Showing lines 1-" << headLines;
+    if (tailLines > 0) out << " and " << (entry.lines - tailLines + 1) << "-" << entry.lines;
+    out << ". Use fetch_result {\"handle\":\"" << handle << "\",\"start_line\":" << (headCut ? 1 : headLines + 1)
+        << "} to page through it (max " << kMaxFetchLines << " lines / " << kMaxFetchBytes / 1024
+        << " KB per call), or offset/length for byte ranges.]\n";
+    out << text.substr(0, headEnd);
+    if (headCut) out << "...\n";
+    else if (headEnd > 0 && text[headEnd - 1] != '\n') out << "\n";
+    const size_t firstOmitted = headLines + 1;
+    const size_t lastOmitted = entry.lines - tailLines;
+    if (lastOmitted >= firstOmitted) out << "... [lines " << firstOmitted << "-" << lastOmitted << " omitted] ...\n";
+    out << text.substr(tailStart);
+    return out.str();
+}
+
+std::string ToolResultStore::maybeStore(const std::string& toolName, const std::string& text) {
+    if (options.inlineLimitBytes == 0 || text.size() <= options.inlineLimitBytes) return text;
+    std::string handle = store(toolName, text);
+    if (handle.empty()) return text;
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = entries.find(handle);
+        if (it == entries.end()) return text;
+        entry.toolName = it->second.toolName;
+        entry.bytes = it->second.bytes;
+        entry.lines = it->second.lines;
+    }
+    return buildPreview(handle, entry, text);
+}
+
+nlohmann::json ToolResultStore::fetchLines(const std::string& handle, size_t startLine, size_t lineCount) const {
+    fs::path file;
+    size_t totalLines = 0;
+    uint64_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = entries.find(handle);
+        if (it == entries.end()) return {{"error", "Unknown or expired result handle: " + handle}};
+        stats.fetches++;
+        touchLocked();
+        const Entry& entry = it->second;
+        if (startLine == 0) startLine = 1;
+        if (startLine > entry.lines) {
+            return {{"error", "start_line " + std::to_string(startLine) + " is beyond the end of " + handle + " (" +
+                                  std::to_string(entry.lines) + " lines)"}};
+        }
+        file = entry.file;
+        totalLines = entry.lines;
+        offset = entry.lineIndex[(startLine - 1) / kLineStride];
+    }
+    if (lineCount == 0 || lineCount > kMaxFetchLines) lineCount = kMaxFetchLines;
+
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return {{"error", "Result " + handle + " is no longer available"}};
+    in.seekg(static_cast<std::streamoff>(offset));
+    std::string line;
+    for (size_t skip = (startLine - 1) % kLineStride; skip > 0; --skip) {
+        if (!std::getline(in, line)) return {{"error", "Result " + handle + " is truncated"}};
+        offset += line.size() + 1;
+    }
+
+    std::string text;
+    size_t endLine = startLine - 1;
+    bool lineTruncated = false;
+    while (endLine - (startLine - 1) < lineCount && std::getline(in, line)) {
+        const bool hasNewline = !in.eof();
+        if (text.size() + line.size() + 1 > kMaxFetchBytes) {
+            if (!text.empty()) break;
+            // 单行超过上限（如压缩过的 JSON）：截断该行，提示改用字节区间
+            line.resize(kMaxFetchBytes);
+            line.resize(completeUtf8Prefix(line));
+            text = line + "\n";
+            lineTruncated = true;
+            ++endLine;
+            break;
+        }
+        text += line;
+        if (hasNewline) text += '\n';
+        offset += line.size() + 1;
+        ++endLine;
+    }
+
+    nlohmann::json result = {{"text", text},
+                             {"start_line", startLine},
+                             {"end_line", endLine},
+                             {"total_lines", totalLines}};
+    if (lineTruncated) {
+        result["line_truncated"] = true;
+        result["line_offset"] = offset;
+    }
+    if (endLine < totalLines) result["next_line"] = endLine + 1;
+    return result;
+}
+
+nlohmann::json ToolResultStore::fetchBytes(const std::string& handle, uint64_t offset, size_t length) const {
+    fs::path file;
+    uint64_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = entries.find(handle);
+        if (it == entries.end()) return {{"error", "Unknown or expired result handle: " + handle}};
+        stats.fetches++;
+        touchLocked();
+        file = it->second.file;
+        total = it->second.bytes;
+    }
+    if (offset >= total) {
+        return {{"error", "offset " + std::to_string(offset) + " is beyond the end of " + handle + " (" +
+                              std::to_string(total) + " bytes)"}};
+    }
+    if (length == 0 || length > kMaxFetchBytes) length = kMaxFetchBytes;
+    const size_t want = static_cast<size_t>(std::min<uint64_t>(length, total - offset));
+
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return {{"error", "Result " + handle + " is no longer available"}};
+    in.seekg(static_cast<std::streamoff>(offset));
+    std::string text(want, '\0');
+    in.read(&text[0], static_cast<std::streamsize>(want));
+    text.resize(static_cast<size_t>(in.gcount()));
+
+    // 对齐到 UTF-8 字符边界：跳过开头的续字节，去掉结尾不完整的字符
+    size_t lead = 0;
+    while (lead < text.size() && lead < 3 && (static_cast<unsigned char>(text[lead]) & 0xC0) == 0x80) ++lead;
+    text.erase(0, lead);
+    if (offset + lead + text.size() < total) text.resize(completeUtf8Prefix(text));
+    const uint64_t start = offset + lead;
+    const uint64_t next = start + text.size();
+
+    nlohmann::json result = {{"text", text}, {"offset", start}, {"length", text.size()}, {"total_bytes", total}};
+    if (next < total) result["next_offset"] = next;
+    return result;
+}
+
+ToolResultStore::Stats ToolResultStore::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
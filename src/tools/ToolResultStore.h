@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/**
+ * 工具大结果的会话级外置存储。
+ * 超过 inlineLimitBytes 的工具输出写入 <baseDir>/<session>/<handle>.txt，对话中只保留头尾预览与 handle，
+ * 模型通过 fetch_result 按行或字节区间分页读取，请求体与内存占用不随工具输出增长。
+ * - 行索引是稀疏的（每 kLineStride 行记一个偏移），按行读取时从最近的索引点向后扫描
+ * - 会话目录总大小超过 maxTotalBytes 时按存入顺序删除最旧的结果（handle 随之失效）
+ * - 析构时删除本会话目录；构造时清理所属进程已退出、且 24 小时未写入或读取的遗留会话目录
+ *   （会话目录内记录 owner.pid，每次存入 / 读取刷新目录 mtime）
+ * 线程安全（并行工具执行可同时 fetch）。
+ */
+class ToolResultStore {
+public:
+    struct Options {
+        /** 超过该字节数的结果外置存储；0 表示不外置 */
+        size_t inlineLimitBytes = 16 * 1024;
+        /** 对话中保留的预览大小（约 3/4 取开头、1/4 取结尾，按整行截取） */
+        size_t previewBytes = 2048;
+        /** 会话目录的磁盘上限 */
+        uint64_t maxTotalBytes = 256ull * 1024 * 1024;
+    };
+
+    static constexpr size_t kLineStride = 256;
+    /** 单次 fetch 的上限 */
+    static constexpr size_t kMaxFetchLines = 400;
+    static constexpr size_t kMaxFetchBytes = 32 * 1024;
+
+    explicit ToolResultStore(const std::string& baseDir);
+    ToolResultStore(const std::string& baseDir, Options options);
+    ~ToolResultStore();
+
+    ToolResultStore(const ToolResultStore&) = delete;
+    ToolResultStore& operator=(const ToolResultStore&) = delete;
+
+    /** 小结果原样返回；大结果存盘并返回「预览 + handle + fetch_result 用法」；存盘失败时原样返回 */
+    std::string maybeStore(const std::string& toolName, const std::string& text);
+
+    /** 存入一段文本，返回 handle（如 "r3"）；失败返回空串 */
+    std::string store(const std::string& toolName, const std::string& text);
+
+    /**
+     * 读取 [startLine, startLine + lineCount) 行（1 起）。
+     * 返回 {"text", "start_line", "end_line", "total_lines", "next_line"(有剩余时)} 或 {"error"}
+     */
+    nlohmann::json fetchLines(const std::string& handle, size_t startLine, size_t lineCount) const;
+    /** 读取 [offset, offset + length) 字节（边界对齐到 UTF-8 字符）；返回 {"text", "offset", "length", "total_bytes", "next_offset"} 或 {"error"} */
+    nlohmann::json fetchBytes(const std::string& handle, uint64_t offset, size_t length) const;
+
+    struct Stats {
+        size_t stored = 0;        // 外置的结果数
+        uint64_t bytesStored = 0; // 累计外置字节
+        uint64_t bytesOnDisk = 0; // 当前占用
+        size_t evicted = 0;       // 因超出磁盘上限被删除的结果数
+        size_t fetches = 0;
+    };
+    Stats getStats() const;
+    const Options& getOptions() const { return options; }
+    std::filesystem::path getSessionDir() const { return sessionDir; }
+
+private:
+    struct Entry {
+        std::filesystem::path file;
+        std::string toolName;
+        uint64_t bytes = 0;
+        size_t lines = 0;
+        std::vector<uint64_t> lineIndex;  // lineIndex[k] = 第 k * kLineStride 行（0 起）的字节偏移
+    };
+
+    Options options;
+    std::filesystem::path sessionDir;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, Entry> entries;
+    std::deque<std::string> order;  // 存入顺序，用于淘汰
+    size_t nextHandle = 1;
+    mutable Stats stats;
+
+    std::string buildPreview(const std::string& handle, const Entry& entry, const std::string& text) const;
+    void evictLocked();
+    /** 刷新会话目录 mtime，标记会话仍在使用 */
+    void touchLocked() const;
+};
@@ -0,0 +1,192 @@
+#include "ToolScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace {
+
+thread_local bool tlsOnToolWorker = false;
+
+double msSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+nlohmann::json runGuarded(const ToolScheduler::Call& call) {
+    try {
+        return call.run ? call.run() : nlohmann::json{{"error", "Tool call has nothing to run"}};
+    } catch (const std::exception& e) {
+        return {{"error", std::string("Tool execution failed: ") + e.what()}};
+    } catch (...) {
+        return {{"error", "Tool execution failed"}};
+    }
+}
+
+}  // namespace
+
+struct ToolScheduler::Batch {
+    std::vector<Call> calls;
+    std::vector<nlohmann::json> results;
+    std::vector<size_t> pendingDeps;              // 尚未完成的冲突前驱数
+    std::vector<std::vector<size_t>> dependents;  // 完成后需要通知的后继
+    size_t done = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+ToolScheduler::ToolScheduler(size_t workers) : workerCount(workers) {
+    if (workerCount == 0) {
+        workerCount = std::min<size_t>(8, std::max(1u, std::thread::hardware_concurrency()));
+    }
+}
+
+ToolScheduler::~ToolScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers) {
+        if (t.joinable()) t.join();
+    }
+}
+
+bool ToolScheduler::conflicts(const ToolEffects& a, const ToolEffects& b) {
+    using Kind = ToolEffects::Kind;
+    if (a.kind == Kind::Process || b.kind == Kind::Process) return true;
+    if (a.kind == Kind::ReadOnly && b.kind == Kind::ReadOnly) return false;
+    if (a.paths.empty() || b.paths.empty()) return true;
+    for (const auto& pa : a.paths) {
+        for (const auto& pb : b.paths) {
+            if (ToolEffects::pathsOverlap(pa, pb)) return true;
+        }
+    }
+    return false;
+}
+
+void ToolScheduler::ensureWorkers() {
+    // 调用方持有 mtx
+    if (!workers.empty()) return;
+    for (size_t i = 0; i < workerCount; ++i) workers.emplace_back([this] { workerLoop(); });
+}
+
+void ToolScheduler::workerLoop() {
+    tlsOnToolWorker = true;
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping && queue.empty()) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job();
+    }
+}
+
+void ToolScheduler::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ensureWorkers();
+        queue.push_back(std::move(job));
+    }
+    cv.notify_one();
+}
+
+void ToolScheduler::runOne(const std::shared_ptr<Batch>& batch, size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.maxConcurrent = std::max(stats.maxConcurrent, ++running);
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    nlohmann::json result = runGuarded(batch->calls[index]);
+    const double ms = msSince(t0);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        --running;
+        stats.busyMs += ms;
+    }
+
+    std::vector<size_t> ready;
+    {
+        std::lock_guard<std::mutex> lock(batch->mtx);
+        batch->results[index] = std::move(result);
+        batch->done++;
+        for (size_t next : batch->dependents[index]) {
+            if (--batch->pendingDeps[next] == 0) ready.push_back(next);
+        }
+    }
+    for (size_t next : ready) enqueue([this, batch, next] { runOne(batch, next); });
+    batch->cv.notify_all();
+}
+
+std::vector<nlohmann::json> ToolScheduler::runBatch(std::vector<Call> calls) {
+    const size_t n = calls.size();
+    const auto t0 = std::chrono::steady_clock::now();
+    size_t earlyUsed = 0, earlyDiscarded = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!calls[i].early) continue;
+        bool dependsOnEarlier = false;
+        for (size_t j = 0; j < i && !dependsOnEarlier; ++j) {
+            dependsOnEarlier = conflicts(calls[j].effects, calls[i].effects);
+        }
+        if (dependsOnEarlier) {
+            ++earlyDiscarded;
+        } else {
+            calls[i].run = std::move(calls[i].early);
+            ++earlyUsed;
+        }
+        calls[i].early = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.batches++;
+        stats.calls += n;
+        stats.earlyUsed += earlyUsed;
+        stats.earlyDiscarded += earlyDiscarded;
+    }
+
+    // 单个调用或在 worker 上嵌套调用：按顺序内联执行
+    if (n <= 1 || tlsOnToolWorker) {
+        std::vector<nlohmann::json> results;
+        results.reserve(n);
+        for (const auto& call : calls) results.push_back(runGuarded(call));
+        const double ms = msSince(t0);
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.busyMs += ms;
+        stats.wallMs += ms;
+        stats.maxConcurrent = std::max<size_t>(stats.maxConcurrent, n > 0 ? 1 : 0);
+        return results;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->calls = std::move(calls);
+    batch->results.resize(n);
+    batch->pendingDeps.assign(n, 0);
+    batch->dependents.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (conflicts(batch->calls[j].effects, batch->calls[i].effects)) {
+                batch->pendingDeps[i]++;
+                batch->dependents[j].push_back(i);
+            }
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (batch->pendingDeps[i] == 0) enqueue([this, batch, i] { runOne(batch, i); });
+    }
+    {
+        std::unique_lock<std::mutex> lock(batch->mtx);
+        batch->cv.wait(lock, [&] { return batch->done == n; });
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.wallMs += msSince(t0);
+    }
+    return std::move(batch->results);
+}
+
+ToolScheduler::Stats ToolScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
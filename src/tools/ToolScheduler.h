@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "ITool.h"
+
+/**
+ * @brief 同一批工具调用的依赖感知并行执行器
+ *
+ * 模型一条消息里常带多个 tool_call（如 6 个 read_code_block + 2 个 grep），互不冲突的调用应同时执行。
+ * 按各调用声明的 ToolEffects 建立依赖：调用 i 须等待所有与之冲突的先前调用 j < i 完成，
+ * 因此写入与读写同一路径的调用保持模型给出的顺序，只读调用之间完全并发，Process 调用独占执行。
+ * 结果按调用顺序返回，写回 messages 的顺序与 tool_calls 一致。
+ * 调用可附带 early（流式阶段已提前开始的只读执行）：它早于本批任何调用运行，因此只有当没有更早的调用与之冲突时
+ * 才采用；否则丢弃，按依赖顺序执行 run。
+ * worker 线程在首次提交时才启动；worker 上嵌套调用 runBatch 时按顺序内联执行。线程安全。
+ */
+class ToolScheduler {
+public:
+    struct Call {
+        ToolEffects effects;
+        std::function<nlohmann::json()> run;
+        std::function<nlohmann::json()> early;  // 可选：取提前执行的结果
+    };
+
+    struct Stats {
+        size_t batches = 0;
+        size_t calls = 0;
+        size_t earlyUsed = 0;       // 采用的提前结果
+        size_t earlyDiscarded = 0;  // 因更早的冲突调用而丢弃的提前结果
+        size_t maxConcurrent = 0;  // 同时执行的调用数峰值
+        double busyMs = 0.0;       // 各调用耗时之和
+        double wallMs = 0.0;       // 各批次实际耗时之和（busyMs - wallMs 即并行节省的时间）
+    };
+
+    /** workers 为 0 时取 min(8, 硬件线程数) */
+    explicit ToolScheduler(size_t workers = 0);
+    ~ToolScheduler();
+
+    ToolScheduler(const ToolScheduler&) = delete;
+    ToolScheduler& operator=(const ToolScheduler&) = delete;
+
+    /** 执行一批调用并按顺序返回结果；调用抛出异常时对应结果为 {"error"} */
+    std::vector<nlohmann::json> runBatch(std::vector<Call> calls);
+
+    /** 两个调用是否必须按顺序执行 */
+    static bool conflicts(const ToolEffects& a, const ToolEffects& b);
+
+    Stats getStats() const;
+
+private:
+    struct Batch;
+
+    size_t workerCount;
+    std::vector<std::thread> workers;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> queue;
+    bool stopping = false;
+    size_t running = 0;
+    Stats stats;
+
+    void ensureWorkers();
+    void workerLoop();
+    void enqueue(std::function<void()> job);
+    void runOne(const std::shared_ptr<Batch>& batch, size_t index);
+};
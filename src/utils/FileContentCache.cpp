@@ -0,0 +1,137 @@
+#include "FileContentCache.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+size_t FileContentCache::File::lineCount() const {
+    ensureIndex();
+    return lineStarts.size();
+}
+
+std::string_view FileContentCache::File::line(size_t n) const {
+    ensureIndex();
+    if (n == 0 || n > lineStarts.size()) return {};
+    size_t begin = lineStarts[n - 1];
+    size_t end = n < lineStarts.size() ? lineStarts[n] - 1 : content.size();
+    // 最后一行：去掉文件末尾的换行（索引不为末尾换行之后开新行）
+    if (n == lineStarts.size() && end > begin && content[end - 1] == '\n') --end;
+    if (end > begin && content[end - 1] == '\r') --end;
+    return std::string_view(content.data() + begin, end - begin);
+}
+
+void FileContentCache::File::ensureIndex() const {
+    std::call_once(indexOnce, [this] {
+        if (content.empty()) return;
+        const char* data = content.data();
+        const char* end = data + content.size();
+        lineStarts.push_back(0);
+        for (const char* p = data; p < end;) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!nl || nl + 1 == end) break;
+            lineStarts.push_back(static_cast<size_t>(nl + 1 - data));
+            p = nl + 1;
+        }
+    });
+}
+
+FileContentCache::FileContentCache(Options opts) : options(opts) {}
+
+FileContentCache& FileContentCache::getInstance() {
+    static FileContentCache instance;
+    return instance;
+}
+
+std::string FileContentCache::makeKey(const fs::path& path) {
+    return path.lexically_normal().generic_u8string();
+}
+
+std::shared_ptr<const FileContentCache::File> FileContentCache::get(const fs::path& path) {
+    std::error_code ec;
+    const std::uintmax_t size = fs::file_size(path, ec);
+    if (ec) return nullptr;
+    const fs::file_time_type mtime = fs::last_write_time(path, ec);
+    if (ec) return nullptr;
+    const std::string key = makeKey(path);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            if (it->second.file->fileSize == size && it->second.file->mtime == mtime) {
+                stats.hits++;
+                lru.splice(lru.begin(), lru, it->second.lruIt);
+                return it->second.file;
+            }
+            eraseLocked(it);
+        }
+        stats.misses++;
+    }
+
+    auto file = std::make_shared<File>();
+    file->fileSize = size;
+    file->mtime = mtime;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return nullptr;
+        file->content.resize(static_cast<size_t>(size));
+        in.read(&file->content[0], static_cast<std::streamsize>(size));
+        // 读取期间文件变短：按实际读到的长度；下次 get 时 size / mtime 不同会重新读取
+        file->content.resize(static_cast<size_t>(in.gcount()));
+    }
+
+    const bool racy = fs::file_time_type::clock::now() - mtime < std::chrono::seconds(2);
+    if (racy || file->content.size() > options.maxFileBytes || file->content.size() > options.maxBytes) return file;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(key);
+    if (it != entries.end()) eraseLocked(it);  // 并发读取同一文件：保留后读到的版本
+    lru.push_front(key);
+    entries[key] = {file, lru.begin()};
+    totalBytes += file->content.size();
+    evictLocked();
+    return file;
+}
+
+void FileContentCache::invalidate(const fs::path& path) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(makeKey(path));
+    if (it != entries.end()) eraseLocked(it);
+}
+
+void FileContentCache::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries.clear();
+    lru.clear();
+    totalBytes = 0;
+}
+
+void FileContentCache::setMaxBytes(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    options.maxBytes = maxBytes;
+    evictLocked();
+}
+
+FileContentCache::Stats FileContentCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    Stats out = stats;
+    out.entries = entries.size();
+    out.bytes = totalBytes;
+    return out;
+}
+
+void FileContentCache::eraseLocked(std::unordered_map<std::string, Entry>::iterator it) {
+    totalBytes -= it->second.file->content.size();
+    lru.erase(it->second.lruIt);
+    entries.erase(it);
+}
+
+void FileContentCache::evictLocked() {
+    while (totalBytes > options.maxBytes && !lru.empty()) {
+        auto it = entries.find(lru.back());
+        if (it == entries.end()) {
+            lru.pop_back();
+            continue;
+        }
+        eraseLocked(it);
+        stats.evictions++;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/**
+ * 进程内共享的文件内容缓存 + 懒建的行偏移索引
+ *
+ * read_code_block 的按行读取、符号扫描、extractCalls、LSP didOpen、语义索引、diff 预览原先各自整文件读入
+ * （readLineRange 还逐行 getline 成 vector<string>），同一文件在一轮对话中被读多次。这里统一：
+ * - 以路径为键，命中时用 (size, mtime) 校验；文件变化后自动重新读取
+ * - 内容一次性读入连续缓冲区；行偏移索引在第一次按行访问时建立，之后任意行范围为 O(范围)
+ * - 按内容字节数计预算，超出时淘汰最久未使用的文件；返回的快照为 shared_ptr，淘汰不影响正在使用者
+ * - mtime 距读取时刻不足 2 秒的文件不入缓存（同 git 的 racy-clean 处理）：防止在同一时间戳内再次修改、
+ *   且大小不变时返回旧内容
+ * 不使用 mmap：缓存条目长期存活，编辑器 / apply_patch 原地截断文件时，访问映射会触发 SIGBUS。
+ * 线程安全。
+ */
+class FileContentCache {
+public:
+    struct Options {
+        size_t maxBytes = 64u * 1024 * 1024;      // 缓存内容的总字节上限
+        size_t maxFileBytes = 16u * 1024 * 1024;  // 更大的文件照常读取但不入缓存
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    /** 某一时刻的文件内容（不可变） */
+    class File {
+    public:
+        const std::string& text() const { return content; }
+        size_t size() const { return content.size(); }
+        /** 行数，与逐行 getline 一致：末尾换行不产生额外空行，空文件为 0 */
+        size_t lineCount() const;
+        /** 第 n 行（1 起），不含换行与行尾 '\r'；越界返回空 */
+        std::string_view line(size_t n) const;
+
+    private:
+        friend class FileContentCache;
+        std::string content;
+        std::uintmax_t fileSize = 0;
+        fs::file_time_type mtime{};
+        mutable std::once_flag indexOnce;
+        mutable std::vector<size_t> lineStarts;  // 每行起始偏移
+
+        void ensureIndex() const;
+    };
+
+    FileContentCache() : FileContentCache(Options()) {}
+    explicit FileContentCache(Options options);
+
+    /** 进程内共享实例 */
+    static FileContentCache& getInstance();
+
+    /** 读取文件（命中且未变化时不读盘）；不存在或无法读取时返回 nullptr */
+    std::shared_ptr<const File> get(const fs::path& path);
+
+    void invalidate(const fs::path& path);
+    void clear();
+    /** 调整预算（0 表示不缓存），超出部分立即淘汰 */
+    void setMaxBytes(size_t maxBytes);
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const File> file;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    Options options;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;  // 头部为最近使用
+    size_t totalBytes = 0;
+    Stats stats;
+
+    static std::string makeKey(const fs::path& path);
+    void eraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+    void evictLocked();
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * 轻量内容哈希（FNV-1a 64 位）。
+ * 用于文件变更检测、embedding 缓存键等「非安全」场景，不可用于密码学用途。
+ */
+inline std::uint64_t fnv1a64(const char* data, std::size_t size) {
+    const std::uint64_t offset = 1469598103934665603ull;
+    const std::uint64_t prime = 1099511628211ull;
+    std::uint64_t hash = offset;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i]));
+        hash *= prime;
+    }
+    return hash;
+}
+
+inline std::uint64_t fnv1a64(const std::string& data) {
+    return fnv1a64(data.data(), data.size());
+}
+
+/** 将 64 位哈希格式化为 16 位十六进制字符串 */
+inline std::string hashToHex(std::uint64_t hash) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+    return std::string(buf);
+}
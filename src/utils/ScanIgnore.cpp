@@ -1,21 +1,23 @@
 #include "ScanIgnore.h"
 #include <regex>
 #include <algorithm>
+#include <cctype>
+#include <mutex>
 
 struct ScanIgnoreRules::Impl {
     std::vector<std::string> patternStrings;
     mutable std::vector<std::regex> compiled;
-    mutable bool compiledDone = false;
+    mutable std::once_flag compiledOnce;  // 并行遍历（GrepEngine）会从多个线程同时查询
 
     void ensureCompiled() const {
-        if (compiledDone) return;
-        compiledDone = true;
-        for (const auto& s : patternStrings) {
-            try {
-                compiled.emplace_back(s, std::regex::ECMAScript);
-            } catch (...) {}
-            // 无效正则则跳过该条
-        }
+        std::call_once(compiledOnce, [this] {
+            for (const auto& s : patternStrings) {
+                try {
+                    compiled.emplace_back(s, std::regex::ECMAScript);
+                } catch (...) {}
+                // 无效正则则跳过该条
+            }
+        });
     }
 };
 
@@ -46,3 +48,26 @@ bool ScanIgnoreRules::shouldIgnore(const fs::path& path) const {
     }
     return false;
 }
+
+std::vector<std::string> ScanIgnoreRules::literalNames() const {
+    static const std::string kMeta = ".^$*+?()[]{}|";
+    std::vector<std::string> names;
+    for (const auto& pattern : impl_->patternStrings) {
+        std::string name;
+        bool literal = !pattern.empty();
+        for (size_t i = 0; i < pattern.size() && literal; ++i) {
+            char c = pattern[i];
+            if (c == '\\') {
+                // 只接受转义的标点（\. \-），\d \w 等字符类不是字面量
+                if (i + 1 >= pattern.size() || std::isalnum(static_cast<unsigned char>(pattern[i + 1]))) literal = false;
+                else name += pattern[++i];
+            } else if (kMeta.find(c) != std::string::npos || c == '/') {
+                literal = false;
+            } else {
+                name += c;
+            }
+        }
+        if (literal && !name.empty() && name.find('/') == std::string::npos) names.push_back(name);
+    }
+    return names;
+}
@@ -21,6 +21,13 @@ public:
 
     bool shouldIgnore(const fs::path& path) const;
 
+    /**
+     * 可安全转换为外部搜索工具排除项（rg -g '!name' / grep --exclude-dir=name）的名字：
+     * 去掉转义后不含正则元字符与 '/' 的规则（如 "build"、"\\.git" -> ".git"）。
+     * 按名字排除的范围不超过 shouldIgnore 的子串匹配，其余规则仍需对结果逐条过滤。
+     */
+    std::vector<std::string> literalNames() const;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
@@ -0,0 +1,501 @@
+#include "utils/Tokenizer.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t kNoRank = std::numeric_limits<uint32_t>::max();
+// count() 的片段缓存上限（每线程）；满了整体清空
+constexpr size_t kPieceCacheLimit = 1 << 16;
+std::atomic<uint64_t> nextVocabId{1};
+
+enum class CharClass { Letter, Number, Space, Newline, Mark, Other };
+enum class LetterCase { Upper, Lower, Caseless };
+
+struct ClassRange {
+    uint32_t lo, hi;
+    CharClass cls;
+};
+
+// 非 ASCII 码点中不是字母的区间（按起点排序）；未列出的一律视为字母（\p{L}）。Mark 为组合符号（\p{M}）：
+// cl100k 按 Other 处理，o200k 归入字母串
+const ClassRange kNonLetterRanges[] = {
+    {0x0080, 0x0084, CharClass::Other},   {0x0085, 0x0085, CharClass::Space},  {0x0086, 0x009F, CharClass::Other},
+    {0x00A0, 0x00A0, CharClass::Space},   {0x00A1, 0x00A9, CharClass::Other},  {0x00AB, 0x00B1, CharClass::Other},
+    {0x00B2, 0x00B3, CharClass::Number},  {0x00B4, 0x00B4, CharClass::Other},  {0x00B6, 0x00B8, CharClass::Other},
+    {0x00B9, 0x00B9, CharClass::Number},  {0x00BB, 0x00BB, CharClass::Other},  {0x00BC, 0x00BE, CharClass::Number},
+    {0x00BF, 0x00BF, CharClass::Other},   {0x00D7, 0x00D7, CharClass::Other},  {0x00F7, 0x00F7, CharClass::Other},
+    {0x02C2, 0x02C5, CharClass::Other},   {0x02D2, 0x02DF, CharClass::Other},  {0x0300, 0x036F, CharClass::Mark},
+    {0x0483, 0x0489, CharClass::Mark},    {0x0591, 0x05C7, CharClass::Mark},   {0x0610, 0x061A, CharClass::Mark},
+    {0x064B, 0x065F, CharClass::Mark},    {0x0660, 0x0669, CharClass::Number}, {0x06F0, 0x06F9, CharClass::Number},
+    {0x0900, 0x0903, CharClass::Mark},    {0x093A, 0x094F, CharClass::Mark},  {0x0966, 0x096F, CharClass::Number},
+    {0x1680, 0x1680, CharClass::Space},   {0x2000, 0x200A, CharClass::Space},  {0x200B, 0x2027, CharClass::Other},
+    {0x2028, 0x2029, CharClass::Space},   {0x202A, 0x202E, CharClass::Other},  {0x202F, 0x202F, CharClass::Space},
+    {0x2030, 0x205E, CharClass::Other},   {0x205F, 0x205F, CharClass::Space},  {0x2060, 0x206F, CharClass::Other},
+    {0x2070, 0x2070, CharClass::Number},  {0x2074, 0x2079, CharClass::Number}, {0x207A, 0x207E, CharClass::Other},
+    {0x2080, 0x2089, CharClass::Number},  {0x208A, 0x208E, CharClass::Other},  {0x20A0, 0x20FF, CharClass::Other},
+    {0x2100, 0x2101, CharClass::Other},   {0x2150, 0x2182, CharClass::Number}, {0x2190, 0x245F, CharClass::Other},
+    {0x2460, 0x249B, CharClass::Number},  {0x249C, 0x24E9, CharClass::Other},  {0x24EA, 0x24FF, CharClass::Number},
+    {0x2500, 0x2775, CharClass::Other},   {0x2776, 0x2793, CharClass::Number}, {0x2794, 0x2BFF, CharClass::Other},
+    {0x2E00, 0x2E7F, CharClass::Other},   {0x3000, 0x3000, CharClass::Space},  {0x3001, 0x3004, CharClass::Other},
+    {0x3007, 0x3007, CharClass::Number},  {0x3008, 0x3020, CharClass::Other},  {0x3021, 0x3029, CharClass::Number},
+    {0x302A, 0x3030, CharClass::Other},   {0x303D, 0x303F, CharClass::Other},  {0x3099, 0x309A, CharClass::Mark},
+    {0x309B, 0x309C, CharClass::Other},
+    {0x30FB, 0x30FB, CharClass::Other},   {0x3200, 0x33FF, CharClass::Other},  {0xD800, 0xF8FF, CharClass::Other},
+    {0xFE00, 0xFE0F, CharClass::Mark},    {0xFE10, 0xFE1F, CharClass::Other},  {0xFE20, 0xFE2F, CharClass::Mark},
+    {0xFE30, 0xFE6F, CharClass::Other},
+    {0xFEFF, 0xFEFF, CharClass::Other},   {0xFF01, 0xFF0F, CharClass::Other},  {0xFF10, 0xFF19, CharClass::Number},
+    {0xFF1A, 0xFF20, CharClass::Other},   {0xFF3B, 0xFF40, CharClass::Other},  {0xFF5B, 0xFF65, CharClass::Other},
+    {0xFFE0, 0xFFFF, CharClass::Other},   {0x1F000, 0x1FAFF, CharClass::Other}, {0xE0000, 0x10FFFF, CharClass::Other},
+};
+
+CharClass classifyNonAscii(uint32_t cp) {
+    const auto* begin = std::begin(kNonLetterRanges);
+    const auto* end = std::end(kNonLetterRanges);
+    const auto* it = std::upper_bound(begin, end, cp, [](uint32_t v, const ClassRange& r) { return v < r.lo; });
+    if (it != begin && cp <= (it - 1)->hi) return (it - 1)->cls;
+    return CharClass::Letter;
+}
+
+struct CodePoint {
+    CharClass cls;
+    size_t len;
+    uint32_t cp = 0;
+};
+
+// 字母的大小写（o200k 按大小写切分单词）：拉丁、希腊、西里尔按区间近似判定，其余字母（CJK、假名等）无大小写
+LetterCase letterCase(uint32_t cp) {
+    if (cp < 0x80) {
+        if (cp >= 'A' && cp <= 'Z') return LetterCase::Upper;
+        if (cp >= 'a' && cp <= 'z') return LetterCase::Lower;
+        return LetterCase::Caseless;
+    }
+    if (cp >= 0xC0 && cp <= 0xDE) return LetterCase::Upper;
+    if (cp >= 0xDF && cp <= 0xFF) return LetterCase::Lower;
+    if (cp >= 0x100 && cp <= 0x17F) {
+        // 拉丁扩展 A：大小写成对交替，0x139-0x148 与 0x179-0x17E 两段奇数为大写
+        if (cp == 0x138 || cp == 0x149 || cp == 0x17F) return LetterCase::Lower;
+        bool oddUpper = (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E);
+        return ((cp % 2 == 1) == oddUpper) ? LetterCase::Upper : LetterCase::Lower;
+    }
+    if (cp >= 0x386 && cp <= 0x3AB) return LetterCase::Upper;
+    if (cp >= 0x3AC && cp <= 0x3CE) return LetterCase::Lower;
+    if (cp >= 0x400 && cp <= 0x42F) return LetterCase::Upper;
+    if (cp >= 0x430 && cp <= 0x45F) return LetterCase::Lower;
+    if (cp >= 0x460 && cp <= 0x4FF) return cp % 2 == 0 ? LetterCase::Upper : LetterCase::Lower;
+    return LetterCase::Caseless;
+}
+
+// 解码 text[i] 起的一个 UTF-8 码点；非法字节按单字节 Other 处理
+CodePoint readCodePoint(std::string_view text, size_t i) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if (c < 0x80) {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) return {CharClass::Letter, 1, c};
+        if (c >= '0' && c <= '9') return {CharClass::Number, 1};
+        if (c == '\r' || c == '\n') return {CharClass::Newline, 1};
+        if (c == ' ' || c == '\t' || c == '\v' || c == '\f') return {CharClass::Space, 1};
+        return {CharClass::Other, 1};
+    }
+    size_t len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    if (len == 1 || i + len > text.size()) return {CharClass::Other, 1};
+    uint32_t cp = c & (0x7F >> len);
+    for (size_t k = 1; k < len; ++k) {
+        unsigned char cc = static_cast<unsigned char>(text[i + k]);
+        if ((cc & 0xC0) != 0x80) return {CharClass::Other, 1};
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    return {classifyNonAscii(cp), len, cp};
+}
+
+bool isWhitespace(CharClass c) { return c == CharClass::Space || c == CharClass::Newline; }
+
+// (?i:'s|'t|'re|'ve|'m|'ll|'d) 在 text[i] 处的匹配长度，0 为不匹配
+size_t contractionLength(std::string_view text, size_t i) {
+    const size_t n = text.size();
+    if (i + 1 >= n || text[i] != '\'') return 0;
+    auto lower = [&](size_t k) { return static_cast<char>(std::tolower(static_cast<unsigned char>(text[k]))); };
+    char a = lower(i + 1);
+    if (a == 's' || a == 't' || a == 'm' || a == 'd') return 2;
+    if (i + 2 < n) {
+        char b = lower(i + 2);
+        if ((a == 'r' && b == 'e') || (a == 'v' && b == 'e') || (a == 'l' && b == 'l')) return 3;
+    }
+    return 0;
+}
+
+int base64Value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+bool base64Decode(std::string_view in, std::string& out) {
+    out.clear();
+    uint32_t buf = 0;
+    int bits = 0;
+    for (char ch : in) {
+        if (ch == '=') break;
+        int v = base64Value(static_cast<unsigned char>(ch));
+        if (v < 0) return false;
+        buf = (buf << 6) | static_cast<uint32_t>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((buf >> bits) & 0xFF));
+        }
+    }
+    return !out.empty();
+}
+
+}  // namespace
+
+struct Tokenizer::Vocab {
+    uint64_t id = nextVocabId++;  // 区分 count() 的线程缓存属于哪个词表
+    std::string name;
+    PreTokenizer rules = PreTokenizer::Cl100k;
+    std::string arena;
+    std::unordered_map<std::string_view, uint32_t> ranks;
+    std::vector<std::string_view> byRank;
+
+    uint32_t rankOf(std::string_view s) const {
+        auto it = ranks.find(s);
+        return it == ranks.end() ? kNoRank : it->second;
+    }
+
+    /**
+     * tiktoken 的 byte_pair_merge：parts[i] = (起始偏移, parts[i] 与 parts[i+1] 合并后的 rank)，
+     * 反复合并 rank 最小的相邻对，直到没有可合并的对。片段通常很短，线性扫描比堆更快。
+     */
+    void merge(std::string_view piece, std::vector<std::pair<size_t, uint32_t>>& parts) const {
+        parts.clear();
+        for (size_t i = 0; i <= piece.size(); ++i) parts.emplace_back(i, kNoRank);
+        auto pairRank = [&](size_t i) -> uint32_t {
+            if (i + 2 >= parts.size()) return kNoRank;
+            return rankOf(piece.substr(parts[i].first, parts[i + 2].first - parts[i].first));
+        };
+        for (size_t i = 0; i + 2 < parts.size(); ++i) parts[i].second = pairRank(i);
+        while (parts.size() > 2) {
+            uint32_t minRank = kNoRank;
+            size_t minIdx = 0;
+            for (size_t i = 0; i + 2 < parts.size(); ++i) {
+                if (parts[i].second < minRank) {
+                    minRank = parts[i].second;
+                    minIdx = i;
+                }
+            }
+            if (minRank == kNoRank) break;
+            parts.erase(parts.begin() + static_cast<std::ptrdiff_t>(minIdx) + 1);
+            parts[minIdx].second = pairRank(minIdx);
+            if (minIdx > 0) parts[minIdx - 1].second = pairRank(minIdx - 1);
+        }
+    }
+};
+
+Tokenizer::Tokenizer() = default;
+Tokenizer::~Tokenizer() = default;
+
+Tokenizer& Tokenizer::getInstance() {
+    static Tokenizer instance;
+    return instance;
+}
+
+bool Tokenizer::loadVocab(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    std::vector<std::pair<std::string, uint32_t>> entries;
+    std::string line, bytes;
+    size_t totalBytes = 0;
+    uint32_t maxRank = 0;
+    while (std::getline(in, line)) {
+        size_t sp = line.find(' ');
+        if (sp == std::string::npos) continue;
+        if (!base64Decode(std::string_view(line).substr(0, sp), bytes)) continue;
+        try {
+            uint32_t rank = static_cast<uint32_t>(std::stoul(line.substr(sp + 1)));
+            if (rank == kNoRank) continue;
+            maxRank = std::max(maxRank, rank);
+            totalBytes += bytes.size();
+            entries.emplace_back(bytes, rank);
+        } catch (...) {}
+    }
+    if (entries.empty()) return false;
+
+    auto v = std::make_shared<Vocab>();
+    v->name = std::filesystem::path(path).filename().string();
+    // o200k_base 约 20 万词项（cl100k_base 约 10 万）；文件名或词表规模任一符合即使用 o200k 的预分词
+    if (v->name.find("o200k") != std::string::npos || maxRank >= 150000) v->rules = PreTokenizer::O200k;
+    v->arena.reserve(totalBytes);  // 预留后不再扩容，string_view 保持有效
+    v->ranks.reserve(entries.size());
+    v->byRank.resize(static_cast<size_t>(maxRank) + 1);
+    for (const auto& [token, rank] : entries) {
+        size_t offset = v->arena.size();
+        v->arena += token;
+        std::string_view view(v->arena.data() + offset, token.size());
+        v->ranks.emplace(view, rank);
+        v->byRank[rank] = view;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    vocab = std::move(v);
+    ++gen;
+    return true;
+}
+
+std::shared_ptr<const Tokenizer::Vocab> Tokenizer::snapshot() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return vocab;
+}
+
+bool Tokenizer::hasVocab() const { return snapshot() != nullptr; }
+
+std::string Tokenizer::vocabName() const {
+    auto v = snapshot();
+    return v ? v->name : "estimate";
+}
+
+Tokenizer::PreTokenizer Tokenizer::preTokenizer() const {
+    auto v = snapshot();
+    return v ? v->rules : PreTokenizer::Cl100k;
+}
+
+uint64_t Tokenizer::generation() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return gen;
+}
+
+/**
+ * 两种词表的预分词正则（tiktoken）：
+ * cl100k_base: (?i:'s|'t|'re|'ve|'m|'ll|'d)|[^\r\n\p{L}\p{N}]?\p{L}+|\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n]*
+ *              |\s*[\r\n]+|\s+(?!\S)|\s+
+ * o200k_base:  [^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]*[\p{Ll}\p{Lm}\p{Lo}\p{M}]+(?i:'s|'t|'re|'ve|'m|'ll|'d)?
+ *              |[^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]+[\p{Ll}\p{Lm}\p{Lo}\p{M}]*(?i:'s|'t|'re|'ve|'m|'ll|'d)?
+ *              |\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n/]*|\s*[\r\n]+|\s+(?!\S)|\s+
+ * o200k 按大小写切分单词（"fooBar" -> "foo" "Bar"），缩写附在单词后，组合符号属于字母串。
+ */
+std::vector<std::string_view> Tokenizer::splitPieces(std::string_view text, PreTokenizer rules) {
+    const bool o200k = rules == PreTokenizer::O200k;
+    auto read = [&](size_t k) {
+        CodePoint cp = readCodePoint(text, k);
+        if (cp.cls == CharClass::Mark) cp.cls = o200k ? CharClass::Letter : CharClass::Other;
+        return cp;
+    };
+    // 组合符号的 cp 不在大小写区间内，按无大小写处理
+    auto caseAt = [&](const CodePoint& cp) { return letterCase(cp.cp); };
+    // o200k 的单词（k 处为字母）：[大写|无大小写]* 后接 [小写|无大小写]+；没有后者时回退到最后一个无大小写字母之后，
+    // 再没有则整段大写为一词（第二个分支）
+    auto o200kWordEnd = [&](size_t k) {
+        const size_t n = text.size();
+        size_t a = k, afterCaseless = std::string::npos;
+        while (a < n) {
+            CodePoint cp = read(a);
+            if (cp.cls != CharClass::Letter) break;
+            LetterCase lc = caseAt(cp);
+            if (lc == LetterCase::Lower) break;
+            a += cp.len;
+            if (lc == LetterCase::Caseless) afterCaseless = a;
+        }
+        size_t b = a;
+        while (b < n) {
+            CodePoint cp = read(b);
+            if (cp.cls != CharClass::Letter || caseAt(cp) == LetterCase::Upper) break;
+            b += cp.len;
+        }
+        if (b > a) return b;
+        return afterCaseless != std::string::npos ? afterCaseless : a;
+    };
+
+    std::vector<std::string_view> pieces;
+    const size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+        const CodePoint cur = read(i);
+        size_t j = i;
+
+        // 1. cl100k：独立的英文缩写
+        if (!o200k) j = i + contractionLength(text, i);
+
+        // 2. [^\r\n\p{L}\p{N}]? + 字母串（o200k 另按大小写切分并附带缩写）
+        if (j == i) {
+            size_t k = i;
+            if (cur.cls == CharClass::Space || cur.cls == CharClass::Other) {
+                if (i + cur.len < n && read(i + cur.len).cls == CharClass::Letter) k = i + cur.len;
+            }
+            if (k < n && read(k).cls == CharClass::Letter) {
+                if (o200k) {
+                    k = o200kWordEnd(k);
+                    k += contractionLength(text, k);
+                } else {
+                    while (k < n) {
+                        CodePoint cp = read(k);
+                        if (cp.cls != CharClass::Letter) break;
+                        k += cp.len;
+                    }
+                }
+                j = k;
+            }
+        }
+
+        // 3. \p{N}{1,3}
+        if (j == i && cur.cls == CharClass::Number) {
+            size_t k = i;
+            for (int d = 0; d < 3 && k < n; ++d) {
+                CodePoint cp = read(k);
+                if (cp.cls != CharClass::Number) break;
+                k += cp.len;
+            }
+            j = k;
+        }
+
+        // 4. " ?[^\s\p{L}\p{N}]+[\r\n]*"（o200k 为 [\r\n/]*）
+        if (j == i) {
+            size_t k = i;
+            if (text[k] == ' ' && k + 1 < n && read(k + 1).cls == CharClass::Other) ++k;
+            if (read(k).cls == CharClass::Other) {
+                while (k < n) {
+                    CodePoint cp = read(k);
+                    if (cp.cls != CharClass::Other) break;
+                    k += cp.len;
+                }
+                while (k < n && (text[k] == '\r' || text[k] == '\n' || (o200k && text[k] == '/'))) ++k;
+                j = k;
+            }
+        }
+
+        // 5-7. 空白：\s*[\r\n]+ | \s+(?!\S) | \s+
+        if (j == i && isWhitespace(cur.cls)) {
+            size_t k = i, lastNewlineEnd = 0, lastStart = i;
+            while (k < n) {
+                CodePoint cp = read(k);
+                if (!isWhitespace(cp.cls)) break;
+                if (cp.cls == CharClass::Newline) lastNewlineEnd = k + cp.len;
+                lastStart = k;
+                k += cp.len;
+            }
+            if (lastNewlineEnd > 0) j = lastNewlineEnd;
+            else if (k == n || lastStart == i) j = k;
+            else j = lastStart;  // 最后一个空白留给后面的单词
+        }
+
+        if (j == i) j = i + cur.len;
+        pieces.push_back(text.substr(i, j - i));
+        i = j;
+    }
+    return pieces;
+}
+
+size_t Tokenizer::estimate(std::string_view text) {
+    size_t ascii = 0, other = 0;
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c < 0x80) ++ascii;
+        else if (c >= 0xC0) ++other;  // 多字节码点只数首字节
+    }
+    return (ascii + 3) / 4 + other;
+}
+
+size_t Tokenizer::count(std::string_view text) const {
+    if (text.empty()) return 0;
+    auto v = snapshot();
+    if (!v) return estimate(text);
+    thread_local std::vector<std::pair<size_t, uint32_t>> parts;
+    // 源码 / 日志中同一标识符反复出现：缓存需要合并的片段的 token 数
+    thread_local std::unordered_map<std::string, uint32_t> pieceCache;
+    thread_local uint64_t cacheOwner = 0;
+    if (cacheOwner != v->id) {
+        pieceCache.clear();
+        cacheOwner = v->id;
+    }
+    thread_local std::string key;
+    size_t total = 0;
+    for (std::string_view piece : splitPieces(text, v->rules)) {
+        if (v->rankOf(piece) != kNoRank) {
+            ++total;
+            continue;
+        }
+        key.assign(piece.data(), piece.size());
+        auto it = pieceCache.find(key);
+        if (it != pieceCache.end()) {
+            total += it->second;
+            continue;
+        }
+        v->merge(piece, parts);
+        const uint32_t n = static_cast<uint32_t>(parts.size() - 1);
+        if (pieceCache.size() >= kPieceCacheLimit) pieceCache.clear();
+        pieceCache.emplace(key, n);
+        total += n;
+    }
+    return total;
+}
+
+std::vector<uint32_t> Tokenizer::encode(std::string_view text) const {
+    std::vector<uint32_t> out;
+    auto v = snapshot();
+    if (!v) return out;
+    std::vector<std::pair<size_t, uint32_t>> parts;
+    for (std::string_view piece : splitPieces(text, v->rules)) {
+        uint32_t whole = v->rankOf(piece);
+        if (whole != kNoRank) {
+            out.push_back(whole);
+            continue;
+        }
+        v->merge(piece, parts);
+        for (size_t i = 0; i + 1 < parts.size(); ++i) {
+            uint32_t r = v->rankOf(piece.substr(parts[i].first, parts[i + 1].first - parts[i].first));
+            if (r != kNoRank) out.push_back(r);
+        }
+    }
+    return out;
+}
+
+std::string Tokenizer::decode(const std::vector<uint32_t>& tokens) const {
+    std::string out;
+    auto v = snapshot();
+    if (!v) return out;
+    for (uint32_t t : tokens) {
+        if (t < v->byRank.size()) out += v->byRank[t];
+    }
+    return out;
+}
+
+size_t Tokenizer::countMessage(const nlohmann::json& message) const {
+    if (!message.is_object()) return 0;
+    size_t total = kPerMessageOverhead;
+    if (message.contains("content")) {
+        const auto& content = message["content"];
+        if (content.is_string()) {
+            total += count(content.get_ref<const std::string&>());
+        } else if (content.is_array()) {
+            // main 把工具结果存为 [{"type":"text","text":...}]
+            for (const auto& part : content) {
+                if (part.is_object() && part.contains("text") && part["text"].is_string()) {
+                    total += count(part["text"].get_ref<const std::string&>());
+                } else if (part.is_string()) {
+                    total += count(part.get_ref<const std::string&>());
+                }
+            }
+        }
+    }
+    if (message.contains("tool_calls") && message["tool_calls"].is_array()) {
+        for (const auto& tc : message["tool_calls"]) {
+            if (!tc.is_object() || !tc.contains("function") || !tc["function"].is_object()) continue;
+            const auto& fn = tc["function"];
+            total += kPerMessageOverhead;
+            if (fn.contains("name") && fn["name"].is_string()) total += count(fn["name"].get_ref<const std::string&>());
+            if (fn.contains("arguments") && fn["arguments"].is_string()) {
+                total += count(fn["arguments"].get_ref<const std::string&>());
+            }
+        }
+    }
+    if (message.contains("tool_call_id") && message["tool_call_id"].is_string()) {
+        total += count(message["tool_call_id"].get_ref<const std::string&>());
+    }
+    return total;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/**
+ * 本地 BPE 分词器，用于上下文预算（token 数而非字符数）。
+ * - 词表为 tiktoken 格式（每行 "<base64 token> <rank>"），可直接加载 cl100k_base / o200k_base 的 .tiktoken 文件
+ * - 预分词按所加载词表的正则规则手写实现（文件名含 "o200k" 或词项超过 15 万时用 o200k，否则 cl100k）：
+ *   缩写 / 字母串 / 1-3 位数字 / 标点串 / 空白与换行；o200k 另按大小写切分单词（camelCase 拆开）。
+ *   ASCII 与 tiktoken 一致；非 ASCII 按码点区间近似判定字母 / 数字 / 空白 / 组合符号，大小写只区分拉丁、
+ *   希腊、西里尔字母，因此含其它有大小写文字的文本计数为近似值
+ * - 未加载词表时退化为估算：ASCII 每 4 字节 1 个 token，非 ASCII 每个码点 1 个 token
+ * 线程安全：词表加载后只读，加载时整体替换。
+ */
+class Tokenizer {
+public:
+    /** 预分词规则 */
+    enum class PreTokenizer { Cl100k, O200k };
+
+    /** 每条 chat 消息的固定开销（角色、分隔符），与 OpenAI 的计数约定一致 */
+    static constexpr size_t kPerMessageOverhead = 4;
+
+    Tokenizer();
+    ~Tokenizer();
+
+    /** 进程内共享实例（ContextManager / Conversation / 状态栏使用） */
+    static Tokenizer& getInstance();
+
+    /** 加载 tiktoken 格式词表；失败时保持原状态并返回 false */
+    bool loadVocab(const std::string& path);
+    bool hasVocab() const;
+    /** 词表文件名（未加载时为 "estimate"） */
+    std::string vocabName() const;
+    /** 每次加载词表后递增，用于让缓存的 token 数失效 */
+    uint64_t generation() const;
+    /** 当前词表对应的预分词规则（未加载时为 Cl100k） */
+    PreTokenizer preTokenizer() const;
+
+    /** 文本的 token 数（无词表时为估算值） */
+    size_t count(std::string_view text) const;
+    /** 编码为 token id；无词表时返回空 */
+    std::vector<uint32_t> encode(std::string_view text) const;
+    std::string decode(const std::vector<uint32_t>& tokens) const;
+
+    /** chat 消息的 token 数：content（字符串或 text part 数组）、tool_calls 的名称与参数、tool_call_id，加固定开销 */
+    size_t countMessage(const nlohmann::json& message) const;
+
+    /** 预分词：按给定规则切成互不合并的片段 */
+    static std::vector<std::string_view> splitPieces(std::string_view text, PreTokenizer rules = PreTokenizer::Cl100k);
+    /** 无词表时的估算 */
+    static size_t estimate(std::string_view text);
+
+private:
+    struct Vocab;
+    mutable std::mutex mtx;
+    std::shared_ptr<const Vocab> vocab;
+    uint64_t gen = 0;
+
+    std::shared_ptr<const Vocab> snapshot() const;
+};
@@ -0,0 +1,294 @@
+#include "Utf8Validate.h"
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PHOTON_UTF8_X86 1
+#include <immintrin.h>
+#define PHOTON_TARGET_AVX2 __attribute__((target("avx2")))
+#define PHOTON_TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define PHOTON_UTF8_X86 0
+#endif
+
+namespace UTF8Utils {
+
+namespace {
+
+// [0, pos) 已校验；若末尾是未完整的多字节字符，退回到它的首字节
+size_t backToBoundary(const char* data, size_t pos) {
+    for (size_t j = 1; j <= 3 && j <= pos; ++j) {
+        unsigned char b = static_cast<unsigned char>(data[pos - j]);
+        if (b < 0x80) break;
+        if (b >= 0xC0) {
+            size_t need = b >= 0xF0 ? 4 : (b >= 0xE0 ? 3 : 2);
+            return need > j ? pos - j : pos;
+        }
+    }
+    return pos;
+}
+
+size_t validPrefixScalar(const char* data, size_t size) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    size_t i = 0;
+    while (i < size) {
+        if (i + 8 <= size) {
+            uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if ((word & 0x8080808080808080ull) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        const unsigned char c = p[i];
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        size_t len = 0;
+        unsigned char lo = 0x80, hi = 0xBF;  // 第二个字节的范围
+        if (c >= 0xC2 && c <= 0xDF) {
+            len = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            len = 3;
+            if (c == 0xE0) lo = 0xA0;
+            else if (c == 0xED) hi = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            len = 4;
+            if (c == 0xF0) lo = 0x90;
+            else if (c == 0xF4) hi = 0x8F;
+        } else {
+            return i;
+        }
+        if (i + len > size || p[i + 1] < lo || p[i + 1] > hi) return i;
+        for (size_t k = 2; k < len; ++k) {
+            if ((p[i + k] & 0xC0) != 0x80) return i;
+        }
+        i += len;
+    }
+    return i;
+}
+
+#if PHOTON_UTF8_X86
+
+// 查表校验的错误位：每个字节与其前一字节组成的字节对按 (前字节高 4 位, 前字节低 4 位, 本字节高 4 位) 查三张表，
+// 三者按位与非零即非法
+constexpr uint8_t kTooShort = 1 << 0;   // 11______ 0_______ / 11______ 11______
+constexpr uint8_t kTooLong = 1 << 1;    // 0_______ 10______
+constexpr uint8_t kOverlong3 = 1 << 2;  // 11100000 100_____
+constexpr uint8_t kTooLarge = 1 << 3;   // 11110100 1001____ 等（超过 U+10FFFF）
+constexpr uint8_t kSurrogate = 1 << 4;  // 11101101 101_____
+constexpr uint8_t kOverlong2 = 1 << 5;  // 1100000_ 10______
+constexpr uint8_t kTooLarge1000 = 1 << 6;
+constexpr uint8_t kOverlong4 = 1 << 6;  // 11110000 1000____
+constexpr uint8_t kTwoConts = 1 << 7;   // 10______ 10______
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+alignas(16) const uint8_t kByte1High[16] = {
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+};
+alignas(16) const uint8_t kByte1Low[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+};
+alignas(16) const uint8_t kByte2High[16] = {
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort,
+};
+// 块末尾 3 个字节若是尚未结束的多字节序列的开头，则下一块必须补全（或输入在此处截断）
+alignas(16) const uint8_t kIncompleteMax[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+};
+
+// ---- AVX2：32 字节 ----
+
+template <int N>
+PHOTON_TARGET_AVX2 inline __m256i prevBytesAvx2(__m256i input, __m256i prev) {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+}
+
+struct TablesAvx2 {
+    __m256i byte1High, byte1Low, byte2High, lowNibble, incompleteMax;
+};
+
+PHOTON_TARGET_AVX2 inline __m256i errorsAvx2(__m256i input, __m256i prev, const TablesAvx2& t) {
+    const __m256i prev1 = prevBytesAvx2<1>(input, prev);
+    const __m256i b1h = _mm256_shuffle_epi8(t.byte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), t.lowNibble));
+    const __m256i b1l = _mm256_shuffle_epi8(t.byte1Low, _mm256_and_si256(prev1, t.lowNibble));
+    const __m256i b2h = _mm256_shuffle_epi8(t.byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), t.lowNibble));
+    const __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+    // 3/4 字节序列的第 3、4 个字节必须是续字节（与 special 中的「两个续字节相邻」位抵消）
+    const __m256i third = _mm256_subs_epu8(prevBytesAvx2<2>(input, prev), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    const __m256i fourth = _mm256_subs_epu8(prevBytesAvx2<3>(input, prev), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    const __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(must23, special);
+}
+
+PHOTON_TARGET_AVX2 size_t validPrefixAvx2(const char* data, size_t size) {
+    TablesAvx2 t;
+    t.byte1High = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kByte1High)));
+    t.byte1Low = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kByte1Low)));
+    t.byte2High = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kByte2High)));
+    t.lowNibble = _mm256_set1_epi8(0x0F);
+    t.incompleteMax = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kIncompleteMax));
+
+    size_t pos = 0;
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    while (pos + 32 <= size) {
+        // 纯 ASCII 一次跳过 64 字节
+        if (pos + 64 <= size && _mm256_testz_si256(incomplete, incomplete)) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 32));
+            if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) == 0) {
+                prev = b;
+                pos += 64;
+                continue;
+            }
+        }
+        const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        if (_mm256_movemask_epi8(input) == 0) {
+            if (!_mm256_testz_si256(incomplete, incomplete)) break;
+            prev = input;
+            pos += 32;
+            continue;
+        }
+        const __m256i err = errorsAvx2(input, prev, t);
+        if (!_mm256_testz_si256(err, err)) break;
+        incomplete = _mm256_subs_epu8(input, t.incompleteMax);
+        prev = input;
+        pos += 32;
+    }
+    return backToBoundary(data, pos);
+}
+
+// ---- SSSE3：16 字节 ----
+
+struct TablesSsse3 {
+    __m128i byte1High, byte1Low, byte2High, lowNibble, incompleteMax;
+};
+
+PHOTON_TARGET_SSSE3 inline __m128i errorsSsse3(__m128i input, __m128i prev, const TablesSsse3& t) {
+    const __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+    const __m128i b1h = _mm_shuffle_epi8(t.byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), t.lowNibble));
+    const __m128i b1l = _mm_shuffle_epi8(t.byte1Low, _mm_and_si128(prev1, t.lowNibble));
+    const __m128i b2h = _mm_shuffle_epi8(t.byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), t.lowNibble));
+    const __m128i special = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+    const __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 14), _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    const __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, prev, 13), _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(must23, special);
+}
+
+PHOTON_TARGET_SSSE3 inline bool anySetSsse3(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF;
+}
+
+PHOTON_TARGET_SSSE3 size_t validPrefixSsse3(const char* data, size_t size) {
+    TablesSsse3 t;
+    t.byte1High = _mm_load_si128(reinterpret_cast<const __m128i*>(kByte1High));
+    t.byte1Low = _mm_load_si128(reinterpret_cast<const __m128i*>(kByte1Low));
+    t.byte2High = _mm_load_si128(reinterpret_cast<const __m128i*>(kByte2High));
+    t.lowNibble = _mm_set1_epi8(0x0F);
+    t.incompleteMax = _mm_load_si128(reinterpret_cast<const __m128i*>(kIncompleteMax + 16));
+
+    size_t pos = 0;
+    __m128i prev = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    while (pos + 16 <= size) {
+        const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        if (_mm_movemask_epi8(input) == 0) {
+            if (anySetSsse3(incomplete)) break;
+            prev = input;
+            pos += 16;
+            continue;
+        }
+        if (anySetSsse3(errorsSsse3(input, prev, t))) break;
+        incomplete = _mm_subs_epu8(input, t.incompleteMax);
+        prev = input;
+        pos += 16;
+    }
+    return backToBoundary(data, pos);
+}
+
+#endif  // PHOTON_UTF8_X86
+
+Utf8Impl detectBestImpl() {
+#if PHOTON_UTF8_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Utf8Impl::AVX2;
+    if (__builtin_cpu_supports("ssse3")) return Utf8Impl::SSSE3;
+#endif
+    return Utf8Impl::Scalar;
+}
+
+}  // namespace
+
+Utf8Impl bestUtf8Impl() {
+    static const Utf8Impl best = detectBestImpl();
+    return best;
+}
+
+bool utf8ImplSupported(Utf8Impl impl) {
+    switch (impl) {
+    case Utf8Impl::Scalar:
+        return true;
+    case Utf8Impl::SSSE3:
+        return bestUtf8Impl() != Utf8Impl::Scalar;
+    case Utf8Impl::AVX2:
+        return bestUtf8Impl() == Utf8Impl::AVX2;
+    }
+    return false;
+}
+
+const char* utf8ImplName(Utf8Impl impl) {
+    switch (impl) {
+    case Utf8Impl::AVX2: return "avx2";
+    case Utf8Impl::SSSE3: return "ssse3";
+    default: return "scalar";
+    }
+}
+
+size_t utf8ValidPrefix(const char* data, size_t size) {
+    return utf8ValidPrefix(data, size, bestUtf8Impl());
+}
+
+size_t utf8ValidPrefix(const char* data, size_t size, Utf8Impl impl) {
+    if (!utf8ImplSupported(impl)) impl = Utf8Impl::Scalar;
+    size_t prefix = 0;
+#if PHOTON_UTF8_X86
+    if (impl == Utf8Impl::AVX2) prefix = validPrefixAvx2(data, size);
+    else if (impl == Utf8Impl::SSSE3) prefix = validPrefixSsse3(data, size);
+    else return validPrefixScalar(data, size);
+#else
+    return validPrefixScalar(data, size);
+#endif
+    // 向量路径在不足一块的尾部或出错的块处停下：从该字符边界起逐字符补完，得到与 Scalar 相同的结果
+    return prefix + validPrefixScalar(data + prefix, size - prefix);
+}
+
+}  // namespace UTF8Utils
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * UTF-8 校验的向量化快速路径（UTF8Utils::sanitize 使用）
+ *
+ * utf8ValidPrefix 返回从 data 起最长的、止于字符边界的合法 UTF-8 前缀长度；sanitize 整段复制这部分，
+ * 只把含非法序列的块交给逐字节处理。
+ * - AVX2（32 字节，每轮先以 64 字节检查纯 ASCII）/ SSSE3（16 字节）：Keiser & Lemire 的查表校验
+ *   （"Validating UTF-8 In Less Than One Instruction Per Byte"），三次 pshufb 查表判定相邻字节对，
+ *   另加 3/4 字节序列的续字节位置检查；运行时按 CPU 选择
+ * - 其余平台：每次 8 字节检查 ASCII，遇到非 ASCII 逐字符校验
+ * 合法性按 RFC 3629（拒绝过长编码、代理区、超过 U+10FFFF）；比 sanitizeScalar 接受的范围更严，
+ * 被拒绝但 sanitizeScalar 会原样保留的字节（如代理区）由慢路径处理，结果不变。
+ */
+namespace UTF8Utils {
+
+enum class Utf8Impl { Scalar, SSSE3, AVX2 };
+
+/** 当前 CPU 上最快的可用实现 */
+Utf8Impl bestUtf8Impl();
+
+/** 该实现是否可在当前 CPU 上运行（Scalar 总是可用） */
+bool utf8ImplSupported(Utf8Impl impl);
+
+const char* utf8ImplName(Utf8Impl impl);
+
+/** 最长合法前缀（止于字符边界），使用 bestUtf8Impl() */
+size_t utf8ValidPrefix(const char* data, size_t size);
+
+/** 指定实现（测试 / 基准使用）；impl 不受支持时退回 Scalar */
+size_t utf8ValidPrefix(const char* data, size_t size, Utf8Impl impl);
+
+}  // namespace UTF8Utils
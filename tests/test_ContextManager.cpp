@@ -1,6 +1,14 @@
 #include <gtest/gtest.h>
 #include "core/ContextManager.h"
+#include "core/Conversation.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // Mock LLMClient for testing context management without network
 class MockLLMClient : public LLMClient {
@@ -65,3 +73,176 @@ TEST(ContextManagerTest, ForceCompress) {
     EXPECT_TRUE(result[1]["content"].get<std::string>().find("Summary") != std::string::npos);
     EXPECT_EQ(result.back()["content"], "msg2");
 }
+
+// 记录每次摘要的输入；gate 未放行前摘要请求一直挂起（模拟慢的后台摘要）
+class RecordingSummaryClient : public LLMClient {
+public:
+    RecordingSummaryClient() : LLMClient("fake_key", "fake_url", "fake_model") {
+        std::promise<void> open;
+        open.set_value();
+        gate = open.get_future().share();
+    }
+    std::string summarize(const std::string& text) override {
+        gate.wait();
+        std::lock_guard<std::mutex> lock(mtx);
+        inputs.push_back(text);
+        return "S" + std::to_string(inputs.size());
+    }
+    std::vector<std::string> getInputs() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return inputs;
+    }
+    std::shared_future<void> gate;
+private:
+    std::mutex mtx;
+    std::vector<std::string> inputs;
+};
+
+static nlohmann::json turn(const std::string& role, const std::string& tag) {
+    // 约 42 token（无词表时按 4 字节 / token 估算）
+    return {{"role", role}, {"content", tag + " " + std::string(150, 'x')}};
+}
+
+TEST(ContextManagerTest, RollingSummaryRunsInBackground) {
+    auto client = std::make_shared<RecordingSummaryClient>();
+    std::promise<void> release;
+    client->gate = release.get_future().share();
+    ContextManager cm(client, 800);
+    cm.setSoftWatermark(0.5);
+
+    Conversation conv;
+    conv.push_back({{"role", "system"}, {"content", "sys"}});
+    for (int i = 0; i < 12; ++i) conv.push_back(turn(i % 2 ? "assistant" : "user", "m" + std::to_string(i)));
+    ASSERT_GT(cm.getSize(conv), 400u);
+    ASSERT_LT(cm.getSize(conv), 800u);
+
+    // 越过软水位：后台开始折叠，本轮历史不变
+    EXPECT_FALSE(cm.manage(conv));
+    EXPECT_TRUE(cm.hasPendingSummary());
+    EXPECT_EQ(conv.size(), 13u);
+
+    // 摘要进行中对话继续追加；完成后下一轮直接换上压缩后的历史
+    conv.push_back(turn("user", "m12"));
+    release.set_value();
+    bool applied = false;
+    for (int i = 0; i < 200 && !applied; ++i) {
+        applied = cm.manage(conv);
+        if (!applied) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(applied);
+    EXPECT_EQ(cm.getRunningSummary(), "S1");
+    EXPECT_EQ(conv[0]["content"], "sys");
+    EXPECT_EQ(conv[1]["content"], "Summary of earlier conversation: S1");
+    EXPECT_FALSE(cm.hasPendingSummary());
+    EXPECT_EQ(conv.size(), 7u);
+    EXPECT_EQ(conv.back()["content"].get<std::string>().substr(0, 3), "m12");
+
+    // 第二次折叠只带上已有摘要与新淘汰的消息
+    for (int i = 13; i < 18; ++i) conv.push_back(turn(i % 2 ? "assistant" : "user", "m" + std::to_string(i)));
+    cm.manage(conv);
+    ASSERT_TRUE(cm.waitForPendingSummary(conv));
+    auto inputs = client->getInputs();
+    ASSERT_EQ(inputs.size(), 2u);
+    EXPECT_NE(inputs[0].find("m0 "), std::string::npos);
+    EXPECT_NE(inputs[1].find("S1"), std::string::npos);
+    EXPECT_EQ(inputs[1].find("m0 "), std::string::npos);
+    EXPECT_NE(inputs[1].find("m8 "), std::string::npos);
+    EXPECT_EQ(conv[1]["content"], "Summary of earlier conversation: S2");
+}
+
+TEST(ContextManagerTest, RollingSummaryKeepsToolResultsWithCall) {
+    auto client = std::make_shared<RecordingSummaryClient>();
+    ContextManager cm(client, 100000);
+
+    nlohmann::json call = {{"role", "assistant"},
+                           {"content", ""},
+                           {"tool_calls", nlohmann::json::array({{{"id", "c1"},
+                                                                   {"type", "function"},
+                                                                   {"function", {{"name", "read"}, {"arguments", "{}"}}}}})}};
+    Conversation conv;
+    conv.push_back({{"role", "system"}, {"content", "sys"}});
+    conv.push_back(turn("user", "u0"));
+    conv.push_back(turn("assistant", "a0"));
+    conv.push_back(turn("user", "u1"));
+    conv.push_back(call);
+    conv.push_back({{"role", "tool"}, {"tool_call_id", "c1"}, {"content", "first result"}});
+    conv.push_back({{"role", "tool"}, {"tool_call_id", "c1"}, {"content", "second result"}});
+
+    // 只保留最后一条会落在工具结果上：边界回退到发起调用的 assistant 消息
+    cm.forceCompress(conv);
+    ASSERT_EQ(conv.size(), 5u);
+    EXPECT_EQ(conv[1]["content"], "Summary of earlier conversation: S1");
+    EXPECT_TRUE(conv[2].contains("tool_calls"));
+    EXPECT_EQ(conv[3]["content"], "first result");
+    EXPECT_EQ(conv[4]["content"], "second result");
+    EXPECT_EQ(client->getInputs()[0].find("result"), std::string::npos);
+}
+
+static nlohmann::json toolCall(const std::string& id, const std::string& name, const nlohmann::json& args) {
+    return {{"role", "assistant"},
+            {"content", ""},
+            {"tool_calls", nlohmann::json::array({{{"id", id},
+                                                   {"type", "function"},
+                                                   {"function", {{"name", name}, {"arguments", args.dump()}}}}})}};
+}
+
+static nlohmann::json toolResult(const std::string& id, const std::string& text) {
+    return {{"role", "tool"},
+            {"tool_call_id", id},
+            {"content", nlohmann::json::array({{{"type", "text"}, {"text", text}}})}};
+}
+
+TEST(ContextManagerTest, DedupsRepeatedToolResults) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "photon_cm_dedup";
+    fs::create_directories(root);
+    {
+        std::ofstream out(root / "a.cpp");
+        out << "int a;\n";
+    }
+    auto client = std::make_shared<RecordingSummaryClient>();
+    ContextManager cm(client, 100000);
+    cm.setProjectRoot(root.string());
+
+    const std::string body(400, 'b');
+    Conversation conv;
+    conv.push_back({{"role", "system"}, {"content", "sys"}});
+    conv.push_back(toolCall("c1", "read", {{"file_path", "a.cpp"}, {"start_line", 1}, {"end_line", 50}}));
+    conv.push_back(toolResult("c1", body + "  \r\n"));
+    // 参数键顺序不同、内容相同：同一调用的重复结果
+    conv.push_back(toolCall("c2", "read", {{"end_line", 50}, {"start_line", 1}, {"file_path", "a.cpp"}}));
+    conv.push_back(toolResult("c2", body + "\n"));
+    // 同一区间再次读取但内容已变化：旧结果被新结果取代
+    conv.push_back(toolCall("c3", "grep", {{"pattern", "x"}}));
+    conv.push_back(toolResult("c3", std::string(300, 'g')));
+    conv.push_back(toolCall("c4", "grep", {{"pattern", "x"}}));
+    conv.push_back(toolResult("c4", std::string(300, 'h')));
+    conv.push_back(toolCall("c5", "run", {{"command", "ls"}}));
+    conv.push_back(toolResult("c5", "ok"));
+    conv.push_back(toolCall("c6", "run", {{"command", "ls"}}));
+    conv.push_back(toolResult("c6", "ok"));
+
+    const size_t before = cm.getSize(conv);
+    EXPECT_GT(cm.dedupToolResults(conv), 0u);
+    EXPECT_EQ(conv[2]["content"], "[Duplicate tool result elided: identical to the later result of call c2]");
+    EXPECT_TRUE(conv[4]["content"].is_array());
+    EXPECT_EQ(conv[6]["content"], "[Earlier result elided: the same call was repeated later (call c4); see that result]");
+    EXPECT_TRUE(conv[8]["content"].is_array());
+    EXPECT_EQ(conv[10]["content"][0]["text"], "ok");  // 短结果不处理
+    auto stats = cm.getStats();
+    EXPECT_EQ(stats.duplicateResults, 1u);
+    EXPECT_EQ(stats.supersededResults, 1u);
+    EXPECT_EQ(stats.tokensSaved, before - cm.getSize(conv));
+
+    // 已处理过的消息不会重复计数
+    EXPECT_EQ(cm.dedupToolResults(conv), 0u);
+
+    // 文件被修改后，最新的读取结果标记为过期
+    fs::last_write_time(root / "a.cpp", fs::last_write_time(root / "a.cpp") + std::chrono::seconds(5));
+    cm.dedupToolResults(conv);
+    const std::string marked = conv[4]["content"].get<std::string>();
+    EXPECT_EQ(marked.rfind("[Stale: a.cpp has been modified", 0), 0u);
+    EXPECT_NE(marked.find(body), std::string::npos);
+    EXPECT_EQ(cm.getStats().staleResults, 1u);
+    fs::remove_all(root);
+}
@@ -0,0 +1,162 @@
+/**
+ * Conversation 单元测试：每条消息只序列化一次、插入/删除/替换后缓存正确，
+ * 以及 LLMClient 用 Conversation 与用 json 数组发出的请求体逐字节一致（本机 httplib 服务捕获）；
+ * 末尾易变槽位始终排在最后，变化时请求前缀（tools + 历史）保持不变。
+ */
+
+#include <gtest/gtest.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "httplib.h"
+
+#include <string>
+#include <thread>
+
+#include "core/Conversation.h"
+#include "core/LLMClient.h"
+
+namespace {
+
+nlohmann::json sampleHistory() {
+  return nlohmann::json::array({
+      {{"role", "system"}, {"content", "sys"}},
+      {{"role", "user"}, {"content", ""}},
+      {{"role", "assistant"},
+       {"content", nullptr},
+       {"tool_calls", nlohmann::json::array({{{"id", "c1"}, {"type", "function"},
+                                              {"function", {{"name", "grep"}, {"arguments", "{\"pattern\":\"x\"}"}}}}})}},
+      {{"role", "tool"}, {"tool_call_id", "c1"}, {"name", "grep"}, {"content", "a \"quoted\"\nline\t✓"}},
+  });
+}
+
+std::string normalizedDump(const nlohmann::json& messages) {
+  nlohmann::json out = nlohmann::json::array();
+  for (const auto& m : messages) out.push_back(normalizeMessageForKimi(m));
+  return out.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+}  // namespace
+
+TEST(Conversation, SerializesEachMessageOnce) {
+  auto history = sampleHistory();
+  Conversation conv(history);
+
+  EXPECT_EQ(conv.serializedMessages(), normalizedDump(history));
+  EXPECT_EQ(conv.fragmentBuilds(), 4u);
+
+  // 追加：只序列化新消息
+  conv.push_back({{"role", "user"}, {"content", "next"}});
+  history.push_back({{"role", "user"}, {"content", "next"}});
+  EXPECT_EQ(conv.serializedMessages(), normalizedDump(history));
+  EXPECT_EQ(conv.fragmentBuilds(), 5u);
+  conv.serializedMessages();
+  EXPECT_EQ(conv.fragmentBuilds(), 5u);
+
+  // 插入 / 删除：其余消息的片段保持有效
+  conv.insert(1, {{"role", "system"}, {"content", "summary"}});
+  history.insert(history.begin() + 1, nlohmann::json{{"role", "system"}, {"content", "summary"}});
+  conv.erase(3);
+  history.erase(history.begin() + 3);
+  EXPECT_EQ(conv.serializedMessages(), normalizedDump(history));
+  EXPECT_EQ(conv.fragmentBuilds(), 6u);
+  EXPECT_EQ(conv.toJson(), history);
+
+  // 整体替换：缓存全部重建
+  conv.assign(sampleHistory());
+  EXPECT_EQ(conv.serializedMessages(), normalizedDump(sampleHistory()));
+  EXPECT_EQ(conv.fragmentBuilds(), 10u);
+
+  conv.clear();
+  EXPECT_EQ(conv.serializedMessages(), "[]");
+}
+
+TEST(Conversation, RequestBodyMatchesJsonPath) {
+  httplib::Server server;
+  std::vector<std::string> bodies;
+  server.Post("/v1/chat/completions", [&](const httplib::Request& req, httplib::Response& res) {
+    bodies.push_back(req.body);
+    res.set_content(R"({"choices":[{"message":{"role":"assistant","content":"ok"},"finish_reason":"stop"}]})",
+                    "application/json");
+  });
+  int port = server.bind_to_any_port("127.0.0.1");
+  std::thread thread([&] { server.listen_after_bind(); });
+  server.wait_until_ready();
+
+  LLMClient client("fake_key", "http://127.0.0.1:" + std::to_string(port) + "/v1", "fake_model", 512);
+  auto tools = nlohmann::json::array({{{"type", "function"}, {"function", {{"name", "grep"}}}}});
+  auto history = sampleHistory();
+  Conversation conv(history);
+
+  client.chatWithTools(history, tools);
+  client.chatWithTools(conv, tools);
+  client.chatWithToolsStream(history, tools, ChatStreamCallbacks());
+  client.chatWithToolsStream(conv, tools, ChatStreamCallbacks());
+
+  server.stop();
+  thread.join();
+
+  ASSERT_EQ(bodies.size(), 4u);
+  EXPECT_EQ(bodies[0], bodies[1]);
+  EXPECT_EQ(bodies[2], bodies[3]);
+  auto body = nlohmann::json::parse(bodies[0]);
+  EXPECT_EQ(body["model"], "fake_model");
+  EXPECT_EQ(body["max_tokens"], 512);
+  EXPECT_EQ(body["tools"], tools);
+  EXPECT_EQ(body["messages"].dump(), nlohmann::json::parse(normalizedDump(history)).dump());
+  EXPECT_FALSE(body["messages"][3].contains("name"));
+  EXPECT_EQ(nlohmann::json::parse(bodies[2]).value("stream", false), true);
+}
+
+TEST(Conversation, TrailingContextKeepsPrefixStable) {
+  httplib::Server server;
+  std::vector<std::string> bodies;
+  server.Post("/v1/chat/completions", [&](const httplib::Request& req, httplib::Response& res) {
+    bodies.push_back(req.body);
+    res.set_content(R"({"choices":[{"message":{"role":"assistant","content":"ok"},"finish_reason":"stop"}]})",
+                    "application/json");
+  });
+  int port = server.bind_to_any_port("127.0.0.1");
+  std::thread thread([&] { server.listen_after_bind(); });
+  server.wait_until_ready();
+
+  LLMClient client("fake_key", "http://127.0.0.1:" + std::to_string(port) + "/v1", "fake_model");
+  auto tools = nlohmann::json::array({{{"type", "function"}, {"function", {{"name", "grep"}}}}});
+  Conversation conv(sampleHistory());
+  const std::string historyJson = conv.serializedMessages();
+  const size_t stablePrefix = tools.dump().size() + historyJson.size() - 1;  // 去掉历史末尾的 ']'
+
+  conv.setTrailingContext("skills", "skill A");
+  conv.setTrailingContext("read_summaries", "read x");
+  EXPECT_EQ(conv.size(), 4u);
+  EXPECT_EQ(conv.trailingMessage()["content"], "read x\n\nskill A");  // 按 key 排序合并
+  client.chatWithTools(conv, tools);
+
+  // 易变内容变化：只有末尾槽位重建，前缀（tools + 历史）逐字节不变
+  const size_t builds = conv.fragmentBuilds();
+  conv.setTrailingContext("read_summaries", "read x, y");
+  conv.setTrailingContext("skills", "skill A");  // 内容相同不重建
+  client.chatWithTools(conv, tools);
+  EXPECT_EQ(conv.fragmentBuilds(), builds + 1);
+  auto prefix = client.getLastPrefixMetrics();
+  EXPECT_EQ(prefix.requests, 2u);
+  EXPECT_GE(prefix.commonPrefixBytes, stablePrefix);
+  EXPECT_LT(prefix.commonPrefixBytes, prefix.promptBytes);
+
+  // 新消息追加在槽位之前，槽位仍在最后
+  conv.push_back({{"role", "user"}, {"content", "next"}});
+  conv.setTrailingContext("skills", "");
+  client.chatWithTools(conv, tools);
+
+  server.stop();
+  thread.join();
+
+  ASSERT_EQ(bodies.size(), 3u);
+  auto messages = nlohmann::json::parse(bodies[2])["messages"];
+  ASSERT_EQ(messages.size(), 6u);
+  EXPECT_EQ(messages[4]["content"][0]["text"], "next");
+  EXPECT_EQ(messages[5]["role"], "system");
+  EXPECT_EQ(messages[5]["content"][0]["text"], "read x, y");
+  EXPECT_GE(client.getLastPrefixMetrics().commonPrefixBytes, stablePrefix);
+}
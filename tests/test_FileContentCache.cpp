@@ -0,0 +1,121 @@
+/**
+ * FileContentCache 单元测试：行索引与 getline 语义一致（CRLF、末尾换行、空文件）、
+ * 未变化时命中、内容变化后重新读取、刚修改的文件不入缓存、按字节预算淘汰最久未使用的文件。
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "utils/FileContentCache.h"
+
+namespace {
+
+// 写入并把 mtime 调到一小时前，越过 racy 窗口
+fs::path writeAged(const fs::path& path, const std::string& content) {
+  fs::create_directories(path.parent_path());
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+  }
+  fs::last_write_time(path, fs::file_time_type::clock::now() - std::chrono::hours(1));
+  return path;
+}
+
+fs::path testDir(const std::string& name) {
+  fs::path dir = fs::temp_directory_path() / "photon_test_file_cache" / name;
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+  fs::create_directories(dir);
+  return dir;
+}
+
+}  // namespace
+
+TEST(FileContentCache, IndexesLinesLikeGetline) {
+  fs::path dir = testDir("lines");
+  FileContentCache cache;
+
+  auto file = cache.get(writeAged(dir / "a.txt", "one\r\ntwo\n\nfour"));
+  ASSERT_TRUE(file);
+  ASSERT_EQ(file->lineCount(), 4u);
+  EXPECT_EQ(file->line(1), "one");
+  EXPECT_EQ(file->line(2), "two");
+  EXPECT_EQ(file->line(3), "");
+  EXPECT_EQ(file->line(4), "four");
+  EXPECT_EQ(file->line(file->lineCount()), "four");
+  EXPECT_EQ(file->line(0), "");
+  EXPECT_EQ(file->line(5), "");
+
+  // 末行不带文件末尾的换行（含 CRLF）
+  auto lf = cache.get(writeAged(dir / "b.txt", "x\ny\n"));
+  EXPECT_EQ(lf->lineCount(), 2u);
+  EXPECT_EQ(lf->line(lf->lineCount()), "y");
+  auto crlf = cache.get(writeAged(dir / "e.txt", "x\r\ny\r\n"));
+  EXPECT_EQ(crlf->lineCount(), 2u);
+  EXPECT_EQ(crlf->line(crlf->lineCount()), "y");
+  EXPECT_EQ(cache.get(writeAged(dir / "c.txt", ""))->lineCount(), 0u);
+  auto newlineOnly = cache.get(writeAged(dir / "d.txt", "\n"));
+  EXPECT_EQ(newlineOnly->lineCount(), 1u);
+  EXPECT_EQ(newlineOnly->line(newlineOnly->lineCount()), "");
+  EXPECT_FALSE(cache.get(dir / "missing.txt"));
+}
+
+TEST(FileContentCache, ReusesUntilFileChanges) {
+  fs::path dir = testDir("reuse");
+  FileContentCache cache;
+  fs::path path = writeAged(dir / "a.cpp", "int a;\n");
+
+  auto first = cache.get(path);
+  auto second = cache.get(path);
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(cache.getStats().hits, 1u);
+
+  // 同样大小、不同内容：mtime 变化即重新读取；旧快照仍可用
+  writeAged(path, "int b;\n");
+  fs::last_write_time(path, fs::file_time_type::clock::now() - std::chrono::minutes(30));
+  auto third = cache.get(path);
+  EXPECT_EQ(third->text(), "int b;\n");
+  EXPECT_EQ(first->text(), "int a;\n");
+
+  // 刚写入的文件（racy 窗口内）照常返回但不缓存
+  fs::path fresh = dir / "fresh.cpp";
+  {
+    std::ofstream out(fresh, std::ios::binary);
+    out << "new\n";
+  }
+  const size_t entries = cache.getStats().entries;
+  EXPECT_EQ(cache.get(fresh)->text(), "new\n");
+  EXPECT_EQ(cache.getStats().entries, entries);
+}
+
+TEST(FileContentCache, EvictsLeastRecentlyUsedWithinBudget) {
+  fs::path dir = testDir("evict");
+  FileContentCache::Options options;
+  options.maxBytes = 250;
+  FileContentCache cache(options);
+  fs::path a = writeAged(dir / "a.txt", std::string(100, 'a'));
+  fs::path b = writeAged(dir / "b.txt", std::string(100, 'b'));
+  fs::path c = writeAged(dir / "c.txt", std::string(100, 'c'));
+
+  cache.get(a);
+  cache.get(b);
+  cache.get(a);  // a 成为最近使用
+  cache.get(c);  // 超出 250 字节，淘汰 b
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.entries, 2u);
+  EXPECT_EQ(stats.bytes, 200u);
+  EXPECT_EQ(stats.evictions, 1u);
+
+  const size_t hits = stats.hits;
+  cache.get(a);
+  EXPECT_EQ(cache.getStats().hits, hits + 1);
+  cache.get(b);
+  EXPECT_EQ(cache.getStats().hits, hits + 1);
+
+  cache.setMaxBytes(0);
+  EXPECT_EQ(cache.getStats().entries, 0u);
+}
@@ -1,14 +1,22 @@
 /**
- * GrepTool 单元测试：在临时目录创建文件，按 pattern 搜索，验证返回的 file/line/content。
- * 依赖系统有 grep、rg 或 Windows findstr（CI 与常见开发环境均有）。
+ * GrepTool 单元测试：在临时目录创建文件，按 pattern 搜索，验证返回的 file/line/content；
+ * 匹配标注所在符号并按符号分组；以及进程内 GrepEngine 的字面量提取、glob、忽略目录剪枝、二进制跳过、提前终止后的有序结果，
+ * 与超长行（≥1MB 的单行文件）不运行正则而是跳过并报告。
+ * 只有 ECMAScript 无法编译的正则才回退到系统 rg / grep。
  */
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <cstdio>
 #include <fstream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <nlohmann/json.hpp>
 
+#include "analysis/SymbolManager.h"
 #include "tools/CoreTools.h"
+#include "tools/GrepEngine.h"
+#include "utils/ScanIgnore.h"
 
 namespace fs = std::filesystem;
 
@@ -96,3 +104,219 @@ TEST(GrepTool, RespectsMaxResults) {
   EXPECT_LE(res["matches"].size(), 5u) << "max_results=5 should cap matches";
   EXPECT_EQ(res["count"].get<int>(), static_cast<int>(res["matches"].size()));
 }
+
+TEST(GrepEngine, ExtractsRequiredLiteral) {
+  bool pure = false;
+  EXPECT_EQ(GrepEngine::requiredLiteral("PhotonToken", &pure), "PhotonToken");
+  EXPECT_TRUE(pure);
+  EXPECT_EQ(GrepEngine::requiredLiteral("foo\\(", &pure), "foo(");
+  EXPECT_TRUE(pure);
+  EXPECT_EQ(GrepEngine::requiredLiteral("class \\w+Tool", &pure), "class ");
+  EXPECT_FALSE(pure);
+  // 量词使前一个字符可选；+ 保留该字符并开始新片段
+  EXPECT_EQ(GrepEngine::requiredLiteral("colou?rs"), "colo");
+  EXPECT_EQ(GrepEngine::requiredLiteral("ab+cdef"), "bcdef");
+  EXPECT_EQ(GrepEngine::requiredLiteral("^int (main|run)\\(x"), "int ");
+  // 顶层分支没有共同的必需字面量
+  EXPECT_EQ(GrepEngine::requiredLiteral("alpha|beta"), "");
+  EXPECT_EQ(GrepEngine::requiredLiteral("[a-z]+"), "");
+}
+
+TEST(GrepEngine, MatchesGlobs) {
+  EXPECT_TRUE(GrepEngine::globMatch("*.cpp", "main.cpp"));
+  EXPECT_FALSE(GrepEngine::globMatch("*.cpp", "main.cc"));
+  EXPECT_TRUE(GrepEngine::globMatch("*.[ch]pp", "a.hpp"));
+  EXPECT_TRUE(GrepEngine::globMatch("src/*/x?.h", "src/core/x1.h"));
+  EXPECT_FALSE(GrepEngine::globMatch("src/*.h", "src/core/x.h"));
+  EXPECT_TRUE(GrepEngine::globMatch("[!_]*", "a_b"));
+}
+
+TEST(GrepEngine, PrunesIgnoredDirsAndSkipsBinaries) {
+  fs::path root = fs::temp_directory_path() / "photon_grep_engine_prune";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root / "src");
+  fs::create_directories(root / "build");
+  fs::create_directories(root / ".git");
+  createFile(root / "src" / "a.cpp", "int x = Needle();\r\nint y;\nint z = Needle() + 1;\n");
+  createFile(root / "build" / "gen.cpp", "Needle();\n");
+  createFile(root / ".git" / "HEAD", "Needle\n");
+  {
+    std::ofstream bin(root / "src" / "blob.bin", std::ios::binary);
+    bin << "Needle" << '\0' << "data";
+  }
+
+  ScanIgnoreRules ignore({"build"});
+  GrepEngine::Options options;
+  auto found = GrepEngine::search(root, ".", "Needle\\(\\)", options, &ignore);
+  ASSERT_TRUE(found.error.empty()) << found.error;
+  ASSERT_EQ(found.matches.size(), 2u);
+  EXPECT_EQ(found.matches[0].file, "src/a.cpp");
+  EXPECT_EQ(found.matches[0].line, 1);
+  EXPECT_EQ(found.matches[0].content, "int x = Needle();");
+  EXPECT_EQ(found.matches[1].line, 3);
+  EXPECT_EQ(found.filesSkipped, 1u);
+
+  // 正则校验：字面量出现但整行不匹配时不计入
+  found = GrepEngine::search(root, "src", "^int z = Needle", options, &ignore);
+  ASSERT_EQ(found.matches.size(), 1u);
+  EXPECT_EQ(found.matches[0].line, 3);
+
+  EXPECT_FALSE(GrepEngine::search(root, "../", "x", options, &ignore).error.empty());
+  EXPECT_FALSE(GrepEngine::search(root, ".", "(unclosed", options, &ignore).error.empty());
+}
+
+TEST(GrepEngine, EarlyTerminationKeepsFileOrder) {
+  fs::path root = fs::temp_directory_path() / "photon_grep_engine_order";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  for (int f = 0; f < 40; ++f) {
+    std::string body;
+    for (int i = 0; i < 10; ++i) body += "hit " + std::to_string(i) + "\n";
+    char name[16];
+    std::snprintf(name, sizeof(name), "f%02d.txt", f);
+    createFile(root / name, body);
+  }
+  GrepEngine::Options options;
+  options.maxResults = 25;
+  options.threads = 4;
+  auto found = GrepEngine::search(root, ".", "hit", options, nullptr);
+  ASSERT_EQ(found.matches.size(), 25u);
+  EXPECT_TRUE(found.truncated);
+  // 与顺序搜索一致：f00 的 10 行、f01 的 10 行、f02 的前 5 行
+  EXPECT_EQ(found.matches[0].file, "f00.txt");
+  EXPECT_EQ(found.matches[19].file, "f01.txt");
+  EXPECT_EQ(found.matches[24].file, "f02.txt");
+  EXPECT_EQ(found.matches[24].line, 5);
+  EXPECT_LT(found.filesScanned, 40u);
+}
+
+TEST(GrepTool, SkipsAndReportsLinesTooLongForRegex) {
+  fs::path root = fs::temp_directory_path() / "photon_grep_test_long_line";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  // 单行 1MB+ 的压缩文件：std::regex_search 在这样的行上会递归到栈溢出
+  createFile(root / "bundle.min.js", "foo" + std::string(1024 * 1024, 'x') + "bar");
+  createFile(root / "a.cpp", "int foo = bar;\nint other;\n");
+
+  GrepTool tool(root.u8string());
+  auto res = tool.execute({{"pattern", "foo.*bar"}, {"with_symbols", false}});
+  ASSERT_FALSE(res.contains("error")) << res.dump();
+  ASSERT_EQ(res["count"], 1);
+  EXPECT_EQ(res["matches"][0]["file"], "a.cpp");
+  ASSERT_TRUE(res.contains("skipped_long_lines"));
+  ASSERT_EQ(res["skipped_long_lines"].size(), 1u);
+  EXPECT_EQ(res["skipped_long_lines"][0]["file"], "bundle.min.js");
+  EXPECT_EQ(res["skipped_long_lines"][0]["line"], 1);
+  EXPECT_GE(res["skipped_long_lines"][0]["bytes"].get<size_t>(), 1024u * 1024u);
+  EXPECT_NE(res["content"][0]["text"].get<std::string>().find("bundle.min.js:1"), std::string::npos);
+
+  // 纯字面模式不运行正则，长行照常匹配
+  auto literal = tool.execute({{"pattern", "foo"}, {"with_symbols", false}});
+  EXPECT_EQ(literal["count"], 2);
+  EXPECT_FALSE(literal.contains("skipped_long_lines"));
+  fs::remove_all(root, ec);
+}
+
+TEST(GrepTool, ExternalFallbackStreamsAndStopsEarly) {
+  fs::path root = fs::temp_directory_path() / "photon_grep_test_external";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root / "build");
+  std::string body;
+  for (int i = 0; i < 20000; ++i) body += "entry " + std::to_string(i) + ": key:value\n";
+  createFile(root / "big.txt", body);
+  createFile(root / "build" / "gen.txt", "key:value\n");
+
+  // x{,1} 不是合法的 ECMAScript 正则，走外部 rg / grep
+  auto ignore = std::make_shared<ScanIgnoreRules>(std::vector<std::string>{"build"});
+  GrepTool tool(root.u8string(), ignore);
+  auto res = tool.execute({{"pattern", "key{,1}:value"}, {"max_results", 3}});
+  if (res.contains("error")) GTEST_SKIP() << "no external grep: " << res["error"].get<std::string>();
+  ASSERT_EQ(res["count"].get<int>(), 3) << res.dump(2);
+  // 内容中的 ':' 不影响 path / line 解析
+  EXPECT_EQ(res["matches"][0]["file"].get<std::string>(), "big.txt");
+  EXPECT_EQ(res["matches"][0]["line"].get<int>(), 1);
+  EXPECT_EQ(res["matches"][0]["content"].get<std::string>(), "entry 0: key:value");
+}
+
+namespace {
+
+// 带结束行的最小符号提供者：以 "int name(...) {" 开始、以 "}" 结束
+class BraceFunctionProvider : public ISymbolProvider {
+public:
+  std::vector<Symbol> extractSymbols(const std::string& content, const std::string& relPath) const override {
+    std::vector<Symbol> out;
+    std::istringstream in(content);
+    std::string line;
+    for (int n = 1; std::getline(in, line); ++n) {
+      if (line.rfind("int ", 0) == 0 && !line.empty() && line.back() == '{') {
+        Symbol s;
+        s.name = line.substr(4, line.find('(') - 4);
+        s.type = "function";
+        s.source = "test";
+        s.path = relPath;
+        s.line = n;
+        out.push_back(s);
+      } else if (line == "}" && !out.empty()) {
+        out.back().endLine = n;
+      }
+    }
+    return out;
+  }
+  bool supportsExtension(const std::string& ext) const override { return ext == ".cpp"; }
+};
+
+}  // namespace
+
+TEST(GrepTool, AnnotatesAndGroupsByEnclosingSymbol) {
+  fs::path root = fs::temp_directory_path() / "photon_grep_test_symbols";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  createFile(root / "a.cpp",
+             "// token at top level\n"
+             "int parse(int x) {\n"
+             "  int token = x;\n"
+             "  return token + 1;\n"
+             "}\n"
+             "int emit(int y) {\n"
+             "  return y; // token\n"
+             "}\n");
+
+  SymbolManager symbolManager(root.u8string());
+  symbolManager.registerProvider(std::make_unique<BraceFunctionProvider>());
+  symbolManager.scanBlocking();
+
+  GrepTool tool(root.u8string(), nullptr, &symbolManager);
+  auto res = tool.execute({{"pattern", "token"}});
+  ASSERT_EQ(res["count"].get<int>(), 4) << res.dump(2);
+  EXPECT_FALSE(res["matches"][0].contains("symbol"));
+  EXPECT_EQ(res["matches"][1]["symbol"]["name"].get<std::string>(), "parse");
+  EXPECT_EQ(res["matches"][1]["symbol"]["line"].get<int>(), 2);
+  EXPECT_EQ(res["matches"][1]["symbol"]["end_line"].get<int>(), 5);
+  EXPECT_EQ(res["matches"][3]["symbol"]["name"].get<std::string>(), "emit");
+
+  // 同一函数内的匹配归在一个分组下
+  std::string text = res["content"][0]["text"].get<std::string>();
+  EXPECT_NE(text.find("  function parse (2-5)\n    3:   int token = x;\n    4:   return token + 1;\n"), std::string::npos) << text;
+  EXPECT_NE(text.find("  (top level)\n    1: "), std::string::npos) << text;
+
+  auto plain = tool.execute({{"pattern", "token"}, {"with_symbols", false}});
+  EXPECT_FALSE(plain["matches"][1].contains("symbol"));
+  EXPECT_NE(plain["content"][0]["text"].get<std::string>().find("a.cpp:3:"), std::string::npos);
+
+  // 批量查询与逐条查询一致
+  std::vector<std::pair<std::string, int>> queries = {{"a.cpp", 1}, {"a.cpp", 3}, {"a.cpp", 3}, {"a.cpp", 7}, {"b.cpp", 1}};
+  auto batch = symbolManager.findEnclosingSymbols(queries);
+  ASSERT_EQ(batch.size(), queries.size());
+  for (size_t i = 0; i < queries.size(); ++i) {
+    auto single = symbolManager.findEnclosingSymbol(queries[i].first, queries[i].second);
+    ASSERT_EQ(batch[i].has_value(), single.has_value()) << i;
+    if (single) {
+      EXPECT_EQ(batch[i]->name, single->name);
+    }
+  }
+}
@@ -0,0 +1,136 @@
+/**
+ * HttpClientPool 单元测试：在本机启动 httplib 服务端（明文 HTTP，不联网），
+ * 以服务端看到的客户端端口区分 TCP 连接，验证 keep-alive 复用、每 host 上限、空闲超时回收，
+ * 以及 LLMClient 的请求经由连接池发出。
+ */
+
+#include <gtest/gtest.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "httplib.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "core/HttpClientPool.h"
+#include "core/LLMClient.h"
+
+namespace {
+
+class LocalServer {
+public:
+  explicit LocalServer(int delayMs = 0) {
+    auto handler = [this, delayMs](const httplib::Request& req, httplib::Response& res) {
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        ports.insert(req.remote_port);
+      }
+      if (delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+      res.set_content(R"({"choices":[{"message":{"role":"assistant","content":"pong"}}]})", "application/json");
+    };
+    server.Post("/echo", handler);
+    server.Post("/v1/chat/completions", handler);
+    port = server.bind_to_any_port("127.0.0.1");
+    thread = std::thread([this] { server.listen_after_bind(); });
+    server.wait_until_ready();
+  }
+  ~LocalServer() {
+    server.stop();
+    thread.join();
+  }
+
+  size_t connectionCount() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return ports.size();
+  }
+
+  int port = 0;
+
+private:
+  httplib::Server server;
+  std::thread thread;
+  std::mutex mtx;
+  std::set<int> ports;
+};
+
+HttpClientPool::Options poolOptions(size_t maxPerHost, int idleTimeoutSec = 60) {
+  HttpClientPool::Options opts;
+  opts.maxPerHost = maxPerHost;
+  opts.idleTimeoutSec = idleTimeoutSec;
+  return opts;
+}
+
+bool post(HttpClientPool& pool, int port) {
+  auto cli = pool.acquire(false, "127.0.0.1", port);
+  auto res = cli->Post("/echo", "{}", "application/json");
+  if (!res) cli.discard();
+  return res && res->status == 200;
+}
+
+}  // namespace
+
+TEST(HttpClientPool, ReusesKeepAliveConnection) {
+  LocalServer server;
+  HttpClientPool pool(poolOptions(2));
+  for (int i = 0; i < 5; ++i) ASSERT_TRUE(post(pool, server.port));
+
+  EXPECT_EQ(server.connectionCount(), 1u);
+  auto stats = pool.getStats();
+  EXPECT_EQ(stats.created, 1u);
+  EXPECT_EQ(stats.reused, 4u);
+}
+
+TEST(HttpClientPool, ZeroSizeOpensConnectionPerRequest) {
+  LocalServer server;
+  HttpClientPool pool(poolOptions(0));
+  for (int i = 0; i < 3; ++i) ASSERT_TRUE(post(pool, server.port));
+
+  EXPECT_EQ(server.connectionCount(), 3u);
+  EXPECT_EQ(pool.getStats().reused, 0u);
+}
+
+TEST(HttpClientPool, CapsConcurrentClientsPerHost) {
+  LocalServer server(30);
+  HttpClientPool pool(poolOptions(2));
+  std::vector<std::thread> workers;
+  std::atomic<int> ok{0};
+  for (int i = 0; i < 6; ++i) {
+    workers.emplace_back([&] {
+      if (post(pool, server.port)) ++ok;
+    });
+  }
+  for (auto& t : workers) t.join();
+
+  EXPECT_EQ(ok.load(), 6);
+  EXPECT_LE(pool.getStats().created, 2u);
+  EXPECT_LE(server.connectionCount(), 2u);
+}
+
+TEST(HttpClientPool, EvictsIdleConnections) {
+  LocalServer server;
+  HttpClientPool pool(poolOptions(2, 0));
+  ASSERT_TRUE(post(pool, server.port));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_TRUE(post(pool, server.port));
+
+  auto stats = pool.getStats();
+  EXPECT_EQ(stats.evictedIdle, 1u);
+  EXPECT_EQ(stats.created, 2u);
+  EXPECT_EQ(server.connectionCount(), 2u);
+}
+
+TEST(HttpClientPool, LLMClientRequestsShareConnection) {
+  LocalServer server;
+  LLMClient client("fake_key", "http://127.0.0.1:" + std::to_string(server.port) + "/v1", "fake_model");
+  EXPECT_EQ(client.chat("ping"), "pong");
+  EXPECT_EQ(client.summarize("some text"), "pong");
+
+  EXPECT_EQ(server.connectionCount(), 1u);
+  EXPECT_EQ(client.getConnectionPool()->getStats().reused, 1u);
+}
@@ -0,0 +1,132 @@
+/**
+ * LLMClient 按用途路由的单元测试：在本机启动 httplib 服务端（明文 HTTP，不联网），以请求体中的 model 区分去向，
+ * 验证 summarize / plan 发往各自路由的模型与 endpoint、agent 主循环（chatWithTools / Stream）始终使用主模型，
+ * 以及按用途累计的时延直方图。
+ */
+
+#include <gtest/gtest.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "httplib.h"
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/Conversation.h"
+#include "core/LLMClient.h"
+
+namespace {
+
+class ModelRecordingServer {
+public:
+  ModelRecordingServer() {
+    server.Post("/v1/chat/completions", [this](const httplib::Request& req, httplib::Response& res) {
+      bool stream = false;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        try {
+          auto body = nlohmann::json::parse(req.body);
+          models.push_back(body.value("model", ""));
+          stream = body.value("stream", false);
+        } catch (...) {}
+      }
+      if (stream) {
+        res.set_content("data: {\"choices\":[{\"delta\":{\"content\":\"pong\"}}]}\n\n"
+                        "data: {\"choices\":[{\"delta\":{},\"finish_reason\":\"stop\"}]}\n\ndata: [DONE]\n\n",
+                        "text/event-stream");
+      } else {
+        res.set_content(R"({"choices":[{"message":{"role":"assistant","content":"pong"}}]})", "application/json");
+      }
+    });
+    port = server.bind_to_any_port("127.0.0.1");
+    thread = std::thread([this] { server.listen_after_bind(); });
+    server.wait_until_ready();
+  }
+  ~ModelRecordingServer() {
+    server.stop();
+    thread.join();
+  }
+
+  std::string url() const { return "http://127.0.0.1:" + std::to_string(port) + "/v1"; }
+
+  std::vector<std::string> seenModels() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return models;
+  }
+
+  int port = 0;
+
+private:
+  httplib::Server server;
+  std::thread thread;
+  std::mutex mtx;
+  std::vector<std::string> models;
+};
+
+LLMRoute routeTo(const ModelRecordingServer& server, const std::string& model) {
+  LLMRoute route;
+  route.model = model;
+  route.baseUrl = server.url();
+  route.timeoutSec = 5;
+  route.maxConcurrent = 1;
+  return route;
+}
+
+}  // namespace
+
+TEST(LLMRouting, RoutesAuxiliaryCallsByPurpose) {
+  ModelRecordingServer mainServer;
+  ModelRecordingServer fastServer;
+  LLMClient client("fake_key", mainServer.url(), "big_model");
+  client.setRoute(LLMPurpose::Summarizer, routeTo(fastServer, "small_model"));
+  EXPECT_TRUE(client.hasRoute(LLMPurpose::Summarizer));
+  EXPECT_FALSE(client.hasRoute(LLMPurpose::Planner));
+  EXPECT_EQ(client.routeModel(LLMPurpose::Summarizer), "small_model");
+  EXPECT_EQ(client.routeModel(LLMPurpose::Planner), "big_model");
+
+  EXPECT_EQ(client.summarize("some text"), "pong");
+  EXPECT_EQ(client.summarizeAsync("more text").get(), "pong");
+  EXPECT_EQ(client.chat("ping"), "pong");
+
+  EXPECT_EQ(mainServer.seenModels(), std::vector<std::string>{"big_model"});
+  EXPECT_EQ(fastServer.seenModels(), (std::vector<std::string>{"small_model", "small_model"}));
+  // 时延按用途分别累计；路由客户端与主客户端共用连接池
+  EXPECT_EQ(client.getLatencyHistogram(LLMPurpose::Summarizer).count, 2u);
+  EXPECT_EQ(client.getLatencyHistogram(LLMPurpose::Embedder).count, 0u);
+  EXPECT_EQ(client.getConnectionPool()->getStats().reused, 1u);
+}
+
+TEST(LLMRouting, PlannerRouteLeavesMainLoopOnPrimaryModel) {
+  ModelRecordingServer mainServer;
+  ModelRecordingServer plannerServer;
+  LLMClient client("fake_key", mainServer.url(), "big_model");
+  client.setRoute(LLMPurpose::Planner, routeTo(plannerServer, "planner_model"));
+
+  Conversation conv;
+  conv.push_back({{"role", "user"}, {"content", "hi"}});
+  const auto tools = nlohmann::json::array();
+  EXPECT_EQ(client.chatWithTools(conv, tools)["choices"][0]["message"]["content"], "pong");
+  EXPECT_EQ(client.chatWithToolsStream(conv, tools, ChatStreamCallbacks())["choices"][0]["message"]["content"], "pong");
+  EXPECT_EQ(client.plan(conv, tools)["choices"][0]["message"]["content"], "pong");
+
+  EXPECT_EQ(mainServer.seenModels(), (std::vector<std::string>{"big_model", "big_model"}));
+  EXPECT_EQ(plannerServer.seenModels(), std::vector<std::string>{"planner_model"});
+  // 主循环的指标来自主客户端，不被 planner 路由截走
+  EXPECT_EQ(client.getLastPrefixMetrics().requests, 2u);
+  EXPECT_GT(client.getLastStreamMetrics().events, 0u);
+  EXPECT_EQ(client.getLatencyHistogram(LLMPurpose::Planner).count, 1u);
+}
+
+TEST(LLMRouting, LatencyHistogramBuckets) {
+  LatencyHistogram h;
+  for (double ms : {10.0, 20.0, 300.0, 40000.0}) h.record(ms);
+  EXPECT_EQ(h.buckets.front(), 2u);
+  EXPECT_EQ(h.buckets.back(), 1u);
+  EXPECT_EQ(h.percentile(0.5), 50.0);
+  EXPECT_EQ(h.percentile(0.75), 500.0);
+  EXPECT_EQ(h.percentile(1.0), 40000.0);
+}
@@ -0,0 +1,153 @@
+/**
+ * 流式 chat completions 单元测试：SseParser 对任意切分 / CRLF / 注释 / 多行 data 的处理；
+ * LLMClient::chatWithToolsStream 对本机 httplib SSE 服务的增量交付（正文、tool_call 参数、
+ * 参数完整即触发 onToolCallReady）、TTFT 指标，以及服务端返回普通 JSON 时的回退。
+ */
+
+#include <gtest/gtest.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "httplib.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/LLMClient.h"
+#include "core/SseParser.h"
+
+namespace {
+
+std::vector<SseParser::Event> parseInPieces(const std::string& stream, size_t pieceSize) {
+  std::vector<SseParser::Event> events;
+  SseParser parser([&](const SseParser::Event& ev) { events.push_back(ev); });
+  for (size_t i = 0; i < stream.size(); i += pieceSize) {
+    parser.feed(stream.substr(i, pieceSize));
+  }
+  parser.finish();
+  return events;
+}
+
+std::string sseData(const std::string& json) { return "data: " + json + "\n\n"; }
+
+class StreamingServer {
+public:
+  explicit StreamingServer(std::vector<std::string> chunks, std::string plainJson = "") {
+    server.Post("/v1/chat/completions", [this, chunks, plainJson](const httplib::Request& req, httplib::Response& res) {
+      lastBody = req.body;
+      if (!plainJson.empty()) {
+        res.set_content(plainJson, "application/json");
+        return;
+      }
+      res.set_chunked_content_provider("text/event-stream", [chunks](size_t, httplib::DataSink& sink) {
+        for (const auto& c : chunks) {
+          sink.write(c.data(), c.size());
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        sink.done();
+        return true;
+      });
+    });
+    port = server.bind_to_any_port("127.0.0.1");
+    thread = std::thread([this] { server.listen_after_bind(); });
+    server.wait_until_ready();
+  }
+  ~StreamingServer() {
+    server.stop();
+    thread.join();
+  }
+  std::string baseUrl() const { return "http://127.0.0.1:" + std::to_string(port) + "/v1"; }
+
+  int port = 0;
+  std::string lastBody;
+
+private:
+  httplib::Server server;
+  std::thread thread;
+};
+
+}  // namespace
+
+TEST(SseParser, HandlesArbitrarySplitsAndLineEndings) {
+  std::string stream =
+      ": keep-alive\r\n"
+      "data: {\"a\":1}\r\n\r\n"
+      "event: update\n"
+      "data: line1\n"
+      "data: line2\n\n"
+      "data:no-space\r\r"
+      "data: tail-without-blank-line";
+  for (size_t piece : {1u, 2u, 3u, 7u, 1000u}) {
+    auto events = parseInPieces(stream, piece);
+    ASSERT_EQ(events.size(), 4u) << "piece=" << piece;
+    EXPECT_EQ(events[0].data, "{\"a\":1}");
+    EXPECT_EQ(events[1].event, "update");
+    EXPECT_EQ(events[1].data, "line1\nline2");
+    EXPECT_EQ(events[2].data, "no-space");
+    EXPECT_EQ(events[3].data, "tail-without-blank-line");
+  }
+}
+
+TEST(LLMStreaming, DeliversContentAndToolCallDeltas) {
+  std::vector<std::string> chunks = {
+      sseData(R"({"choices":[{"index":0,"delta":{"role":"assistant","content":"Hel"}}]})"),
+      sseData(R"({"choices":[{"index":0,"delta":{"content":"lo\n"}}]})"),
+      sseData(R"({"choices":[{"index":0,"delta":{"tool_calls":[{"index":0,"id":"call_a","type":"function","function":{"name":"grep","arguments":""}}]}}]})"),
+      sseData(R"({"choices":[{"index":0,"delta":{"tool_calls":[{"index":0,"function":{"arguments":"{\"pattern\":"}}]}}]})"),
+      sseData(R"({"choices":[{"index":0,"delta":{"tool_calls":[{"index":0,"function":{"arguments":"\"foo\"}"}}]}}]})"),
+      sseData(R"({"choices":[{"index":0,"delta":{"tool_calls":[{"index":1,"id":"call_b","type":"function","function":{"name":"write","arguments":"{\"path\":\"x\"}"}}]}}]})"),
+      sseData(R"({"choices":[{"index":0,"delta":{},"finish_reason":"tool_calls"}]})"),
+      "data: [DONE]\n\n"};
+  StreamingServer server(chunks);
+  LLMClient client("fake_key", server.baseUrl(), "fake_model");
+
+  std::string content;
+  std::vector<std::string> order;  // 回调触发顺序
+  ChatStreamCallbacks callbacks;
+  callbacks.onContent = [&](const std::string& d) { content += d; };
+  callbacks.onToolCallDelta = [&](size_t index, const std::string&) { order.push_back("delta" + std::to_string(index)); };
+  callbacks.onToolCallReady = [&](size_t index, const nlohmann::json& tc) {
+    order.push_back("ready" + std::to_string(index) + ":" + tc["function"]["arguments"].get<std::string>());
+  };
+
+  auto res = client.chatWithToolsStream(nlohmann::json::array({{{"role", "user"}, {"content", "hi"}}}),
+                                        nlohmann::json::array(), callbacks);
+
+  EXPECT_EQ(nlohmann::json::parse(server.lastBody).value("stream", false), true);
+  EXPECT_EQ(content, "Hello\n");
+  // 第一个调用的参数拼完即就绪，早于第二个调用的增量
+  std::vector<std::string> expected = {"delta0", "delta0", "ready0:{\"pattern\":\"foo\"}", "delta1",
+                                       "ready1:{\"path\":\"x\"}"};
+  EXPECT_EQ(order, expected);
+
+  ASSERT_TRUE(res.contains("choices"));
+  const auto& choice = res["choices"][0];
+  EXPECT_EQ(choice["finish_reason"], "tool_calls");
+  EXPECT_EQ(choice["message"]["content"], "Hello\n");
+  ASSERT_EQ(choice["message"]["tool_calls"].size(), 2u);
+  EXPECT_EQ(choice["message"]["tool_calls"][0]["id"], "call_a");
+  EXPECT_EQ(choice["message"]["tool_calls"][0]["function"]["name"], "grep");
+  EXPECT_EQ(choice["message"]["tool_calls"][1]["function"]["arguments"], "{\"path\":\"x\"}");
+
+  auto metrics = client.getLastStreamMetrics();
+  EXPECT_GE(metrics.ttftMs, 0.0);
+  EXPECT_GE(metrics.totalMs, metrics.ttftMs);
+  EXPECT_EQ(metrics.events, chunks.size());
+}
+
+TEST(LLMStreaming, FallsBackToPlainJsonResponse) {
+  StreamingServer server({}, R"({"choices":[{"message":{"role":"assistant","content":"plain"},"finish_reason":"stop"}]})");
+  LLMClient client("fake_key", server.baseUrl(), "fake_model");
+
+  std::string content;
+  ChatStreamCallbacks callbacks;
+  callbacks.onContent = [&](const std::string& d) { content += d; };
+  auto res = client.chatWithToolsStream(nlohmann::json::array({{{"role", "user"}, {"content", "hi"}}}),
+                                        nlohmann::json::array(), callbacks);
+
+  EXPECT_EQ(content, "plain");
+  EXPECT_EQ(res["choices"][0]["message"]["content"], "plain");
+  EXPECT_EQ(res["choices"][0]["finish_reason"], "stop");
+}
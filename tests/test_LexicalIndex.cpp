@@ -0,0 +1,193 @@
+/**
+ * LexicalIndex 单元测试：代码感知分词、BM25 排序、按文件增量更新、压缩 posting 与持久化往返、损坏索引文件被拒绝。
+ */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "analysis/LexicalIndex.h"
+
+namespace fs = std::filesystem;
+
+static bool hasToken(const std::vector<std::string>& tokens, const std::string& t) {
+  return std::find(tokens.begin(), tokens.end(), t) != tokens.end();
+}
+
+TEST(LexicalIndex, TokenizesIdentifiersAndPaths) {
+  auto tokens = LexicalIndex::tokenize("parseUnifiedDiff read_code_block HTTPServer src/core/LLMClient.cpp");
+  EXPECT_TRUE(hasToken(tokens, "parseunifieddiff"));
+  EXPECT_TRUE(hasToken(tokens, "parse"));
+  EXPECT_TRUE(hasToken(tokens, "unified"));
+  EXPECT_TRUE(hasToken(tokens, "diff"));
+  EXPECT_TRUE(hasToken(tokens, "read_code_block"));
+  EXPECT_TRUE(hasToken(tokens, "block"));
+  EXPECT_TRUE(hasToken(tokens, "http"));
+  EXPECT_TRUE(hasToken(tokens, "server"));
+  EXPECT_TRUE(hasToken(tokens, "llmclient.cpp"));
+  EXPECT_TRUE(hasToken(tokens, "core"));
+  // 停用词与单字符被过滤
+  EXPECT_FALSE(hasToken(LexicalIndex::tokenize("where is the x"), "the"));
+}
+
+TEST(LexicalIndex, Bm25RanksIdentifierMatchesFirst) {
+  LexicalIndex index;
+  index.addDocument("a.cpp", "a", "void applyPatch() { auto hunks = parseUnifiedDiff(text); }");
+  index.addDocument("b.cpp", "b", "void render() { draw(diff); }");
+  index.addDocument("c.md", "c", "The unified diff format is described here.");
+
+  auto hits = index.search("where is parseUnifiedDiff called", 3);
+  ASSERT_FALSE(hits.empty());
+  EXPECT_EQ(hits[0].key, "a");
+  EXPECT_GT(hits[0].score, 0.0);
+}
+
+TEST(LexicalIndex, IncrementalGroupUpdate) {
+  LexicalIndex index;
+  index.addDocument("a.cpp", "a#1", "alpha beta");
+  index.addDocument("a.cpp", "a#2", "gamma delta");
+  index.addDocument("b.cpp", "b#1", "alpha epsilon");
+  EXPECT_EQ(index.documentCount(), 3u);
+
+  index.removeGroup("a.cpp");
+  EXPECT_EQ(index.documentCount(), 1u);
+  auto hits = index.search("alpha", 5);
+  ASSERT_EQ(hits.size(), 1u);
+  EXPECT_EQ(hits[0].key, "b#1");
+  EXPECT_TRUE(index.search("gamma", 5).empty());
+
+  // 同 key 重新添加即替换
+  index.addDocument("b.cpp", "b#1", "zeta");
+  EXPECT_EQ(index.documentCount(), 1u);
+  EXPECT_TRUE(index.search("alpha", 5).empty());
+  EXPECT_EQ(index.search("zeta", 5).size(), 1u);
+}
+
+TEST(LexicalIndex, PostingsAreCompressedAndPersist) {
+  LexicalIndex index;
+  for (int i = 0; i < 500; ++i) {
+    index.addDocument("f" + std::to_string(i), "k" + std::to_string(i), "common token shared" + std::to_string(i % 7));
+  }
+  // 每个文档 4 个词项（common/token/shared/sharedN）：每条 posting 为 1 字节差值 + 1 字节 tf，
+  // 未压缩的 (docId, tf) 两个 uint32 则需 8 字节
+  EXPECT_LE(index.postingBytes(), 500u * 4u * 2u);
+
+  fs::path file = fs::temp_directory_path() / "photon_lexical_index_test.bin";
+  ASSERT_TRUE(index.save(file));
+  LexicalIndex loaded;
+  ASSERT_TRUE(loaded.load(file));
+  EXPECT_EQ(loaded.documentCount(), 500u);
+  auto a = index.search("shared3 common", 5);
+  auto b = loaded.search("shared3 common", 5);
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) EXPECT_EQ(a[i].key, b[i].key);
+  fs::remove(file);
+}
+
+// 纯字母的唯一词（数字会被切成子词）
+static std::string letters(const std::string& prefix, int n) {
+  std::string out = prefix;
+  do {
+    out += static_cast<char>('a' + n % 26);
+    n /= 26;
+  } while (n > 0);
+  return out;
+}
+
+TEST(LexicalIndex, CompactsTombstonesAndUnusedTerms) {
+  LexicalIndex index;
+  index.addDocument("keep.cpp", "keep", "stable anchor");
+  // 反复重建同一文件，每轮的词项都不同
+  for (int round = 0; round < 50; ++round) {
+    index.removeGroup("churn.cpp");
+    for (int k = 0; k < 10; ++k) {
+      index.addDocument("churn.cpp", "c" + std::to_string(k),
+                        letters("churn", round) + " " + letters("item", k));
+    }
+  }
+  EXPECT_EQ(index.documentCount(), 11u);
+  // 压缩后槽位与词项数有界（未压缩时为 501 个槽位、60 个词项）
+  EXPECT_LT(index.storedDocumentCount(), 64u);
+  EXPECT_LE(index.termCount(), 2u + 1u + 10u + 10u);
+  EXPECT_TRUE(index.search(letters("churn", 3), 5).empty());
+  ASSERT_EQ(index.search(letters("churn", 49), 20).size(), 10u);
+  auto hits = index.search("anchor", 5);
+  ASSERT_EQ(hits.size(), 1u);
+  EXPECT_EQ(hits[0].key, "keep");
+
+  // 压缩后的编号可继续增量更新与持久化
+  index.removeGroup("keep.cpp");
+  fs::path file = fs::temp_directory_path() / "photon_lexical_index_compact.bin";
+  ASSERT_TRUE(index.save(file));
+  LexicalIndex loaded;
+  ASSERT_TRUE(loaded.load(file));
+  EXPECT_EQ(loaded.documentCount(), 10u);
+  EXPECT_EQ(loaded.search(letters("item", 7), 5).size(), 1u);
+  EXPECT_TRUE(loaded.search("anchor", 5).empty());
+  fs::remove(file);
+}
+
+static std::string readBytes(const fs::path& p) {
+  std::ifstream f(p, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static void writeBytes(const fs::path& p, const std::string& bytes) {
+  std::ofstream f(p, std::ios::binary | std::ios::trunc);
+  f.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+static std::string patchU32(std::string bytes, size_t offset, std::uint32_t v) {
+  std::memcpy(&bytes[offset], &v, sizeof(v));
+  return bytes;
+}
+
+TEST(LexicalIndex, RejectsCorruptFiles) {
+  LexicalIndex index;
+  index.addDocument("a", "a", "alpha");
+  index.addDocument("b", "b", "beta");
+  index.removeGroup("b");  // 槽位 1 成为墓碑，"beta" 的 posting 为空
+  fs::path file = fs::temp_directory_path() / "photon_lexical_index_corrupt.bin";
+  ASSERT_TRUE(index.save(file));
+  const std::string good = readBytes(file);
+  // 布局：magic[0,4) termCount[4,8)
+  //   "alpha": len[8,12) str[12,17) df[17,21) lastDoc[21,25) byteLen[25,29) posting[29]=差值 [30]=tf
+  //   "beta":  len[31,35) str[35,39) df[39,43) lastDoc[43,47) byteLen[47,51)
+  //   docCount[51,55) ...
+  ASSERT_GT(good.size(), 55u);
+  ASSERT_EQ(good.substr(12, 5), "alpha");
+
+  LexicalIndex loaded;
+  ASSERT_TRUE(loaded.load(file));
+  ASSERT_EQ(loaded.search("alpha", 5).size(), 1u);
+
+  std::vector<std::pair<std::string, std::string>> cases = {
+      {"huge term count", patchU32(good, 4, 0xFFFFFFFFu)},
+      {"huge term length", patchU32(good, 8, 0x7FFFFFFFu)},
+      {"huge posting length", patchU32(good, 25, 0x7FFFFFFFu)},
+      {"df mismatch", patchU32(good, 17, 3)},
+      {"huge doc count", patchU32(good, 51, 0xFFFFFFFFu)},
+      {"truncated", good.substr(0, 40)},
+  };
+  std::string deadDoc = good;
+  deadDoc[29] = 1;  // 指向已删除的槽位 1
+  cases.emplace_back("posting to dead doc", deadDoc);
+  std::string outOfRange = good;
+  outOfRange[29] = 7;  // docId 超出 docCount
+  cases.emplace_back("posting out of range", outOfRange);
+  std::string badVarint = good;
+  badVarint[30] = static_cast<char>(0x80);  // tf 的 varint 在 posting 末尾被截断
+  cases.emplace_back("truncated varint", badVarint);
+
+  for (const auto& [name, bytes] : cases) {
+    writeBytes(file, bytes);
+    EXPECT_FALSE(loaded.load(file)) << name;
+    // 失败的 load 不改动已有内容
+    EXPECT_EQ(loaded.search("alpha", 5).size(), 1u) << name;
+  }
+  fs::remove(file);
+}
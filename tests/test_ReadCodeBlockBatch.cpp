@@ -0,0 +1,109 @@
+/**
+ * read_code_block 批量模式单元测试：按文件分组并行读取后，每一项的结果与单独调用一致、
+ * 输出顺序与请求顺序一致（多次运行相同），无效项与不存在的文件在原位置报告错误。
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "analysis/SymbolManager.h"
+#include "tools/CoreTools.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 带结束行的最小符号提供者：以 "int name(...) {" 开始、以 "}" 结束
+class BlockProvider : public ISymbolProvider {
+public:
+  std::vector<Symbol> extractSymbols(const std::string& content, const std::string& relPath) const override {
+    std::vector<Symbol> out;
+    std::istringstream in(content);
+    std::string line;
+    for (int n = 1; std::getline(in, line); ++n) {
+      if (line.rfind("int ", 0) == 0 && !line.empty() && line.back() == '{') {
+        Symbol s;
+        s.name = line.substr(4, line.find('(') - 4);
+        s.type = "function";
+        s.source = "test";
+        s.path = relPath;
+        s.line = n;
+        out.push_back(s);
+      } else if (line == "}" && !out.empty()) {
+        out.back().endLine = n;
+      }
+    }
+    return out;
+  }
+  bool supportsExtension(const std::string& ext) const override { return ext == ".cpp"; }
+};
+
+std::string textOf(const nlohmann::json& result) {
+  if (!result.contains("content")) return "";
+  return result["content"][0]["text"].get<std::string>();
+}
+
+}  // namespace
+
+TEST(ReadCodeBlockBatch, MatchesSingleReadsInRequestOrder) {
+  fs::path root = fs::temp_directory_path() / "photon_test_read_batch";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root / "src");
+  for (int f = 0; f < 4; ++f) {
+    std::ofstream out(root / "src" / ("m" + std::to_string(f) + ".cpp"));
+    for (int k = 0; k < 5; ++k) {
+      out << "int f" << f << "_" << k << "(int v) {\n  return v + " << k << ";\n}\n";
+    }
+  }
+
+  SymbolManager symbolManager(root.u8string());
+  symbolManager.registerProvider(std::make_unique<BlockProvider>());
+  symbolManager.scanBlocking();
+  ReadCodeBlockTool tool(root.u8string(), &symbolManager);
+
+  nlohmann::json requests = nlohmann::json::array({
+      {{"file_path", "src/m2.cpp"}, {"symbol_name", "f2_3"}},
+      {{"file_path", "src/m0.cpp"}, {"start_line", 1}, {"end_line", 4}},
+      {{"file_path", "src/missing.cpp"}, {"start_line", 1}},
+      {{"file_path", "./src/m2.cpp"}, {"symbol_name", "f2_0"}},
+      {{"file_path", "src/m1.cpp"}},
+      {{"file_path", "src/m3.cpp"}, {"symbol_name", "nope"}},
+      {{"file_path", "src/m0.cpp"}, {"symbol_name", "f0_4"}},
+      {{"start_line", 1}},
+  });
+  auto batch = tool.execute({{"requests", requests}});
+  ASSERT_TRUE(batch.contains("items")) << batch.dump(2);
+  ASSERT_EQ(batch["items"].size(), requests.size());
+
+  for (size_t i : {0u, 1u, 2u, 3u, 5u, 6u}) {
+    auto single = tool.execute(requests[i]);
+    const auto& item = batch["items"][i];
+    ASSERT_TRUE(item.contains("result")) << i;
+    EXPECT_EQ(item["file_path"], requests[i]["file_path"]);
+    EXPECT_EQ(item["result"].contains("error"), single.contains("error")) << i;
+    EXPECT_EQ(textOf(item["result"]), textOf(single)) << i;
+  }
+  EXPECT_EQ(batch["items"][2]["result"]["error"].get<std::string>(), "File not found: src/missing.cpp");
+  EXPECT_EQ(batch["items"][4]["index"].get<int>(), 4);
+  EXPECT_EQ(batch["items"][7]["index"].get<int>(), 7);
+
+  // 文本按请求顺序拼接；并行执行不改变输出
+  std::string text = textOf(batch);
+  size_t p0 = text.find("--- src/m2.cpp ---");
+  size_t p1 = text.find("--- src/m0.cpp ---");
+  size_t p2 = text.find("--- src/missing.cpp (error) ---");
+  size_t p3 = text.find("--- ./src/m2.cpp ---");
+  ASSERT_NE(p0, std::string::npos);
+  EXPECT_LT(p0, p1);
+  EXPECT_LT(p1, p2);
+  EXPECT_LT(p2, p3);
+  for (int run = 0; run < 5; ++run) {
+    EXPECT_EQ(textOf(tool.execute({{"requests", requests}})), text);
+  }
+}
@@ -0,0 +1,118 @@
+/**
+ * ReadSummaryPipeline 单元测试：request 不等待摘要生成、完成后由 takeReady 收取、
+ * 相同内容跨实例（跨会话）命中磁盘缓存、内容变化后重新生成、cancelAll 丢弃进行中的结果。
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+#include "core/ReadSummaryPipeline.h"
+
+namespace {
+
+// 摘要函数在 release() 之前一直阻塞，用来确认调用方不等待
+class Gate {
+public:
+  void wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return open; });
+  }
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      open = true;
+    }
+    cv.notify_all();
+  }
+
+private:
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool open = false;
+};
+
+fs::path freshCacheFile(const std::string& name) {
+  fs::path dir = fs::temp_directory_path() / "photon_test_read_summary";
+  fs::create_directories(dir);
+  fs::path file = dir / (name + ".json");
+  fs::remove(file);
+  return file;
+}
+
+}  // namespace
+
+TEST(ReadSummaryPipeline, RequestDoesNotWaitForSummary) {
+  Gate gate;
+  std::atomic<int> calls{0};
+  ReadSummaryPipeline pipeline(freshCacheFile("nowait"), "m", [&](const std::string& prompt) {
+    calls++;
+    gate.wait();
+    return "summary of " + std::to_string(prompt.size());
+  });
+
+  auto t0 = std::chrono::steady_clock::now();
+  pipeline.request("src/a.cpp:foo", "1| int foo();\n");
+  EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::milliseconds(500));
+  EXPECT_TRUE(pipeline.takeReady().empty());
+
+  gate.release();
+  ASSERT_TRUE(pipeline.waitIdle(5000));
+  auto ready = pipeline.takeReady();
+  ASSERT_EQ(ready.size(), 1u);
+  EXPECT_EQ(ready[0].first, "src/a.cpp:foo");
+  EXPECT_EQ(calls.load(), 1);
+  EXPECT_TRUE(pipeline.takeReady().empty());
+}
+
+TEST(ReadSummaryPipeline, ReusesSummariesAcrossSessions) {
+  fs::path file = freshCacheFile("persist");
+  std::atomic<int> calls{0};
+  auto summarize = [&](const std::string&) {
+    calls++;
+    return std::string("points");
+  };
+  {
+    ReadSummaryPipeline first(file, "m", summarize);
+    first.request("src/a.cpp:1-3", "1| a\n2| b\n3| c\n");
+    ASSERT_TRUE(first.waitIdle(5000));
+  }
+  ASSERT_TRUE(fs::exists(file));
+
+  ReadSummaryPipeline second(file, "m", summarize);
+  second.request("src/a.cpp:1-3", "1| a\n2| b\n3| c\n");
+  auto ready = second.takeReady();
+  ASSERT_EQ(ready.size(), 1u);
+  EXPECT_EQ(ready[0].second, "points");
+  EXPECT_EQ(second.getStats().cacheHits, 1u);
+  EXPECT_EQ(calls.load(), 1);
+
+  // 代码变化（或换了摘要模型）后不再复用
+  second.request("src/a.cpp:1-3", "1| a\n2| B\n3| c\n");
+  ASSERT_TRUE(second.waitIdle(5000));
+  EXPECT_EQ(calls.load(), 2);
+  ReadSummaryPipeline otherModel(file, "m2", summarize);
+  otherModel.request("src/a.cpp:1-3", "1| a\n2| b\n3| c\n");
+  ASSERT_TRUE(otherModel.waitIdle(5000));
+  EXPECT_EQ(calls.load(), 3);
+}
+
+TEST(ReadSummaryPipeline, CancelDropsInFlightResults) {
+  Gate gate;
+  ReadSummaryPipeline pipeline(freshCacheFile("cancel"), "m", [&](const std::string&) {
+    gate.wait();
+    return std::string("late");
+  });
+  // 无论任务还在队列中还是已在生成，取消后都不会产出结果
+  pipeline.request("x", "1| x\n");
+  pipeline.cancelAll();
+  gate.release();
+  ASSERT_TRUE(pipeline.waitIdle(5000));
+  EXPECT_TRUE(pipeline.takeReady().empty());
+  EXPECT_EQ(pipeline.getStats().completed, 0u);
+}
@@ -0,0 +1,190 @@
+/**
+ * RequestScheduler 单元测试：优先级出队顺序、endpoint 并发上限、排队请求的取消（取消即唤醒空闲 worker）、
+ * worker 上嵌套 run() 内联执行、在任务中释放调度器的最后一个引用，以及 LLMClient 异步接口经调度器调用（可被子类覆盖的）同步实现。
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/LLMClient.h"
+#include "core/RequestScheduler.h"
+
+namespace {
+
+RequestScheduler::Options singleWorker() {
+  RequestScheduler::Options o;
+  o.workerThreads = 1;
+  o.defaultEndpointLimit = 4;
+  return o;
+}
+
+class SummaryMockClient : public LLMClient {
+public:
+  SummaryMockClient() : LLMClient("fake_key", "fake_url", "fake_model") {}
+  std::string summarize(const std::string& text) override {
+    onWorker = RequestScheduler::onWorkerThread();
+    return "summary of " + text;
+  }
+  std::atomic<bool> onWorker{false};
+};
+
+}  // namespace
+
+TEST(RequestScheduler, RunsHigherPriorityFirst) {
+  RequestScheduler scheduler(singleWorker());
+  std::promise<void> gate;
+  std::shared_future<void> gateFuture = gate.get_future().share();
+  std::mutex mtx;
+  std::vector<std::string> order;
+  auto record = [&](const std::string& name) {
+    return [&, name] {
+      std::lock_guard<std::mutex> lock(mtx);
+      order.push_back(name);
+    };
+  };
+
+  // 先占住唯一的 worker，再按低到高优先级提交
+  auto blocker = scheduler.submit(RequestPriority::Interactive, "chat", [gateFuture] { gateFuture.wait(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto bg = scheduler.submit(RequestPriority::Background, "embed", record("background"));
+  auto sum = scheduler.submit(RequestPriority::Summarization, "chat", record("summarization"));
+  auto chat = scheduler.submit(RequestPriority::Interactive, "chat", record("interactive"));
+  gate.set_value();
+  blocker.get();
+  bg.get();
+  sum.get();
+  chat.get();
+
+  std::vector<std::string> expected = {"interactive", "summarization", "background"};
+  EXPECT_EQ(order, expected);
+}
+
+TEST(RequestScheduler, RespectsEndpointLimit) {
+  RequestScheduler::Options o;
+  o.workerThreads = 4;
+  o.endpointLimits["embed"] = 1;
+  RequestScheduler scheduler(o);
+
+  std::atomic<int> active{0}, peak{0};
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < 4; ++i) {
+    futures.push_back(scheduler.submit(RequestPriority::Interactive, "embed", [&] {
+      int now = ++active;
+      int prev = peak.load();
+      while (now > prev && !peak.compare_exchange_weak(prev, now)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      --active;
+    }));
+  }
+  for (auto& f : futures) f.get();
+  EXPECT_EQ(peak.load(), 1);
+  EXPECT_EQ(scheduler.getStats().submitted, 4u);
+}
+
+TEST(RequestScheduler, CancelsQueuedRequest) {
+  RequestScheduler scheduler(singleWorker());
+  std::promise<void> gate;
+  std::shared_future<void> gateFuture = gate.get_future().share();
+  auto blocker = scheduler.submit(RequestPriority::Interactive, "chat", [gateFuture] { gateFuture.wait(); });
+
+  CancellationToken token;
+  std::atomic<bool> ran{false};
+  auto queued = scheduler.submit(RequestPriority::Interactive, "chat", [&] { ran = true; return 1; }, token);
+  token.cancel();
+  gate.set_value();
+  blocker.get();
+
+  EXPECT_THROW(queued.get(), RequestCancelled);
+  EXPECT_FALSE(ran.load());
+  EXPECT_EQ(scheduler.getStats().cancelled, 1u);
+}
+
+TEST(RequestScheduler, CancelWakesIdleWorker) {
+  RequestScheduler::Options o;
+  o.workerThreads = 2;
+  o.defaultEndpointLimit = 1;
+  RequestScheduler scheduler(o);
+  std::promise<void> gate;
+  std::shared_future<void> gateFuture = gate.get_future().share();
+  auto blocker = scheduler.submit(RequestPriority::Interactive, "chat", [gateFuture] { gateFuture.wait(); });
+
+  // endpoint 已满：请求留在队列中，另一个 worker 空闲等待；取消须唤醒它，而不是等到 blocker 结束
+  CancellationToken token;
+  auto queued = scheduler.submit(RequestPriority::Interactive, "chat", [] { return 1; }, token);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  token.cancel();
+  ASSERT_EQ(queued.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+  EXPECT_THROW(queued.get(), RequestCancelled);
+
+  gate.set_value();
+  blocker.get();
+  // 调度器析构后取消已注册的 token 不会访问它
+  CancellationToken late;
+  {
+    RequestScheduler shortLived(singleWorker());
+    shortLived.submit(RequestPriority::Interactive, "chat", [] {}, late).get();
+  }
+  late.cancel();
+}
+
+TEST(RequestScheduler, NestedRunExecutesInline) {
+  RequestScheduler scheduler(singleWorker());
+  // 唯一的 worker 上再同步发起请求：若重新排队会死锁
+  auto outer = scheduler.submit(RequestPriority::Summarization, "chat", [&] {
+    return scheduler.run(RequestPriority::Interactive, "chat", [] { return 42; });
+  });
+  ASSERT_EQ(outer.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_EQ(outer.get(), 42);
+  EXPECT_EQ(scheduler.getStats().inlineRuns, 1u);
+}
+
+TEST(RequestScheduler, LastReferenceDroppedInsideTask) {
+  auto waitExpired = [](const std::weak_ptr<RequestScheduler>& weak) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!weak.expired() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return weak.expired();
+  };
+  RequestScheduler::Options o;
+  o.workerThreads = 2;
+
+  // 任务体内显式释放：析构在该 worker 上执行，worker 随后仍要更新计数并退出
+  auto owner = std::make_shared<RequestScheduler>(o);
+  std::weak_ptr<RequestScheduler> weak = owner;
+  auto* scheduler = owner.get();
+  auto inside = scheduler->submit(RequestPriority::Interactive, "chat", [&owner] {
+    owner.reset();
+    return 7;
+  });
+  ASSERT_EQ(inside.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_EQ(inside.get(), 7);
+  EXPECT_TRUE(waitExpired(weak));
+
+  // 任务闭包持有最后一个引用（如异步接口捕获了 LLMClient）：任务对象销毁时析构
+  auto captured = std::make_shared<RequestScheduler>(o);
+  weak = captured;
+  scheduler = captured.get();
+  auto closure = scheduler->submit(RequestPriority::Background, "embed", [keep = std::move(captured)] { return 8; });
+  ASSERT_EQ(closure.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_EQ(closure.get(), 8);
+  EXPECT_TRUE(waitExpired(weak));
+  // 让 detach 的 worker 有时间走完退出路径
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+TEST(RequestScheduler, LLMClientAsyncUsesOverriddenSyncCall) {
+  SummaryMockClient client;
+  auto future = client.summarizeAsync("text");
+  EXPECT_EQ(future.get(), "summary of text");
+  EXPECT_TRUE(client.onWorker.load());
+}
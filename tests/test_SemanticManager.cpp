@@ -0,0 +1,398 @@
+/**
+ * SemanticManager 单元测试：使用计数型 Mock LLMClient（不联网），
+ * 验证 embedding 缓存在重建索引、跨会话、跨文件相同文本时复用，且命中率计数正确；
+ * 以及按符号范围的代码分块规则与增量同步、离线 LocalEmbeddingProvider、BM25 + 向量混合检索、chunk 按偏移量延迟读取正文；
+ * 后台索引进行中析构时等待索引线程与同步线程结束。
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "analysis/SemanticManager.h"
+#include "analysis/SymbolManager.h"
+#include "analysis/providers/LocalEmbeddingProvider.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class CountingEmbeddingClient : public LLMClient {
+public:
+  CountingEmbeddingClient() : LLMClient("fake_key", "fake_url", "fake_model") {}
+  std::vector<float> getEmbedding(const std::string& text) override {
+    ++calls;
+    std::vector<float> v(8, 0.0f);
+    for (size_t i = 0; i < text.size(); ++i) {
+      v[i % v.size()] += static_cast<float>(static_cast<unsigned char>(text[i])) / 255.0f;
+    }
+    return v;
+  }
+  std::atomic<int> calls{0};
+};
+
+void createFile(const fs::path& p, const std::string& content) {
+  fs::create_directories(p.parent_path());
+  std::ofstream f(p);
+  ASSERT_TRUE(f.is_open()) << "create " << p.u8string();
+  f << content;
+}
+
+fs::path freshRoot(const std::string& name) {
+  fs::path root = fs::temp_directory_path() / name;
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  return root;
+}
+
+// 简易 provider：识别 "class X {" ... "};" 与 "void f() {" ... 同缩进 "}"，给出精确 line/endLine
+class BraceSymbolProvider : public ISymbolProvider {
+public:
+  std::vector<Symbol> extractSymbols(const std::string& content, const std::string& relPath) const override {
+    std::vector<std::string> lines;
+    std::string line;
+    for (char c : content) {
+      if (c == '\n') { lines.push_back(line); line.clear(); } else line += c;
+    }
+    if (!line.empty()) lines.push_back(line);
+
+    std::vector<Symbol> out;
+    for (size_t i = 0; i < lines.size(); ++i) {
+      const std::string& l = lines[i];
+      size_t indent = l.find_first_not_of(' ');
+      if (indent == std::string::npos) continue;
+      bool isClass = l.compare(indent, 6, "class ") == 0;
+      bool isFunc = l.compare(indent, 5, "void ") == 0;
+      if (!isClass && !isFunc) continue;
+      std::string closing = std::string(indent, ' ') + (isClass ? "};" : "}");
+      int end = static_cast<int>(i) + 1;
+      for (size_t j = i + 1; j < lines.size(); ++j) {
+        if (lines[j] == closing) { end = static_cast<int>(j) + 1; break; }
+      }
+      size_t nameStart = indent + (isClass ? 6 : 5);
+      size_t nameEnd = l.find_first_of(" ({", nameStart);
+      out.push_back({l.substr(nameStart, nameEnd - nameStart), isClass ? "class" : "function", "test",
+                     relPath, static_cast<int>(i) + 1, end, l});
+    }
+    return out;
+  }
+  bool supportsExtension(const std::string& ext) const override { return ext == ".cpp"; }
+};
+
+std::string makeFunction(const std::string& name, int bodyLines, const std::string& indent = "") {
+  std::string out = indent + "void " + name + "() {\n";
+  for (int i = 0; i < bodyLines; ++i) {
+    out += indent + "    total += compute_" + name + "_step(" + std::to_string(i) + ", buffer, options);\n";
+  }
+  out += indent + "}\n";
+  return out;
+}
+
+std::vector<SemanticChunk> allChunks(SemanticManager& mgr, const std::string& relPath) {
+  std::vector<SemanticChunk> out;
+  for (auto& c : mgr.search("anything", 1000)) {
+    if (c.path == relPath && c.type == "code") out.push_back(c);
+  }
+  std::sort(out.begin(), out.end(), [](const SemanticChunk& a, const SemanticChunk& b) {
+    return a.startLine < b.startLine;
+  });
+  return out;
+}
+
+// embedding 后端不可用（离线/远端失败）：始终返回空向量
+class NoEmbeddingClient : public LLMClient {
+public:
+  NoEmbeddingClient() : LLMClient("fake_key", "fake_url", "fake_model") {}
+  std::vector<float> getEmbedding(const std::string&) override { return {}; }
+};
+
+const std::string kDoc =
+    "# Intro\n"
+    "Photon is a terminal agent that edits code with patches and tools.\n"
+    "# Usage\n"
+    "Run the binary in the project root and describe the change you want.\n";
+
+} // namespace
+
+TEST(SemanticManager, EmbeddingCacheReusedAcrossReindex) {
+  fs::path root = freshRoot("photon_semantic_cache_reindex");
+  createFile(root / "docs" / "a.md", kDoc);
+
+  auto client = std::make_shared<CountingEmbeddingClient>();
+  SemanticManager mgr(root.u8string(), client);
+  mgr.indexFile("docs/a.md", "markdown");
+  int firstPass = client->calls.load();
+  ASSERT_GT(firstPass, 0);
+
+  mgr.indexFile("docs/a.md", "markdown");
+  EXPECT_EQ(client->calls.load(), firstPass);
+
+  auto stats = mgr.getEmbeddingCacheStats();
+  EXPECT_EQ(stats.misses, static_cast<size_t>(firstPass));
+  EXPECT_EQ(stats.hits, static_cast<size_t>(firstPass));
+  EXPECT_DOUBLE_EQ(stats.hitRate(), 0.5);
+}
+
+TEST(SemanticManager, EmbeddingCacheSharedAcrossFilesAndSessions) {
+  fs::path root = freshRoot("photon_semantic_cache_session");
+  createFile(root / "a.md", kDoc);
+  createFile(root / "b.md", kDoc + "\n\n");  // 仅尾部空白不同
+
+  auto client = std::make_shared<CountingEmbeddingClient>();
+  int firstPass = 0;
+  {
+    SemanticManager mgr(root.u8string(), client);
+    mgr.indexFile("a.md", "markdown");
+    firstPass = client->calls.load();
+    mgr.indexFile("b.md", "markdown");
+    EXPECT_EQ(client->calls.load(), firstPass);
+  }
+  ASSERT_TRUE(fs::exists(root / ".photon" / "index" / "embedding_cache.json"));
+
+  // 新会话：从磁盘加载缓存，不再调用远端
+  SemanticManager mgr2(root.u8string(), client);
+  mgr2.indexFile("a.md", "markdown");
+  EXPECT_EQ(client->calls.load(), firstPass);
+  EXPECT_GT(mgr2.getEmbeddingCacheStats().hits, 0u);
+  EXPECT_EQ(mgr2.getEmbeddingCacheStats().misses, 0u);
+}
+
+TEST(SemanticManager, EmbeddingCacheKeyIncludesModel) {
+  EXPECT_NE(EmbeddingCache::makeKey("model-a", "text"), EmbeddingCache::makeKey("model-b", "text"));
+  EXPECT_EQ(EmbeddingCache::makeKey("m", "line  \r\nnext\n"), EmbeddingCache::makeKey("m", "line\nnext"));
+}
+
+TEST(SemanticManager, EmbeddingCacheEvictsLeastRecentlyUsed) {
+  fs::path root = freshRoot("photon_semantic_cache_lru");
+  fs::path file = root / "cache.json";
+  std::vector<float> out;
+  {
+    EmbeddingCache cache(file, 2);
+    cache.put("m", "a", {1.0f});
+    cache.put("m", "b", {2.0f});
+    ASSERT_TRUE(cache.get("m", "a", out));  // a 变为最近使用
+    cache.put("m", "c", {3.0f});
+    EXPECT_FALSE(cache.get("m", "b", out));
+    EXPECT_EQ(cache.getStats().evictions, 1u);
+    cache.save();
+  }
+  // 重新加载后保留顺序：c 最近、a 其次；上限缩小时先淘汰 a
+  EmbeddingCache reloaded(file, 1);
+  reloaded.load();
+  EXPECT_TRUE(reloaded.get("m", "c", out));
+  EXPECT_FALSE(reloaded.get("m", "a", out));
+}
+
+TEST(SemanticManager, QueryEmbeddingsAreNotPersisted) {
+  fs::path root = freshRoot("photon_semantic_query_cache");
+  createFile(root / "a.md", kDoc);
+
+  auto client = std::make_shared<CountingEmbeddingClient>();
+  size_t indexed = 0;
+  {
+    SemanticManager mgr(root.u8string(), client);
+    mgr.indexFile("a.md", "markdown");
+    indexed = mgr.getEmbeddingCacheStats().entries;
+    int before = client->calls.load();
+    for (int i = 0; i < 20; ++i) mgr.search("query number " + std::to_string(i), 3);
+    mgr.search("query number 0", 3);  // 内存中命中
+    EXPECT_EQ(client->calls.load(), before + 20);
+    EXPECT_EQ(mgr.getEmbeddingCacheStats().entries, indexed);
+  }
+  SemanticManager reopened(root.u8string(), client);
+  EXPECT_EQ(reopened.getEmbeddingCacheStats().entries, indexed);
+}
+
+TEST(SemanticManager, CodeChunksFollowSymbolRanges) {
+  fs::path root = freshRoot("photon_semantic_code_chunks");
+  std::string code;
+  code += "class Widget {\n";                       // 1
+  code += "public:\n";                              // 2
+  code += "    int total = 0;\n";                   // 3
+  code += makeFunction("render", 6, "    ");          // 4-11
+  code += "};\n";                                   // 12
+  code += "\n";                                     // 13
+  code += makeFunction("huge", 120);                  // 14-135
+  code += makeFunction("tinyA", 1);                   // 136-138
+  code += makeFunction("tinyB", 1);                   // 139-141
+  createFile(root / "src" / "widget.cpp", code);
+
+  SymbolManager symbols(root.u8string());
+  symbols.registerProvider(std::make_unique<BraceSymbolProvider>());
+  symbols.scanBlocking();
+
+  auto client = std::make_shared<CountingEmbeddingClient>();
+  SemanticManager mgr(root.u8string(), client);
+  mgr.setSymbolManager(&symbols);
+  mgr.syncCodeIndex();
+
+  auto chunks = allChunks(mgr, "src/widget.cpp");
+  ASSERT_GE(chunks.size(), 5u);
+
+  // 类头单独成块（到第一个成员之前）
+  EXPECT_EQ(chunks[0].startLine, 1);
+  EXPECT_EQ(chunks[0].endLine, 3);
+  // 方法独立成块
+  EXPECT_EQ(chunks[1].startLine, 4);
+  EXPECT_EQ(chunks[1].endLine, 11);
+  // 过大的函数被切分，且各片段不越出函数范围
+  int hugePieces = 0;
+  for (const auto& c : chunks) {
+    if (c.startLine >= 14 && c.endLine <= 135) ++hugePieces;
+    EXPECT_FALSE(c.startLine < 14 && c.endLine > 14) << "chunk crosses function start";
+  }
+  EXPECT_GE(hugePieces, 2);
+  // 相邻小函数合并
+  EXPECT_EQ(chunks.back().startLine, 136);
+  EXPECT_EQ(chunks.back().endLine, 141);
+}
+
+TEST(SemanticManager, CodeSyncOnlyRechunksChangedFiles) {
+  fs::path root = freshRoot("photon_semantic_code_sync");
+  createFile(root / "a.cpp", makeFunction("alpha", 10));
+  createFile(root / "b.cpp", makeFunction("beta", 10));
+
+  SymbolManager symbols(root.u8string());
+  symbols.registerProvider(std::make_unique<BraceSymbolProvider>());
+  symbols.scanBlocking();
+
+  auto client = std::make_shared<CountingEmbeddingClient>();
+  SemanticManager mgr(root.u8string(), client);
+  mgr.setSymbolManager(&symbols);
+  mgr.syncCodeIndex();
+  auto before = mgr.getEmbeddingCacheStats();
+  EXPECT_EQ(before.misses, 2u);
+
+  createFile(root / "b.cpp", makeFunction("beta", 12));
+  symbols.updateFile("b.cpp");
+  mgr.syncCodeIndex();
+
+  // 仅 b.cpp 被重新分块：新增一次未命中，a.cpp 未被重新读取（无命中）
+  auto after = mgr.getEmbeddingCacheStats();
+  EXPECT_EQ(after.misses, 3u);
+  EXPECT_EQ(after.hits, before.hits);
+
+  // 无变化时不做任何事
+  mgr.syncCodeIndex();
+  EXPECT_EQ(mgr.getEmbeddingCacheStats().misses, 3u);
+}
+
+TEST(SemanticManager, DestroyWhileAsyncIndexingRuns) {
+  fs::path root = freshRoot("photon_semantic_async_destroy");
+  for (int i = 0; i < 20; ++i) {
+    createFile(root / ("doc" + std::to_string(i) + ".md"), kDoc);
+    createFile(root / ("f" + std::to_string(i) + ".cpp"), makeFunction("fn" + std::to_string(i), 4));
+  }
+  SymbolManager symbols(root.u8string());
+  symbols.registerProvider(std::make_unique<BraceSymbolProvider>());
+  symbols.scanBlocking();
+
+  // 索引线程随时可能在 requestCodeSync 中创建 syncThread；析构须先 join 索引线程，不得与之竞争
+  for (int round = 0; round < 5; ++round) {
+    auto mgr = std::make_unique<SemanticManager>(root.u8string(), std::make_unique<LocalEmbeddingProvider>());
+    mgr->setSymbolManager(&symbols);
+    mgr->startAsyncIndexing();
+    if (round % 2) std::this_thread::sleep_for(std::chrono::milliseconds(5 * round));
+    mgr.reset();
+  }
+  // 中途停止后落盘的索引仍可正常打开与检索
+  SemanticManager reopened(root.u8string(), std::make_unique<LocalEmbeddingProvider>());
+  reopened.indexFile("doc0.md", "markdown");
+  EXPECT_FALSE(reopened.search("terminal agent patches", 3).empty());
+}
+
+TEST(SemanticManager, LocalProviderIsDeterministicAndNormalized) {
+  LocalEmbeddingProvider provider(256);
+  auto a = provider.embed("parseHttpRequest(buffer)");
+  auto b = provider.embed("parseHttpRequest(buffer)");
+  ASSERT_EQ(a.size(), 256u);
+  EXPECT_EQ(a, b);
+  double norm = 0.0;
+  for (float x : a) norm += static_cast<double>(x) * x;
+  EXPECT_NEAR(norm, 1.0, 1e-4);
+  EXPECT_NE(provider.modelId(), LocalEmbeddingProvider(384).modelId());
+}
+
+TEST(SemanticManager, LocalProviderSearchWithoutNetwork) {
+  fs::path root = freshRoot("photon_semantic_local_provider");
+  createFile(root / "net.md",
+             "# Networking\nThe HttpClientPool keeps keep-alive connections and retries requests on timeout.\n");
+  createFile(root / "ui.md",
+             "# Rendering\nThe markdown renderer colors headings and code blocks in the terminal output.\n");
+  createFile(root / "zh.md", "# 摘要\n上下文压缩时会把较早的对话折叠为滚动摘要，保留最近的消息。\n");
+
+  SemanticManager mgr(root.u8string(), std::make_unique<LocalEmbeddingProvider>());
+  mgr.indexFile("net.md", "markdown");
+  mgr.indexFile("ui.md", "markdown");
+  mgr.indexFile("zh.md", "markdown");
+
+  auto results = mgr.search("http client retry timeout", 3);
+  ASSERT_FALSE(results.empty());
+  EXPECT_EQ(results[0].path, "net.md");
+
+  auto zh = mgr.search("滚动摘要", 3);
+  ASSERT_FALSE(zh.empty());
+  EXPECT_EQ(zh[0].path, "zh.md");
+}
+
+TEST(SemanticManager, LexicalOnlySearchWithoutEmbeddings) {
+  fs::path root = freshRoot("photon_semantic_lexical_only");
+  createFile(root / "patch.cpp", makeFunction("applyHunks", 3) + "// calls parseUnifiedDiff(text)\n");
+  createFile(root / "render.cpp", makeFunction("renderDiff", 3));
+
+  SemanticManager mgr(root.u8string(), std::make_shared<NoEmbeddingClient>());
+  mgr.indexFile("patch.cpp", "code");
+  mgr.indexFile("render.cpp", "code");
+
+  auto results = mgr.search("where is parseUnifiedDiff called", 5);
+  ASSERT_FALSE(results.empty());
+  EXPECT_EQ(results[0].path, "patch.cpp");
+  EXPECT_FLOAT_EQ(results[0].score, 1.0f);
+
+  // 重新打开：词法索引从磁盘恢复
+  SemanticManager reopened(root.u8string(), std::make_shared<NoEmbeddingClient>());
+  auto again = reopened.search("parseUnifiedDiff", 5);
+  ASSERT_FALSE(again.empty());
+  EXPECT_EQ(again[0].path, "patch.cpp");
+}
+
+TEST(SemanticManager, ChunksStoreOffsetsAndDetectStaleContent) {
+  fs::path root = freshRoot("photon_semantic_offsets");
+  std::string intro = "# Intro\nPhoton indexes markdown sections by heading for retrieval.\n";
+  std::string fence = "```\n# not a heading inside a fence\n```\n";
+  std::string usage = "## Usage\nRun the agent with a config file and a project root path.\n";
+  createFile(root / "guide.md", intro + fence + usage);
+
+  SemanticManager mgr(root.u8string(), std::make_unique<LocalEmbeddingProvider>());
+  mgr.indexFile("guide.md", "markdown");
+
+  auto results = mgr.search("config file project root", 5);
+  ASSERT_FALSE(results.empty());
+  const auto& hit = results[0];
+  EXPECT_EQ(hit.content, usage);
+  EXPECT_EQ(hit.byteOffset, intro.size() + fence.size());
+  EXPECT_EQ(hit.byteLength, usage.size());
+  EXPECT_EQ(hit.startLine, 6);
+  EXPECT_FALSE(hit.stale);
+
+  // 重新打开后正文仍按偏移量从源文件读取（索引中不存正文）
+  mgr.saveIndex();
+  {
+    SemanticManager reopened(root.u8string(), std::make_unique<LocalEmbeddingProvider>());
+    auto again = reopened.search("config file project root", 5);
+    ASSERT_FALSE(again.empty());
+    EXPECT_EQ(again[0].content, usage);
+  }
+
+  // 文件被修改后旧偏移量失效：不返回错误正文
+  createFile(root / "guide.md", "# Rewritten\nCompletely different text about config file and project root.\n");
+  for (const auto& r : mgr.search("config file project root", 5)) {
+    EXPECT_NE(r.content, usage);
+  }
+}
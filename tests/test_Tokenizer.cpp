@@ -0,0 +1,147 @@
+/**
+ * Tokenizer 单元测试：cl100k / o200k 预分词规则（按词表选择）、tiktoken 词表加载与 BPE 合并（encode / decode / count）、
+ * 无词表时的估算，以及 ContextManager 按 token 计数（含 text part 数组形式的工具结果）触发压缩。
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/ContextManager.h"
+#include "core/Conversation.h"
+#include "utils/Tokenizer.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string base64(const std::string& in) {
+  static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  size_t i = 0;
+  for (; i + 2 < in.size(); i += 3) {
+    unsigned v = (static_cast<unsigned char>(in[i]) << 16) | (static_cast<unsigned char>(in[i + 1]) << 8) |
+                 static_cast<unsigned char>(in[i + 2]);
+    out += {table[v >> 18], table[(v >> 12) & 63], table[(v >> 6) & 63], table[v & 63]};
+  }
+  if (i + 1 == in.size()) {
+    unsigned v = static_cast<unsigned char>(in[i]) << 16;
+    out += {table[v >> 18], table[(v >> 12) & 63], '=', '='};
+  } else if (i + 2 == in.size()) {
+    unsigned v = (static_cast<unsigned char>(in[i]) << 16) | (static_cast<unsigned char>(in[i + 1]) << 8);
+    out += {table[v >> 18], table[(v >> 12) & 63], table[(v >> 6) & 63], '='};
+  }
+  return out;
+}
+
+// 256 个单字节 + 少量合并（rank 256 起）："he" "ll" "hell" "hello" " w" " wo" " wor"
+fs::path writeTinyVocab(const std::string& name = "photon_test_tiny.tiktoken") {
+  fs::path path = fs::temp_directory_path() / name;
+  std::ofstream out(path, std::ios::binary);
+  uint32_t rank = 0;
+  for (int b = 0; b < 256; ++b) out << base64(std::string(1, static_cast<char>(b))) << " " << rank++ << "\n";
+  for (const char* merge : {"he", "ll", "hell", "hello", " w", " wo", " wor"}) out << base64(merge) << " " << rank++ << "\n";
+  return path;
+}
+
+std::vector<std::string> pieces(const std::string& text, Tokenizer::PreTokenizer rules = Tokenizer::PreTokenizer::Cl100k) {
+  std::vector<std::string> out;
+  for (auto p : Tokenizer::splitPieces(text, rules)) out.emplace_back(p);
+  return out;
+}
+
+class FixedSummaryClient : public LLMClient {
+public:
+  FixedSummaryClient() : LLMClient("fake_key", "fake_url", "fake_model") {}
+  std::string summarize(const std::string&) override { return "short"; }
+};
+
+}  // namespace
+
+TEST(Tokenizer, SplitsLikeCl100k) {
+  std::vector<std::string> expected = {"Hello", " world", "'s", " ", "123", "45", " ", " x", "\n\n", "foo", "();\n"};
+  EXPECT_EQ(pieces("Hello world's 12345  x\n\nfoo();\n"), expected);
+  // 中文按字母串处理；全角标点与其后的字母串合为一片（同 [^\r\n\p{L}\p{N}]?\p{L}+）
+  std::vector<std::string> cjk = {"你好", "，世界", "。"};
+  EXPECT_EQ(pieces("你好，世界。"), cjk);
+}
+
+TEST(Tokenizer, SplitsLikeO200k) {
+  const auto o200k = Tokenizer::PreTokenizer::O200k;
+  // o200k 按大小写切分单词、缩写附在单词后、标点串可带上后面的 '/'
+  std::vector<std::string> camel = {"foo", "Bar", " HTTPServer's", " x", "/y", "\n"};
+  EXPECT_EQ(pieces("fooBar HTTPServer's x/y\n", o200k), camel);
+  std::vector<std::string> camelCl100k = {"fooBar", " HTTPServer", "'s", " x", "/y", "\n"};
+  EXPECT_EQ(pieces("fooBar HTTPServer's x/y\n"), camelCl100k);
+  std::vector<std::string> comment = {");\n//"};
+  EXPECT_EQ(pieces(");\n//", o200k), comment);
+  std::vector<std::string> commentCl100k = {");\n", "//"};
+  EXPECT_EQ(pieces(");\n//"), commentCl100k);
+  std::vector<std::string> cjk = {"你好", "，世界", "。"};
+  EXPECT_EQ(pieces("你好，世界。", o200k), cjk);
+
+  // 规则跟随加载的词表
+  Tokenizer tokenizer;
+  ASSERT_TRUE(tokenizer.loadVocab(writeTinyVocab().string()));
+  EXPECT_EQ(tokenizer.preTokenizer(), Tokenizer::PreTokenizer::Cl100k);
+  ASSERT_TRUE(tokenizer.loadVocab(writeTinyVocab("photon_test_o200k_tiny.tiktoken").string()));
+  EXPECT_EQ(tokenizer.preTokenizer(), o200k);
+  // cl100k 下 "helloWorld" 是一片（无法整体合并）；o200k 拆成 "hello" + "World"，"hello" 整片命中
+  EXPECT_EQ(tokenizer.encode("helloWorld").front(), 259u);
+}
+
+TEST(Tokenizer, EncodesWithBytePairMerges) {
+  Tokenizer tokenizer;
+  EXPECT_FALSE(tokenizer.hasVocab());
+  ASSERT_TRUE(tokenizer.loadVocab(writeTinyVocab().string()));
+  EXPECT_EQ(tokenizer.vocabName(), "photon_test_tiny.tiktoken");
+
+  auto tokens = tokenizer.encode("hello world");
+  // "hello" 整片命中；" world" -> " wor" + "l" + "d"
+  std::vector<uint32_t> expected = {259, 262, 'l', 'd'};
+  EXPECT_EQ(tokens, expected);
+  EXPECT_EQ(tokenizer.count("hello world"), 4u);
+  EXPECT_EQ(tokenizer.decode(tokens), "hello world");
+
+  // 任意字节序列（含非法 UTF-8）可无损往返
+  std::string binary = "ab\xff\xfe\xe4\xbd\xa0 \n\t\xc3";
+  EXPECT_EQ(tokenizer.decode(tokenizer.encode(binary)), binary);
+}
+
+TEST(Tokenizer, EstimatesWithoutVocab) {
+  Tokenizer tokenizer;
+  EXPECT_EQ(tokenizer.count("abcdefgh"), 2u);
+  EXPECT_EQ(tokenizer.count("你好"), 2u);
+  EXPECT_TRUE(tokenizer.encode("abc").empty());
+
+  nlohmann::json toolResult = {{"role", "tool"},
+                               {"tool_call_id", "c1"},
+                               {"content", nlohmann::json::array({{{"type", "text"}, {"text", std::string(400, 'x')}}})}};
+  EXPECT_EQ(tokenizer.countMessage(toolResult), Tokenizer::kPerMessageOverhead + 1 + 100);
+}
+
+TEST(Tokenizer, ContextManagerCountsToolResultArrays) {
+  auto client = std::make_shared<FixedSummaryClient>();
+  ContextManager cm(client, 500);
+
+  Conversation conv;
+  conv.push_back({{"role", "system"}, {"content", "sys"}});
+  for (int i = 0; i < 4; ++i) {
+    conv.push_back({{"role", "user"}, {"content", "read it"}});
+    conv.push_back({{"role", "tool"},
+                    {"tool_call_id", "c" + std::to_string(i)},
+                    {"content", nlohmann::json::array({{{"type", "text"}, {"text", std::string(800, static_cast<char>('p' + i))}}})}});
+  }
+  // 字符串 content 很短，工具结果（数组形式，内容互不相同以免被去重）占大头：按旧的字符计数不会触发压缩
+  EXPECT_GT(cm.getSize(conv), 500u);
+  EXPECT_TRUE(cm.manage(conv));
+  EXPECT_LT(cm.getSize(conv), 500u);
+
+  // 上下文窗口减去回复预留后比 threshold 更小时以窗口为准
+  cm.setContextWindow(300, 100);
+  EXPECT_EQ(cm.getEffectiveThreshold(), 200u);
+}
@@ -0,0 +1,125 @@
+/**
+ * ToolPrefetcher 单元测试：调用图键解析、grep 之后预取命中所在符号并被真实调用命中、
+ * 预取条目受单独的字节预算约束且不挤占普通条目。
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "analysis/SymbolManager.h"
+#include "tools/CoreTools.h"
+#include "tools/ToolPrefetcher.h"
+#include "tools/ToolRegistry.h"
+#include "tools/ToolResultCache.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 带结束行的最小符号提供者（RegexSymbolProvider 不给 endLine，按符号名读取需要完整范围）
+class FunctionBlockProvider : public ISymbolProvider {
+public:
+  std::vector<Symbol> extractSymbols(const std::string& content, const std::string& relPath) const override {
+    std::vector<Symbol> out;
+    std::istringstream in(content);
+    std::string line;
+    for (int n = 1; std::getline(in, line); ++n) {
+      if (line.rfind("int ", 0) == 0 && !line.empty() && line.back() == '{') {
+        Symbol s;
+        s.name = line.substr(4, line.find('(') - 4);
+        s.type = "function";
+        s.source = "test";
+        s.path = relPath;
+        s.line = n;
+        out.push_back(s);
+      } else if (line == "}" && !out.empty()) {
+        out.back().endLine = n;
+      }
+    }
+    return out;
+  }
+  bool supportsExtension(const std::string& ext) const override { return ext == ".cpp"; }
+};
+
+}  // namespace
+
+TEST(ToolPrefetcher, ParsesSymbolKeys) {
+  std::string path, name;
+  ASSERT_TRUE(ToolPrefetcher::parseSymbolKey("src/a.cpp:12:compute", path, name));
+  EXPECT_EQ(path, "src/a.cpp");
+  EXPECT_EQ(name, "compute");
+  // Windows 盘符里的冒号属于路径
+  ASSERT_TRUE(ToolPrefetcher::parseSymbolKey("C:/p/a.cpp:3:f", path, name));
+  EXPECT_EQ(path, "C:/p/a.cpp");
+  EXPECT_FALSE(ToolPrefetcher::parseSymbolKey("unresolved:compute", path, name));
+  EXPECT_FALSE(ToolPrefetcher::parseSymbolKey("ambiguous:a:b", path, name));
+  EXPECT_FALSE(ToolPrefetcher::parseSymbolKey("src/a.cpp:12:", path, name));
+}
+
+TEST(ToolPrefetcher, PrefetchesEnclosingSymbolAfterGrep) {
+  fs::path root = fs::temp_directory_path() / "photon_test_prefetch";
+  fs::remove_all(root);
+  fs::create_directories(root / "src");
+  {
+    std::ofstream out(root / "src" / "a.cpp");
+    out << "int helper(int x) {\n  return x + 1;\n}\n\nint compute(int y) {\n  return helper(y) * 2;\n}\n";
+  }
+  {
+    SymbolManager symbolManager(root.u8string());
+    symbolManager.registerProvider(std::make_unique<FunctionBlockProvider>());
+    symbolManager.scanBlocking();
+
+    auto cache = std::make_shared<ToolResultCache>();
+    ToolRegistry registry;
+    registry.registerTool(std::make_unique<ReadCodeBlockTool>(root.u8string(), &symbolManager));
+    registry.setResultCache(cache);
+    ToolPrefetcher prefetcher(registry, &symbolManager);
+
+    nlohmann::json grepResult = {{"matches", {{{"file", "src/a.cpp"}, {"line", 6}, {"content", "  return helper(y) * 2;"}}}}};
+    prefetcher.observe("grep", {{"pattern", "helper\\("}}, grepResult);
+    ASSERT_TRUE(prefetcher.waitIdle(5000));
+    EXPECT_EQ(prefetcher.getStats().executed, 1u);
+    EXPECT_EQ(cache->getStats().prefetched, 1u);
+
+    auto result = registry.executeTool("read_code_block", {{"file_path", "src/a.cpp"}, {"symbol_name", "compute"}});
+    ASSERT_FALSE(result.contains("error")) << result.dump();
+    EXPECT_NE(result.dump().find("helper(y)"), std::string::npos);
+    auto stats = cache->getStats();
+    EXPECT_EQ(stats.prefetchHits, 1u);
+    EXPECT_EQ(stats.misses, 0u);
+
+    // 已缓存的预测不会重复执行
+    prefetcher.observe("grep", {{"pattern", "helper\\("}}, grepResult);
+    ASSERT_TRUE(prefetcher.waitIdle(5000));
+    EXPECT_EQ(prefetcher.getStats().executed, 1u);
+  }
+  fs::remove_all(root);
+}
+
+TEST(ToolPrefetcher, SpeculativeEntriesHaveTheirOwnBudget) {
+  ToolResultCache::Options options;
+  options.maxSpeculativeBytes = 300;
+  ToolResultCache cache(options);
+  const std::string payload(100, 'x');
+  cache.store("real", payload, {"/p/r"}, 1.0, cache.generation());
+  for (int i = 0; i < 4; ++i) cache.store("spec" + std::to_string(i), payload, {"/p/s"}, 5.0, cache.generation(), true);
+
+  // 超出预算时淘汰最旧的预取条目，普通条目保留
+  EXPECT_TRUE(cache.contains("real"));
+  EXPECT_FALSE(cache.contains("spec0"));
+  EXPECT_TRUE(cache.contains("spec3"));
+
+  // 预取不覆盖已有条目；命中后转为普通条目
+  cache.store("real", std::string("other"), {"/p/r"}, 1.0, cache.generation(), true);
+  EXPECT_EQ(cache.lookup("real").value(), payload);
+  ASSERT_TRUE(cache.lookup("spec3").has_value());
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.prefetched, 4u);
+  EXPECT_EQ(stats.prefetchHits, 1u);
+  EXPECT_DOUBLE_EQ(stats.prefetchSavedMs, 5.0);
+}
@@ -0,0 +1,178 @@
+/**
+ * ToolResultCache 单元测试：ToolRegistry 对只读工具的结果复用、文件指纹变化后不命中（目录依赖的树指纹按目录记忆，随路径失效重新计算）、
+ * 写工具按路径失效、路径重叠规则、执行期间发生写入时结果不入缓存，以及 SymbolManager 不把未变化的
+ * 不支持文件反复报告为变化（否则每轮轮询都会清掉依赖项目根的条目）。
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "analysis/SymbolManager.h"
+#include "analysis/providers/RegexSymbolProvider.h"
+#include "tools/CoreTools.h"
+#include "tools/ToolRegistry.h"
+#include "tools/ToolResultCache.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void writeFile(const fs::path& path, const std::string& content) {
+  fs::create_directories(path.parent_path());
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << content;
+}
+
+class ToolResultCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    root = fs::temp_directory_path() / "photon_test_tool_cache";
+    fs::remove_all(root);
+    writeFile(root / "src" / "a.cpp", "int a() { return 1; }\n");
+    writeFile(root / "src" / "b.cpp", "int b() { return 2; }\n");
+    cache = std::make_shared<ToolResultCache>();
+    registry.registerTool(std::make_unique<ReadCodeBlockTool>(root.string()));
+    registry.registerTool(std::make_unique<WriteTool>(root.string()));
+    registry.registerTool(std::make_unique<GrepTool>(root.string()));
+    registry.setResultCache(cache);
+  }
+
+  void TearDown() override { fs::remove_all(root); }
+
+  nlohmann::json read(const std::string& rel) {
+    return registry.executeTool("read_code_block", {{"file_path", rel}, {"start_line", 1}, {"end_line", 5}});
+  }
+
+  fs::path root;
+  std::shared_ptr<ToolResultCache> cache;
+  ToolRegistry registry;
+};
+
+}  // namespace
+
+TEST_F(ToolResultCacheTest, RepeatedReadIsServedFromCache) {
+  auto first = read("src/a.cpp");
+  ASSERT_FALSE(first.contains("error")) << first.dump();
+  auto second = read("src/a.cpp");
+  EXPECT_EQ(first, second);
+  // 参数对象键顺序不同也是同一个键
+  registry.executeTool("read_code_block", {{"end_line", 5}, {"start_line", 1}, {"file_path", "src/a.cpp"}});
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(cache->size(), 1u);
+}
+
+TEST_F(ToolResultCacheTest, ExternalEditChangesFingerprint) {
+  read("src/a.cpp");
+  // 不经过工具直接改文件（watch 尚未轮询到），大小变化即不命中
+  writeFile(root / "src" / "a.cpp", "int a() { return 100; }\n");
+  auto result = read("src/a.cpp");
+  EXPECT_NE(result.dump().find("100"), std::string::npos);
+  EXPECT_EQ(cache->getStats().hits, 0u);
+  EXPECT_EQ(cache->getStats().invalidated, 1u);
+}
+
+TEST_F(ToolResultCacheTest, InPlaceEditUnderSearchedDirectoryChangesFingerprint) {
+  auto grep = [&] { return registry.executeTool("grep", {{"pattern", "return"}, {"path", "."}}); };
+  auto first = grep();
+  ASSERT_FALSE(first.contains("error")) << first.dump();
+  EXPECT_EQ(grep(), first);
+  EXPECT_EQ(cache->getStats().hits, 1u);
+
+  // 原地修改子目录中的文件：目录树指纹按目录记忆，watch 轮询到之前仍命中（不再每次遍历整棵树）
+  writeFile(root / "src" / "b.cpp", "int b() { return 20; }\n");
+  EXPECT_EQ(grep(), first);
+  EXPECT_EQ(cache->getStats().hits, 2u);
+
+  // watch 报告该文件变化后，依赖其上级目录的条目与记忆的指纹一并失效，重新遍历
+  cache->invalidatePaths({(root / "src" / "b.cpp").lexically_normal().generic_u8string()});
+  auto second = grep();
+  EXPECT_NE(second.dump().find("return 20"), std::string::npos);
+  EXPECT_EQ(cache->getStats().hits, 2u);
+  EXPECT_EQ(cache->getStats().invalidated, 1u);
+  EXPECT_EQ(grep(), second);
+  EXPECT_EQ(cache->getStats().hits, 3u);
+}
+
+TEST_F(ToolResultCacheTest, WriteInvalidatesOnlyOverlappingEntries) {
+  read("src/a.cpp");
+  read("src/b.cpp");
+  ASSERT_EQ(cache->size(), 2u);
+
+  auto written = registry.executeTool("write", {{"path", "src/a.cpp"}, {"content", "int a() { return 7; }\n"}});
+  ASSERT_FALSE(written.contains("error")) << written.dump();
+  EXPECT_EQ(cache->size(), 1u);
+
+  EXPECT_NE(read("src/a.cpp").dump().find("return 7"), std::string::npos);
+  read("src/b.cpp");
+  EXPECT_EQ(cache->getStats().hits, 1u);
+}
+
+TEST(ToolResultCache, InvalidatePathsMatchesParentsAndChildren) {
+  ToolResultCache cache;
+  const auto gen = cache.generation();
+  cache.store("file", {{"v", 1}}, {"/p/src/x.h"}, 1.0, gen);
+  cache.store("dir", {{"v", 2}}, {"/p/src"}, 1.0, gen);
+  cache.store("other", {{"v", 3}}, {"/p/src2/y.h"}, 1.0, gen);
+  cache.store("project", {{"v", 4}}, {}, 1.0, gen);
+  ASSERT_EQ(cache.size(), 4u);
+
+  // 目录失效覆盖其下文件；src2 仅前缀相同，不受影响；依赖整个项目的条目总是失效
+  cache.invalidatePaths({"/p/src"});
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_TRUE(cache.lookup("other").has_value());
+  EXPECT_EQ(cache.getStats().invalidated, 3u);
+
+  cache.invalidatePaths({});
+  EXPECT_EQ(cache.size(), 1u);
+  cache.invalidateAll();
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(ToolResultCache, SkipsStoreWhenWriteRacedExecution) {
+  ToolResultCache cache;
+  const auto gen = cache.generation();
+  cache.invalidatePaths({"/p/a.cpp"});
+  cache.store("read", {{"v", 1}}, {"/p/b.cpp"}, 1.0, gen);
+  EXPECT_EQ(cache.size(), 0u);
+
+  ToolResultCache::Options options;
+  options.maxEntries = 2;
+  ToolResultCache small(options);
+  for (int i = 0; i < 3; ++i) small.store("k" + std::to_string(i), {{"v", i}}, {"/p"}, 1.0, small.generation());
+  EXPECT_EQ(small.size(), 2u);
+  EXPECT_FALSE(small.lookup("k0").has_value());
+  EXPECT_EQ(small.getStats().evicted, 1u);
+}
+
+TEST(ToolResultCache, SymbolManagerDoesNotReportUnchangedUnsupportedFiles) {
+  fs::path root = fs::temp_directory_path() / "photon_test_tool_cache_watch";
+  fs::remove_all(root);
+  writeFile(root / "src" / "a.cpp", "int a() { return 1; }\n");
+  writeFile(root / "notes.txt", "not a source file\n");
+  {
+    SymbolManager symbolManager(root.u8string());
+    symbolManager.registerProvider(std::make_unique<RegexSymbolProvider>());
+    symbolManager.scanBlocking();
+    std::atomic<int> reports{0};
+    symbolManager.setOnFilesChanged([&](const std::vector<std::string>&) { reports++; });
+    symbolManager.startWatching(1);
+    // 首轮轮询记录 notes.txt 的 meta，之后不再报告
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    const int afterFirstPoll = reports.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2200));
+    symbolManager.stopWatching();
+    EXPECT_LE(afterFirstPoll, 1);
+    EXPECT_EQ(reports.load(), afterFirstPoll);
+  }
+  fs::remove_all(root);
+}
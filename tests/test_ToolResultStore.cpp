@@ -0,0 +1,134 @@
+/**
+ * ToolResultStore / fetch_result 单元测试：小结果内联、大结果存盘后只保留头尾预览与 handle、
+ * 跨稀疏行索引的分页读取、字节区间的 UTF-8 对齐、磁盘上限淘汰与会话目录清理（不清理仍在运行的会话）。
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "tools/FetchResultTool.h"
+#include "tools/ToolResultStore.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path testBaseDir() {
+  fs::path dir = fs::temp_directory_path() / "photon_test_results";
+  fs::remove_all(dir);
+  return dir;
+}
+
+std::string numberedLines(size_t count) {
+  std::string text;
+  for (size_t i = 1; i <= count; ++i) text += "line " + std::to_string(i) + "\n";
+  return text;
+}
+
+}  // namespace
+
+TEST(ToolResultStore, KeepsSmallResultsInlineAndStoresLargeOnes) {
+  ToolResultStore::Options options;
+  options.inlineLimitBytes = 1024;
+  options.previewBytes = 200;
+  ToolResultStore store(testBaseDir().string(), options);
+
+  EXPECT_EQ(store.maybeStore("grep", "short"), "short");
+  EXPECT_EQ(store.getStats().stored, 0u);
+
+  const std::string text = numberedLines(1000);
+  const std::string preview = store.maybeStore("grep", text);
+  EXPECT_LT(preview.size(), 600u);
+  EXPECT_NE(preview.find("stored as result \"r1\""), std::string::npos);
+  EXPECT_NE(preview.find("1000 lines"), std::string::npos);
+  EXPECT_EQ(preview.find("line 1\n"), preview.find("]\n") + 2);  // 开头按整行保留
+  EXPECT_NE(preview.find("line 1000\n"), std::string::npos);      // 结尾同样保留
+  EXPECT_NE(preview.find("omitted"), std::string::npos);
+  EXPECT_EQ(store.getStats().stored, 1u);
+  EXPECT_EQ(store.getStats().bytesOnDisk, text.size());
+}
+
+TEST(ToolResultStore, PagesByLinesAcrossIndexStride) {
+  ToolResultStore store(testBaseDir().string());
+  const std::string handle = store.store("run_command", numberedLines(1000));
+  ASSERT_EQ(handle, "r1");
+
+  auto page = store.fetchLines(handle, 255, 4);  // 跨越第 256 行的索引点
+  EXPECT_EQ(page["text"], "line 255\nline 256\nline 257\nline 258\n");
+  EXPECT_EQ(page["end_line"], 258);
+  EXPECT_EQ(page["next_line"], 259);
+
+  auto last = store.fetchLines(handle, 999, 100);
+  EXPECT_EQ(last["text"], "line 999\nline 1000\n");
+  EXPECT_FALSE(last.contains("next_line"));
+
+  // 单次读取受行数上限约束
+  auto capped = store.fetchLines(handle, 1, 100000);
+  EXPECT_EQ(capped["end_line"], ToolResultStore::kMaxFetchLines);
+
+  EXPECT_TRUE(store.fetchLines(handle, 1001, 1).contains("error"));
+  EXPECT_TRUE(store.fetchLines("r99", 1, 1).contains("error"));
+}
+
+TEST(ToolResultStore, AlignsByteRangesToUtf8) {
+  ToolResultStore store(testBaseDir().string());
+  const std::string text = "ab\xe4\xbd\xa0\xe5\xa5\xbd" "cd";  // "ab你好cd"
+  const std::string handle = store.store("read_code_block", text);
+
+  // 从 "你" 的第二个字节开始、在 "好" 中间结束：对齐后只剩完整字符
+  auto page = store.fetchBytes(handle, 3, 4);
+  EXPECT_EQ(page["offset"], 5);
+  EXPECT_EQ(page["text"], "");
+  auto whole = store.fetchBytes(handle, 2, 6);
+  EXPECT_EQ(whole["text"], "\xe4\xbd\xa0\xe5\xa5\xbd");
+  EXPECT_EQ(whole["next_offset"], 8);
+}
+
+TEST(ToolResultStore, EvictsOldestBeyondDiskBudgetAndCleansUp) {
+  ToolResultStore::Options options;
+  options.maxTotalBytes = 5000;
+  fs::path sessionDir;
+  {
+    ToolResultStore store(testBaseDir().string(), options);
+    sessionDir = store.getSessionDir();
+    const std::string r1 = store.store("grep", std::string(3000, 'a'));
+    const std::string r2 = store.store("grep", std::string(3000, 'b'));
+    EXPECT_TRUE(store.fetchBytes(r1, 0, 10).contains("error"));
+    EXPECT_EQ(store.fetchBytes(r2, 0, 3)["text"], "bbb");
+    EXPECT_EQ(store.getStats().evicted, 1u);
+    EXPECT_EQ(store.getStats().bytesOnDisk, 3000u);
+
+    FetchResultTool tool(std::shared_ptr<ToolResultStore>(&store, [](ToolResultStore*) {}));
+    auto result = tool.execute({{"handle", r2}, {"offset", 2990}});
+    ASSERT_TRUE(result.contains("content"));
+    EXPECT_EQ(result["content"][0]["text"], "[r2 bytes 2990-3000 of 3000]\nbbbbbbbbbb");
+    EXPECT_TRUE(tool.execute({{"handle", r1}}).contains("error"));
+    EXPECT_TRUE(fs::exists(sessionDir));
+  }
+  EXPECT_FALSE(fs::exists(sessionDir));
+}
+
+TEST(ToolResultStore, KeepsLiveSessionsWhenCleaningStaleOnes) {
+  const fs::path base = testBaseDir();
+  const auto old = fs::file_time_type::clock::now() - std::chrono::hours(48);
+  // 异常退出遗留的会话：没有存活的 owner
+  fs::path orphan = base / "session-orphan";
+  fs::create_directories(orphan);
+  fs::last_write_time(orphan, old);
+
+  ToolResultStore live(base.string());
+  const std::string handle = live.store("grep", numberedLines(10));
+  ASSERT_FALSE(handle.empty());
+  // 长时间运行、超过 24 小时未写入的会话仍然属于存活进程
+  fs::last_write_time(live.getSessionDir(), old);
+
+  ToolResultStore other(base.string());
+  EXPECT_FALSE(fs::exists(orphan));
+  EXPECT_TRUE(fs::exists(live.getSessionDir()));
+  EXPECT_EQ(live.fetchLines(handle, 1, 1)["text"], "line 1\n");
+  // 读取刷新目录 mtime
+  EXPECT_GT(fs::last_write_time(live.getSessionDir()), old + std::chrono::hours(24));
+}
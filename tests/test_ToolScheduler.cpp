@@ -0,0 +1,169 @@
+/**
+ * ToolScheduler 单元测试：副作用冲突规则、只读调用并发执行、写同一路径的调用保持顺序、
+ * 结果按调用顺序返回，提前执行的结果仅在没有更早的冲突调用时采用，以及核心工具按参数声明的读写路径。
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tools/CoreTools.h"
+#include "tools/ToolRegistry.h"
+#include "tools/ToolScheduler.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 等到 n 个调用同时在执行（超时返回 false：说明被串行化了）
+class Rendezvous {
+public:
+  explicit Rendezvous(int n) : expected(n) {}
+  bool arriveAndWait() {
+    arrived++;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (arrived.load() < expected) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+private:
+  int expected;
+  std::atomic<int> arrived{0};
+};
+
+}  // namespace
+
+TEST(ToolScheduler, ConflictRules) {
+  auto read = [](std::vector<std::string> p) { return ToolEffects::readOnly(std::move(p)); };
+  auto write = [](std::vector<std::string> p) { return ToolEffects::writes(std::move(p)); };
+
+  EXPECT_FALSE(ToolScheduler::conflicts(read({"/p/a.cpp"}), read({"/p/a.cpp"})));
+  EXPECT_FALSE(ToolScheduler::conflicts(read({}), read({"/p"})));
+  EXPECT_TRUE(ToolScheduler::conflicts(read({"/p/a.cpp"}), write({"/p/a.cpp"})));
+  EXPECT_FALSE(ToolScheduler::conflicts(read({"/p/a.cpp"}), write({"/p/b.cpp"})));
+  // 目录包含文件；前缀相同但不是父目录的不算重叠
+  EXPECT_TRUE(ToolScheduler::conflicts(read({"/p/src"}), write({"/p/src/x.h"})));
+  EXPECT_FALSE(ToolScheduler::conflicts(read({"/p/src"}), write({"/p/src2/x.h"})));
+  // 路径未知的写入与一切读写冲突；Process 与任何调用冲突
+  EXPECT_TRUE(ToolScheduler::conflicts(read({"/p/a.cpp"}), write({})));
+  EXPECT_TRUE(ToolScheduler::conflicts(read({"/p/a.cpp"}), ToolEffects::process()));
+}
+
+TEST(ToolScheduler, RunsReadOnlyCallsConcurrently) {
+  ToolScheduler scheduler(4);
+  Rendezvous all(4);
+  std::vector<ToolScheduler::Call> calls;
+  for (int i = 0; i < 4; ++i) {
+    calls.push_back({ToolEffects::readOnly({"/p/f" + std::to_string(i)}), [&all, i] {
+                       return nlohmann::json{{"index", i}, {"together", all.arriveAndWait()}};
+                     }, nullptr});
+  }
+  auto results = scheduler.runBatch(std::move(calls));
+  ASSERT_EQ(results.size(), 4u);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(results[i]["index"], i);
+    EXPECT_TRUE(results[i]["together"].get<bool>());
+  }
+  EXPECT_EQ(scheduler.getStats().maxConcurrent, 4u);
+}
+
+TEST(ToolScheduler, SerializesConflictingCallsInOrder) {
+  ToolScheduler scheduler(4);
+  std::mutex mtx;
+  std::vector<std::string> trace;
+  auto step = [&](std::string name, int sleepMs) {
+    return [&, name, sleepMs] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+      std::lock_guard<std::mutex> lock(mtx);
+      trace.push_back(name);
+      return nlohmann::json{{"name", name}};
+    };
+  };
+  std::vector<ToolScheduler::Call> calls;
+  calls.push_back({ToolEffects::readOnly({"/p/a.cpp"}), step("read-a", 40), nullptr});
+  calls.push_back({ToolEffects::writes({"/p/a.cpp"}), step("write-a", 0), nullptr});
+  calls.push_back({ToolEffects::readOnly({"/p/a.cpp"}), step("reread-a", 0), nullptr});
+  calls.push_back({ToolEffects::readOnly({"/p/b.cpp"}), step("read-b", 0), nullptr});
+  calls.push_back({ToolEffects::process(), [] () -> nlohmann::json { throw std::runtime_error("boom"); }, nullptr});
+
+  auto results = scheduler.runBatch(std::move(calls));
+  ASSERT_EQ(results.size(), 5u);
+  EXPECT_EQ(results[0]["name"], "read-a");
+  EXPECT_EQ(results[3]["name"], "read-b");
+  EXPECT_EQ(results[4]["error"], "Tool execution failed: boom");
+
+  // read-b 不依赖 a.cpp，先于慢的 read-a 完成；对 a.cpp 的读写保持模型给出的顺序
+  auto at = [&](const std::string& name) { return std::find(trace.begin(), trace.end(), name) - trace.begin(); };
+  EXPECT_LT(at("read-b"), at("read-a"));
+  EXPECT_LT(at("read-a"), at("write-a"));
+  EXPECT_LT(at("write-a"), at("reread-a"));
+}
+
+TEST(ToolScheduler, DiscardsEarlyResultAfterConflictingWrite) {
+  fs::path root = fs::temp_directory_path() / "photon_test_scheduler_early";
+  fs::create_directories(root);
+  fs::path file = root / "a.txt";
+  { std::ofstream(file) << "before"; }
+  auto readFile = [file] {
+    std::ifstream in(file);
+    return nlohmann::json{{"text", std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>())}};
+  };
+  // 流式阶段提前执行的读取：早于本批中的写入，拿到的是旧内容
+  nlohmann::json staleRead = readFile();
+  nlohmann::json staleOther = nlohmann::json{{"text", "other"}};
+
+  ToolScheduler scheduler(4);
+  std::vector<ToolScheduler::Call> calls;
+  calls.push_back({ToolEffects::writes({file.generic_string()}), [file] {
+                     std::ofstream(file) << "after";
+                     return nlohmann::json{{"ok", true}};
+                   }, nullptr});
+  calls.push_back({ToolEffects::readOnly({file.generic_string()}), readFile, [staleRead] { return staleRead; }});
+  calls.push_back({ToolEffects::readOnly({(root / "b.txt").generic_string()}),
+                   [] { return nlohmann::json{{"text", "executed"}}; }, [staleOther] { return staleOther; }});
+
+  auto results = scheduler.runBatch(std::move(calls));
+  ASSERT_EQ(results.size(), 3u);
+  EXPECT_EQ(results[1]["text"], "after");
+  // 不受写入影响的提前结果照常采用
+  EXPECT_EQ(results[2]["text"], "other");
+  EXPECT_EQ(scheduler.getStats().earlyUsed, 1u);
+  EXPECT_EQ(scheduler.getStats().earlyDiscarded, 1u);
+  fs::remove_all(root);
+}
+
+TEST(ToolScheduler, CoreToolsDeclareEffects) {
+  fs::path root = fs::temp_directory_path() / "photon_test_scheduler";
+  fs::create_directories(root);
+  ToolRegistry registry;
+  registry.registerTool(std::make_unique<ReadCodeBlockTool>(root.string()));
+  registry.registerTool(std::make_unique<WriteTool>(root.string()));
+  registry.registerTool(std::make_unique<ApplyPatchTool>(root.string()));
+  registry.registerTool(std::make_unique<RunCommandTool>(root.string()));
+
+  auto readA = registry.getToolEffects("read_code_block", {{"file_path", "src/a.cpp"}, {"start_line", 1}});
+  auto writeA = registry.getToolEffects("write", {{"path", "./src/../src/a.cpp"}, {"content", "x"}});
+  auto patchB = registry.getToolEffects("apply_patch", {{"files", {{{"path", "src/b.cpp"}, {"content", "y"}}}}});
+  auto patchC = registry.getToolEffects("apply_patch", {{"files", {{{"path", "src/c.cpp"}, {"content", "z"}}}}});
+
+  EXPECT_EQ(readA.kind, ToolEffects::Kind::ReadOnly);
+  EXPECT_EQ(writeA.kind, ToolEffects::Kind::WritesPaths);
+  EXPECT_TRUE(ToolScheduler::conflicts(readA, writeA));
+  EXPECT_FALSE(ToolScheduler::conflicts(readA, patchB));
+  // 两次 apply_patch 共用备份目录，总是串行
+  EXPECT_TRUE(ToolScheduler::conflicts(patchB, patchC));
+  EXPECT_EQ(registry.getToolEffects("run_command", {{"command", "ls"}}).kind, ToolEffects::Kind::Process);
+  EXPECT_EQ(registry.getToolEffects("mcp_tool", nlohmann::json::object()).kind, ToolEffects::Kind::Process);
+}
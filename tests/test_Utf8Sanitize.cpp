@@ -0,0 +1,102 @@
+/**
+ * UTF8Utils::sanitize 快速路径单元测试：随机输入（ASCII、合法多字节字符、截断 / 过长编码 / 代理区 /
+ * 孤立续字节与随机字节混合）下输出与逐字节的 sanitizeScalar 完全一致；各向量实现的合法前缀与标量实现一致，
+ * 非法字节恰好落在块边界前后时也不例外。
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tools/CoreTools.h"
+#include "utils/Utf8Validate.h"
+
+using UTF8Utils::Utf8Impl;
+
+namespace {
+
+// 按权重拼接各类片段，使非法序列稀疏地出现在较长的合法段之间
+std::string randomText(std::mt19937& rng, size_t maxLen) {
+  static const std::vector<std::string> kValid = {
+      "a", "int x = 0;\n", "\xC3\xA9", "\xDF\xBF", "\xE4\xB8\xAD\xE6\x96\x87", "\xE0\xA0\x80", "\xED\x9F\xBF",
+      "\xEF\xBF\xBD", "\xF0\x9F\x98\x80", "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF"};
+  static const std::vector<std::string> kInvalid = {
+      "\x80", "\xBF", "\xC0\xAF", "\xC1\xBF", "\xC3", "\xE4\xB8", "\xE0\x80\xAF", "\xE0\x9F\xBF",
+      "\xED\xA0\x80", "\xED\xBF\xBF", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80",
+      "\xFF", "\xF0\x9F\x98", "\xC3\xC3", "\xE4\x41\x42"};
+  std::uniform_int_distribution<size_t> lenDist(0, maxLen);
+  std::uniform_int_distribution<int> kind(0, 99);
+  std::uniform_int_distribution<int> byteDist(0, 255);
+  const size_t len = lenDist(rng);
+  std::string out;
+  while (out.size() < len) {
+    int k = kind(rng);
+    if (k < 60) {
+      out += kValid[rng() % kValid.size()];
+    } else if (k < 80) {
+      out.append(1 + rng() % 40, static_cast<char>('a' + rng() % 26));
+    } else if (k < 92) {
+      out += kInvalid[rng() % kInvalid.size()];
+    } else {
+      out.push_back(static_cast<char>(byteDist(rng)));
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(Utf8Sanitize, MatchesScalarOnRandomInput) {
+  std::mt19937 rng(20261018);
+  for (int iter = 0; iter < 20000; ++iter) {
+    std::string input = randomText(rng, iter % 10 == 0 ? 2000 : 200);
+    ASSERT_EQ(UTF8Utils::sanitize(input), UTF8Utils::sanitizeScalar(input)) << "iteration " << iter;
+  }
+}
+
+TEST(Utf8Sanitize, MatchesScalarOnUniformBytes) {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> byteDist(0, 255);
+  for (int iter = 0; iter < 5000; ++iter) {
+    std::string input(rng() % 300, '\0');
+    for (auto& ch : input) ch = static_cast<char>(byteDist(rng));
+    ASSERT_EQ(UTF8Utils::sanitize(input), UTF8Utils::sanitizeScalar(input)) << "iteration " << iter;
+  }
+}
+
+TEST(Utf8Sanitize, ValidPrefixAgreesAcrossImplementations) {
+  std::mt19937 rng(99);
+  const Utf8Impl impls[] = {Utf8Impl::SSSE3, Utf8Impl::AVX2};
+  for (int iter = 0; iter < 20000; ++iter) {
+    std::string input = randomText(rng, 300);
+    size_t expected = UTF8Utils::utf8ValidPrefix(input.data(), input.size(), Utf8Impl::Scalar);
+    for (Utf8Impl impl : impls) {
+      if (!UTF8Utils::utf8ImplSupported(impl)) continue;
+      ASSERT_EQ(UTF8Utils::utf8ValidPrefix(input.data(), input.size(), impl), expected)
+          << UTF8Utils::utf8ImplName(impl) << " iteration " << iter;
+    }
+  }
+}
+
+TEST(Utf8Sanitize, InvalidBytesAroundBlockBoundaries) {
+  const std::vector<std::string> bad = {"\xFF", "\xE4\xB8", "\xED\xA0\x80", "\xF0\x9F\x98", "\xC0\x80", "\x80"};
+  for (size_t pos = 0; pos < 140; ++pos) {
+    for (const auto& b : bad) {
+      // 前后为中文，使多字节字符跨越 16/32/64 字节边界
+      std::string input;
+      while (input.size() < pos) input += input.size() % 2 ? "\xE4\xB8\xAD" : "x";
+      input += b;
+      for (int k = 0; k < 30; ++k) input += "\xE6\x96\x87y";
+      ASSERT_EQ(UTF8Utils::sanitize(input), UTF8Utils::sanitizeScalar(input)) << "pos " << pos;
+      for (size_t cut = input.size() - 8; cut < input.size(); ++cut) {
+        std::string truncated = input.substr(0, cut);
+        ASSERT_EQ(UTF8Utils::sanitize(truncated), UTF8Utils::sanitizeScalar(truncated));
+      }
+    }
+  }
+  std::string ascii(1000, 'q');
+  EXPECT_EQ(UTF8Utils::sanitize(ascii), ascii);
+  EXPECT_EQ(UTF8Utils::utf8ValidPrefix(ascii.data(), ascii.size()), ascii.size());
+}